@@ -0,0 +1,336 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  EventDispatcherTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+static void *const kTestSinkQueueKey = (void *)&kTestSinkQueueKey;
+
+// Records the events it gets, called on its own queue
+@interface TestEventSink : NSObject<CKTEventSink>
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableArray<NSString *> *received;  // "<method> <id>"
+@property (nonatomic, assign) NSUInteger wrongQueue;
+@property (nonatomic, assign) NSUInteger expected;
+@property (nonatomic, strong) dispatch_semaphore_t done;
+
+@end
+
+@implementation TestEventSink
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("TestEventSink", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(_queue, kTestSinkQueueKey, kTestSinkQueueKey, NULL);
+        _received = [NSMutableArray array];
+        _done = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)record:(NSString *)method objectId:(NSString *)objectId
+{
+    if (dispatch_get_specific(kTestSinkQueueKey) != kTestSinkQueueKey) {
+        self.wrongQueue++;
+    }
+    [self.received addObject:[NSString stringWithFormat:@"%@ %@", method, objectId]];
+    if (self.received.count == self.expected) {
+        dispatch_semaphore_signal(self.done);
+    }
+}
+
+- (BOOL)waitForEvents:(NSUInteger)count
+{
+    __block BOOL arrived;
+    dispatch_sync(self.queue, ^{
+        self.expected = count;
+        arrived = self.received.count >= count;
+    });
+    return arrived || !dispatch_semaphore_wait(self.done, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+}
+
+- (NSArray<NSString *> *)events
+{
+    __block NSArray *events;
+    dispatch_sync(self.queue, ^{ events = [self.received copy]; });
+    return events;
+}
+
+- (void)callIncoming:(NSDictionary *)event
+{
+    [self record:@"callIncoming" objectId:event[@"call"][@"callId"]];
+}
+
+- (void)callEnded:(NSDictionary *)event
+{
+    [self record:@"callEnded" objectId:event[@"call"][@"callId"]];
+}
+
+- (void)sessionExpires:(NSDictionary *)event
+{
+    [self record:@"sessionExpires" objectId:@"-"];
+}
+
+- (void)itemAdded:(NSDictionary *)event
+{
+    [self record:@"itemAdded" objectId:event[@"item"][@"itemId"]];
+}
+
+- (void)userPresenceChanged:(NSDictionary *)event
+{
+    [self record:@"userPresenceChanged" objectId:event[@"presenceState"][@"userId"]];
+}
+
+@end
+
+static NSDictionary *CKTTestCall(NSString *callId)
+{
+    return @{ @"call" : @{ @"callId" : callId, @"convId" : @"c1" } };
+}
+
+static NSDictionary *CKTTestItem(NSString *itemId)
+{
+    return @{ @"item" : @{ @"itemId" : itemId, @"convId" : @"c1" } };
+}
+
+static NSDictionary *CKTTestPresence(NSString *userId)
+{
+    return @{ @"presenceState" : @{ @"userId" : userId, @"state" : @"AVAILABLE" } };
+}
+
+@interface EventDispatcherTests : XCTestCase
+
+@property (nonatomic, strong) CKTEventDispatcher *dispatcher;
+@property (nonatomic, strong) TestEventSink *sink;
+
+@end
+
+@implementation EventDispatcherTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The JS engine is not started by the tests, the events are dispatched from the test thread instead
+    _dispatcher = [[CKTEventDispatcher alloc] init];
+    _dispatcher.postsNotifications = NO;
+    _sink = [[TestEventSink alloc] init];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    [_dispatcher removeSink:_sink];
+    _sink = nil;
+    _dispatcher = nil;
+}
+
+- (void)dispatch:(JSEvent)event name:(NSString *)name data:(NSDictionary *)data
+{
+    uint64_t now = CKTMonotonicMicroseconds();
+    [_dispatcher dispatchEvent:event name:name data:data received:now converted:now];
+}
+
+- (void)testSinkDelivery
+{
+    [_dispatcher addSink:_sink queue:_sink.queue];
+
+    [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:CKTTestItem(@"i1")];
+    [self dispatch:JSEventCallIncoming name:CKTNotificationCallIncoming data:CKTTestCall(@"call1")];
+
+    XCTAssert([_sink waitForEvents:2], @"Both events should be delivered.");
+    NSArray *expected = @[ @"itemAdded i1", @"callIncoming call1" ];
+    XCTAssertEqualObjects([_sink events], expected, @"The sink methods should get the event objects.");
+    XCTAssertEqual(_sink.wrongQueue, (NSUInteger)0, @"The sink should be called on its queue.");
+    XCTAssertEqualObjects([_dispatcher statistics][kCKTEventDispatcherDeliveries], @2, @"Unexpected deliveries.");
+}
+
+- (void)testOrder
+{
+    static const NSUInteger count = 1000;
+    [_dispatcher addSink:_sink queue:_sink.queue];
+
+    NSMutableArray *expected = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *objectId = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+        switch (i % 3) {
+            case 0:
+                [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:CKTTestItem(objectId)];
+                [expected addObject:[@"itemAdded " stringByAppendingString:objectId]];
+                break;
+            case 1:
+                [self dispatch:JSEventCallIncoming name:CKTNotificationCallIncoming data:CKTTestCall(objectId)];
+                [expected addObject:[@"callIncoming " stringByAppendingString:objectId]];
+                break;
+            default:
+                [self dispatch:JSEventUserPresenceChanged
+                          name:CKTNotificationUserPresenceChanged
+                          data:CKTTestPresence(objectId)];
+                [expected addObject:[@"userPresenceChanged " stringByAppendingString:objectId]];
+                break;
+        }
+    }
+
+    XCTAssert([_sink waitForEvents:count], @"All events should be delivered.");
+    XCTAssertEqualObjects([_sink events], expected, @"The events should be delivered in the order received.");
+}
+
+- (void)testUnobservedEvents
+{
+    XCTAssertFalse([_dispatcher isEventObserved:JSEventItemAdded], @"Nobody observes itemAdded yet.");
+
+    [_dispatcher addSink:_sink queue:_sink.queue];
+    XCTAssert([_dispatcher isEventObserved:JSEventItemAdded], @"The sink observes itemAdded.");
+    XCTAssertFalse([_dispatcher isEventObserved:JSEventItemUpdated], @"The sink does not implement itemUpdated.");
+
+    id observer = [_dispatcher addObserverForName:CKTNotificationItemUpdated
+                                            queue:nil
+                                       usingBlock:^(NSNotification *notification){
+                                       }];
+    XCTAssert([_dispatcher isEventObserved:JSEventItemUpdated], @"An observer was added for itemUpdated.");
+    [_dispatcher removeObserver:observer name:nil];
+    XCTAssertFalse([_dispatcher isEventObserved:JSEventItemUpdated], @"The observer was removed.");
+
+    [_dispatcher removeSink:_sink];
+    XCTAssertFalse([_dispatcher isEventObserved:JSEventItemAdded], @"The sink was removed.");
+
+    // What the PubSubService does instead of converting the event
+    [_dispatcher skipEvent:JSEventItemAdded];
+    NSDictionary *statistics = [_dispatcher statistics];
+    XCTAssertEqualObjects(statistics[kCKTEventDispatcherReceived], @1, @"The skipped event was received.");
+    XCTAssertEqualObjects(statistics[kCKTEventDispatcherSkipped], @1, @"The event should count as skipped.");
+    XCTAssertEqualObjects(statistics[kCKTEventDispatcherObservedEvents], @[], @"No event should be observed.");
+
+    _dispatcher.postsNotifications = YES;
+    XCTAssert([_dispatcher isEventObserved:JSEventItemAdded], @"Posting all notifications observes every event.");
+}
+
+- (void)testFullBufferKeepsCallEvents
+{
+    [_dispatcher addSink:_sink queue:_sink.queue capacity:2 overflowPolicy:CKTEventOverflowPolicyDropOldest];
+
+    // Nothing is delivered until the queue resumes, so the buffer fills up
+    dispatch_suspend(_sink.queue);
+    [self dispatch:JSEventUserPresenceChanged name:CKTNotificationUserPresenceChanged data:CKTTestPresence(@"u1")];
+    [self dispatch:JSEventCallIncoming name:CKTNotificationCallIncoming data:CKTTestCall(@"call1")];
+    [self dispatch:JSEventCallEnded name:CKTNotificationCallEnded data:CKTTestCall(@"call1")];
+    [self dispatch:JSEventSessionExpires name:CKTNotificationSessionExpires data:@{}];
+    dispatch_resume(_sink.queue);
+
+    XCTAssert([_sink waitForEvents:3], @"The call and session events should be delivered.");
+    NSArray *expected = @[ @"callIncoming call1", @"callEnded call1", @"sessionExpires -" ];
+    XCTAssertEqualObjects([_sink events], expected, @"Only the presence update should give way.");
+
+    NSDictionary *statistics = [_dispatcher statistics];
+    XCTAssertEqualObjects(statistics[kCKTEventDispatcherDropped], @1, @"One update should be dropped.");
+    XCTAssertEqualObjects(statistics[kCKTEventDispatcherMaxBacklog], @3, @"The buffer should exceed its capacity.");
+}
+
+- (void)testFullBufferCoalescesUpdates
+{
+    [_dispatcher addSink:_sink queue:_sink.queue capacity:2 overflowPolicy:CKTEventOverflowPolicyCoalesce];
+
+    dispatch_suspend(_sink.queue);
+    [self dispatch:JSEventUserPresenceChanged name:CKTNotificationUserPresenceChanged data:CKTTestPresence(@"u1")];
+    [self dispatch:JSEventUserPresenceChanged name:CKTNotificationUserPresenceChanged data:CKTTestPresence(@"u2")];
+    [self dispatch:JSEventUserPresenceChanged name:CKTNotificationUserPresenceChanged data:CKTTestPresence(@"u1")];
+    dispatch_resume(_sink.queue);
+
+    XCTAssert([_sink waitForEvents:2], @"The merged events should be delivered.");
+    NSArray *expected = @[ @"userPresenceChanged u2", @"userPresenceChanged u1" ];
+    XCTAssertEqualObjects([_sink events], expected, @"The newer update of u1 should take its own place.");
+    XCTAssertEqualObjects([_dispatcher statistics][kCKTEventDispatcherOverflowMerged], @1, @"One merge expected.");
+}
+
+- (void)testSinkGoingAway
+{
+    @autoreleasepool {
+        TestEventSink *sink = [[TestEventSink alloc] init];
+        [_dispatcher addSink:sink queue:sink.queue];
+        XCTAssert([_dispatcher isEventObserved:JSEventItemAdded], @"The sink observes itemAdded.");
+        sink = nil;
+    }
+
+    // Delivering to a sink which was released is a no-op
+    [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:CKTTestItem(@"i1")];
+    [_dispatcher addSink:_sink queue:_sink.queue];
+    [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:CKTTestItem(@"i2")];
+    XCTAssert([_sink waitForEvents:1], @"The event should be delivered.");
+    XCTAssertEqualObjects([_sink events], @[ @"itemAdded i2" ], @"Only the event after adding should arrive.");
+}
+
+// Cost of dispatching on the JS thread, plus the time until the sink got every event
+- (void)testDispatchPerformance
+{
+    static const NSUInteger count = 10000;
+    NSMutableArray *events = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [events addObject:CKTTestItem([NSString stringWithFormat:@"%lu", (unsigned long)i])];
+    }
+
+    [self measureBlock:^{
+        TestEventSink *sink = [[TestEventSink alloc] init];
+        [self.dispatcher addSink:sink queue:sink.queue];
+        for (NSDictionary *event in events) {
+            [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:event];
+        }
+        XCTAssert([sink waitForEvents:count], @"All events should be delivered.");
+        [self.dispatcher removeSink:sink];
+    }];
+
+    NSDictionary *latency = [_dispatcher statistics][kCKTEventDispatcherLatency];
+    NSLog(@"Sink latency: p50 %@ us, p99 %@ us", latency[kCKTHistogramP50], latency[kCKTHistogramP99]);
+}
+
+// Main thread time of the notifications, which a sink on its own queue does not cost
+- (void)testNotificationMainThreadPerformance
+{
+    static const NSUInteger count = 2000;
+    _dispatcher.postsNotifications = YES;
+    __block NSUInteger received = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:CKTNotificationItemAdded
+                                                                    object:nil
+                                                                     queue:nil
+                                                                usingBlock:^(NSNotification *notification) {
+                                                                    received++;
+                                                                }];
+
+    [self measureBlock:^{
+        received = 0;
+        for (NSUInteger i = 0; i < count; i++) {
+            [self dispatch:JSEventItemAdded name:CKTNotificationItemAdded data:CKTTestItem(@"i1")];
+        }
+        NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:10];
+        while (received < count && [deadline timeIntervalSinceNow] > 0) {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
+                                     beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+        }
+        XCTAssertEqual(received, count, @"All notifications should be posted.");
+    }];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+
+    NSDictionary *mainThreadTime = [_dispatcher statistics][kCKTEventDispatcherMainThreadTime];
+    NSLog(@"Main thread time per notification: mean %@ us, p99 %@ us", mainThreadTime[kCKTHistogramMean],
+          mainThreadTime[kCKTHistogramP99]);
+}
+
+@end
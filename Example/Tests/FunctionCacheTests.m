@@ -0,0 +1,101 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  FunctionCacheTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+// Lookups per measured block
+static const NSUInteger kLookups = 100000;
+
+@interface FunctionCacheTests : XCTestCase
+
+@property (nonatomic, strong) JSContext *context;
+@property (nonatomic, strong) JSFunctionCache *cache;
+
+@end
+
+@implementation FunctionCacheTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The JS engine is not started by the tests, the functions are not owned by its VM but stay reachable through
+    // sdkClient
+    _context = [[JSContext alloc] init];
+    [_context evaluateScript:@"var sdkClient = { version: '1.0', getConversations: function () { return 1; },"
+                              "getUserById: function (userId) { return userId; } };"];
+    _cache = [[JSFunctionCache alloc] initWithContext:_context];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    [_cache removeAllFunctions];
+    _cache = nil;
+    _context = nil;
+}
+
+- (void)testLookup
+{
+    JSValue *function = [_cache functionNamed:@"getUserById"];
+    XCTAssertEqualObjects([[function callWithArguments:@[ @"u1" ]] toString], @"u1", @"The function should be found.");
+    XCTAssert([[_cache functionNamed:@"getUserById"] isEqualToObject:function], @"The cached function is expected.");
+
+    XCTAssertFalse([[_cache functionNamed:@"version"] isObject], @"A property is returned but not cached.");
+    XCTAssert([[_cache functionNamed:@"unknown"] isUndefined], @"An unknown function is undefined.");
+
+    NSDictionary *statistics = [_cache statistics];
+    XCTAssertEqualObjects(statistics[kJSFunctionCacheHits], @1, @"Unexpected number of hits.");
+    XCTAssertEqualObjects(statistics[kJSFunctionCacheMisses], @3, @"Unexpected number of misses.");
+    XCTAssertEqualObjects(statistics[kJSFunctionCacheSize], @1, @"Only the function should be cached.");
+}
+
+- (void)testCachedLookupPerformance
+{
+    [_cache functionNamed:@"getConversations"];
+
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < kLookups; i++) {
+            @autoreleasepool
+            {
+                [self.cache functionNamed:@"getConversations"];
+            }
+        }
+    }];
+
+    NSLog(@"Cached lookups: %@", [_cache statistics]);
+}
+
+// Baseline for the above, the lookup each API call did before the cache
+- (void)testBridgeLookupPerformance
+{
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < kLookups; i++) {
+            @autoreleasepool
+            {
+                JSValue *sdkClient = self.context[@"sdkClient"];
+                (void)sdkClient[@"getConversations"];
+            }
+        }
+    }];
+}
+
+@end
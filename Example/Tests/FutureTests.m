@@ -0,0 +1,177 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  FutureTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+@interface FutureTests : XCTestCase
+
+@property (nonatomic, strong) dispatch_queue_t deliveryQueue;
+
+@end
+
+@implementation FutureTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The JS engine is not started by the tests, completions are delivered on this queue
+    _deliveryQueue = dispatch_queue_create("FutureTests", DISPATCH_QUEUE_SERIAL);
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    _deliveryQueue = nil;
+}
+
+// Waits until the blocks already queued to the delivery queue have run
+- (void)drainDeliveryQueue
+{
+    dispatch_sync(_deliveryQueue, ^{
+    });
+}
+
+- (void)testCompletionIsDelivered
+{
+    CKTFuture *future = [CKTFuture futureWithTimeout:0 deliveryQueue:_deliveryQueue];
+    XCTestExpectation *delivered = [self expectationWithDescription:@"delivered"];
+
+    CKTFutureCompletion completion = [future completionForCompletion:^(id data, NSError *error) {
+        XCTAssertEqualObjects(data, @"result", @"The result should be passed on.");
+        XCTAssertNil(error, @"No error was expected.");
+        [delivered fulfill];
+    }];
+    XCTAssertNotNil(completion, @"The request should be sent.");
+    XCTAssertFalse(future.finished, @"A completion is pending.");
+
+    completion(@"result", nil);
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+    XCTAssert(future.finished, @"All completions have been called.");
+}
+
+- (void)testCancel
+{
+    CKTFuture *future = [CKTFuture futureWithTimeout:0 deliveryQueue:_deliveryQueue];
+    __block NSUInteger calls = 0;
+
+    CKTFutureCompletion completion = [future completionForCompletion:^(id data, NSError *error) { calls++; }];
+    [future cancel];
+    XCTAssert(future.cancelled, @"The future should be cancelled.");
+    XCTAssert(future.finished, @"A cancelled future is finished.");
+
+    completion(@"result", nil);
+    XCTAssertNil([future completionForCompletion:^(id data, NSError *error) { calls++; }],
+                 @"Requests made after cancel must not be sent.");
+    [self drainDeliveryQueue];
+    XCTAssertEqual(calls, (NSUInteger)0, @"No completion should be called after cancel.");
+}
+
+- (void)testTimeout
+{
+    __block CKTFutureCompletion completion;
+    __block NSUInteger calls = 0;
+    XCTestExpectation *timedOut = [self expectationWithDescription:@"timed out"];
+
+    CKTFuture *future = [[CKTFuture futureWithTimeout:0.05 deliveryQueue:_deliveryQueue] run:^{
+        completion = [[CKTFuture currentFuture] completionForCompletion:^(id data, NSError *error) {
+            calls++;
+            XCTAssertEqualObjects(error.domain, @"CircuitKit", @"Unexpected error domain.");
+            XCTAssertEqual(error.code, CKTFutureErrorTimedOut, @"The timeout error was expected.");
+            [timedOut fulfill];
+        }];
+    }];
+    XCTAssertNotNil(completion, @"The request should be sent before the deadline.");
+
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+    XCTAssert(future.timedOut, @"The future should be timed out.");
+    XCTAssert(future.finished, @"A timed out future is finished.");
+
+    // The response arriving late is dropped
+    completion(@"result", nil);
+    [self drainDeliveryQueue];
+    XCTAssertEqual(calls, (NSUInteger)1, @"The completion should only be called with the timeout.");
+}
+
+- (void)testRequestAfterTimeout
+{
+    CKTFuture *future = [[CKTFuture futureWithTimeout:0.01 deliveryQueue:_deliveryQueue] run:^{
+    }];
+    XCTestExpectation *timedOut = [self expectationForPredicate:[NSPredicate predicateWithFormat:@"timedOut == YES"]
+                                            evaluatedWithObject:future
+                                                        handler:nil];
+    [self waitForExpectations:@[ timedOut ] timeout:1];
+
+    __block NSUInteger calls = 0;
+    __block NSError *error;
+    CKTFutureCompletion completion = [future completionForCompletion:^(id data, NSError *timeoutError) {
+        calls++;
+        error = timeoutError;
+    }];
+    XCTAssertNil(completion, @"Requests made after the deadline must not be sent.");
+
+    [self drainDeliveryQueue];
+    XCTAssertEqual(calls, (NSUInteger)1, @"The timeout should be delivered once.");
+    XCTAssertEqual(error.code, CKTFutureErrorTimedOut, @"The timeout error was expected.");
+}
+
+// Requests are added while the deadline passes on another thread, each completion gets exactly one call
+- (void)testTimeoutRacingWithRequest
+{
+    static const NSUInteger iterations = 500;
+    NSMutableArray<CKTFuture *> *futures = [NSMutableArray arrayWithCapacity:iterations];
+    NSMutableArray<NSNumber *> *calls = [NSMutableArray arrayWithCapacity:iterations];
+    for (NSUInteger i = 0; i < iterations; i++) {
+        [calls addObject:@0];
+    }
+    dispatch_group_t group = dispatch_group_create();
+
+    for (NSUInteger i = 0; i < iterations; i++) {
+        dispatch_group_enter(group);
+
+        CKTFuture *future = [[CKTFuture futureWithTimeout:0.001 deliveryQueue:_deliveryQueue] run:^{
+        }];
+        [futures addObject:future];
+
+        usleep((useconds_t)(i % 5) * 250);
+        [future completionForCompletion:^(id data, NSError *error) {
+            // Called on the serial delivery queue
+            NSUInteger count = calls[i].unsignedIntegerValue + 1;
+            calls[i] = @(count);
+            if (count == 1) {
+                dispatch_group_leave(group);
+            }
+        }];
+    }
+
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0L,
+                   @"Every completion should be called.");
+
+    // Leave time for a second delivery to show up
+    usleep(50000);
+    [self drainDeliveryQueue];
+    for (NSUInteger i = 0; i < iterations; i++) {
+        XCTAssertEqual(calls[i].unsignedIntegerValue, (NSUInteger)1, @"Completion %lu was called more than once.",
+                       (unsigned long)i);
+    }
+}
+
+@end
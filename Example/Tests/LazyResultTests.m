@@ -0,0 +1,182 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  LazyResultTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+#import <mach/mach.h>
+
+// Conversations in the large feed, each with participants and a few items
+static const NSUInteger kFeedSize = 2000;
+
+// Physical footprint of the app in bytes
+static uint64_t CKTTestFootprint(void)
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.phys_footprint;
+}
+
+@interface LazyResultTests : XCTestCase
+
+@property (nonatomic, strong) JSContext *context;
+
+@end
+
+@implementation LazyResultTests
+
+- (void)setUp
+{
+    [super setUp];
+    _context = [[JSContext alloc] init];
+    [_context evaluateScript:
+                  @"function makeFeed(size) {"
+                   "    var feed = [];"
+                   "    for (var i = 0; i < size; i++) {"
+                   "        var participants = [];"
+                   "        for (var p = 0; p < 20; p++) {"
+                   "            participants.push({ userId: 'user' + p, displayName: 'User ' + p, roles: ['A'] });"
+                   "        }"
+                   "        feed.push({ convId: 'conv' + i, topic: 'Conversation topic ' + i, type: 'GROUP',"
+                   "                    creationTime: 1500000000000 + i, participants: participants,"
+                   "                    items: [{ itemId: 'item' + i, text: { content: 'Hello '.repeat(20) } }],"
+                   "                    notify: function () {}, unset: undefined });"
+                   "    }"
+                   "    return feed;"
+                   "}"];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    _context = nil;
+}
+
+- (void)testKeys
+{
+    NSArray *globals = [[_context evaluateScript:@"Object.keys(this)"] toArray];
+    JSValue *value = [_context evaluateScript:@"({ a: 1, b: null, c: undefined, d: function () {}, e: [] })"];
+    CKTLazyDictionary *dictionary = [[CKTLazyDictionary alloc] initWithValue:value];
+
+    NSArray *keys = [dictionary.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    NSArray *expected = @[ @"a", @"b", @"e" ];
+    XCTAssertEqualObjects(keys, expected, @"Undefined fields and functions should be left out, like toObject does.");
+    XCTAssertEqualObjects([[_context evaluateScript:@"Object.keys(this)"] toArray], globals,
+                          @"Enumerating the keys must not add globals to the context.");
+}
+
+- (void)testLiveUntilFrozen
+{
+    JSValue *value = [_context evaluateScript:@"var conversation = { topic: 'old', participants: ['u1'] };"
+                                                "conversation"];
+    CKTLazyDictionary *dictionary = [[CKTLazyDictionary alloc] initWithValue:value];
+    XCTAssertEqualObjects(dictionary[@"topic"], @"old", @"The field should be converted.");
+
+    [_context evaluateScript:@"conversation.topic = 'new'; conversation.participants.push('u2');"];
+    XCTAssertEqualObjects(dictionary[@"topic"], @"old", @"A converted field keeps its value.");
+    XCTAssertEqual([dictionary[@"participants"] count], (NSUInteger)2, @"A field not read yet is read live.");
+
+    [dictionary freeze];
+    XCTAssert(dictionary.frozen, @"The view should be frozen.");
+    [_context evaluateScript:@"conversation.type = 'DIRECT';"];
+    XCTAssertNil(dictionary[@"type"], @"A frozen view is a snapshot.");
+    XCTAssertEqual(dictionary.count, (NSUInteger)2, @"A frozen view keeps its keys.");
+}
+
+- (void)testEagerConversionPerformance
+{
+    JSValue *feed = [_context[@"makeFeed"] callWithArguments:@[ @(kFeedSize) ]];
+
+    [self measureBlock:^{
+        @autoreleasepool
+        {
+            NSArray *conversations = [feed toObject];
+            XCTAssertEqual(conversations.count, kFeedSize, @"Every conversation should be converted.");
+        }
+    }];
+}
+
+// Conversion of the list and of the one field of each conversation a list view shows
+- (void)testLazyConversionPerformance
+{
+    JSValue *feed = [_context[@"makeFeed"] callWithArguments:@[ @(kFeedSize) ]];
+
+    [self measureBlock:^{
+        @autoreleasepool
+        {
+            CKTLazyArray *conversations = [[CKTLazyArray alloc] initWithValue:feed];
+            for (NSDictionary *conversation in conversations) {
+                XCTAssertNotNil(conversation[@"topic"], @"The topic should be converted.");
+            }
+        }
+    }];
+}
+
+- (void)testPeakMemory
+{
+    JSValue *feed = [_context[@"makeFeed"] callWithArguments:@[ @(kFeedSize) ]];
+
+    // Lazy first, so that it does not profit from pages released by the eager conversion
+    uint64_t lazyPeak = [self peakFootprintOf:^id {
+        CKTLazyArray *conversations = [[CKTLazyArray alloc] initWithValue:feed];
+        for (NSDictionary *conversation in conversations) {
+            (void)conversation[@"topic"];
+        }
+        return conversations;
+    }];
+    uint64_t eagerPeak = [self peakFootprintOf:^id { return [feed toObject]; }];
+
+    NSLog(@"Peak memory for %lu conversations: eager %.1f MB, lazy %.1f MB", (unsigned long)kFeedSize,
+          eagerPeak / (1024.0 * 1024.0), lazyPeak / (1024.0 * 1024.0));
+    XCTAssertLessThan(lazyPeak, eagerPeak, @"The lazy conversion should need less memory.");
+}
+
+#pragma mark - internal functions
+
+// Growth of the footprint over the one before the block, sampled every millisecond while it runs and once more
+// while its result is still held
+- (uint64_t)peakFootprintOf:(id (^)(void))block
+{
+    dispatch_queue_t queue = dispatch_queue_create("LazyResultTests.sampler", DISPATCH_QUEUE_SERIAL);
+    dispatch_source_t sampler = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+    uint64_t baseline = CKTTestFootprint();
+    __block uint64_t peak = baseline;
+
+    dispatch_source_set_timer(sampler, DISPATCH_TIME_NOW, NSEC_PER_MSEC, 0);
+    dispatch_source_set_event_handler(sampler, ^{ peak = MAX(peak, CKTTestFootprint()); });
+    dispatch_resume(sampler);
+
+    @autoreleasepool
+    {
+        NS_VALID_UNTIL_END_OF_SCOPE id result = block();
+        dispatch_sync(queue, ^{ peak = MAX(peak, CKTTestFootprint()); });
+    }
+
+    dispatch_source_cancel(sampler);
+    __block uint64_t growth;
+    dispatch_sync(queue, ^{ growth = peak - baseline; });
+    return growth;
+}
+
+@end
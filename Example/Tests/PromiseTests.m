@@ -0,0 +1,192 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  PromiseTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+@interface PromiseTests : XCTestCase
+
+@property (nonatomic, strong) JSContext *context;
+
+@end
+
+@implementation PromiseTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The JS engine is not started by the tests, without a JS thread promise callbacks run synchronously
+    _context = [[JSContext alloc] init];
+    [_context evaluateScript:@"var results = [];"
+                              "function first(value) { results.push('first ' + value); return 1; }"
+                              "function second(value) { results.push('second ' + value); return 2; }"
+                              "function failed(error) { results.push('failed ' + error); }"];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    _context = nil;
+}
+
+- (void)testThenTwiceOnResolvedPromise
+{
+    Defer *defer = [[Defer alloc] init];
+    _context[@"promise"] = defer.promise;
+
+    [defer resolve:[JSValue valueWithObject:@"done" inContext:_context]];
+
+    JSValue *chained = [_context evaluateScript:@"[promise.then(first), promise.then(second)]"];
+
+    NSArray *results = [_context[@"results"] toArray];
+    NSArray *expected = @[ @"first done", @"second done" ];
+    XCTAssertEqualObjects(results, expected, @"Both callbacks should be called with the result.");
+
+    Promise *firstChained = [chained[0] toObject];
+    Promise *secondChained = [chained[1] toObject];
+    XCTAssert(firstChained.resolved, @"The promise returned by the first then was not resolved.");
+    XCTAssert(secondChained.resolved, @"The promise returned by the second then was not resolved.");
+}
+
+- (void)testThenTwiceBeforeResolve
+{
+    Defer *defer = [[Defer alloc] init];
+    _context[@"promise"] = defer.promise;
+
+    JSValue *chained = [_context evaluateScript:@"[promise.then(first, failed), promise.then(second, failed)]"];
+
+    [defer resolve:[JSValue valueWithObject:@"done" inContext:_context]];
+
+    NSArray *results = [_context[@"results"] toArray];
+    NSArray *expected = @[ @"first done", @"second done" ];
+    XCTAssertEqualObjects(results, expected, @"Both callbacks should be called in registration order.");
+
+    XCTAssert([[chained[0] toObject] resolved], @"The promise returned by the first then was not resolved.");
+    XCTAssert([[chained[1] toObject] resolved], @"The promise returned by the second then was not resolved.");
+}
+
+- (void)testThenAndCatchOnRejectedPromise
+{
+    Defer *defer = [[Defer alloc] init];
+    _context[@"promise"] = defer.promise;
+
+    [defer reject:[JSValue valueWithObject:@"error" inContext:_context]];
+
+    JSValue *chained = [_context evaluateScript:@"[promise.then(first), promise.catch(failed)]"];
+
+    NSArray *results = [_context[@"results"] toArray];
+    NSArray *expected = @[ @"failed error" ];
+    XCTAssertEqualObjects(results, expected, @"Only the error callback should be called.");
+
+    XCTAssert([[chained[0] toObject] rejected], @"The promise returned by then was not rejected.");
+    XCTAssert([[chained[1] toObject] resolved], @"The promise returned by catch was not resolved.");
+}
+
+// Returns the JS thread once it runs, the engine loads the SDK scripts first
+- (JSRunLoop *)startJSThread
+{
+    [[JSEngine sharedInstance] start];
+
+    JSRunLoop *jsThread = [JSEngine sharedInstance].jsThread;
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:30];
+    while (!jsThread.isExecuting && [deadline timeIntervalSinceNow] > 0) {
+        usleep(10000);
+    }
+    return jsThread.isExecuting ? jsThread : nil;
+}
+
+- (void)testQueuedCallbacksDrain
+{
+    XCTAssertNotNil([self startJSThread], @"The JS thread should start.");
+
+    NSMutableArray *results = [NSMutableArray array];
+    XCTestExpectation *drained = [self expectationWithDescription:@"drained"];
+
+    [[JSEngine sharedInstance] performBlock:^{
+        // Settled on the JS thread, the callbacks are queued and run by a drain instead of from resolve
+        [Promise resetStatistics];
+        JSContext *context = [JSEngine sharedInstance].context;
+        Defer *first = [[Defer alloc] init];
+        Defer *second = [[Defer alloc] init];
+
+        [first.promise addSuccessCallback:^(JSValue *value) {
+            [results addObject:[@"first " stringByAppendingString:[value toString]]];
+            // Settled by a callback, handled by the same drain
+            [second resolve:[JSValue valueWithObject:@"later" inContext:context]];
+        }
+                            errorCallback:nil];
+        [second.promise addSuccessCallback:^(JSValue *value) {
+            [results addObject:[@"second " stringByAppendingString:[value toString]]];
+            [drained fulfill];
+        }
+                             errorCallback:nil];
+
+        [first resolve:[JSValue valueWithObject:@"done" inContext:context]];
+        XCTAssertEqual(results.count, (NSUInteger)0, @"Callbacks must not be called from resolve on the JS thread.");
+    }];
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+
+    NSArray *expected = @[ @"first done", @"second later" ];
+    XCTAssertEqualObjects(results, expected, @"Both callbacks should be called in settling order.");
+
+    NSDictionary *statistics = [Promise statistics];
+    XCTAssertGreaterThanOrEqual([statistics[kPromiseDrains] unsignedIntegerValue], (NSUInteger)1,
+                                @"The callbacks should be run by a drain.");
+    XCTAssertGreaterThanOrEqual([statistics[kPromiseMaxCallbacksPerDrain] unsignedIntegerValue], (NSUInteger)2,
+                                @"The promise settled by a callback should be handled by the same drain.");
+}
+
+// Promises settled in bursts on the JS thread, e.g. by a batch of responses
+- (void)testDrainPerformance
+{
+    static const NSUInteger count = 10000;
+    XCTAssertNotNil([self startJSThread], @"The JS thread should start.");
+    [Promise resetStatistics];
+
+    [self measureBlock:^{
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+
+        [[JSEngine sharedInstance] performBlock:^{
+            JSValue *data = [JSValue valueWithObject:@"done" inContext:[JSEngine sharedInstance].context];
+            __block NSUInteger called = 0;
+            for (NSUInteger i = 0; i < count; i++) {
+                Defer *defer = [[Defer alloc] init];
+                [defer.promise addSuccessCallback:^(JSValue *value) {
+                    if (++called == count) {
+                        dispatch_semaphore_signal(done);
+                    }
+                }
+                                    errorCallback:nil];
+                [defer resolve:data];
+            }
+        }];
+
+        XCTAssertEqual(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC)), 0L,
+                       @"All callbacks should be called.");
+    }];
+
+    NSDictionary *statistics = [Promise statistics];
+    NSLog(@"%@ callbacks in %@ drains, largest drain %@, %@ resolutions per second", statistics[kPromiseCallbacks],
+          statistics[kPromiseDrains], statistics[kPromiseMaxCallbacksPerDrain],
+          statistics[kPromiseResolutionsPerSecond]);
+}
+
+@end
@@ -0,0 +1,119 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  RecordStoreBenchmark.cpp
+//  CircuitSDK
+//
+//  Timings of ckt::RecordStore at 100k items, built and run with `make benchmark` in this directory.
+//
+
+#include "CKTRecordStore.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace ckt;
+
+static const int kItemCount = 100000;
+static const int kConversationCount = 500;
+
+static double milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string key(int i)
+{
+    return "item" + std::to_string(i);
+}
+
+static std::string parent(int i)
+{
+    return "conv" + std::to_string(i % kConversationCount);
+}
+
+int main()
+{
+    std::string path = std::string(getenv("TMPDIR") ?: "/tmp") + "/RecordStoreBenchmark." + std::to_string(getpid());
+    unlink(path.c_str());
+
+    std::mt19937 random(1);
+    std::string error;
+    {
+        RecordStore store(path);
+        if (!store.open(&error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return EXIT_FAILURE;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kItemCount; i++) {
+            store.put(RecordKind::Item, key(i), parent(i), i, std::string(200 + random() % 800, 'a'));
+        }
+        printf("put %d items: %.1f ms\n", kItemCount, milliseconds(start));
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kItemCount; i++) {
+            store.put(RecordKind::Item, key(i), parent(i), i, std::string(100 + random() % 50, 'b'));
+        }
+        printf("overwrite %d items: %.1f ms, %llu bytes\n", kItemCount, milliseconds(start),
+               static_cast<unsigned long long>(store.statistics().fileBytes));
+    }
+
+    RecordStore store(path);
+    auto start = std::chrono::steady_clock::now();
+    if (!store.open(&error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("open: %.1f ms\n", milliseconds(start));
+
+    start = std::chrono::steady_clock::now();
+    std::string value;
+    for (int n = 0; n < kItemCount; n++) {
+        store.get(RecordKind::Item, key(static_cast<int>(random() % kItemCount)), &value);
+    }
+    printf("get %d random items: %.1f ms\n", kItemCount, milliseconds(start));
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::string> values;
+    for (int i = 0; i < kConversationCount; i++) {
+        store.query(RecordKind::Item, parent(i), INT64_MAX, RecordDirection::Before, 25, &values);
+    }
+    printf("query the last page of %d conversations: %.1f ms\n", kConversationCount, milliseconds(start));
+
+    // The copy runs without the caller's lock, only the two other steps block lookups
+    uint64_t size = store.statistics().fileBytes;
+    start = std::chrono::steady_clock::now();
+    std::unique_ptr<RecordStore::Compaction> compaction = store.beginCompaction();
+    double begin = milliseconds(start);
+    bool copied = compaction && compaction->copy();
+    auto finishStart = std::chrono::steady_clock::now();
+    bool compacted = copied && store.finishCompaction(compaction.get());
+    printf("compact: %.1f ms (%s), begin %.1f ms, finish %.1f ms, %llu -> %llu bytes\n", milliseconds(start),
+           compacted ? "done" : "failed", begin, milliseconds(finishStart), static_cast<unsigned long long>(size),
+           static_cast<unsigned long long>(store.statistics().fileBytes));
+
+    store.close();
+    unlink(path.c_str());
+    return compacted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,385 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  RecordStoreTests.cpp
+//  CircuitSDK
+//
+//  Plain C++ tests of ckt::RecordStore, built and run with `make test` in this directory.
+//
+
+#include "CKTRecordStore.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace ckt;
+
+static int failures = 0;
+
+#define EXPECT(condition)                                                                                             \
+    do {                                                                                                              \
+        if (!(condition)) {                                                                                           \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition);                                  \
+            failures++;                                                                                               \
+        }                                                                                                             \
+    } while (0)
+
+static const int kItemCount = 100000;
+static const int kConversationCount = 500;
+
+// Expected contents of the store, the items of conversation i % kConversationCount have sort key i
+struct Model {
+    std::map<std::string, std::pair<int64_t, std::string>> items;
+
+    static std::string key(int i) { return "item" + std::to_string(i); }
+    static std::string parent(int i) { return "conv" + std::to_string(i % kConversationCount); }
+
+    // Values of the given conversation in query order
+    std::vector<std::string> query(int conversation, int64_t sortKey, RecordDirection direction, size_t limit) const
+    {
+        std::vector<std::string> values;
+        if (direction == RecordDirection::Before) {
+            for (int64_t i = sortKey - 1; i >= 0 && (limit == 0 || values.size() < limit); i--) {
+                append(conversation, static_cast<int>(i), &values);
+            }
+        } else {
+            for (int64_t i = sortKey + 1; i < kItemCount && (limit == 0 || values.size() < limit); i++) {
+                append(conversation, static_cast<int>(i), &values);
+            }
+        }
+        return values;
+    }
+
+    void append(int conversation, int i, std::vector<std::string> *values) const
+    {
+        if (i % kConversationCount != conversation) {
+            return;
+        }
+        auto it = items.find(key(i));
+        if (it != items.end()) {
+            values->push_back(it->second.second);
+        }
+    }
+
+    // Sort keys of the given conversation, newest first
+    std::vector<int64_t> sortKeys(int conversation) const
+    {
+        std::vector<int64_t> keys;
+        for (int i = kItemCount - 1; i >= 0; i--) {
+            if (i % kConversationCount == conversation && items.count(key(i))) {
+                keys.push_back(i);
+            }
+        }
+        return keys;
+    }
+};
+
+static std::string temporaryPath(const char *name)
+{
+    std::string path = std::string(getenv("TMPDIR") ?: "/tmp") + "/" + name + "." + std::to_string(getpid());
+    unlink(path.c_str());
+    unlink((path + ".compact").c_str());
+    return path;
+}
+
+// Fills the store with kItemCount items, then overwrites and removes a third of them
+static void populate(RecordStore *store, Model *model)
+{
+    std::mt19937 random(1);
+    for (int i = 0; i < kItemCount; i++) {
+        std::string value(200 + random() % 800, static_cast<char>('a' + i % 26));
+        EXPECT(store->put(RecordKind::Item, Model::key(i), Model::parent(i), i, value));
+        model->items[Model::key(i)] = std::make_pair(static_cast<int64_t>(i), value);
+    }
+    for (int n = 0; n < kItemCount / 3; n++) {
+        int i = static_cast<int>(random() % kItemCount);
+        if (random() % 3 == 0) {
+            store->remove(RecordKind::Item, Model::key(i));
+            model->items.erase(Model::key(i));
+        } else {
+            std::string value(100 + random() % 50, 'z');
+            EXPECT(store->put(RecordKind::Item, Model::key(i), Model::parent(i), i, value));
+            model->items[Model::key(i)] = std::make_pair(static_cast<int64_t>(i), value);
+        }
+    }
+}
+
+static void expectContents(RecordStore *store, const Model &model)
+{
+    EXPECT(store->statistics().records[static_cast<size_t>(RecordKind::Item)] == model.items.size());
+
+    size_t mismatches = 0;
+    for (const auto &item : model.items) {
+        std::string value;
+        if (!store->get(RecordKind::Item, item.first, &value) || value != item.second.second) {
+            mismatches++;
+        }
+    }
+    EXPECT(mismatches == 0);
+
+    for (int conversation : {0, 7, kConversationCount - 1}) {
+        for (int64_t sortKey : {static_cast<int64_t>(0), static_cast<int64_t>(kItemCount / 2), INT64_MAX}) {
+            for (size_t limit : {static_cast<size_t>(0), static_cast<size_t>(25)}) {
+                std::vector<std::string> values;
+                store->query(RecordKind::Item, Model::parent(conversation), sortKey, RecordDirection::Before, limit,
+                             &values);
+                EXPECT(values == model.query(conversation, std::min<int64_t>(sortKey, kItemCount),
+                                             RecordDirection::Before, limit));
+
+                values.clear();
+                store->query(RecordKind::Item, Model::parent(conversation), sortKey, RecordDirection::After, limit,
+                             &values);
+                EXPECT(values == model.query(conversation, std::min<int64_t>(sortKey, kItemCount),
+                                             RecordDirection::After, limit));
+            }
+        }
+    }
+}
+
+static void testPutGet()
+{
+    std::string path = temporaryPath("RecordStoreTests.putGet");
+    RecordStore store(path);
+    std::string error;
+    EXPECT(store.open(&error));
+
+    std::string value;
+    EXPECT(!store.get(RecordKind::Conversation, "c1", &value));
+    EXPECT(!store.put(RecordKind::Conversation, "", "", 1, "empty key"));
+    EXPECT(store.put(RecordKind::Conversation, "c1", "", 1, "first"));
+    EXPECT(store.get(RecordKind::Conversation, "c1", &value) && value == "first");
+    EXPECT(!store.contains(RecordKind::Item, "c1"));
+
+    // Same contents, nothing appended
+    uint64_t size = store.statistics().fileBytes;
+    EXPECT(store.put(RecordKind::Conversation, "c1", "", 1, "first"));
+    EXPECT(store.statistics().unchangedPuts == 1);
+    EXPECT(store.statistics().fileBytes == size);
+
+    EXPECT(store.put(RecordKind::Conversation, "c1", "", 2, "second"));
+    EXPECT(store.get(RecordKind::Conversation, "c1", &value) && value == "second");
+    EXPECT(store.put(RecordKind::Conversation, "c2", "", 3, ""));
+    EXPECT(store.get(RecordKind::Conversation, "c2", &value) && value.empty());
+
+    EXPECT(store.remove(RecordKind::Conversation, "c2"));
+    EXPECT(!store.remove(RecordKind::Conversation, "c2"));
+    EXPECT(!store.contains(RecordKind::Conversation, "c2"));
+
+    store.close();
+    EXPECT(store.open(&error));
+    EXPECT(store.get(RecordKind::Conversation, "c1", &value) && value == "second");
+    EXPECT(!store.contains(RecordKind::Conversation, "c2"));
+
+    EXPECT(store.clear());
+    EXPECT(!store.contains(RecordKind::Conversation, "c1"));
+    store.close();
+    EXPECT(store.open(&error));
+    EXPECT(!store.contains(RecordKind::Conversation, "c1"));
+    unlink(path.c_str());
+}
+
+static void testPagedQuery()
+{
+    std::string path = temporaryPath("RecordStoreTests.pagedQuery");
+    RecordStore store(path);
+    std::string error;
+    EXPECT(store.open(&error));
+
+    Model model;
+    populate(&store, &model);
+    expectContents(&store, model);
+
+    // Paging back through a conversation from the sort key of the last item of each page returns every item once
+    std::vector<int64_t> sortKeys = model.sortKeys(7);
+    std::vector<std::string> pages;
+    int64_t sortKey = INT64_MAX;
+    for (;;) {
+        std::vector<std::string> page;
+        store.query(RecordKind::Item, Model::parent(7), sortKey, RecordDirection::Before, 25, &page);
+        if (page.empty() || pages.size() + page.size() > sortKeys.size()) {
+            break;
+        }
+        pages.insert(pages.end(), page.begin(), page.end());
+        sortKey = sortKeys[pages.size() - 1];
+    }
+    EXPECT(pages.size() == sortKeys.size());
+    EXPECT(pages == model.query(7, kItemCount, RecordDirection::Before, 0));
+
+    // And forward again from the oldest one
+    std::vector<std::string> forward;
+    sortKey = sortKeys.empty() ? 0 : sortKeys.back();
+    store.query(RecordKind::Item, Model::parent(7), sortKey, RecordDirection::After, 0, &forward);
+    EXPECT(forward.size() + 1 == sortKeys.size());
+    EXPECT(std::equal(forward.rbegin(), forward.rend(), pages.begin()));
+    unlink(path.c_str());
+}
+
+static void testTornTail()
+{
+    std::string path = temporaryPath("RecordStoreTests.tornTail");
+    Model model;
+    {
+        RecordStore store(path);
+        std::string error;
+        EXPECT(store.open(&error));
+        populate(&store, &model);
+    }
+
+    // The header and part of the payload of a record which was being written when the app was terminated
+    std::string torn("\x01\x02\x03\x04\x40\x00\x00\x00\x01\x01\x02\x00\x00\x00\x00\x00", 16);
+    torn.append(8, '\0');
+    torn.append("partial");
+    FILE *file = fopen(path.c_str(), "ab");
+    EXPECT(file != nullptr);
+    if (file) {
+        fwrite(torn.data(), 1, torn.size(), file);
+        fclose(file);
+    }
+
+    RecordStore store(path);
+    std::string error;
+    EXPECT(store.open(&error));
+    EXPECT(store.statistics().truncatedBytes == torn.size());
+    expectContents(&store, model);
+
+    // Appends follow the last complete record
+    EXPECT(store.put(RecordKind::Item, Model::key(0), Model::parent(0), 0, "after truncation"));
+    model.items[Model::key(0)] = std::make_pair(static_cast<int64_t>(0), std::string("after truncation"));
+    store.close();
+    EXPECT(store.open(&error));
+    EXPECT(store.statistics().truncatedBytes == 0);
+    expectContents(&store, model);
+    unlink(path.c_str());
+}
+
+static void testCompaction()
+{
+    std::string path = temporaryPath("RecordStoreTests.compaction");
+    RecordStore store(path);
+    std::string error;
+    EXPECT(store.open(&error));
+
+    Model model;
+    populate(&store, &model);
+    EXPECT(store.put(RecordKind::Conversation, "c1", "", 1, "conversation"));
+    for (int i = 0; i < kItemCount; i += 2) {
+        store.remove(RecordKind::Item, Model::key(i));
+        model.items.erase(Model::key(i));
+    }
+    EXPECT(store.needsCompaction());
+
+    EXPECT(store.compact());
+    EXPECT(!store.needsCompaction());
+    EXPECT(store.statistics().compactions == 1);
+    EXPECT(store.statistics().fileBytes == store.statistics().liveBytes + 16);
+    expectContents(&store, model);
+
+    store.close();
+    EXPECT(store.open(&error));
+    EXPECT(store.statistics().truncatedBytes == 0);
+    expectContents(&store, model);
+    std::string value;
+    EXPECT(store.get(RecordKind::Conversation, "c1", &value) && value == "conversation");
+    EXPECT(access((path + ".compact").c_str(), F_OK) != 0);
+    unlink(path.c_str());
+}
+
+static void testCompactionWithConcurrentWrites()
+{
+    std::string path = temporaryPath("RecordStoreTests.concurrentCompaction");
+    RecordStore store(path);
+    std::string error;
+    EXPECT(store.open(&error));
+
+    Model model;
+    populate(&store, &model);
+
+    // The store is written and read while the live records are copied on another thread
+    std::unique_ptr<RecordStore::Compaction> compaction = store.beginCompaction();
+    EXPECT(compaction != nullptr);
+    bool copied = false;
+    std::thread copier([&] { copied = compaction->copy(); });
+    size_t mismatches = 0;
+    for (int i = 0; i < kItemCount; i += 3) {
+        if (i % 2) {
+            store.remove(RecordKind::Item, Model::key(i));
+            model.items.erase(Model::key(i));
+        } else {
+            std::string value = "written during the compaction " + std::to_string(i);
+            EXPECT(store.put(RecordKind::Item, Model::key(i), Model::parent(i), i, value));
+            model.items[Model::key(i)] = std::make_pair(static_cast<int64_t>(i), value);
+        }
+        auto item = model.items.find(Model::key(i + 1));
+        std::string value;
+        if (item != model.items.end() &&
+            (!store.get(RecordKind::Item, item->first, &value) || value != item->second.second)) {
+            mismatches++;
+        }
+    }
+    copier.join();
+    EXPECT(mismatches == 0);
+    EXPECT(copied);
+
+    EXPECT(store.finishCompaction(compaction.get()));
+    EXPECT(store.statistics().compactions == 1);
+    expectContents(&store, model);
+
+    store.close();
+    EXPECT(store.open(&error));
+    expectContents(&store, model);
+
+    // A compaction started before the store was cleared is dropped
+    EXPECT(store.put(RecordKind::Conversation, "c1", "", 1, "conversation"));
+    compaction = store.beginCompaction();
+    EXPECT(compaction != nullptr && compaction->copy());
+    EXPECT(store.clear());
+    EXPECT(store.put(RecordKind::Conversation, "c2", "", 2, "conversation"));
+    EXPECT(!store.finishCompaction(compaction.get()));
+    compaction.reset();
+    EXPECT(access((path + ".compact").c_str(), F_OK) != 0);
+    EXPECT(!store.contains(RecordKind::Conversation, "c1"));
+    EXPECT(store.contains(RecordKind::Conversation, "c2"));
+    unlink(path.c_str());
+}
+
+int main()
+{
+    struct {
+        const char *name;
+        void (*run)();
+    } tests[] = {
+        {"testPutGet", testPutGet},
+        {"testPagedQuery", testPagedQuery},
+        {"testTornTail", testTornTail},
+        {"testCompaction", testCompaction},
+        {"testCompactionWithConcurrentWrites", testCompactionWithConcurrentWrites},
+    };
+
+    for (const auto &test : tests) {
+        int before = failures;
+        test.run();
+        printf("%s %s\n", failures == before ? "PASS" : "FAIL", test.name);
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,255 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  TaskQueueTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+// Consumer thread sleeping in its run loop with the queue attached, like the JS thread
+@interface TaskQueueThread : NSThread
+
+@property (nonatomic, strong) JSTaskQueue *queue;
+@property (nonatomic, strong) dispatch_semaphore_t started;
+@property (nonatomic, strong) dispatch_semaphore_t finished;
+
+@end
+
+@implementation TaskQueueThread
+
+- (instancetype)initWithQueue:(JSTaskQueue *)queue
+{
+    if (self = [super init]) {
+        _queue = queue;
+        _started = dispatch_semaphore_create(0);
+        _finished = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)main
+{
+    @autoreleasepool {
+        [self.queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+        dispatch_semaphore_signal(self.started);
+
+        // Returns once the queue is invalidated, its source was the only one
+        while (!self.isCancelled &&
+               [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]]) {
+        }
+        dispatch_semaphore_signal(self.finished);
+    }
+}
+
+- (void)startAndWait
+{
+    [self start];
+    dispatch_semaphore_wait(self.started, DISPATCH_TIME_FOREVER);
+}
+
+- (void)stopAndWait
+{
+    JSTaskQueue *queue = self.queue;
+    [queue addTask:^{
+        [self cancel];
+        [queue invalidate];
+    }];
+    dispatch_semaphore_wait(self.finished, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+}
+
+@end
+
+@interface TaskQueueTests : XCTestCase
+
+@property (nonatomic, strong) JSTaskQueue *queue;
+@property (nonatomic, strong) NSMutableArray *executed;
+
+@end
+
+@implementation TaskQueueTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The tests attach the queue to the main run loop, tasks run while -runUntilExecuted: spins it
+    _queue = [[JSTaskQueue alloc] init];
+    _executed = [NSMutableArray array];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    [_queue invalidate];
+    _queue = nil;
+    _executed = nil;
+}
+
+- (void)addTask:(id)name priority:(JSTaskPriority)priority
+{
+    [_queue addTask:^{ [self.executed addObject:name]; } priority:priority];
+}
+
+- (BOOL)runUntilExecuted:(NSUInteger)count
+{
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:5];
+    while (_executed.count < count && [deadline timeIntervalSinceNow] > 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return _executed.count == count;
+}
+
+- (void)testFIFOWithinPriority
+{
+    static const NSUInteger count = 1000;
+    NSMutableArray *expected = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [self addTask:@(i) priority:JSTaskPriorityTimer];
+        [expected addObject:@(i)];
+    }
+    [_queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+
+    XCTAssert([self runUntilExecuted:count], @"All tasks should be executed.");
+    XCTAssertEqualObjects(_executed, expected, @"Tasks of a priority should run in the order added.");
+    XCTAssertEqual([_queue depthForPriority:JSTaskPriorityTimer], (NSUInteger)0, @"No task should be waiting.");
+}
+
+- (void)testPriorityOrder
+{
+    [self addTask:@"background" priority:JSTaskPriorityBackground];
+    [self addTask:@"timer" priority:JSTaskPriorityTimer];
+    [self addTask:@"callSignaling" priority:JSTaskPriorityCallSignaling];
+    [self addTask:@"userInteractive" priority:JSTaskPriorityUserInteractive];
+    XCTAssertEqual([_queue depthForPriority:JSTaskPriorityBackground], (NSUInteger)1, @"One task should wait.");
+    [_queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+
+    XCTAssert([self runUntilExecuted:4], @"All tasks should be executed.");
+    NSArray *expected = @[ @"userInteractive", @"callSignaling", @"timer", @"background" ];
+    XCTAssertEqualObjects(_executed, expected, @"Higher priorities should run first.");
+}
+
+- (void)testPreemption
+{
+    // A higher priority task added by a running task goes before the tasks already waiting
+    [_queue addTask:^{
+        [self.executed addObject:@"background 1"];
+        [self addTask:@"callSignaling" priority:JSTaskPriorityCallSignaling];
+    }
+           priority:JSTaskPriorityBackground];
+    [self addTask:@"background 2" priority:JSTaskPriorityBackground];
+    [_queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+
+    XCTAssert([self runUntilExecuted:3], @"All tasks should be executed.");
+    NSArray *expected = @[ @"background 1", @"callSignaling", @"background 2" ];
+    XCTAssertEqualObjects(_executed, expected, @"The new higher priority task should preempt the waiting ones.");
+}
+
+- (void)testDiscardHandlerOnInvalidate
+{
+    __block NSUInteger discarded = 0;
+    [_queue addTask:^{ [self.executed addObject:@"task"]; }
+              priority:JSTaskPriorityBackground
+                 label:"discardedTask"
+        discardHandler:^{ discarded++; }];
+    [_queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+
+    [_queue invalidate];
+    XCTAssertEqual(discarded, (NSUInteger)1, @"The pending task should be discarded.");
+
+    [_queue addTask:^{ [self.executed addObject:@"late task"]; }
+              priority:JSTaskPriorityUserInteractive
+                 label:"lateTask"
+        discardHandler:^{ discarded++; }];
+    XCTAssertEqual(discarded, (NSUInteger)2, @"A task added after invalidate should be discarded right away.");
+
+    [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    XCTAssertEqual(_executed.count, (NSUInteger)0, @"No discarded task should run.");
+    XCTAssertEqual([_queue depthForPriority:JSTaskPriorityBackground], (NSUInteger)0, @"No task should be waiting.");
+}
+
+- (void)testOneWakeupPerBurst
+{
+    static const NSUInteger count = 100;
+    [_queue scheduleInRunLoop:[NSRunLoop currentRunLoop]];
+    [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    [_queue resetStatistics];
+
+    // Only the first task finds the list empty and signals the run loop
+    for (NSUInteger i = 0; i < count; i++) {
+        [self addTask:@(i) priority:JSTaskPriorityUserInteractive];
+    }
+    XCTAssert([self runUntilExecuted:count], @"All tasks should be executed.");
+
+    NSDictionary *statistics = [_queue statistics];
+    XCTAssertEqualObjects(statistics[kJSTaskQueueWakeups], @1, @"The burst should cost a single wakeup.");
+    XCTAssertEqualObjects(statistics[kJSTaskQueueMaxBatchSize], @(count), @"The burst should run in one batch.");
+}
+
+- (void)testWakeupOfSleepingThread
+{
+    TaskQueueThread *thread = [[TaskQueueThread alloc] initWithQueue:_queue];
+    [thread startAndWait];
+
+    // The consumer sleeps in its run loop, adding to the empty queue has to wake it up
+    for (NSUInteger i = 0; i < 3; i++) {
+        usleep(20000);
+        XCTestExpectation *executed = [self expectationWithDescription:@"executed"];
+        [_queue addTask:^{ [executed fulfill]; } priority:JSTaskPriorityTimer];
+        [self waitForExpectationsWithTimeout:1 handler:nil];
+    }
+
+    [thread stopAndWait];
+    XCTAssert(thread.isFinished || thread.isCancelled, @"The consumer thread should stop.");
+}
+
+// Producers on several threads feeding the consumer thread
+- (void)testMultiThreadedProducersPerformance
+{
+    static const NSUInteger producers = 4;
+    static const NSUInteger tasksPerProducer = 25000;
+    TaskQueueThread *thread = [[TaskQueueThread alloc] initWithQueue:_queue];
+    [thread startAndWait];
+
+    [self measureBlock:^{
+        __block NSUInteger executed = 0;
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        JSTaskQueue *queue = self.queue;
+
+        dispatch_apply(producers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t producer) {
+            JSTaskPriority priority = (JSTaskPriority)(producer % JSTaskPriorityNumberOfPriorities);
+            for (NSUInteger i = 0; i < tasksPerProducer; i++) {
+                [queue addTask:^{
+                    // Only the consumer thread touches the counter
+                    if (++executed == producers * tasksPerProducer) {
+                        dispatch_semaphore_signal(done);
+                    }
+                }
+                      priority:priority];
+            }
+        });
+        XCTAssertEqual(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0L,
+                       @"All tasks should be executed.");
+    }];
+
+    NSDictionary *statistics = [_queue statistics];
+    NSLog(@"%@ tasks in %@ wakeups, largest batch %@", statistics[kJSTaskQueueExecutedTasks],
+          statistics[kJSTaskQueueWakeups], statistics[kJSTaskQueueMaxBatchSize]);
+    [thread stopAndWait];
+}
+
+@end
@@ -0,0 +1,237 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  TimerWheelTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+@interface TimerWheelTests : XCTestCase
+
+@property (nonatomic, strong) JSTimerWheel *wheel;
+@property (nonatomic, strong) NSMutableArray *fired;  // Targets in the order their timers fired
+@property (nonatomic, copy) void (^onFire)(id target, BOOL repeats);
+
+@end
+
+@implementation TimerWheelTests
+
+- (void)setUp
+{
+    [super setUp];
+    // The wheel is driven by the main run loop, the wakeup expires the timers right away instead of going through
+    // the JS thread
+    _fired = [NSMutableArray array];
+
+    __weak typeof(self) weakSelf = self;
+    _wheel = [[JSTimerWheel alloc] initWithWakeup:^{ [weakSelf.wheel expireTimers]; }
+                                          handler:^(id target, id argument, BOOL repeats) {
+                                              [weakSelf.fired addObject:target];
+                                              if (weakSelf.onFire) {
+                                                  weakSelf.onFire(target, repeats);
+                                              }
+                                          }];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    [_wheel cancelAllTimers:nil];
+    _wheel = nil;
+    _fired = nil;
+    _onFire = nil;
+}
+
+- (BOOL)runUntilFired:(NSUInteger)count timeout:(NSTimeInterval)timeout
+{
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    while (_fired.count < count && [deadline timeIntervalSinceNow] > 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return _fired.count >= count;
+}
+
+- (void)runFor:(NSTimeInterval)interval
+{
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:interval]];
+}
+
+- (void)testExpiryOrder
+{
+    [_wheel scheduleTimerAfter:30 repeats:NO target:@"30" argument:nil];
+    [_wheel scheduleTimerAfter:10 repeats:NO target:@"10 first" argument:nil];
+    [_wheel scheduleTimerAfter:20 repeats:NO target:@"20" argument:nil];
+    [_wheel scheduleTimerAfter:10 repeats:NO target:@"10 second" argument:nil];
+    [_wheel scheduleTimerAfter:0 repeats:NO target:@"0" argument:nil];
+
+    XCTAssert([self runUntilFired:5 timeout:1], @"All timers should fire.");
+    NSArray *expected = @[ @"0", @"10 first", @"10 second", @"20", @"30" ];
+    XCTAssertEqualObjects(_fired, expected, @"Timers should fire by expiry, in scheduling order at the same time.");
+    XCTAssertEqualObjects([_wheel statistics][kJSTimerWheelActiveTimers], @0, @"No timer should be left.");
+}
+
+- (void)testCascadingAcrossLevels
+{
+    // 200 ms is filed in the second level and 4.2 s in the third, both are moved to finer levels before firing
+    NSDate *start = [NSDate date];
+    [_wheel scheduleTimerAfter:4200 repeats:NO target:@"level 2" argument:nil];
+    [_wheel scheduleTimerAfter:200 repeats:NO target:@"level 1" argument:nil];
+
+    XCTAssert([self runUntilFired:1 timeout:1], @"The 200 ms timer should fire.");
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], 0.2, @"The timer must not fire early.");
+
+    XCTAssert([self runUntilFired:2 timeout:6], @"The 4.2 s timer should fire.");
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], 4.2, @"The timer must not fire early.");
+    XCTAssertEqualObjects(_fired, (@[ @"level 1", @"level 2" ]), @"Unexpected order.");
+    XCTAssertGreaterThanOrEqual([[_wheel statistics][kJSTimerWheelCascades] unsignedIntegerValue], (NSUInteger)2,
+                                @"Both timers should be moved to a finer level before firing.");
+}
+
+- (void)testOverflow
+{
+    // Beyond the 4.6 h covered by the levels
+    static const NSTimeInterval delay = 24 * 3600 * 1000.0;
+    JSTimerId timerId = [_wheel scheduleTimerAfter:delay repeats:NO target:@"overflow" argument:nil];
+    [_wheel scheduleTimerAfter:10 repeats:NO target:@"short" argument:nil];
+
+    XCTAssert([self runUntilFired:1 timeout:1], @"The short timer should fire.");
+    [self runFor:0.05];
+    XCTAssertEqualObjects(_fired, @[ @"short" ], @"The overflow timer must not fire.");
+
+    __block NSNumber *dueIn;
+    [_wheel enumerateTimersUsingBlock:^(id target, id argument, NSDictionary *timer) {
+        dueIn = timer[kJSTimerWheelTimerDueIn];
+    }];
+    XCTAssertGreaterThan(dueIn.doubleValue, delay - 1000, @"The overflow timer should keep its expiry.");
+
+    XCTAssertEqualObjects([_wheel cancelTimer:timerId], @"overflow", @"The overflow timer should be cancellable.");
+    XCTAssertEqualObjects([_wheel statistics][kJSTimerWheelActiveTimers], @0, @"No timer should be left.");
+}
+
+- (void)testCancelStaleId
+{
+    JSTimerId timerId = [_wheel scheduleTimerAfter:10 repeats:NO target:@"cancelled" argument:nil];
+    XCTAssertEqualObjects([_wheel cancelTimer:timerId], @"cancelled", @"The timer should be cancelled.");
+    XCTAssertNil([_wheel cancelTimer:timerId], @"Cancelling twice should do nothing.");
+
+    // Enough timers to reuse the record of the cancelled one
+    NSMutableSet *ids = [NSMutableSet set];
+    for (NSUInteger i = 0; i < 128; i++) {
+        JSTimerId newId = [_wheel scheduleTimerAfter:10 repeats:NO target:@(i) argument:nil];
+        XCTAssertNotEqual(newId, timerId, @"A reused record should get a new id.");
+        [ids addObject:@(newId)];
+    }
+    XCTAssertEqual(ids.count, (NSUInteger)128, @"Timer ids should be unique.");
+
+    XCTAssertNil([_wheel cancelTimer:timerId], @"A stale id must not cancel a newer timer.");
+    XCTAssertNil([_wheel cancelTimer:0], @"0 is never a timer id.");
+    XCTAssertEqualObjects([_wheel statistics][kJSTimerWheelActiveTimers], @128, @"All new timers should be kept.");
+
+    XCTAssert([self runUntilFired:128 timeout:1], @"The new timers should fire.");
+}
+
+- (void)testClearIntervalInHandler
+{
+    __block JSTimerId intervalId = 0;
+    __block NSUInteger calls = 0;
+    __block BOOL repeated = NO;
+    __weak typeof(self) weakSelf = self;
+    self.onFire = ^(id target, BOOL repeats) {
+        calls++;
+        repeated = repeats;
+        XCTAssertEqualObjects([weakSelf.wheel cancelTimer:intervalId], @"interval",
+                              @"The interval should be cancellable from its handler.");
+    };
+
+    intervalId = [_wheel scheduleTimerAfter:10 repeats:YES target:@"interval" argument:nil];
+    XCTAssert([self runUntilFired:1 timeout:1], @"The interval should fire.");
+    [self runFor:0.1];
+
+    XCTAssertEqual(calls, (NSUInteger)1, @"A cleared interval must not fire again.");
+    XCTAssert(repeated, @"The handler of an interval is told it repeats.");
+    XCTAssertEqualObjects([_wheel statistics][kJSTimerWheelActiveTimers], @0, @"No timer should be left.");
+}
+
+- (void)testIntervalRepeats
+{
+    JSTimerId intervalId = [_wheel scheduleTimerAfter:10 repeats:YES target:@"interval" argument:nil];
+    XCTAssert([self runUntilFired:3 timeout:1], @"The interval should fire repeatedly.");
+    XCTAssertEqualObjects([_wheel cancelTimer:intervalId], @"interval", @"The interval should still be scheduled.");
+}
+
+- (void)testLeewayPerClass
+{
+    [_wheel setLeeway:500 forClass:JSTimerClassRequestTimeout];
+    XCTAssertEqual([_wheel leewayForClass:JSTimerClassRequestTimeout], 500.0, @"The leeway should be kept.");
+    XCTAssertEqual([_wheel leewayForClass:JSTimerClassPrecise], 0.0, @"Other classes should stay precise.");
+
+    [_wheel scheduleTimerAfter:10000 repeats:NO timerClass:JSTimerClassRequestTimeout target:@"request" argument:@"r1"];
+    [_wheel scheduleTimerAfter:10000 repeats:NO timerClass:JSTimerClassPrecise target:@"precise" argument:nil];
+    [_wheel scheduleTimerAfter:1000 repeats:NO timerClass:JSTimerClassRequestTimeout target:@"short" argument:@"r2"];
+
+    NSMutableDictionary *leeways = [NSMutableDictionary dictionary];
+    NSMutableDictionary *classes = [NSMutableDictionary dictionary];
+    [_wheel enumerateTimersUsingBlock:^(id target, id argument, NSDictionary *timer) {
+        leeways[target] = timer[kJSTimerWheelTimerLeeway];
+        classes[target] = timer[kJSTimerWheelTimerClass];
+    }];
+    XCTAssertEqualObjects(leeways[@"request"], @500, @"A request timeout should get the leeway of its class.");
+    XCTAssertEqualObjects(leeways[@"precise"], @0, @"A precise timer should get no leeway.");
+    XCTAssertEqualObjects(leeways[@"short"], @100, @"The leeway should be capped at a tenth of the delay.");
+    XCTAssertEqualObjects(classes[@"request"], @(JSTimerClassRequestTimeout), @"The class should be listed.");
+    XCTAssertEqualObjects([_wheel statistics][kJSTimerWheelCoalescedTimers], @2, @"Two timers should be coalesced.");
+
+    JSTimerId intervalId = [_wheel scheduleTimerAfter:10 repeats:YES target:@"interval" argument:nil];
+    __block NSNumber *intervalClass;
+    [_wheel enumerateTimersUsingBlock:^(id target, id argument, NSDictionary *timer) {
+        if ([target isEqual:@"interval"]) {
+            intervalClass = timer[kJSTimerWheelTimerClass];
+        }
+    }];
+    XCTAssertEqualObjects(intervalClass, @(JSTimerClassInterval), @"A repeating timer should be an interval.");
+    [_wheel cancelTimer:intervalId];
+}
+
+// Scheduling and cancelling request timeouts, most of which never fire
+- (void)testChurnPerformance
+{
+    static const NSUInteger count = 100000;
+    JSTimerId *ids = malloc(count * sizeof(JSTimerId));
+
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < count; i++) {
+            NSTimeInterval delay = 1000 + (i * 7919) % 60000;
+            ids[i] = [self.wheel scheduleTimerAfter:delay
+                                            repeats:NO
+                                         timerClass:JSTimerClassRequestTimeout
+                                             target:@"churn"
+                                           argument:nil];
+        }
+        for (NSUInteger i = 0; i < count; i++) {
+            [self.wheel cancelTimer:ids[i]];
+        }
+    }];
+
+    free(ids);
+    NSDictionary *statistics = [_wheel statistics];
+    NSLog(@"%@ timers created, %@ cancelled, %@ per second", statistics[kJSTimerWheelCreatedTimers],
+          statistics[kJSTimerWheelCancelledTimers], statistics[kJSTimerWheelChurnPerSecond]);
+}
+
+@end
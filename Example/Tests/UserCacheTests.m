@@ -0,0 +1,151 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  UserCacheTests.m
+//  CircuitSDK
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <CircuitSDK/CircuitSDK.h>
+
+static NSDictionary *CKTTestUser(NSString *userId)
+{
+    return @{ @"userId" : userId, @"emailAddress" : [userId stringByAppendingString:@"@Example.com"] };
+}
+
+static NSDictionary *CKTTestPresence(NSString *userId)
+{
+    return @{ @"userId" : userId, @"state" : @"AVAILABLE" };
+}
+
+@interface UserCacheTests : XCTestCase
+
+@property (nonatomic, strong) CKTUserCache *cache;
+
+@end
+
+@implementation UserCacheTests
+
+- (void)setUp
+{
+    [super setUp];
+    _cache = [[CKTUserCache alloc] init];
+    _cache.capacity = 3;
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    _cache.capacity = 0;
+    _cache = nil;
+}
+
+- (void)testLookup
+{
+    [_cache storeUsers:@[ CKTTestUser(@"u1"), CKTTestUser(@"u2") ]];
+
+    XCTAssertEqualObjects([_cache userWithId:@"u1"], CKTTestUser(@"u1"), @"The user should be found by id.");
+    XCTAssertEqualObjects([_cache userWithEmail:@"u2@example.com"], CKTTestUser(@"u2"),
+                          @"The user should be found by email, ignoring the case.");
+    XCTAssertNil([_cache userWithId:@"u3"], @"Unknown users are a miss.");
+
+    NSArray *expected = @[ CKTTestUser(@"u2"), CKTTestUser(@"u1") ];
+    XCTAssertEqualObjects([_cache usersWithIds:@[ @"u2", @"u1" ]], expected, @"The users should keep the order.");
+    XCTAssertNil([_cache usersWithIds:@[ @"u1", @"u3" ]], @"A partial answer is a miss.");
+
+    NSDictionary *statistics = [_cache statistics];
+    XCTAssertEqualObjects(statistics[kCKTUserCacheHits], @5, @"Unexpected number of hits.");
+    XCTAssertEqualObjects(statistics[kCKTUserCacheMisses], @2, @"Unexpected number of misses.");
+}
+
+- (void)testLeastRecentlyUsedEviction
+{
+    [_cache storeUsers:CKTTestUser(@"u1")];
+    [_cache storeUsers:CKTTestUser(@"u2")];
+    [_cache storeUsers:CKTTestUser(@"u3")];
+
+    // u1 becomes the most recently used, u2 the least
+    XCTAssertNotNil([_cache userWithId:@"u1"], @"u1 should be cached.");
+    [_cache storePresence:CKTTestPresence(@"u3") full:NO];
+
+    [_cache storeUsers:CKTTestUser(@"u4")];
+    XCTAssertNil([_cache userWithId:@"u2"], @"The least recently used user should be evicted.");
+    XCTAssertNil([_cache userWithEmail:@"u2@example.com"], @"The email of an evicted user should be dropped.");
+    XCTAssertNotNil([_cache userWithId:@"u1"], @"A recently looked up user should be kept.");
+    XCTAssertNotNil([_cache userWithId:@"u3"], @"A user with a recent presence update should be kept.");
+    XCTAssertNotNil([_cache userWithId:@"u4"], @"The newest user should be kept.");
+    XCTAssertEqualObjects([_cache statistics][kCKTUserCacheEvictions], @1, @"One user should be evicted.");
+
+    _cache.capacity = 1;
+    XCTAssertEqualObjects([_cache statistics][kCKTUserCacheUsers], @1, @"Lowering the capacity should trim.");
+    XCTAssertNotNil([_cache userWithId:@"u4"], @"The most recently used user should be kept.");
+}
+
+- (void)testProfileTimeToLive
+{
+    _cache.profileTimeToLive = 0.05;
+    [_cache storeUsers:CKTTestUser(@"u1")];
+    XCTAssertNotNil([_cache userWithId:@"u1"], @"A fresh profile should be a hit.");
+
+    [NSThread sleepForTimeInterval:0.1];
+    XCTAssertNil([_cache userWithId:@"u1"], @"An expired profile should be a miss.");
+    XCTAssertEqualObjects([_cache statistics][kCKTUserCacheExpired], @1, @"The miss should count as expired.");
+
+    [_cache storeUsers:CKTTestUser(@"u1")];
+    XCTAssertNotNil([_cache userWithId:@"u1"], @"Storing the profile again should refresh it.");
+}
+
+- (void)testPresenceTimeToLive
+{
+    _cache.presenceTimeToLive = 0.05;
+    [_cache storeUsers:CKTTestUser(@"u1")];
+    [_cache storePresence:CKTTestPresence(@"u1") full:NO];
+
+    XCTAssertNotNil([_cache presenceOfUser:@"u1" full:NO], @"A fresh presence should be a hit.");
+    XCTAssertNil([_cache presenceOfUser:@"u1" full:YES], @"A basic presence does not answer a full one.");
+
+    [NSThread sleepForTimeInterval:0.1];
+    XCTAssertNil([_cache presenceOfUser:@"u1" full:NO], @"An expired presence should be a miss.");
+    XCTAssertNotNil([_cache userWithId:@"u1"], @"The profile expires separately.");
+
+    [_cache storePresence:@[ CKTTestPresence(@"u1") ] full:YES];
+    XCTAssertNotNil([_cache presenceOfUser:@"u1" full:YES], @"A full presence should be a hit.");
+    XCTAssertNotNil([_cache presenceOfUser:@"u1" full:NO], @"A full presence also answers a basic one.");
+}
+
+- (void)testLazyResultsAreCopied
+{
+    JSContext *context = [[JSContext alloc] init];
+    JSValue *value = [context evaluateScript:@"({ userId: 'u1', emailAddress: 'u1@example.com', tags: [{ a: 1 }] })"];
+    [_cache storeUsers:[[CKTLazyDictionary alloc] initWithValue:value]];
+
+    NSDictionary *user = [_cache userWithId:@"u1"];
+    XCTAssertFalse([user isKindOfClass:[CKTLazyDictionary class]], @"The cache should keep a plain copy.");
+    XCTAssertFalse([user[@"tags"] isKindOfClass:[CKTLazyArray class]], @"Nested values should be copied as well.");
+    XCTAssertFalse([user[@"tags"][0] isKindOfClass:[CKTLazyDictionary class]], @"Nested values should be copied.");
+    XCTAssertEqualObjects(user[@"tags"][0][@"a"], @1, @"The copy should keep the values.");
+}
+
+- (void)testDisabled
+{
+    _cache.capacity = 0;
+    [_cache storeUsers:CKTTestUser(@"u1")];
+    XCTAssertNil([_cache userWithId:@"u1"], @"A disabled cache stores nothing.");
+    XCTAssertFalse(_cache.enabled, @"A capacity of 0 disables the cache.");
+}
+
+@end
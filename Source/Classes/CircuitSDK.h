@@ -26,14 +26,36 @@
 #import "CKTClient.h"
 #import "CKTClient+Auth.h"
 #import "CKTClient+Conversation.h"
+#import "CKTClient+Diagnostics.h"
+#import "CKTClient+Events.h"
+#import "CKTClient+Future.h"
 #import "CKTClient+Logon.h"
+#import "CKTClient+Store.h"
 #import "CKTClient+User.h"
+#import "CKTEventDispatcher.h"
+#import "CKTEventSink.h"
+#import "CKTFuture.h"
+#import "CKTHistogram.h"
 #import "CKTHttp.h"
+#import "CKTLazyDictionary.h"
+#import "CKTLocalStore.h"
 #import "CKTProxyConfiguration.h"
+#import "CKTRequestCoalescer.h"
+#import "CKTRequestTracer.h"
+#import "CKTResultConverter.h"
+#import "CKTSyncEngine.h"
+#import "CKTUserCache.h"
 #import "Element.h"
 #import "JSEngine.h"
+#import "JSFunctionCache.h"
+#import "JSHeapMonitor.h"
 #import "JSNotificationCenter.h"
 #import "JSRunLoop.h"
+#import "JSScriptCache.h"
+#import "JSStartupProfiler.h"
+#import "JSTaskQueue.h"
+#import "JSThreadWatchdog.h"
+#import "JSTimerWheel.h"
 #import "JSValue+an.h"
 #import "Log.h"
 #import "Logger.h"
@@ -41,6 +63,7 @@
 #import "PubSubEvents.h"
 #import "PubSubResults.h"
 #import "PubSubService.h"
+#import "WebSocketConnectionManager.h"
 #import "WebSocketManager.h"
 #import "Window.h"
 #import "XMLHttpRequest.h"
@@ -0,0 +1,79 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTFuture.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class Promise;
+
+typedef NS_ENUM(NSInteger, CKTFutureError) {
+    CKTFutureErrorTimedOut = 1  // Passed to the completions still pending when the timeout expires
+};
+
+typedef void (^CKTFutureCompletion)(id data, NSError *error);
+
+// Handle for the CKTClient requests made within -run:, allowing to cancel them, give them a deadline and choose the
+// queue their completions are called on.
+//
+//   CKTFuture *future = [[CKTFuture futureWithTimeout:10 deliveryQueue:dispatch_get_main_queue()] run:^{
+//       [[CKTClient sharedInstance] getConversationItems:convId options:nil completion:^(id items, NSError *error) {
+//           ...
+//       }];
+//   }];
+//   ...
+//   [future cancel];
+//
+// After -cancel no completion of the future is called. Requests not sent yet are dropped, the promises of the
+// requests in flight are cancelled so that their results are never converted and their JS callbacks are released.
+// When the timeout expires the pending completions are called with CKTFutureErrorTimedOut and the requests are
+// cancelled the same way.
+@interface CKTFuture : NSObject
+
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, readonly, getter=isTimedOut) BOOL timedOut;
+
+// YES once all completions have been called, or the future was cancelled or timed out
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+// A timeout of 0 means no deadline, a nil queue calls the completions on the JS thread as without a future
++ (instancetype)futureWithTimeout:(NSTimeInterval)timeout deliveryQueue:(dispatch_queue_t)queue;
+
+// Runs the block, CKTClient requests made within it belong to the future. The deadline starts now.
+- (instancetype)run:(void (^)(void))requests;
+
+- (void)cancel;
+
+#pragma mark - Used by the SDK
+
+// The future whose -run: block or requests are executing on the current thread, if any
++ (CKTFuture *)currentFuture;
+
+// Executes the block with the given future as current future
++ (void)performWithCurrentFuture:(CKTFuture *)future block:(dispatch_block_t)block;
+
+// Returns the completion to be passed to the promise of a request, which calls the given completion unless the
+// future was cancelled or timed out. Returns nil if the request must not be sent, in which case the timeout error
+// has already been delivered if the deadline passed.
+- (CKTFutureCompletion)completionForCompletion:(CKTFutureCompletion)completion;
+
+// Registers the promise of a request to be cancelled with the future, must be called on the JS thread
+- (void)addPromise:(Promise *)promise;
+
+@end
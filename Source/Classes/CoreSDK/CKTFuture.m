@@ -0,0 +1,229 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTFuture.m
+//  CircuitSDK
+//
+//
+
+#import "CKTFuture.h"
+#import "JSEngine.h"
+#import "Log.h"
+#import "Promise.h"
+
+// Not retained, the future is kept alive by the code running it
+static __thread __unsafe_unretained CKTFuture *currentFuture;
+
+@interface CKTFuture ()
+
+@property (nonatomic, assign) NSTimeInterval timeout;
+@property (nonatomic, strong) dispatch_queue_t deliveryQueue;
+
+// Protected by @synchronized(self)
+@property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, assign, getter=isTimedOut) BOOL timedOut;
+@property (nonatomic, strong) NSMutableArray *pendingCompletions;
+
+// JS thread only
+@property (nonatomic, strong) NSMutableArray<Promise *> *promises;
+
+@end
+
+@implementation CKTFuture
+
+static NSString *LOG_TAG = @"[CKTFuture]";
+
++ (instancetype)futureWithTimeout:(NSTimeInterval)timeout deliveryQueue:(dispatch_queue_t)queue
+{
+    CKTFuture *future = [[CKTFuture alloc] init];
+    future.timeout = timeout;
+    future.deliveryQueue = queue;
+    return future;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _pendingCompletions = [NSMutableArray array];
+        _promises = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (instancetype)run:(void (^)(void))requests
+{
+    if (self.timeout > 0) {
+        __weak CKTFuture *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.timeout * NSEC_PER_SEC)),
+                       dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{ [weakSelf expire]; });
+    }
+
+    [CKTFuture performWithCurrentFuture:self block:requests];
+    return self;
+}
+
+- (void)cancel
+{
+    @synchronized(self)
+    {
+        if (self.cancelled || self.timedOut) {
+            return;
+        }
+        self.cancelled = YES;
+        [self.pendingCompletions removeAllObjects];
+    }
+
+    LOGD(LOG_TAG, @"cancel - %p", self);
+    [self cancelPromises];
+}
+
+- (BOOL)isFinished
+{
+    @synchronized(self)
+    {
+        return self.cancelled || self.timedOut || self.pendingCompletions.count == 0;
+    }
+}
+
+#pragma mark - Used by the SDK
+
++ (CKTFuture *)currentFuture
+{
+    return currentFuture;
+}
+
++ (void)performWithCurrentFuture:(CKTFuture *)future block:(dispatch_block_t)block
+{
+    CKTFuture *previous = currentFuture;
+    currentFuture = future;
+    block();
+    currentFuture = previous;
+}
+
+- (CKTFutureCompletion)completionForCompletion:(CKTFutureCompletion)completion
+{
+    CKTFutureCompletion pending = [completion copy];
+    BOOL timedOut;
+
+    // Decided under the lock: either -expire finds the completion pending or the timeout is delivered here
+    @synchronized(self)
+    {
+        if (self.cancelled) {
+            return nil;
+        }
+        timedOut = self.timedOut;
+        if (!timedOut) {
+            [self.pendingCompletions addObject:pending];
+        }
+    }
+
+    if (timedOut) {
+        // The request had not even started when the deadline passed
+        NSError *error = [self timeoutError];
+        [self deliver:^{ pending(nil, error); }];
+        return nil;
+    }
+
+    return ^(id data, NSError *error) {
+        @synchronized(self)
+        {
+            // Cancelled or timed out in the meantime
+            if (![self.pendingCompletions containsObject:pending]) {
+                return;
+            }
+            [self.pendingCompletions removeObject:pending];
+        }
+        [self deliver:^{ pending(data, error); }];
+    };
+}
+
+- (void)addPromise:(Promise *)promise
+{
+    if (!promise) {
+        return;
+    }
+
+    if (self.isCancelled || self.isTimedOut) {
+        [promise cancel];
+        return;
+    }
+    [self.promises addObject:promise];
+}
+
+#pragma mark - internal functions
+
+- (void)expire
+{
+    NSArray *completions;
+
+    @synchronized(self)
+    {
+        if (self.cancelled) {
+            return;
+        }
+        self.timedOut = YES;
+        completions = [self.pendingCompletions copy];
+        [self.pendingCompletions removeAllObjects];
+    }
+
+    if (completions.count == 0) {
+        return;
+    }
+
+    LOGW(LOG_TAG, @"%p timed out after %.1f s, %lu request(s) pending", self, self.timeout,
+         (unsigned long)completions.count);
+
+    NSError *error = [self timeoutError];
+    for (CKTFutureCompletion completion in completions) {
+        [self deliver:^{ completion(nil, error); }];
+    }
+
+    [self cancelPromises];
+}
+
+- (NSError *)timeoutError
+{
+    return [NSError errorWithDomain:@"CircuitKit"
+                               code:CKTFutureErrorTimedOut
+                           userInfo:@{NSLocalizedDescriptionKey : @"The request timed out"}];
+}
+
+- (void)cancelPromises
+{
+    // The promises hold JS references which must be released on the JS thread
+    [[JSEngine sharedInstance] performBlock:^{
+        for (Promise *promise in self.promises) {
+            [promise cancel];
+        }
+        [self.promises removeAllObjects];
+    }
+                                   priority:JSTaskPriorityUserInteractive
+                                      label:"CKTFuture cancel"];
+}
+
+- (void)deliver:(dispatch_block_t)block
+{
+    if (self.deliveryQueue) {
+        dispatch_async(self.deliveryQueue, block);
+    } else if ([NSThread currentThread] == [JSEngine sharedInstance].jsThread) {
+        block();
+    } else {
+        // Without a queue completions are called on the JS thread, also when the timeout expires
+        [[JSEngine sharedInstance] performBlock:block priority:JSTaskPriorityUserInteractive label:"CKTFuture deliver"];
+    }
+}
+
+@end
@@ -0,0 +1,60 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTHistogram.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Keys of the dictionary returned by -[CKTHistogram dictionaryRepresentation]
+extern NSString *const kCKTHistogramCount;
+extern NSString *const kCKTHistogramMean;
+extern NSString *const kCKTHistogramMin;
+extern NSString *const kCKTHistogramMax;
+extern NSString *const kCKTHistogramP50;
+extern NSString *const kCKTHistogramP90;
+extern NSString *const kCKTHistogramP99;
+extern NSString *const kCKTHistogramBuckets;
+
+// Monotonic clock in microseconds, not affected by wall clock changes
+uint64_t CKTMonotonicMicroseconds(void);
+
+// Fixed size latency histogram with power of two buckets (in microseconds). Recording a
+// sample is O(1) and allocation free so it can be used on hot paths such as the JS thread.
+// Not thread safe, callers are expected to serialize access.
+@interface CKTHistogram : NSObject
+
+@property (nonatomic, readonly) uint64_t count;
+@property (nonatomic, readonly) uint64_t min;
+@property (nonatomic, readonly) uint64_t max;
+@property (nonatomic, readonly) double mean;
+
+- (void)recordValue:(uint64_t)microseconds;
+- (void)reset;
+
+// Adds the samples of the given histogram to this one
+- (void)mergeHistogram:(CKTHistogram *)histogram;
+
+// Upper bound (in microseconds) of the bucket containing the given percentile (0.0 - 1.0)
+- (uint64_t)valueAtPercentile:(double)percentile;
+
+// Values are reported in milliseconds. Buckets maps the upper bound of each non empty bucket
+// (in milliseconds) to the number of samples it holds.
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
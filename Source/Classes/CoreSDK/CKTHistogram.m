@@ -0,0 +1,151 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTHistogram.m
+//  CircuitSDK
+//
+//
+
+#import "CKTHistogram.h"
+
+#import <mach/mach_time.h>
+
+NSString *const kCKTHistogramCount = @"count";
+NSString *const kCKTHistogramMean = @"mean";
+NSString *const kCKTHistogramMin = @"min";
+NSString *const kCKTHistogramMax = @"max";
+NSString *const kCKTHistogramP50 = @"p50";
+NSString *const kCKTHistogramP90 = @"p90";
+NSString *const kCKTHistogramP99 = @"p99";
+NSString *const kCKTHistogramBuckets = @"buckets";
+
+// Bucket i holds samples in [2^(i-1), 2^i) microseconds, the last one everything above ~35 minutes
+#define HISTOGRAM_BUCKETS 32
+
+uint64_t CKTMonotonicMicroseconds(void)
+{
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ mach_timebase_info(&timebase); });
+
+    return (mach_absolute_time() * timebase.numer / timebase.denom) / NSEC_PER_USEC;
+}
+
+@interface CKTHistogram () {
+    uint64_t _buckets[HISTOGRAM_BUCKETS];
+    uint64_t _sum;
+}
+
+@end
+
+@implementation CKTHistogram
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        [self reset];
+    }
+    return self;
+}
+
+- (void)recordValue:(uint64_t)microseconds
+{
+    int bucket = microseconds ? (64 - __builtin_clzll(microseconds)) : 0;
+    if (bucket >= HISTOGRAM_BUCKETS) {
+        bucket = HISTOGRAM_BUCKETS - 1;
+    }
+
+    _buckets[bucket]++;
+    _sum += microseconds;
+    _count++;
+
+    if (microseconds < _min) {
+        _min = microseconds;
+    }
+    if (microseconds > _max) {
+        _max = microseconds;
+    }
+}
+
+- (void)reset
+{
+    memset(_buckets, 0, sizeof(_buckets));
+    _sum = 0;
+    _count = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+}
+
+- (void)mergeHistogram:(CKTHistogram *)histogram
+{
+    if (histogram.count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        _buckets[i] += histogram->_buckets[i];
+    }
+    _sum += histogram->_sum;
+    _count += histogram.count;
+    _min = MIN(_min, histogram.min);
+    _max = MAX(_max, histogram.max);
+}
+
+- (double)mean
+{
+    return _count ? (double)_sum / _count : 0;
+}
+
+- (uint64_t)valueAtPercentile:(double)percentile
+{
+    if (_count == 0) {
+        return 0;
+    }
+
+    uint64_t threshold = (uint64_t)ceil(_count * percentile);
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= threshold && _buckets[i]) {
+            // Never report more than what was actually observed
+            return MIN((uint64_t)1 << i, _max);
+        }
+    }
+    return _max;
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    NSMutableDictionary *buckets = [NSMutableDictionary dictionary];
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (_buckets[i]) {
+            buckets[@(((uint64_t)1 << i) / 1000.0)] = @(_buckets[i]);
+        }
+    }
+
+    return @{
+        kCKTHistogramCount : @(_count),
+        kCKTHistogramMean : @(self.mean / 1000.0),
+        kCKTHistogramMin : @(_count ? _min / 1000.0 : 0),
+        kCKTHistogramMax : @(_max / 1000.0),
+        kCKTHistogramP50 : @([self valueAtPercentile:0.5] / 1000.0),
+        kCKTHistogramP90 : @([self valueAtPercentile:0.9] / 1000.0),
+        kCKTHistogramP99 : @([self valueAtPercentile:0.99] / 1000.0),
+        kCKTHistogramBuckets : buckets
+    };
+}
+
+@end
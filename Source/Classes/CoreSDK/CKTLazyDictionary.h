@@ -0,0 +1,65 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTLazyDictionary.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class JSValue;
+
+// Read only views of a JS object or array that convert a field to Objective-C only when it is first accessed,
+// instead of deep copying the whole graph with -[JSValue toObject]. Nested objects and arrays are lazy as well.
+// Functions and undefined fields are left out, null becomes NSNull, like -[JSValue toObject] does.
+//
+// The views read the live JS object, they are not a snapshot: a field is read when it is first accessed and the keys
+// when the view is first counted or enumerated, so changes the JS SDK makes to the object until then show up. Once
+// read, a field keeps its value. Accessing a field that has not been converted yet goes through the JSC bridge and
+// waits for the JS thread to release the VM. Call -freeze (e.g. on the JS thread in the completion block) to take the
+// snapshot: it converts the remaining fields and drops the reference to the JS value, do so before handing the result
+// to another thread for a long time.
+//
+// Copying (-copy, -mutableCopy, -isEqual:) converts all fields, as it enumerates them.
+
+@interface CKTLazyDictionary : NSDictionary
+
+@property (nonatomic, readonly, getter=isFrozen) BOOL frozen;
+
+- (instancetype)initWithValue:(JSValue *)value;
+
+// Bulk mode: returns the value at the dot separated key path (e.g. "conversation.participants" or "items.0.text")
+// fully converted, without converting anything else. Numeric components index into arrays.
+- (id)objectForKeyPath:(NSString *)keyPath;
+
+// Converts all remaining fields, including those of nested objects and arrays, and releases the JS value
+- (void)freeze;
+
+@end
+
+@interface CKTLazyArray : NSArray
+
+@property (nonatomic, readonly, getter=isFrozen) BOOL frozen;
+
+- (instancetype)initWithValue:(JSValue *)value;
+
+// See -[CKTLazyDictionary objectForKeyPath:], the first component is an index
+- (id)objectForKeyPath:(NSString *)keyPath;
+
+- (void)freeze;
+
+@end
@@ -0,0 +1,326 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTLazyDictionary.m
+//  CircuitSDK
+//
+//
+
+#import <JavaScriptCore/JavaScriptCore.h>
+
+#import "CKTLazyDictionary.h"
+#import "CKTResultConverter.h"
+
+// Keys that -[JSValue toObject] would convert: the enumerable properties, without undefined fields and functions.
+// Enumerated through the C API so that nothing is added to the context.
+static NSArray<NSString *> *CKTLazyKeysOfValue(JSValue *value)
+{
+    JSContextRef context = value.context.JSGlobalContextRef;
+    JSObjectRef object = JSValueToObject(context, value.JSValueRef, NULL);
+    if (!object) {
+        return @[];
+    }
+
+    JSPropertyNameArrayRef names = JSObjectCopyPropertyNames(context, object);
+    size_t count = JSPropertyNameArrayGetCount(names);
+    NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:count];
+    for (size_t i = 0; i < count; i++) {
+        JSStringRef name = JSPropertyNameArrayGetNameAtIndex(names, i);
+        JSValueRef field = JSObjectGetProperty(context, object, name, NULL);
+        if (!field || JSValueIsUndefined(context, field)) {
+            continue;
+        }
+        if (JSValueIsObject(context, field) && JSObjectIsFunction(context, (JSObjectRef)field)) {
+            continue;
+        }
+        [keys addObject:CFBridgingRelease(JSStringCopyCFString(kCFAllocatorDefault, name))];
+    }
+    JSPropertyNameArrayRelease(names);
+    return keys;
+}
+
+// Returns nil for undefined and functions
+static id CKTLazyObjectFromValue(JSValue *value)
+{
+    if (!value || [value isUndefined]) {
+        return nil;
+    } else if ([value isNull]) {
+        return [NSNull null];
+    } else if ([value isArray]) {
+        return [[CKTLazyArray alloc] initWithValue:value];
+    } else if ([value isDate]) {
+        return [value toDate];
+    } else if ([value isObject]) {
+        if (JSObjectIsFunction(value.context.JSGlobalContextRef, (JSObjectRef)value.JSValueRef)) {
+            return nil;
+        }
+        return [[CKTLazyDictionary alloc] initWithValue:value];
+    }
+
+    [CKTResultConverter didConvertLazyField];
+    return [value toObject];
+}
+
+static void CKTLazyFreeze(id object)
+{
+    if ([object isKindOfClass:[CKTLazyDictionary class]] || [object isKindOfClass:[CKTLazyArray class]]) {
+        [object freeze];
+    }
+}
+
+// Returns the value at the key path below the given object, see -objectForKeyPath:
+static id CKTLazyObjectForKeyPath(id object, NSArray<NSString *> *components)
+{
+    if ([object isKindOfClass:[CKTLazyDictionary class]] || [object isKindOfClass:[CKTLazyArray class]]) {
+        return [object objectForKeyPath:[components componentsJoinedByString:@"."]];
+    }
+
+    // Already fully converted
+    for (NSString *component in components) {
+        if ([object isKindOfClass:[NSDictionary class]]) {
+            object = object[component];
+        } else if ([object isKindOfClass:[NSArray class]]) {
+            NSInteger index = component.integerValue;
+            object = (index >= 0 && index < (NSInteger)[object count]) ? object[index] : nil;
+        } else {
+            return nil;
+        }
+    }
+    return object;
+}
+
+@implementation CKTLazyDictionary {
+    JSValue *_value;
+    NSArray<NSString *> *_keys;
+    NSMutableDictionary *_converted;
+}
+
+- (instancetype)initWithValue:(JSValue *)value
+{
+    if (self = [super init]) {
+        _value = value;
+        _converted = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - NSDictionary primitives
+
+- (NSUInteger)count
+{
+    return [self keys].count;
+}
+
+- (id)objectForKey:(id)key
+{
+    if (![key isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        id object = _converted[key];
+        if (object || !_value) {
+            return object;
+        }
+
+        object = CKTLazyObjectFromValue(_value[key]);
+        if (object) {
+            _converted[key] = object;
+        }
+        return object;
+    }
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+    return [[self keys] objectEnumerator];
+}
+
+#pragma mark - Bulk conversion
+
+- (id)objectForKeyPath:(NSString *)keyPath
+{
+    NSArray<NSString *> *components = [keyPath componentsSeparatedByString:@"."];
+    NSString *key = components.firstObject;
+
+    @synchronized(self)
+    {
+        id object = _converted[key];
+        if (!object && _value) {
+            JSValue *field = _value[key];
+            if (components.count == 1) {
+                // Deep conversion of the requested value only
+                object = CKTLazyObjectFromValue(field);
+                if ([object isKindOfClass:[CKTLazyDictionary class]] || [object isKindOfClass:[CKTLazyArray class]]) {
+                    object = [field toObject];
+                }
+            } else {
+                object = CKTLazyObjectFromValue(field);
+            }
+            if (object) {
+                _converted[key] = object;
+            }
+        }
+
+        if (components.count == 1) {
+            CKTLazyFreeze(object);
+            return object;
+        }
+        return CKTLazyObjectForKeyPath(object, [components subarrayWithRange:NSMakeRange(1, components.count - 1)]);
+    }
+}
+
+- (BOOL)isFrozen
+{
+    @synchronized(self)
+    {
+        return _value == nil;
+    }
+}
+
+- (void)freeze
+{
+    @synchronized(self)
+    {
+        if (!_value) {
+            return;
+        }
+
+        for (NSString *key in [self keys]) {
+            CKTLazyFreeze([self objectForKey:key]);
+        }
+        _keys = _converted.allKeys;
+        _value = nil;
+    }
+}
+
+#pragma mark - internal functions
+
+- (NSArray<NSString *> *)keys
+{
+    @synchronized(self)
+    {
+        if (!_keys) {
+            _keys = _value ? CKTLazyKeysOfValue(_value) : @[];
+        }
+        return _keys;
+    }
+}
+
+@end
+
+@implementation CKTLazyArray {
+    JSValue *_value;
+    NSUInteger _count;
+    NSPointerArray *_converted;
+}
+
+- (instancetype)initWithValue:(JSValue *)value
+{
+    if (self = [super init]) {
+        _value = value;
+        _count = [value[@"length"] toUInt32];
+        _converted = [NSPointerArray strongObjectsPointerArray];
+        _converted.count = _count;
+    }
+    return self;
+}
+
+#pragma mark - NSArray primitives
+
+- (NSUInteger)count
+{
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    if (index >= _count) {
+        [NSException raise:NSRangeException format:@"index %lu beyond bounds [0 .. %lu]", (unsigned long)index,
+                                                    (unsigned long)_count];
+    }
+
+    @synchronized(self)
+    {
+        id object = (__bridge id)[_converted pointerAtIndex:index];
+        if (object || !_value) {
+            return object;
+        }
+
+        // Arrays can not hold nil, as with -[JSValue toObject] holes become NSNull
+        object = CKTLazyObjectFromValue([_value valueAtIndex:index]) ?: [NSNull null];
+        [_converted replacePointerAtIndex:index withPointer:(__bridge void *)object];
+        return object;
+    }
+}
+
+#pragma mark - Bulk conversion
+
+- (id)objectForKeyPath:(NSString *)keyPath
+{
+    NSArray<NSString *> *components = [keyPath componentsSeparatedByString:@"."];
+    NSInteger index = components.firstObject.integerValue;
+    if (index < 0 || index >= (NSInteger)_count) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        id object = (__bridge id)[_converted pointerAtIndex:index];
+        if (!object && _value) {
+            JSValue *element = [_value valueAtIndex:index];
+            object = CKTLazyObjectFromValue(element);
+            if (components.count == 1 &&
+                ([object isKindOfClass:[CKTLazyDictionary class]] || [object isKindOfClass:[CKTLazyArray class]])) {
+                object = [element toObject];
+            }
+            object = object ?: [NSNull null];
+            [_converted replacePointerAtIndex:index withPointer:(__bridge void *)object];
+        }
+
+        if (components.count == 1) {
+            CKTLazyFreeze(object);
+            return object;
+        }
+        return CKTLazyObjectForKeyPath(object, [components subarrayWithRange:NSMakeRange(1, components.count - 1)]);
+    }
+}
+
+- (BOOL)isFrozen
+{
+    @synchronized(self)
+    {
+        return _value == nil;
+    }
+}
+
+- (void)freeze
+{
+    @synchronized(self)
+    {
+        if (!_value) {
+            return;
+        }
+
+        for (NSUInteger i = 0; i < _count; i++) {
+            CKTLazyFreeze([self objectAtIndex:i]);
+        }
+        _value = nil;
+    }
+}
+
+@end
@@ -0,0 +1,85 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTLocalStore.h
+//  CircuitSDK
+//
+//
+
+
+#import <Foundation/Foundation.h>
+
+#import "CKTEventSink.h"
+
+// Keys of -[CKTLocalStore statistics]
+extern NSString *const kCKTLocalStoreConversations;   // Conversations in the store
+extern NSString *const kCKTLocalStoreItems;           // Items in the store
+extern NSString *const kCKTLocalStoreFileSize;        // Size of the log in bytes
+extern NSString *const kCKTLocalStoreLiveSize;        // Bytes of the log holding current records
+extern NSString *const kCKTLocalStoreLoadTime;        // Milliseconds spent indexing the log when it was opened
+extern NSString *const kCKTLocalStoreWrites;          // Records written
+extern NSString *const kCKTLocalStoreUnchangedWrites; // Records not written since identical to the stored ones
+extern NSString *const kCKTLocalStoreReads;           // Values read
+extern NSString *const kCKTLocalStoreCompactions;     // Times the log was rewritten without superseded records
+extern NSString *const kCKTLocalStoreTruncatedBytes;  // Bytes of a torn record dropped when the log was opened
+extern NSString *const kCKTLocalStoreQueryTime;       // Histogram of the time spent answering a query
+
+// On-device store of the conversations and items of a user, so that an app can draw them right after launch,
+// before the JS SDK is connected, and reconcile with the results of the regular APIs afterwards.
+//
+// Backed by an append only log with an in-memory index (see CKTRecordStore.hpp) in the caches directory. While
+// open it is kept up to date from the conversation and item events and the results of the conversation APIs,
+// writes happen on a background queue. Queries are synchronous and may be made on any thread.
+@interface CKTLocalStore : NSObject<CKTEventSink>
+
+@property (atomic, readonly, getter=isOpen) BOOL open;
+
++ (CKTLocalStore *)sharedInstance;
+
+// Opens the store of the given user, closing the store of another user
+- (BOOL)openForUser:(NSString *)userId error:(NSError **)error;
+- (void)close;
+
+// Removes all records of the open store
+- (void)purge;
+
+// Conversations by decreasing last activity, older than the timestamp (in milliseconds, nil for now)
+- (NSArray<NSDictionary *> *)conversationsBefore:(NSNumber *)timestamp limit:(NSUInteger)limit;
+- (NSDictionary *)conversationWithId:(NSString *)convId;
+
+// Items of a conversation by creation time, newest first before the timestamp or oldest first after it (in
+// milliseconds, nil for no bound)
+- (NSArray<NSDictionary *> *)itemsOfConversation:(NSString *)convId
+                                           before:(BOOL)before
+                                        timestamp:(NSNumber *)timestamp
+                                            limit:(NSUInteger)limit;
+- (NSDictionary *)itemWithId:(NSString *)itemId;
+
+// Results of the JS SDK APIs: a conversation or an array of them, an item or an array of them, a conversation feed
+- (void)storeConversations:(id)conversations;
+- (void)storeItems:(id)items;
+- (void)storeFeed:(id)feed;
+
+// Changes whenever the store is opened, closed or purged. Taken when a request is made and passed with its result,
+// so that the result of a request made for another user (or before a purge) is dropped.
+- (NSUInteger)currentGeneration;
+- (void)storeConversations:(id)conversations generation:(NSUInteger)generation;
+- (void)storeItems:(id)items generation:(NSUInteger)generation;
+- (void)storeFeed:(id)feed generation:(NSUInteger)generation;
+
+- (NSDictionary *)statistics;
+
+@end
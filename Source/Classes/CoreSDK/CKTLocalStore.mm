@@ -0,0 +1,538 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTLocalStore.mm
+//  CircuitSDK
+//
+//
+
+
+#import "CKTLocalStore.h"
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
+#import "Log.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+#include <memory>
+#include "CKTRecordStore.hpp"
+
+NSString *const kCKTLocalStoreConversations = @"conversations";
+NSString *const kCKTLocalStoreItems = @"items";
+NSString *const kCKTLocalStoreFileSize = @"fileSize";
+NSString *const kCKTLocalStoreLiveSize = @"liveSize";
+NSString *const kCKTLocalStoreLoadTime = @"loadTime";
+NSString *const kCKTLocalStoreWrites = @"writes";
+NSString *const kCKTLocalStoreUnchangedWrites = @"unchangedWrites";
+NSString *const kCKTLocalStoreReads = @"reads";
+NSString *const kCKTLocalStoreCompactions = @"compactions";
+NSString *const kCKTLocalStoreTruncatedBytes = @"truncatedBytes";
+NSString *const kCKTLocalStoreQueryTime = @"queryTime";
+
+static NSArray *CKTObjectsOf(id value)
+{
+    if ([value isKindOfClass:[NSArray class]]) {
+        return value;
+    }
+    return [value isKindOfClass:[NSDictionary class]] ? @[ value ] : @[];
+}
+
+static std::string CKTStringOf(id value)
+{
+    NSString *string = [value isKindOfClass:[NSString class]] ? value : nil;
+    return string.length > 0 ? std::string(string.UTF8String) : std::string();
+}
+
+@interface CKTLocalStore () {
+    std::unique_ptr<ckt::RecordStore> _store;
+    // Incremented whenever the store is opened, closed or purged, writes queued before are dropped
+    NSUInteger _generation;
+}
+
+@property (atomic, readwrite, getter=isOpen) BOOL open;
+@property (nonatomic, strong) NSString *storeDirectory;
+@property (nonatomic, strong) dispatch_queue_t writeQueue;
+@property (nonatomic, strong) CKTHistogram *queryTime;
+
+@end
+
+@implementation CKTLocalStore
+
+static NSString *LOG_TAG = @"[CKTLocalStore]";
+
++ (CKTLocalStore *)sharedInstance
+{
+    static CKTLocalStore *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTLocalStore alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _writeQueue = dispatch_queue_create("com.unify.circuitsdk.localstore", DISPATCH_QUEUE_SERIAL);
+        _queryTime = [[CKTHistogram alloc] init];
+
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        _storeDirectory = [caches stringByAppendingPathComponent:@"CircuitSDK/store"];
+    }
+    return self;
+}
+
+#pragma mark - Lifecycle
+
+- (BOOL)openForUser:(NSString *)userId error:(NSError **)error
+{
+    LOGI(LOG_TAG, @"openForUser %@", userId);
+
+    if (userId.length == 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:@"CircuitKit"
+                                         code:0
+                                     userInfo:@{NSLocalizedDescriptionKey : @"A user id is required"}];
+        }
+        return NO;
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtPath:self.storeDirectory
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    NSString *path = [self storePathForUser:userId];
+
+    @synchronized(self)
+    {
+        if (_store && _store->path() == path.UTF8String) {
+            return YES;
+        }
+    }
+
+    // The events of the previous user still buffered are dropped, the one being written goes to its store
+    [[CKTEventDispatcher sharedInstance] removeSink:self];
+    dispatch_sync(self.writeQueue, ^{
+    });
+
+    @synchronized(self)
+    {
+        [self closeStore];
+
+        std::unique_ptr<ckt::RecordStore> store(new ckt::RecordStore(path.UTF8String));
+        std::string message;
+        if (!store->open(&message)) {
+            LOGE(LOG_TAG, @"Error opening the store: %s", message.c_str());
+            if (error) {
+                NSString *description = [NSString stringWithUTF8String:message.c_str()];
+                *error = [NSError errorWithDomain:@"CircuitKit"
+                                             code:0
+                                         userInfo:@{NSLocalizedDescriptionKey : description ?: @""}];
+            }
+            return NO;
+        }
+
+        ckt::RecordStoreStatistics statistics = store->statistics();
+        LOGI(LOG_TAG, @"Indexed %llu conversations and %llu items in %.1f ms",
+             statistics.records[static_cast<size_t>(ckt::RecordKind::Conversation)],
+             statistics.records[static_cast<size_t>(ckt::RecordKind::Item)], statistics.loadTime / 1000.0);
+
+        _store = std::move(store);
+        self.open = YES;
+    }
+
+    NSDictionary *attributes = @{NSFileProtectionKey : NSFileProtectionCompleteUntilFirstUserAuthentication};
+    [[NSFileManager defaultManager] setAttributes:attributes ofItemAtPath:path error:nil];
+
+    [[CKTEventDispatcher sharedInstance] addSink:self queue:self.writeQueue];
+    return YES;
+}
+
+- (void)close
+{
+    LOGI(LOG_TAG, @"close");
+
+    [[CKTEventDispatcher sharedInstance] removeSink:self];
+
+    @synchronized(self)
+    {
+        [self closeStore];
+    }
+}
+
+- (void)purge
+{
+    LOGI(LOG_TAG, @"purge");
+
+    @synchronized(self)
+    {
+        _generation++;
+        if (_store) {
+            _store->clear();
+        }
+    }
+}
+
+#pragma mark - Queries
+
+- (NSArray<NSDictionary *> *)conversationsBefore:(NSNumber *)timestamp limit:(NSUInteger)limit
+{
+    return [self query:ckt::RecordKind::Conversation
+                parent:std::string()
+             direction:ckt::RecordDirection::Before
+               sortKey:timestamp ? timestamp.longLongValue : INT64_MAX
+                 limit:limit];
+}
+
+- (NSDictionary *)conversationWithId:(NSString *)convId
+{
+    return [self get:ckt::RecordKind::Conversation key:CKTStringOf(convId)];
+}
+
+- (NSArray<NSDictionary *> *)itemsOfConversation:(NSString *)convId
+                                           before:(BOOL)before
+                                        timestamp:(NSNumber *)timestamp
+                                            limit:(NSUInteger)limit
+{
+    std::string parent = CKTStringOf(convId);
+    if (parent.empty()) {
+        return @[];
+    }
+
+    if (before) {
+        return [self query:ckt::RecordKind::Item
+                    parent:parent
+                 direction:ckt::RecordDirection::Before
+                   sortKey:timestamp ? timestamp.longLongValue : INT64_MAX
+                     limit:limit];
+    }
+    return [self query:ckt::RecordKind::Item
+                parent:parent
+             direction:ckt::RecordDirection::After
+               sortKey:timestamp ? timestamp.longLongValue : INT64_MIN
+                 limit:limit];
+}
+
+- (NSDictionary *)itemWithId:(NSString *)itemId
+{
+    return [self get:ckt::RecordKind::Item key:CKTStringOf(itemId)];
+}
+
+#pragma mark - Updates
+
+- (void)storeConversations:(id)conversations
+{
+    [self storeConversations:conversations generation:[self currentGeneration]];
+}
+
+- (void)storeItems:(id)items
+{
+    [self storeItems:items generation:[self currentGeneration]];
+}
+
+- (void)storeFeed:(id)feed
+{
+    [self storeFeed:feed generation:[self currentGeneration]];
+}
+
+- (void)storeConversations:(id)conversations generation:(NSUInteger)generation
+{
+    [self write:^{
+        for (id conversation in CKTObjectsOf(conversations)) {
+            [self putConversation:conversation generation:generation];
+        }
+    }];
+}
+
+- (void)storeItems:(id)items generation:(NSUInteger)generation
+{
+    [self write:^{
+        for (id item in CKTObjectsOf(items)) {
+            [self putItem:item generation:generation];
+        }
+    }];
+}
+
+- (void)storeFeed:(id)feed generation:(NSUInteger)generation
+{
+    if (![feed isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+
+    [self write:^{
+        for (id thread in CKTObjectsOf(feed[@"threads"])) {
+            [self putItem:thread[@"parentItem"] generation:generation];
+            for (id comment in CKTObjectsOf(thread[@"comments"])) {
+                [self putItem:comment generation:generation];
+            }
+        }
+    }];
+}
+
+#pragma mark - CKTEventSink
+
+// Called on the write queue. The sink is removed, dropping its buffered events, and the queue drained before another
+// store is opened, so the current generation is the one of the events.
+
+- (void)conversationCreated:(NSDictionary *)event
+{
+    [self putConversation:event[@"conversation"] generation:[self currentGeneration]];
+}
+
+- (void)conversationUpdated:(NSDictionary *)event
+{
+    [self putConversation:event[@"conversation"] generation:[self currentGeneration]];
+}
+
+- (void)itemAdded:(NSDictionary *)event
+{
+    [self putItem:event[@"item"] generation:[self currentGeneration]];
+}
+
+- (void)itemUpdated:(NSDictionary *)event
+{
+    [self putItem:event[@"item"] generation:[self currentGeneration]];
+}
+
+- (void)coalescedEvents:(NSArray<NSDictionary *> *)events notification:(NSString *)name
+{
+    NSUInteger generation = [self currentGeneration];
+    for (NSDictionary *event in events) {
+        [self putConversation:event[@"conversation"] generation:generation];
+        [self putItem:event[@"item"] generation:generation];
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        ckt::RecordStoreStatistics statistics = _store ? _store->statistics() : ckt::RecordStoreStatistics();
+        return @{
+            kCKTLocalStoreConversations : @(statistics.records[static_cast<size_t>(ckt::RecordKind::Conversation)]),
+            kCKTLocalStoreItems : @(statistics.records[static_cast<size_t>(ckt::RecordKind::Item)]),
+            kCKTLocalStoreFileSize : @(statistics.fileBytes),
+            kCKTLocalStoreLiveSize : @(statistics.liveBytes),
+            kCKTLocalStoreLoadTime : @(statistics.loadTime / 1000.0),
+            kCKTLocalStoreWrites : @(statistics.puts + statistics.removes),
+            kCKTLocalStoreUnchangedWrites : @(statistics.unchangedPuts),
+            kCKTLocalStoreReads : @(statistics.reads),
+            kCKTLocalStoreCompactions : @(statistics.compactions),
+            kCKTLocalStoreTruncatedBytes : @(statistics.truncatedBytes),
+            kCKTLocalStoreQueryTime : [self.queryTime dictionaryRepresentation]
+        };
+    }
+}
+
+#pragma mark - internal functions
+
+// Called with the lock held
+- (void)closeStore
+{
+    _generation++;
+    if (_store) {
+        _store->sync();
+        _store.reset();
+    }
+    self.open = NO;
+}
+
+- (NSUInteger)currentGeneration
+{
+    @synchronized(self)
+    {
+        return _generation;
+    }
+}
+
+- (void)write:(dispatch_block_t)block
+{
+    if (!self.isOpen) {
+        return;
+    }
+
+    dispatch_async(self.writeQueue, ^{
+        @autoreleasepool {
+            block();
+        }
+    });
+}
+
+- (void)putConversation:(id)conversation generation:(NSUInteger)generation
+{
+    if (![conversation isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+
+    // Same order as the conversation list
+    NSNumber *sortKey = conversation[@"lastItemModificationTime"] ?: conversation[@"creationTime"];
+    [self put:ckt::RecordKind::Conversation
+               key:CKTStringOf(conversation[@"convId"])
+            parent:std::string()
+           sortKey:[sortKey isKindOfClass:[NSNumber class]] ? sortKey.longLongValue : 0
+            object:conversation
+        generation:generation];
+}
+
+- (void)putItem:(id)item generation:(NSUInteger)generation
+{
+    if (![item isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+
+    NSNumber *sortKey = item[@"creationTime"];
+    [self put:ckt::RecordKind::Item
+               key:CKTStringOf(item[@"itemId"])
+            parent:CKTStringOf(item[@"convId"])
+           sortKey:[sortKey isKindOfClass:[NSNumber class]] ? sortKey.longLongValue : 0
+            object:item
+        generation:generation];
+}
+
+- (void)put:(ckt::RecordKind)kind
+           key:(const std::string &)key
+        parent:(const std::string &)parent
+       sortKey:(int64_t)sortKey
+        object:(NSDictionary *)object
+    generation:(NSUInteger)generation
+{
+    if (key.empty() || ![NSJSONSerialization isValidJSONObject:object]) {
+        return;
+    }
+
+    // Encoded outside of the lock, queries do not wait for it
+    NSData *data = [NSJSONSerialization dataWithJSONObject:object options:0 error:nil];
+    if (!data) {
+        return;
+    }
+    std::string value(static_cast<const char *>(data.bytes), data.length);
+
+    std::unique_ptr<ckt::RecordStore::Compaction> compaction;
+    @synchronized(self)
+    {
+        if (!_store || generation != _generation) {
+            return;
+        }
+        if (!_store->put(kind, key, parent, sortKey, value)) {
+            LOGW(LOG_TAG, @"Error writing record %s", key.c_str());
+        }
+        if (_store->needsCompaction()) {
+            compaction = _store->beginCompaction();
+        }
+    }
+
+    if (compaction) {
+        [self compact:compaction.get() generation:generation];
+    }
+}
+
+// Called on the write queue, the live records are copied without the lock so that queries only wait for the
+// records written in the meantime to be appended and the logs to be swapped
+- (void)compact:(ckt::RecordStore::Compaction *)compaction generation:(NSUInteger)generation
+{
+    uint64_t start = CKTMonotonicMicroseconds();
+    BOOL compacted = compaction->copy();
+    uint64_t copied = CKTMonotonicMicroseconds();
+
+    @synchronized(self)
+    {
+        compacted = compacted && _store && generation == _generation && _store->finishCompaction(compaction);
+    }
+
+    uint64_t end = CKTMonotonicMicroseconds();
+    LOGI(LOG_TAG, @"Compacted the store (%@) in %.1f ms, %.1f ms of it locked", compacted ? @"done" : @"failed",
+         (end - start) / 1000.0, (end - copied) / 1000.0);
+}
+
+- (NSDictionary *)get:(ckt::RecordKind)kind key:(const std::string &)key
+{
+    if (key.empty()) {
+        return nil;
+    }
+
+    uint64_t start = CKTMonotonicMicroseconds();
+    std::string value;
+    @synchronized(self)
+    {
+        if (!_store || !_store->get(kind, key, &value)) {
+            return nil;
+        }
+    }
+
+    NSDictionary *object = [self objectFromValue:value];
+    [self recordQueryTime:CKTMonotonicMicroseconds() - start];
+    return object;
+}
+
+- (NSArray *)query:(ckt::RecordKind)kind
+            parent:(const std::string &)parent
+         direction:(ckt::RecordDirection)direction
+           sortKey:(int64_t)sortKey
+             limit:(NSUInteger)limit
+{
+    uint64_t start = CKTMonotonicMicroseconds();
+    std::vector<std::string> values;
+    @synchronized(self)
+    {
+        if (!_store) {
+            return @[];
+        }
+        _store->query(kind, parent, sortKey, direction, limit, &values);
+    }
+
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:values.size()];
+    for (const std::string &value : values) {
+        NSDictionary *object = [self objectFromValue:value];
+        if (object) {
+            [objects addObject:object];
+        }
+    }
+    [self recordQueryTime:CKTMonotonicMicroseconds() - start];
+    return objects;
+}
+
+- (NSDictionary *)objectFromValue:(const std::string &)value
+{
+    NSData *data = [NSData dataWithBytesNoCopy:const_cast<char *>(value.data()) length:value.size() freeWhenDone:NO];
+    id object = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    return [object isKindOfClass:[NSDictionary class]] ? object : nil;
+}
+
+- (void)recordQueryTime:(uint64_t)time
+{
+    @synchronized(self)
+    {
+        [self.queryTime recordValue:time];
+    }
+}
+
+// The file name is a digest of the user id, so that it is not disclosed by the file system
+- (NSString *)storePathForUser:(NSString *)userId
+{
+    const char *userString = userId.UTF8String;
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(userString, (CC_LONG)strlen(userString), digest);
+
+    NSMutableString *fileName = [NSMutableString string];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [fileName appendFormat:@"%02x", digest[i]];
+    }
+    [fileName appendString:@".log"];
+
+    return [self.storeDirectory stringByAppendingPathComponent:fileName];
+}
+
+@end
@@ -0,0 +1,647 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRecordStore.cpp
+//  CircuitSDK
+//
+//
+
+
+#include "CKTRecordStore.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ckt {
+
+// The log starts with this magic and version, followed by the records. Each record is a little endian header
+// (checksum, payload length, operation, kind, key length, parent length, padding, sort key) followed by the key,
+// the parent and the value. The checksum covers everything after itself.
+static const char kFileMagic[8] = {'C', 'K', 'T', 'S', 'T', 'O', 'R', 'E'};
+static const uint32_t kFileVersion = 1;
+static const size_t kFileHeaderSize = 16;
+static const size_t kRecordHeaderSize = 24;
+
+// Logs smaller than this are never compacted
+static const uint64_t kMinCompactionSize = 1024 * 1024;
+
+// Compaction reads and writes the records in chunks of this size
+static const uint64_t kCopyChunkSize = 1024 * 1024;
+
+enum : uint8_t { kOpPut = 1, kOpRemove = 2 };
+
+static uint32_t fnv1a(const uint8_t *data, size_t length, uint32_t hash = 2166136261u)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t checksumOf(const std::string &value)
+{
+    return fnv1a(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+}
+
+static void putUInt(std::string *buffer, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        buffer->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static uint64_t getUInt(const uint8_t *data, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t monotonicMicroseconds()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+static bool writeAll(int fd, const char *data, size_t length, uint64_t offset)
+{
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t length, uint64_t offset)
+{
+    while (length > 0) {
+        ssize_t count = pread(fd, data, length, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        length -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+// Appends an encoded record to |buffer| and returns the offset of its value within the buffer
+static size_t encodeRecord(std::string *buffer, uint8_t op, RecordKind kind, const std::string &key,
+                           const std::string &parent, int64_t sortKey, const std::string &value)
+{
+    size_t start = buffer->size();
+    putUInt(buffer, 0, 4);
+    putUInt(buffer, key.size() + parent.size() + value.size(), 4);
+    putUInt(buffer, op, 1);
+    putUInt(buffer, static_cast<uint8_t>(kind), 1);
+    putUInt(buffer, key.size(), 2);
+    putUInt(buffer, parent.size(), 2);
+    putUInt(buffer, 0, 2);
+    putUInt(buffer, static_cast<uint64_t>(sortKey), 8);
+    buffer->append(key);
+    buffer->append(parent);
+    size_t valueOffset = buffer->size();
+    buffer->append(value);
+
+    uint8_t *record = reinterpret_cast<uint8_t *>(&(*buffer)[start]);
+    uint32_t checksum = fnv1a(record + 4, buffer->size() - start - 4);
+    for (size_t i = 0; i < 4; i++) {
+        record[i] = static_cast<uint8_t>((checksum >> (8 * i)) & 0xff);
+    }
+    return valueOffset - start;
+}
+
+static size_t recordSize(const std::string &key, const std::string &parent, uint32_t length)
+{
+    return kRecordHeaderSize + key.size() + parent.size() + length;
+}
+
+static std::string fileHeader()
+{
+    std::string header(kFileMagic, sizeof(kFileMagic));
+    putUInt(&header, kFileVersion, 4);
+    putUInt(&header, 0, 4);
+    return header;
+}
+
+RecordStore::RecordStore(std::string path) : path_(std::move(path)) {}
+
+RecordStore::~RecordStore()
+{
+    close();
+}
+
+bool RecordStore::open(std::string *error)
+{
+    if (fd_ >= 0) {
+        return true;
+    }
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd_ < 0) {
+        if (error) {
+            *error = "open " + path_ + ": " + strerror(errno);
+        }
+        return false;
+    }
+
+    uint64_t start = monotonicMicroseconds();
+    if (!load(error)) {
+        close();
+        return false;
+    }
+    statistics_.loadTime = monotonicMicroseconds() - start;
+    return true;
+}
+
+void RecordStore::close()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    reset();
+}
+
+bool RecordStore::put(RecordKind kind, const std::string &key, const std::string &parent, int64_t sortKey,
+                      const std::string &value)
+{
+    if (fd_ < 0 || key.empty() || key.size() > UINT16_MAX || parent.size() > UINT16_MAX || value.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t checksum = checksumOf(value);
+    Index &records = records_[static_cast<size_t>(kind)];
+    auto it = records.find(key);
+    if (it != records.end() && it->second.checksum == checksum && it->second.length == value.size() &&
+        it->second.sortKey == sortKey && it->second.parent == parent) {
+        statistics_.unchangedPuts++;
+        return true;
+    }
+
+    uint64_t offset;
+    if (!append(kOpPut, kind, key, parent, sortKey, value, &offset)) {
+        return false;
+    }
+    index(kind, key, Entry{offset, static_cast<uint32_t>(value.size()), checksum, sortKey, parent});
+    statistics_.puts++;
+    return true;
+}
+
+bool RecordStore::remove(RecordKind kind, const std::string &key)
+{
+    if (fd_ < 0 || !contains(kind, key)) {
+        return false;
+    }
+
+    uint64_t offset;
+    if (!append(kOpRemove, kind, key, std::string(), 0, std::string(), &offset)) {
+        return false;
+    }
+    unindex(kind, key);
+    statistics_.removes++;
+    return true;
+}
+
+bool RecordStore::get(RecordKind kind, const std::string &key, std::string *value)
+{
+    const Index &records = records_[static_cast<size_t>(kind)];
+    auto it = records.find(key);
+    if (it == records.end()) {
+        return false;
+    }
+    return readValue(it->second, value);
+}
+
+bool RecordStore::contains(RecordKind kind, const std::string &key) const
+{
+    const Index &records = records_[static_cast<size_t>(kind)];
+    return records.find(key) != records.end();
+}
+
+void RecordStore::query(RecordKind kind, const std::string &parent, int64_t sortKey, RecordDirection direction,
+                        size_t limit, std::vector<std::string> *values)
+{
+    const Children &children = children_[static_cast<size_t>(kind)];
+    auto group = children.find(parent);
+    if (group == children.end()) {
+        return;
+    }
+
+    const Index &records = records_[static_cast<size_t>(kind)];
+    const auto &members = group->second;
+    size_t found = 0;
+    auto read = [&](const std::pair<int64_t, std::string> &member) {
+        std::string value;
+        if (readValue(records.at(member.second), &value)) {
+            values->push_back(std::move(value));
+            found++;
+        }
+        return limit == 0 || found < limit;
+    };
+
+    if (direction == RecordDirection::Before) {
+        auto it = members.lower_bound(std::make_pair(sortKey, std::string()));
+        while (it != members.begin()) {
+            if (!read(*--it)) {
+                break;
+            }
+        }
+    } else {
+        auto it = members.end();
+        if (sortKey < INT64_MAX) {
+            it = members.lower_bound(std::make_pair(sortKey + 1, std::string()));
+        }
+        for (; it != members.end(); ++it) {
+            if (!read(*it)) {
+                break;
+            }
+        }
+    }
+}
+
+bool RecordStore::clear()
+{
+    if (fd_ < 0) {
+        return false;
+    }
+
+    std::string header = fileHeader();
+    if (ftruncate(fd_, 0) != 0 || !writeAll(fd_, header.data(), header.size(), 0)) {
+        return false;
+    }
+
+    RecordStoreStatistics statistics = statistics_;
+    reset();
+    statistics_ = statistics;
+    size_ = header.size();
+    return true;
+}
+
+bool RecordStore::compact()
+{
+    std::unique_ptr<Compaction> compaction = beginCompaction();
+    return compaction && compaction->copy() && finishCompaction(compaction.get());
+}
+
+std::unique_ptr<RecordStore::Compaction> RecordStore::beginCompaction()
+{
+    if (fd_ < 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Compaction> compaction(new Compaction());
+    compaction->path_ = path_ + ".compact";
+    compaction->epoch_ = epoch_;
+    compaction->sourceSize_ = size_;
+    compaction->sourceFd_ = dup(fd_);
+    compaction->fd_ = ::open(compaction->path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (compaction->sourceFd_ < 0 || compaction->fd_ < 0) {
+        return nullptr;
+    }
+
+    // Only the location of the live records is taken, copy() reads them back whole
+    for (size_t kind = 0; kind < static_cast<size_t>(RecordKind::NumberOfKinds); kind++) {
+        compaction->records_.reserve(compaction->records_.size() + records_[kind].size());
+        for (const auto &record : records_[kind]) {
+            const Entry &entry = record.second;
+            compaction->records_.push_back(
+                Compaction::Span{entry.offset - kRecordHeaderSize - record.first.size() - entry.parent.size(),
+                                 recordSize(record.first, entry.parent, entry.length)});
+        }
+    }
+    std::sort(compaction->records_.begin(), compaction->records_.end(),
+              [](const Compaction::Span &a, const Compaction::Span &b) { return a.offset < b.offset; });
+    return compaction;
+}
+
+bool RecordStore::finishCompaction(Compaction *compaction)
+{
+    if (fd_ < 0 || !compaction || !compaction->copied_ || compaction->epoch_ != epoch_ ||
+        size_ < compaction->sourceSize_) {
+        return false;
+    }
+
+    // Records written since beginCompaction() are appended as they are, replaying them has the same effect
+    uint64_t tail = size_ - compaction->sourceSize_;
+    std::string buffer;
+    for (uint64_t copied = 0; copied < tail; copied += buffer.size()) {
+        buffer.resize(static_cast<size_t>(std::min(tail - copied, kCopyChunkSize)));
+        if (!readAll(fd_, &buffer[0], buffer.size(), compaction->sourceSize_ + copied) ||
+            !writeAll(compaction->fd_, buffer.data(), buffer.size(), compaction->size_ + copied)) {
+            return false;
+        }
+    }
+    if (tail > 0 && fsync(compaction->fd_) != 0) {
+        return false;
+    }
+
+    // The new offsets only replace the current ones once the new log is in place
+    std::vector<std::pair<Entry *, uint64_t>> offsets;
+    for (size_t kind = 0; kind < static_cast<size_t>(RecordKind::NumberOfKinds); kind++) {
+        for (auto &record : records_[kind]) {
+            Entry &entry = record.second;
+            if (entry.offset >= compaction->sourceSize_) {
+                offsets.emplace_back(&entry, entry.offset - compaction->sourceSize_ + compaction->size_);
+                continue;
+            }
+            uint64_t recordOffset = entry.offset - kRecordHeaderSize - record.first.size() - entry.parent.size();
+            auto moved = compaction->moved_.find(recordOffset);
+            if (moved == compaction->moved_.end()) {
+                return false;
+            }
+            offsets.emplace_back(&entry, moved->second + entry.offset - recordOffset);
+        }
+    }
+
+    if (rename(compaction->path_.c_str(), path_.c_str()) != 0) {
+        return false;
+    }
+
+    ::close(fd_);
+    fd_ = compaction->fd_;
+    compaction->fd_ = -1;
+    size_ = compaction->size_ + tail;
+    for (auto &offset : offsets) {
+        offset.first->offset = offset.second;
+    }
+    epoch_++;
+    statistics_.compactions++;
+    return true;
+}
+
+bool RecordStore::needsCompaction() const
+{
+    return fd_ >= 0 && size_ >= kMinCompactionSize && size_ - kFileHeaderSize - liveBytes_ > liveBytes_;
+}
+
+bool RecordStore::sync()
+{
+    return fd_ >= 0 && fsync(fd_) == 0;
+}
+
+RecordStoreStatistics RecordStore::statistics() const
+{
+    RecordStoreStatistics statistics = statistics_;
+    for (size_t kind = 0; kind < static_cast<size_t>(RecordKind::NumberOfKinds); kind++) {
+        statistics.records[kind] = records_[kind].size();
+    }
+    statistics.fileBytes = size_;
+    statistics.liveBytes = liveBytes_;
+    return statistics;
+}
+
+RecordStore::Compaction::~Compaction()
+{
+    if (sourceFd_ >= 0) {
+        ::close(sourceFd_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        unlink(path_.c_str());
+    }
+}
+
+bool RecordStore::Compaction::copy()
+{
+    if (sourceFd_ < 0 || fd_ < 0 || copied_) {
+        return false;
+    }
+
+    std::string buffer = fileHeader();
+    uint64_t written = 0;
+    size_t next = 0;
+    while (next < records_.size()) {
+        // Adjacent records are read at once
+        uint64_t offset = records_[next].offset;
+        uint64_t length = 0;
+        size_t start = buffer.size();
+        while (next < records_.size() && records_[next].offset == offset + length &&
+               (length == 0 || length + records_[next].length <= kCopyChunkSize)) {
+            moved_[records_[next].offset] = written + start + length;
+            length += records_[next].length;
+            next++;
+        }
+
+        buffer.resize(start + static_cast<size_t>(length));
+        if (!readAll(sourceFd_, &buffer[start], static_cast<size_t>(length), offset)) {
+            return false;
+        }
+        if (buffer.size() >= kCopyChunkSize) {
+            if (!writeAll(fd_, buffer.data(), buffer.size(), written)) {
+                return false;
+            }
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    if (!writeAll(fd_, buffer.data(), buffer.size(), written) || fsync(fd_) != 0) {
+        return false;
+    }
+    size_ = written + buffer.size();
+    copied_ = true;
+    return true;
+}
+
+// Internal functions
+
+bool RecordStore::load(std::string *error)
+{
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+        if (error) {
+            *error = "stat " + path_ + ": " + strerror(errno);
+        }
+        return false;
+    }
+
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    const uint8_t *data = nullptr;
+    if (size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            if (error) {
+                *error = "mmap " + path_ + ": " + strerror(errno);
+            }
+            return false;
+        }
+        data = static_cast<const uint8_t *>(mapping);
+    }
+
+    // A log written by another version is not worth migrating, the data is fetched again
+    uint64_t offset = 0;
+    if (size >= kFileHeaderSize && memcmp(data, kFileMagic, sizeof(kFileMagic)) == 0 &&
+        getUInt(data + sizeof(kFileMagic), 4) == kFileVersion) {
+        offset = kFileHeaderSize;
+    }
+
+    while (offset > 0 && size - offset >= kRecordHeaderSize) {
+        const uint8_t *record = data + offset;
+        uint64_t length = getUInt(record + 4, 4);
+        uint8_t op = record[8];
+        uint8_t kind = record[9];
+        size_t keyLength = getUInt(record + 10, 2);
+        size_t parentLength = getUInt(record + 12, 2);
+
+        if (length > size - offset - kRecordHeaderSize || keyLength + parentLength > length ||
+            kind >= static_cast<uint8_t>(RecordKind::NumberOfKinds) || (op != kOpPut && op != kOpRemove) ||
+            fnv1a(record + 4, kRecordHeaderSize - 4 + length) != getUInt(record, 4)) {
+            break;
+        }
+
+        const char *payload = reinterpret_cast<const char *>(record + kRecordHeaderSize);
+        std::string key(payload, keyLength);
+        if (op == kOpPut) {
+            uint32_t valueLength = static_cast<uint32_t>(length - keyLength - parentLength);
+            const uint8_t *value = record + kRecordHeaderSize + keyLength + parentLength;
+            index(static_cast<RecordKind>(kind), key,
+                  Entry{offset + kRecordHeaderSize + keyLength + parentLength, valueLength,
+                        fnv1a(value, valueLength), static_cast<int64_t>(getUInt(record + 16, 8)),
+                        std::string(payload + keyLength, parentLength)});
+        } else {
+            unindex(static_cast<RecordKind>(kind), key);
+        }
+        offset += kRecordHeaderSize + length;
+    }
+
+    if (data) {
+        munmap(const_cast<uint8_t *>(data), static_cast<size_t>(size));
+    }
+
+    if (offset == 0) {
+        reset();
+        std::string header = fileHeader();
+        if (ftruncate(fd_, 0) != 0 || !writeAll(fd_, header.data(), header.size(), 0)) {
+            if (error) {
+                *error = "write " + path_ + ": " + strerror(errno);
+            }
+            return false;
+        }
+        size_ = header.size();
+        return true;
+    }
+
+    // Drop the tail of a record which was being written when the app was terminated
+    if (offset < size) {
+        statistics_.truncatedBytes = size - offset;
+        if (ftruncate(fd_, static_cast<off_t>(offset)) != 0) {
+            if (error) {
+                *error = "truncate " + path_ + ": " + strerror(errno);
+            }
+            return false;
+        }
+    }
+    size_ = offset;
+    return true;
+}
+
+bool RecordStore::append(uint8_t op, RecordKind kind, const std::string &key, const std::string &parent,
+                         int64_t sortKey, const std::string &value, uint64_t *valueOffset)
+{
+    std::string buffer;
+    buffer.reserve(kRecordHeaderSize + key.size() + parent.size() + value.size());
+    size_t offset = encodeRecord(&buffer, op, kind, key, parent, sortKey, value);
+
+    if (!writeAll(fd_, buffer.data(), buffer.size(), size_)) {
+        // Do not leave a partial record behind, the next append would follow it
+        if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            close();
+        }
+        return false;
+    }
+
+    *valueOffset = size_ + offset;
+    size_ += buffer.size();
+    return true;
+}
+
+bool RecordStore::readValue(const Entry &entry, std::string *value)
+{
+    value->resize(entry.length);
+    if (entry.length > 0 && !readAll(fd_, &(*value)[0], entry.length, entry.offset)) {
+        value->clear();
+        return false;
+    }
+    statistics_.reads++;
+    return true;
+}
+
+void RecordStore::index(RecordKind kind, const std::string &key, Entry entry)
+{
+    unindex(kind, key);
+
+    liveBytes_ += recordSize(key, entry.parent, entry.length);
+    children_[static_cast<size_t>(kind)][entry.parent].emplace(entry.sortKey, key);
+    records_[static_cast<size_t>(kind)].emplace(key, std::move(entry));
+}
+
+void RecordStore::unindex(RecordKind kind, const std::string &key)
+{
+    Index &records = records_[static_cast<size_t>(kind)];
+    auto it = records.find(key);
+    if (it == records.end()) {
+        return;
+    }
+
+    const Entry &entry = it->second;
+    liveBytes_ -= recordSize(key, entry.parent, entry.length);
+
+    Children &children = children_[static_cast<size_t>(kind)];
+    auto group = children.find(entry.parent);
+    if (group != children.end()) {
+        group->second.erase(std::make_pair(entry.sortKey, key));
+        if (group->second.empty()) {
+            children.erase(group);
+        }
+    }
+    records.erase(it);
+}
+
+void RecordStore::reset()
+{
+    for (size_t kind = 0; kind < static_cast<size_t>(RecordKind::NumberOfKinds); kind++) {
+        records_[kind].clear();
+        children_[kind].clear();
+    }
+    size_ = 0;
+    liveBytes_ = 0;
+    epoch_++;
+    statistics_ = RecordStoreStatistics();
+}
+
+}  // namespace ckt
@@ -0,0 +1,180 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRecordStore.hpp
+//  CircuitSDK
+//
+//
+
+
+#ifndef CKTRecordStore_hpp
+#define CKTRecordStore_hpp
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ckt {
+
+// Kinds of records kept in the store, each kind has its own key space
+enum class RecordKind : uint8_t {
+    Conversation,
+    Item,
+
+    // Must be last
+    NumberOfKinds
+};
+
+// Direction of a range query relative to its sort key
+enum class RecordDirection {
+    Before,  // Newest first, sort keys lower than the given one
+    After    // Oldest first, sort keys higher than the given one
+};
+
+struct RecordStoreStatistics {
+    uint64_t records[static_cast<size_t>(RecordKind::NumberOfKinds)] = {};
+    uint64_t fileBytes = 0;
+    uint64_t liveBytes = 0;
+    uint64_t loadTime = 0;  // Microseconds spent indexing the log when it was opened
+    uint64_t puts = 0;
+    uint64_t unchangedPuts = 0;
+    uint64_t removes = 0;
+    uint64_t reads = 0;
+    uint64_t compactions = 0;
+    uint64_t truncatedBytes = 0;  // Torn or corrupt bytes dropped from the end of the log when it was opened
+};
+
+// Append only log of opaque values with an in-memory index, written in portable C++ (POSIX file I/O only) so that
+// it can be built and exercised outside of Xcode, see Example/Tests/RecordStore.
+//
+// Every put or remove appends a checksummed record to the log, only the index (key, parent, sort key and offset of
+// the value) is kept in memory and values are read back with pread. Opening the store replays the log, a torn or
+// corrupt tail left by a crash is truncated. Records are grouped by parent (e.g. the items of a conversation) and
+// ordered by their sort key (e.g. the creation time) for range queries. Superseded records stay in the log until
+// compact() rewrites it.
+//
+// Not thread safe, callers are expected to serialize access. The only exception is Compaction::copy().
+class RecordStore {
+public:
+    // Compaction split in steps, so that callers can copy the live records without holding their lock:
+    // beginCompaction() and finishCompaction() are serialized with the other calls, copy() only reads the records
+    // written before beginCompaction() through its own descriptor and may run concurrently with any call.
+    // finishCompaction() appends the records written in the meantime and swaps the logs, it fails if the store was
+    // closed, cleared or compacted since beginCompaction(). Only one compaction at a time.
+    class Compaction {
+    public:
+        ~Compaction();
+
+        Compaction(const Compaction &) = delete;
+        Compaction &operator=(const Compaction &) = delete;
+
+        bool copy();
+
+    private:
+        friend class RecordStore;
+
+        struct Span {
+            uint64_t offset;
+            uint64_t length;
+        };
+
+        Compaction() = default;
+
+        std::string path_;
+        int sourceFd_ = -1;
+        int fd_ = -1;
+        uint64_t epoch_ = 0;
+        uint64_t sourceSize_ = 0;  // Of the log when the compaction began
+        uint64_t size_ = 0;        // Of the new log
+        bool copied_ = false;
+        std::vector<Span> records_;                     // Live records in log order
+        std::unordered_map<uint64_t, uint64_t> moved_;  // Offset of each live record in the old and in the new log
+    };
+
+    explicit RecordStore(std::string path);
+    ~RecordStore();
+
+    RecordStore(const RecordStore &) = delete;
+    RecordStore &operator=(const RecordStore &) = delete;
+
+    // Creates the log if needed and indexes it. A log with an unknown header is discarded.
+    bool open(std::string *error);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Writing a value identical to the current one (same parent, sort key and contents) is a no-op
+    bool put(RecordKind kind, const std::string &key, const std::string &parent, int64_t sortKey,
+             const std::string &value);
+    bool remove(RecordKind kind, const std::string &key);
+    bool get(RecordKind kind, const std::string &key, std::string *value);
+    bool contains(RecordKind kind, const std::string &key) const;
+
+    // Appends to |values| up to |limit| values of the given parent (0 for no limit) in sort key order
+    void query(RecordKind kind, const std::string &parent, int64_t sortKey, RecordDirection direction, size_t limit,
+               std::vector<std::string> *values);
+
+    // Removes every record, keeps the store open
+    bool clear();
+
+    // Rewrites the log with the live records only. Worth doing when needsCompaction() is true.
+    bool compact();
+    std::unique_ptr<Compaction> beginCompaction();
+    bool finishCompaction(Compaction *compaction);
+    bool needsCompaction() const;
+
+    // Flushes the log to stable storage
+    bool sync();
+
+    const std::string &path() const { return path_; }
+    RecordStoreStatistics statistics() const;
+
+private:
+    struct Entry {
+        uint64_t offset;  // Of the value in the log
+        uint32_t length;
+        uint32_t checksum;
+        int64_t sortKey;
+        std::string parent;
+    };
+
+    using Index = std::unordered_map<std::string, Entry>;
+    using Children = std::unordered_map<std::string, std::set<std::pair<int64_t, std::string>>>;
+
+    bool load(std::string *error);
+    bool append(uint8_t op, RecordKind kind, const std::string &key, const std::string &parent, int64_t sortKey,
+                const std::string &value, uint64_t *valueOffset);
+    bool readValue(const Entry &entry, std::string *value);
+    void index(RecordKind kind, const std::string &key, Entry entry);
+    void unindex(RecordKind kind, const std::string &key);
+    void reset();
+
+    std::string path_;
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    uint64_t liveBytes_ = 0;
+    uint64_t epoch_ = 0;  // Incremented whenever the log is replaced or emptied
+    Index records_[static_cast<size_t>(RecordKind::NumberOfKinds)];
+    Children children_[static_cast<size_t>(RecordKind::NumberOfKinds)];
+    RecordStoreStatistics statistics_;
+};
+
+}  // namespace ckt
+
+#endif /* CKTRecordStore_hpp */
@@ -0,0 +1,67 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRequestCoalescer.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Keys of the dictionary returned by -[CKTRequestCoalescer statistics]
+extern NSString *const kCKTCoalescerSharedRequests;  // Read requests sent to the JS SDK that could be shared
+extern NSString *const kCKTCoalescerSharedHits;      // Requests answered by an identical request in flight
+extern NSString *const kCKTCoalescerMergedUsers;     // getUserById calls merged into a getUsersById batch
+extern NSString *const kCKTCoalescerUserBatches;     // getUsersById batches sent for merged getUserById calls
+
+typedef void (^CKTCoalescerCompletion)(id data, NSError *error);
+
+// Book keeping for the de-duplication of identical read requests and the batching of getUserById calls.
+// Apart from the statistics and the configuration all methods must be called on the JS thread.
+@interface CKTRequestCoalescer : NSObject
+
+// Disabled by default
+@property (atomic, assign, getter=isEnabled) BOOL enabled;
+
+// Time during which getUserById calls are collected into one getUsersById request while enabled, 10 ms by
+// default. 0 disables the batching.
+@property (atomic, assign) NSTimeInterval userBatchWindow;
+
++ (CKTRequestCoalescer *)sharedInstance;
+
+// Returns the key identifying the request if the function is a read request that can be shared, nil otherwise
+- (NSString *)keyForFunction:(NSString *)functionName args:(NSArray *)args;
+
+// Returns nil if an identical request is in flight, the completion is then invoked with its result.
+// Otherwise returns the completion to be passed to the request, which invokes the given completion and
+// those of all requests joining in the meantime.
+- (CKTCoalescerCompletion)shareRequestWithKey:(NSString *)key completion:(CKTCoalescerCompletion)completion;
+
+// Adds a getUserById call to the current batch. Returns YES if this starts a new batch, in which case the
+// caller has to send the batch after userBatchWindow.
+- (BOOL)addPendingUserId:(NSString *)userId completion:(CKTCoalescerCompletion)completion;
+
+// User id -> array of completions of the current batch. Starts a new batch.
+- (NSDictionary<NSString *, NSArray<CKTCoalescerCompletion> *> *)takePendingUserIds;
+
+// Forgets the requests in flight and fails the getUserById calls of the current batch, used when the JS
+// environment is reset or cleared and their promises will never settle
+- (void)discardPendingRequests;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
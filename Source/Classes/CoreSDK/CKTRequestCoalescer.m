@@ -0,0 +1,210 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRequestCoalescer.m
+//  CircuitSDK
+//
+//
+
+#import "CKTRequestCoalescer.h"
+#import "Log.h"
+
+NSString *const kCKTCoalescerSharedRequests = @"sharedRequests";
+NSString *const kCKTCoalescerSharedHits = @"sharedHits";
+NSString *const kCKTCoalescerMergedUsers = @"mergedUsers";
+NSString *const kCKTCoalescerUserBatches = @"userBatches";
+
+@interface CKTRequestCoalescer ()
+
+@property (nonatomic, strong) NSSet<NSString *> *sharedFunctions;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray *> *requestsInFlight;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray *> *pendingUserIds;
+
+@property (nonatomic, assign) uint64_t sharedRequests;
+@property (nonatomic, assign) uint64_t sharedHits;
+@property (nonatomic, assign) uint64_t mergedUsers;
+@property (nonatomic, assign) uint64_t userBatches;
+
+@end
+
+@implementation CKTRequestCoalescer
+
+static NSString *LOG_TAG = @"[CKTRequestCoalescer]";
+
++ (CKTRequestCoalescer *)sharedInstance
+{
+    static CKTRequestCoalescer *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTRequestCoalescer alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _enabled = NO;
+        _userBatchWindow = 0.01;
+
+        // Read only JS SDK functions whose result does not depend on who asked
+        _sharedFunctions = [NSSet setWithArray:@[
+            @"getConversationById", @"getLoggedOnUser", @"getPresence", @"getUserByEmail", @"getUserById",
+            @"getUsersById"
+        ]];
+        _requestsInFlight = [NSMutableDictionary dictionary];
+        _pendingUserIds = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - De-duplication
+
+- (NSString *)keyForFunction:(NSString *)functionName args:(NSArray *)args
+{
+    if (!self.enabled || ![self.sharedFunctions containsObject:functionName]) {
+        return nil;
+    }
+
+    if (!args.count) {
+        return functionName;
+    }
+
+    if (![NSJSONSerialization isValidJSONObject:args]) {
+        return nil;
+    }
+
+    NSData *json = [NSJSONSerialization dataWithJSONObject:args options:0 error:nil];
+    if (!json) {
+        return nil;
+    }
+
+    return [NSString stringWithFormat:@"%@:%@", functionName,
+                                      [[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding]];
+}
+
+- (CKTCoalescerCompletion)shareRequestWithKey:(NSString *)key completion:(CKTCoalescerCompletion)completion
+{
+    NSMutableArray *completions = self.requestsInFlight[key];
+    if (completions) {
+        LOGD(LOG_TAG, @"Joining request in flight: %@", key);
+        [completions addObject:[completion copy]];
+        @synchronized(self)
+        {
+            self.sharedHits++;
+        }
+        return nil;
+    }
+
+    completions = [NSMutableArray arrayWithObject:[completion copy]];
+    self.requestsInFlight[key] = completions;
+    @synchronized(self)
+    {
+        self.sharedRequests++;
+    }
+
+    __weak CKTRequestCoalescer *weakSelf = self;
+    return ^(id data, NSError *error) {
+        // Requests made from within the completions must not join this one. After -discardPendingRequests the
+        // key may belong to a newer request, which stays in flight.
+        CKTRequestCoalescer *strongSelf = weakSelf;
+        if (strongSelf.requestsInFlight[key] == completions) {
+            [strongSelf.requestsInFlight removeObjectForKey:key];
+        }
+        for (CKTCoalescerCompletion waiting in completions) {
+            waiting(data, error);
+        }
+    };
+}
+
+#pragma mark - getUserById batching
+
+- (BOOL)addPendingUserId:(NSString *)userId completion:(CKTCoalescerCompletion)completion
+{
+    BOOL newBatch = (self.pendingUserIds.count == 0);
+
+    NSMutableArray *completions = self.pendingUserIds[userId];
+    if (!completions) {
+        completions = [NSMutableArray array];
+        self.pendingUserIds[userId] = completions;
+    }
+    [completions addObject:[completion copy]];
+
+    return newBatch;
+}
+
+- (NSDictionary<NSString *, NSArray<CKTCoalescerCompletion> *> *)takePendingUserIds
+{
+    NSDictionary *pending = self.pendingUserIds;
+    self.pendingUserIds = [NSMutableDictionary dictionary];
+
+    if (pending.count > 1) {
+        @synchronized(self)
+        {
+            self.userBatches++;
+            self.mergedUsers += pending.count;
+        }
+    }
+    return pending;
+}
+
+- (void)discardPendingRequests
+{
+    LOGD(LOG_TAG, @"discardPendingRequests - %lu requests in flight, %lu pending user ids",
+         (unsigned long)self.requestsInFlight.count, (unsigned long)self.pendingUserIds.count);
+
+    // The requests in flight are failed with their promises, see +[Promise discardPendingCallbacks]
+    [self.requestsInFlight removeAllObjects];
+
+    // The batch will not be sent anymore
+    NSDictionary<NSString *, NSArray<CKTCoalescerCompletion> *> *pendingUserIds = self.pendingUserIds;
+    self.pendingUserIds = [NSMutableDictionary dictionary];
+
+    NSError *error = [NSError errorWithDomain:@"CircuitKit"
+                                         code:0
+                                     userInfo:@{NSLocalizedDescriptionKey : @"The JS environment has been reset"}];
+    for (NSArray<CKTCoalescerCompletion> *completions in pendingUserIds.allValues) {
+        for (CKTCoalescerCompletion completion in completions) {
+            completion(nil, error);
+        }
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        return @{
+            kCKTCoalescerSharedRequests : @(self.sharedRequests),
+            kCKTCoalescerSharedHits : @(self.sharedHits),
+            kCKTCoalescerMergedUsers : @(self.mergedUsers),
+            kCKTCoalescerUserBatches : @(self.userBatches)
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        self.sharedRequests = 0;
+        self.sharedHits = 0;
+        self.mergedUsers = 0;
+        self.userBatches = 0;
+    }
+}
+
+@end
@@ -0,0 +1,77 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRequestTracer.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Points in the life of an API request where a trace record is stamped
+typedef NS_ENUM(NSInteger, CKTTracePoint) {
+    CKTTracePointEntry,            // -[CKTService executeFunction:...] was entered
+    CKTTracePointSent,             // -[WebSocketManager send:] sent the matching request
+    CKTTracePointResponse,         // The response frame with the matching request id was received
+    CKTTracePointResolved,         // The native Promise was resolved or rejected
+    CKTTracePointCompletionStart,  // The completion block is about to be invoked
+    CKTTracePointCompletionEnd,    // The completion block has returned
+
+    // Must be last
+    CKTTracePointNumberOfPoints
+};
+
+// Phases reported per API in -[CKTRequestTracer latencyStatistics]
+extern NSString *const kCKTTracePhaseRequest;     // Entry until the request hits the WebSocket
+extern NSString *const kCKTTracePhaseNetwork;     // Request sent until response received (socket + server)
+extern NSString *const kCKTTracePhaseResponse;    // Response received until the promise is resolved
+extern NSString *const kCKTTracePhaseConversion;  // Promise resolved until the completion is invoked
+extern NSString *const kCKTTracePhaseDelivery;    // Time spent in the completion block
+extern NSString *const kCKTTracePhaseTotal;       // Entry until the completion block returned
+
+@interface CKTRequestTrace : NSObject
+
+@property (nonatomic, readonly) NSString *functionName;
+
+- (void)stamp:(CKTTracePoint)point;
+
+@end
+
+@interface CKTRequestTracer : NSObject
+
+// Tracing is disabled by default. When disabled none of the hooks below allocate or parse anything.
+@property (atomic, assign, getter=isEnabled) BOOL enabled;
+
++ (CKTRequestTracer *)sharedInstance;
+
+// Starts a trace for the given API function. The trace stays "active" until -endActiveTrace is called,
+// so that WebSocket messages sent synchronously in between are correlated with it.
+// Returns nil if tracing is disabled.
+- (CKTRequestTrace *)beginTraceForFunction:(NSString *)functionName;
+- (void)endActiveTrace;
+
+// Records the trace in the per API histograms
+- (void)finishTrace:(CKTRequestTrace *)trace;
+
+// WebSocket hooks, called with the raw JSON frames
+- (void)socketWillSendMessage:(NSString *)json;
+- (void)socketDidReceiveMessage:(NSString *)json;
+
+// Dictionary of API function name -> phase -> histogram dictionary (see CKTHistogram.h)
+- (NSDictionary *)latencyStatistics;
+- (void)resetLatencyStatistics;
+
+@end
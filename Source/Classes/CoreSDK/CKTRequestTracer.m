@@ -0,0 +1,282 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTRequestTracer.m
+//  CircuitSDK
+//
+//
+
+#import "CKTRequestTracer.h"
+#import "CKTHistogram.h"
+#import "Log.h"
+
+NSString *const kCKTTracePhaseRequest = @"request";
+NSString *const kCKTTracePhaseNetwork = @"network";
+NSString *const kCKTTracePhaseResponse = @"response";
+NSString *const kCKTTracePhaseConversion = @"conversion";
+NSString *const kCKTTracePhaseDelivery = @"delivery";
+NSString *const kCKTTracePhaseTotal = @"total";
+
+// Requests whose promise never settles are dropped once this many are outstanding
+static const NSUInteger kCKTMaxPendingTraces = 512;
+
+@interface CKTRequestTrace () {
+    uint64_t _stamps[CKTTracePointNumberOfPoints];
+}
+
+@property (nonatomic, strong) NSNumber *requestId;
+
+- (instancetype)initWithFunctionName:(NSString *)functionName;
+- (uint64_t)timeOf:(CKTTracePoint)point;
+
+@end
+
+@implementation CKTRequestTrace
+
+- (instancetype)initWithFunctionName:(NSString *)functionName
+{
+    if (self = [super init]) {
+        _functionName = [functionName copy];
+        [self stamp:CKTTracePointEntry];
+    }
+    return self;
+}
+
+- (void)stamp:(CKTTracePoint)point
+{
+    // Only the first stamp counts, e.g. a promise rejected after it has been resolved
+    if (_stamps[point] == 0) {
+        _stamps[point] = CKTMonotonicMicroseconds();
+    }
+}
+
+- (uint64_t)timeOf:(CKTTracePoint)point
+{
+    return _stamps[point];
+}
+
+@end
+
+@interface CKTRequestTracer ()
+
+@property (nonatomic, strong) CKTRequestTrace *activeTrace;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, CKTRequestTrace *> *pendingRequests;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableDictionary *> *histograms;
+
+@end
+
+@implementation CKTRequestTracer
+
+static NSString *LOG_TAG = @"[CKTRequestTracer]";
+
++ (CKTRequestTracer *)sharedInstance
+{
+    static CKTRequestTracer *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTRequestTracer alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _enabled = NO;
+        _pendingRequests = [NSMutableDictionary dictionary];
+        _histograms = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - Trace lifecycle
+
+- (CKTRequestTrace *)beginTraceForFunction:(NSString *)functionName
+{
+    if (!self.enabled) {
+        return nil;
+    }
+
+    CKTRequestTrace *trace = [[CKTRequestTrace alloc] initWithFunctionName:functionName];
+    self.activeTrace = trace;
+    return trace;
+}
+
+- (void)endActiveTrace
+{
+    self.activeTrace = nil;
+}
+
+- (void)finishTrace:(CKTRequestTrace *)trace
+{
+    if (!trace) {
+        return;
+    }
+
+    uint64_t entry = [trace timeOf:CKTTracePointEntry];
+    uint64_t sent = [trace timeOf:CKTTracePointSent];
+    uint64_t response = [trace timeOf:CKTTracePointResponse];
+    uint64_t resolved = [trace timeOf:CKTTracePointResolved];
+    uint64_t completionStart = [trace timeOf:CKTTracePointCompletionStart];
+    uint64_t completionEnd = [trace timeOf:CKTTracePointCompletionEnd];
+
+    @synchronized(self)
+    {
+        if (trace.requestId) {
+            [self.pendingRequests removeObjectForKey:trace.requestId];
+        }
+
+        NSMutableDictionary *phases = self.histograms[trace.functionName];
+        if (!phases) {
+            phases = [NSMutableDictionary dictionary];
+            self.histograms[trace.functionName] = phases;
+        }
+
+        // Requests answered locally by the business logic never hit the socket, in which case
+        // the whole time until resolution is accounted to the request phase.
+        if (sent && response) {
+            [self record:sent - entry phase:kCKTTracePhaseRequest in:phases];
+            [self record:response - sent phase:kCKTTracePhaseNetwork in:phases];
+            if (resolved) {
+                [self record:resolved - response phase:kCKTTracePhaseResponse in:phases];
+            }
+        } else if (resolved) {
+            [self record:resolved - entry phase:kCKTTracePhaseRequest in:phases];
+        }
+        if (resolved && completionStart) {
+            [self record:completionStart - resolved phase:kCKTTracePhaseConversion in:phases];
+        }
+        if (completionStart && completionEnd) {
+            [self record:completionEnd - completionStart phase:kCKTTracePhaseDelivery in:phases];
+            [self record:completionEnd - entry phase:kCKTTracePhaseTotal in:phases];
+        }
+    }
+}
+
+#pragma mark - WebSocket hooks
+
+- (void)socketWillSendMessage:(NSString *)json
+{
+    CKTRequestTrace *trace = self.activeTrace;
+    if (!trace || trace.requestId) {
+        return;
+    }
+
+    NSNumber *requestId = [self requestIdFromMessage:json];
+    if (requestId) {
+        [trace stamp:CKTTracePointSent];
+        trace.requestId = requestId;
+        @synchronized(self)
+        {
+            if (self.pendingRequests.count >= kCKTMaxPendingTraces) {
+                LOGW(LOG_TAG, @"Too many outstanding traced requests, dropping %lu",
+                     (unsigned long)self.pendingRequests.count);
+                [self.pendingRequests removeAllObjects];
+            }
+            self.pendingRequests[requestId] = trace;
+        }
+    }
+}
+
+- (void)socketDidReceiveMessage:(NSString *)json
+{
+    if (!self.enabled) {
+        return;
+    }
+
+    @synchronized(self)
+    {
+        if (self.pendingRequests.count == 0) {
+            return;
+        }
+    }
+
+    // Events and requests from the server do not carry a response object
+    if ([json rangeOfString:@"\"response\""].location == NSNotFound) {
+        return;
+    }
+
+    NSNumber *requestId = [self requestIdFromMessage:json];
+    if (requestId) {
+        @synchronized(self)
+        {
+            [self.pendingRequests[requestId] stamp:CKTTracePointResponse];
+        }
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)latencyStatistics
+{
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionary];
+
+    @synchronized(self)
+    {
+        [self.histograms enumerateKeysAndObjectsUsingBlock:^(NSString *function, NSDictionary *phases, BOOL *stop) {
+            NSMutableDictionary *phaseStatistics = [NSMutableDictionary dictionary];
+            [phases enumerateKeysAndObjectsUsingBlock:^(NSString *phase, CKTHistogram *histogram, BOOL *stop) {
+                phaseStatistics[phase] = [histogram dictionaryRepresentation];
+            }];
+            statistics[function] = phaseStatistics;
+        }];
+    }
+
+    return statistics;
+}
+
+- (void)resetLatencyStatistics
+{
+    LOGD(LOG_TAG, @"resetLatencyStatistics");
+
+    @synchronized(self)
+    {
+        [self.histograms removeAllObjects];
+        [self.pendingRequests removeAllObjects];
+    }
+}
+
+#pragma mark - internal functions
+
+- (void)record:(uint64_t)value phase:(NSString *)phase in:(NSMutableDictionary *)phases
+{
+    CKTHistogram *histogram = phases[phase];
+    if (!histogram) {
+        histogram = [[CKTHistogram alloc] init];
+        phases[phase] = histogram;
+    }
+    [histogram recordValue:value];
+}
+
+// Extracts the numeric request id from a request/response frame, e.g.
+// {"msgType":"REQUEST","request":{"requestId":42,...}}. Avoids parsing the whole JSON
+// since frames may be several hundred kilobytes.
+- (NSNumber *)requestIdFromMessage:(NSString *)json
+{
+    NSRange range = [json rangeOfString:@"\"requestId\":"];
+    if (range.location == NSNotFound) {
+        return nil;
+    }
+
+    NSScanner *scanner = [NSScanner scannerWithString:json];
+    scanner.scanLocation = NSMaxRange(range);
+
+    long long requestId;
+    if ([scanner scanLongLong:&requestId]) {
+        return @(requestId);
+    }
+    return nil;
+}
+
+@end
@@ -0,0 +1,50 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTResultConverter.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class JSValue;
+
+// Keys of the dictionary returned by -[CKTResultConverter statistics]
+extern NSString *const kCKTResultConverterEagerTime;     // Histogram (see CKTHistogram.h) of -[JSValue toObject]
+extern NSString *const kCKTResultConverterLazyTime;      // Histogram of the creation of lazy results
+extern NSString *const kCKTResultConverterLazyResults;   // Number of lazy results handed out
+extern NSString *const kCKTResultConverterLazyFields;    // Number of fields converted on access
+
+// Converts the results of the JS SDK functions for the completion blocks
+@interface CKTResultConverter : NSObject
+
+// Lazy conversion (see CKTLazyDictionary.h) of the results of list functions, e.g. getConversations or
+// getConversationItems. Disabled by default.
+@property (atomic, assign, getter=isLazyConversionEnabled) BOOL lazyConversionEnabled;
+
++ (CKTResultConverter *)sharedInstance;
+
+// Returns the result of the given JS SDK function as Objective-C object
+- (id)objectFromValue:(JSValue *)value function:(NSString *)functionName;
+
+// Called by the lazy results for each converted primitive field
++ (void)didConvertLazyField;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
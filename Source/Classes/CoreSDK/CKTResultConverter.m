@@ -0,0 +1,132 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTResultConverter.m
+//  CircuitSDK
+//
+//
+
+#import <JavaScriptCore/JavaScriptCore.h>
+#import <stdatomic.h>
+
+#import "CKTHistogram.h"
+#import "CKTLazyDictionary.h"
+#import "CKTResultConverter.h"
+
+NSString *const kCKTResultConverterEagerTime = @"eagerTime";
+NSString *const kCKTResultConverterLazyTime = @"lazyTime";
+NSString *const kCKTResultConverterLazyResults = @"lazyResults";
+NSString *const kCKTResultConverterLazyFields = @"lazyFields";
+
+// Fields are converted on any thread, counted without a lock
+static atomic_uint_fast64_t lazyFields;
+
+@interface CKTResultConverter ()
+
+@property (nonatomic, strong) NSSet<NSString *> *lazyFunctions;
+
+// Protected by @synchronized(self)
+@property (nonatomic, strong) CKTHistogram *eagerTime;
+@property (nonatomic, strong) CKTHistogram *lazyTime;
+@property (nonatomic, assign) uint64_t lazyResults;
+
+@end
+
+@implementation CKTResultConverter
+
++ (CKTResultConverter *)sharedInstance
+{
+    static CKTResultConverter *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTResultConverter alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _lazyConversionEnabled = NO;
+
+        // Functions returning lists which may hold hundreds of entries
+        _lazyFunctions = [NSSet setWithArray:@[
+            @"getConversationFeed", @"getConversationItems", @"getConversationParticipants", @"getConversations",
+            @"getItemsById", @"getItemsByThread", @"getTenantUsers", @"getUsersById"
+        ]];
+        _eagerTime = [[CKTHistogram alloc] init];
+        _lazyTime = [[CKTHistogram alloc] init];
+    }
+    return self;
+}
+
+- (id)objectFromValue:(JSValue *)value function:(NSString *)functionName
+{
+    uint64_t start = CKTMonotonicMicroseconds();
+
+    id object;
+    BOOL lazy = self.isLazyConversionEnabled && [self.lazyFunctions containsObject:functionName] &&
+                [value isObject];
+    if (!lazy) {
+        object = [value toObject];
+    } else if ([value isArray]) {
+        object = [[CKTLazyArray alloc] initWithValue:value];
+    } else {
+        object = [[CKTLazyDictionary alloc] initWithValue:value];
+    }
+
+    uint64_t duration = CKTMonotonicMicroseconds() - start;
+    @synchronized(self)
+    {
+        if (lazy) {
+            self.lazyResults++;
+            [self.lazyTime recordValue:duration];
+        } else {
+            [self.eagerTime recordValue:duration];
+        }
+    }
+
+    return object;
+}
+
++ (void)didConvertLazyField
+{
+    atomic_fetch_add_explicit(&lazyFields, 1, memory_order_relaxed);
+}
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        return @{
+            kCKTResultConverterEagerTime : [self.eagerTime dictionaryRepresentation],
+            kCKTResultConverterLazyTime : [self.lazyTime dictionaryRepresentation],
+            kCKTResultConverterLazyResults : @(self.lazyResults),
+            kCKTResultConverterLazyFields : @(atomic_load_explicit(&lazyFields, memory_order_relaxed))
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        [self.eagerTime reset];
+        [self.lazyTime reset];
+        self.lazyResults = 0;
+        atomic_store_explicit(&lazyFields, 0, memory_order_relaxed);
+    }
+}
+
+@end
@@ -20,6 +20,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "JSTaskQueue.h"
 
 @class JSValue;
 
@@ -37,6 +38,7 @@ typedef void (^CompletionBlockWithErrorOnly)(NSError *);
 
 - (void)executeSync:(SEL)sel withObject:(id)object;
 - (void)executeAsync:(SEL)sel withObject:(id)object;
+- (void)executeAsync:(SEL)sel withObject:(id)object priority:(JSTaskPriority)priority;
 - (BOOL)executeMyselfAsync:(SEL)me withObject:(id)object;
 
 - (void)executeFunction:(NSString *)functionName
@@ -22,7 +22,13 @@
 #import <JavaScriptCore/JavaScriptCore.h>
 
 #import "CKTService.h"
+#import "CKTFuture.h"
+#import "CKTRequestCoalescer.h"
+#import "CKTRequestTracer.h"
+#import "CKTResultConverter.h"
 #import "JSEngine.h"
+#import "JSFunctionCache.h"
+#import "JSThreadWatchdog.h"
 #import "Log.h"
 #import "Promise.h"
 
@@ -43,9 +49,17 @@ static NSString *LOG_TAG = @"[CKTService]";
 
 - (JSValue *)callFunction:(NSString *)functionName withArguments:(NSArray *)arguments;
 {
-    JSValue *circuit = [self getCircuitObject];
-    JSValue *function = circuit[functionName];
+    JSRunLoop *jsThread = [JSEngine sharedInstance].jsThread;
+
+    // The cache is only there once the scripts are loaded
+    JSFunctionCache *functionCache = jsThread.functionCache;
+    JSValue *function =
+        functionCache ? [functionCache functionNamed:functionName] : [self getCircuitObject][functionName];
+
+    JSThreadWatchdog *watchdog = [JSThreadWatchdog sharedInstance];
+    [watchdog willCallFunction:functionName];
     JSValue *result = [function callWithArguments:arguments];
+    [watchdog didCallFunction];
 
     return result;
 }
@@ -96,6 +110,18 @@ static NSString *LOG_TAG = @"[CKTService]";
     [[JSEngine sharedInstance] performAction:self selector:sel withObject:object waitUntilDone:NO];
 }
 
+/**
+ *  Executes the selector asynchronously with the given scheduling priority
+ *
+ *  @param sel      Function to be executed
+ *  @param object   Argument to be passed into the executed function
+ *  @param priority Scheduling class, e.g. JSTaskPriorityBackground for bulk requests
+ */
+- (void)executeAsync:(SEL)sel withObject:(id)object priority:(JSTaskPriority)priority
+{
+    [[JSEngine sharedInstance] performAction:self selector:sel withObject:object priority:priority];
+}
+
 /**
  *  Executes the function by calling performAction if you are not on the current
  *thread.
@@ -117,77 +143,154 @@ static NSString *LOG_TAG = @"[CKTService]";
     return NO;
 }
 
+// The SDK functions return either our Promise or a JS object holding it in __nativePromise
+- (Promise *)nativePromiseFromValue:(JSValue *)jsPromise
+{
+    if (![jsPromise isObject]) {
+        return nil;
+    }
+
+    // Only the native promise is converted, not the whole wrapper object
+    JSValue *nativePromise = jsPromise[@"__nativePromise"];
+    id promise = [nativePromise isUndefined] ? [jsPromise toObject] : [nativePromise toObject];
+    return [promise isKindOfClass:[Promise class]] ? promise : nil;
+}
+
 - (void)executeFunction:(NSString *)functionName
                    args:(NSArray *)args
       completionHandler:(void (^)(NSDictionary *jsData, NSError *error))completion
 {
-    Promise *promise = [[Promise alloc] init];
+    // Requests made within -[CKTFuture run:] are delivered by the future
+    CKTFuture *future = [CKTFuture currentFuture];
+    if (future) {
+        completion = [future completionForCompletion:completion];
+        if (!completion) {
+            return;
+        }
+    }
+
+    // Identical read requests in flight share one JS call and one promise
+    CKTRequestCoalescer *coalescer = [CKTRequestCoalescer sharedInstance];
+    NSString *sharedKey = [coalescer keyForFunction:functionName args:args];
+
+    // A shared promise is not cancelled with the future, other requests may still wait for it
+    BOOL cancellable = future && !sharedKey;
+
+    if (sharedKey) {
+        completion = [coalescer shareRequestWithKey:sharedKey completion:completion];
+        if (!completion) {
+            return;
+        }
+    }
 
     JSValue *jsPromise;
 
+    CKTRequestTracer *tracer = [CKTRequestTracer sharedInstance];
+    CKTRequestTrace *trace = [tracer beginTraceForFunction:functionName];
+
     jsPromise = [self callFunction:functionName withArguments:args];
 
+    [tracer endActiveTrace];
+
     PromiseCallback successCallback = ^(JSValue *jsData) {
+        if (cancellable && (future.isCancelled || future.isTimedOut)) {
+            // Do not pay for converting a result nobody waits for anymore
+            return;
+        }
         if (![jsData isNull] && ![jsData isUndefined]) {
-            NSDictionary *data = [jsData toObject];
+            NSDictionary *data = [[CKTResultConverter sharedInstance] objectFromValue:jsData function:functionName];
+            [trace stamp:CKTTracePointCompletionStart];
             completion(data, nil);
         } else {
+            [trace stamp:CKTTracePointCompletionStart];
             completion(nil, nil);
         }
+        [trace stamp:CKTTracePointCompletionEnd];
+        [tracer finishTrace:trace];
     };
 
     PromiseCallback errorCallback = ^(JSValue *jsError) {
         NSError *error = JS_SERVICE_NSERROR_FROM_JSERROR(jsError);
         LOGE(LOG_TAG, @"Error: %@", error);
+        [trace stamp:CKTTracePointCompletionStart];
         completion(nil, error);
+        [trace stamp:CKTTracePointCompletionEnd];
+        [tracer finishTrace:trace];
     };
 
-    JSValue *jsSuccessCallback = [JSValue valueWithObject:successCallback inContext:[JSEngine sharedInstance].context];
+    Promise *promise = [self nativePromiseFromValue:jsPromise];
 
-    JSValue *jsErrorCallback = [JSValue valueWithObject:errorCallback inContext:[JSEngine sharedInstance].context];
+    if (trace && promise) {
+        promise.trace = trace;
+        if (promise.resolved || promise.rejected) {
+            // Settled synchronously by the business logic
+            [trace stamp:CKTTracePointResolved];
+        }
+    }
 
-    JSValue *promiseDict = [jsPromise toObject];
+    [promise addSuccessCallback:successCallback errorCallback:errorCallback];
 
-    if ([promiseDict isKindOfClass:[NSDictionary class]]) {
-        promise = [promiseDict valueForKey:@"__nativePromise"];
-    } else {
-        promise = [jsPromise toObject];
+    if (cancellable && promise) {
+        [future addPromise:promise];
     }
-
-    [promise then:jsSuccessCallback:jsErrorCallback];
 }
 
 - (void)executeFunction:(NSString *)functionName
                    args:(NSArray *)args
       completionHandlerWithErrorOnly:(void (^)(NSError *error))completion
 {
-    Promise *promise = [[Promise alloc] init];
+    // Requests made within -[CKTFuture run:] are delivered by the future
+    CKTFuture *future = [CKTFuture currentFuture];
+    if (future) {
+        void (^errorOnlyCompletion)(NSError *error) = completion;
+        CKTFutureCompletion futureCompletion =
+            [future completionForCompletion:^(id data, NSError *error) { errorOnlyCompletion(error); }];
+        if (!futureCompletion) {
+            return;
+        }
+        completion = ^(NSError *error) { futureCompletion(nil, error); };
+    }
 
     JSValue *jsPromise;
 
+    CKTRequestTracer *tracer = [CKTRequestTracer sharedInstance];
+    CKTRequestTrace *trace = [tracer beginTraceForFunction:functionName];
+
     jsPromise = [self callFunction:functionName withArguments:args];
 
+    [tracer endActiveTrace];
+
     PromiseCallback successCallback = ^(JSValue *jsData) {
-            completion(nil);
+        [trace stamp:CKTTracePointCompletionStart];
+        completion(nil);
+        [trace stamp:CKTTracePointCompletionEnd];
+        [tracer finishTrace:trace];
     };
 
     PromiseCallback errorCallback = ^(JSValue *jsError) {
         NSError *error = JS_SERVICE_NSERROR_FROM_JSERROR(jsError);
         LOGE(LOG_TAG, @"Error: %@", error);
+        [trace stamp:CKTTracePointCompletionStart];
         completion(error);
+        [trace stamp:CKTTracePointCompletionEnd];
+        [tracer finishTrace:trace];
     };
 
-    JSValue *jsSuccessCallback = [JSValue valueWithObject:successCallback inContext:[JSEngine sharedInstance].context];
-    JSValue *jsErrorCallback = [JSValue valueWithObject:errorCallback inContext:[JSEngine sharedInstance].context];
-    JSValue *promiseDict = [jsPromise toObject];
+    Promise *promise = [self nativePromiseFromValue:jsPromise];
 
-    if ([promiseDict isKindOfClass:[NSDictionary class]]) {
-        promise = [promiseDict valueForKey:@"__nativePromise"];
-    } else {
-        promise = [jsPromise toObject];
+    if (trace && promise) {
+        promise.trace = trace;
+        if (promise.resolved || promise.rejected) {
+            // Settled synchronously by the business logic
+            [trace stamp:CKTTracePointResolved];
+        }
     }
 
-    [promise then:jsSuccessCallback:jsErrorCallback];
+    [promise addSuccessCallback:successCallback errorCallback:errorCallback];
+
+    if (future && promise) {
+        [future addPromise:promise];
+    }
 }
 
 - (void)executeFunction:(NSString *)functionName
@@ -0,0 +1,77 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTSyncEngine.h
+//  CircuitSDK
+//
+//
+
+
+#import <Foundation/Foundation.h>
+
+#import "CKTEventSink.h"
+
+// Keys of the diffs passed to the sync handler
+extern NSString *const kCKTSyncConversationId;  // Conversation the diff is about
+extern NSString *const kCKTSyncAddedItems;      // Items created since the last known item of the conversation
+extern NSString *const kCKTSyncUpdatedItems;    // Items created before and modified since
+
+// Keys of the dictionary returned by -[CKTSyncEngine statistics]
+extern NSString *const kCKTSyncEngineConversations;        // Conversations with a watermark
+extern NSString *const kCKTSyncEngineSyncs;                // Syncs run
+extern NSString *const kCKTSyncEngineSyncedConversations;  // Conversations queried by the syncs
+extern NSString *const kCKTSyncEngineChangedConversations; // Conversations with a diff
+extern NSString *const kCKTSyncEngineRequests;             // getConversationItems requests made
+extern NSString *const kCKTSyncEngineFailedRequests;       // Requests which failed, the conversation is skipped
+extern NSString *const kCKTSyncEngineAddedItems;           // Items reported as added
+extern NSString *const kCKTSyncEngineUpdatedItems;         // Items reported as updated
+extern NSString *const kCKTSyncEngineSyncTime;             // Histogram of the time from the start to the end of a sync
+
+// Incremental sync of the conversation items after a reconnect.
+//
+// Records the high water marks (newest creation and modification time) of the conversations whose items were
+// fetched or received in events. When the connection comes back, the items modified since the watermark of each
+// conversation are fetched with getConversationItems, a few conversations at a time, and handed to the handler as a
+// diff per conversation, instead of the app refetching full pages. Thread safe.
+@interface CKTSyncEngine : NSObject<CKTEventSink>
+
+// Conversations fetched at the same time, defaults to 4
+@property (atomic, assign) NSUInteger maxConcurrentRequests;
+
+@property (atomic, readonly, getter=isEnabled) BOOL enabled;
+
++ (CKTSyncEngine *)sharedInstance;
+
+// Enables the sync, the handler is called on the queue (main queue if nil) with each diff. A nil handler disables it
+// and forgets the watermarks like removeAllWatermarks.
+- (void)setHandler:(void (^)(NSDictionary *diff))handler queue:(dispatch_queue_t)queue;
+
+// Results of the JS SDK APIs: an item or an array of them, a conversation feed
+- (void)trackItems:(id)items;
+- (void)trackFeed:(id)feed;
+
+// Forgets the watermarks, e.g. when another user logs on. A sync in flight is abandoned: its completions are called
+// and the results of its requests dropped.
+- (void)removeAllWatermarks;
+
+// Syncs the most recently active conversations now, the completion is called on the main queue once all diffs are
+// delivered. Calls made while a sync runs wait for it.
+- (void)synchronize:(void (^)(void))completion;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,548 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTSyncEngine.m
+//  CircuitSDK
+//
+//
+
+
+#import "CKTSyncEngine.h"
+#import "CKTClient+Conversation.h"
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
+#import "JSEngine.h"
+#import "Log.h"
+
+NSString *const kCKTSyncConversationId = @"convId";
+NSString *const kCKTSyncAddedItems = @"added";
+NSString *const kCKTSyncUpdatedItems = @"updated";
+
+NSString *const kCKTSyncEngineConversations = @"conversations";
+NSString *const kCKTSyncEngineSyncs = @"syncs";
+NSString *const kCKTSyncEngineSyncedConversations = @"syncedConversations";
+NSString *const kCKTSyncEngineChangedConversations = @"changedConversations";
+NSString *const kCKTSyncEngineRequests = @"requests";
+NSString *const kCKTSyncEngineFailedRequests = @"failedRequests";
+NSString *const kCKTSyncEngineAddedItems = @"addedItems";
+NSString *const kCKTSyncEngineUpdatedItems = @"updatedItems";
+NSString *const kCKTSyncEngineSyncTime = @"syncTime";
+
+// Conversations synced at a time, the most recently active first
+static const NSUInteger kCKTSyncMaxConversations = 50;
+// Items fetched per request, a full page is followed by a request for the next one
+static const NSUInteger kCKTSyncPageSize = 100;
+
+static NSString *const kCKTConnectionStateConnected = @"Connected";
+
+static NSArray *CKTItemsOf(id value)
+{
+    if ([value isKindOfClass:[NSArray class]]) {
+        return value;
+    }
+    return [value isKindOfClass:[NSDictionary class]] ? @[ value ] : @[];
+}
+
+static int64_t CKTTimeOf(NSDictionary *item, NSString *key)
+{
+    NSNumber *time = item[key];
+    return [time isKindOfClass:[NSNumber class]] ? time.longLongValue : 0;
+}
+
+@interface CKTSyncWatermark : NSObject
+
+@property (nonatomic, assign) int64_t creationTime;
+@property (nonatomic, assign) int64_t modificationTime;
+
+@end
+
+@implementation CKTSyncWatermark
+
+@end
+
+@interface CKTSyncTask : NSObject
+
+@property (nonatomic, strong) NSString *convId;
+// Sync the task belongs to, see -[CKTSyncEngine abandonSync]
+@property (nonatomic, assign) NSUInteger generation;
+// Watermark of the conversation when the sync started, events received since do not move it
+@property (nonatomic, assign) int64_t creationTime;
+// The next request fetches the items modified after this time
+@property (nonatomic, assign) int64_t cursor;
+@property (nonatomic, strong) NSMutableArray *added;
+@property (nonatomic, strong) NSMutableArray *updated;
+
+@end
+
+@implementation CKTSyncTask
+
+@end
+
+@interface CKTSyncEngine () {
+    uint64_t _syncs;
+    uint64_t _syncedConversations;
+    uint64_t _changedConversations;
+    uint64_t _requests;
+    uint64_t _failedRequests;
+    uint64_t _addedItems;
+    uint64_t _updatedItems;
+}
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, CKTSyncWatermark *> *watermarks;
+@property (nonatomic, copy) void (^handler)(NSDictionary *diff);
+@property (nonatomic, strong) dispatch_queue_t handlerQueue;
+@property (nonatomic, strong) dispatch_queue_t eventQueue;
+@property (nonatomic, strong) NSString *connectionState;
+
+// Set while a sync runs
+@property (nonatomic, strong) NSMutableArray *completions;
+@property (nonatomic, strong) NSMutableArray<CKTSyncTask *> *pendingTasks;
+@property (nonatomic, assign) NSUInteger runningTasks;
+@property (nonatomic, assign) uint64_t syncStart;
+// Incremented when a sync is abandoned, the results of its requests are then ignored
+@property (nonatomic, assign) NSUInteger generation;
+@property (nonatomic, strong) CKTHistogram *syncTime;
+
+@end
+
+@implementation CKTSyncEngine
+
+static NSString *LOG_TAG = @"[CKTSyncEngine]";
+
++ (CKTSyncEngine *)sharedInstance
+{
+    static CKTSyncEngine *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTSyncEngine alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _maxConcurrentRequests = 4;
+        _watermarks = [NSMutableDictionary dictionary];
+        _eventQueue = dispatch_queue_create("com.unify.circuitsdk.sync", DISPATCH_QUEUE_SERIAL);
+        _syncTime = [[CKTHistogram alloc] init];
+    }
+    return self;
+}
+
+- (void)setHandler:(void (^)(NSDictionary *diff))handler queue:(dispatch_queue_t)queue
+{
+    LOGD(LOG_TAG, @"setHandler %@", handler ? @"set" : @"removed");
+
+    BOOL wasEnabled;
+    NSArray *completions = nil;
+    @synchronized(self)
+    {
+        wasEnabled = self.handler != nil;
+        self.handler = handler;
+        self.handlerQueue = queue ?: dispatch_get_main_queue();
+        if (!handler) {
+            [self.watermarks removeAllObjects];
+            completions = [self abandonSync];
+        }
+    }
+    [self callCompletions:completions];
+
+    if (handler && !wasEnabled) {
+        [[CKTEventDispatcher sharedInstance] addSink:self queue:self.eventQueue];
+    } else if (!handler && wasEnabled) {
+        [[CKTEventDispatcher sharedInstance] removeSink:self];
+    }
+}
+
+- (BOOL)isEnabled
+{
+    @synchronized(self)
+    {
+        return self.handler != nil;
+    }
+}
+
+#pragma mark - Watermarks
+
+- (void)trackItems:(id)items
+{
+    @synchronized(self)
+    {
+        if (!self.handler) {
+            return;
+        }
+
+        for (NSDictionary *item in CKTItemsOf(items)) {
+            [self advanceWatermarkWithItem:item];
+        }
+    }
+}
+
+- (void)trackFeed:(id)feed
+{
+    if (![feed isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+
+    for (NSDictionary *thread in CKTItemsOf(feed[@"threads"])) {
+        [self trackItems:thread[@"parentItem"]];
+        [self trackItems:thread[@"comments"]];
+    }
+}
+
+- (void)removeAllWatermarks
+{
+    LOGD(LOG_TAG, @"removeAllWatermarks");
+
+    NSArray *completions;
+    @synchronized(self)
+    {
+        [self.watermarks removeAllObjects];
+        completions = [self abandonSync];
+    }
+    [self callCompletions:completions];
+}
+
+#pragma mark - Sync
+
+- (void)synchronize:(void (^)(void))completion
+{
+    @synchronized(self)
+    {
+        if (self.completions) {
+            if (completion) {
+                [self.completions addObject:completion];
+            }
+            return;
+        }
+
+        if (!self.handler || self.watermarks.count == 0) {
+            if (completion) {
+                dispatch_async(dispatch_get_main_queue(), completion);
+            }
+            return;
+        }
+
+        NSArray *convIds = [self.watermarks
+            keysSortedByValueUsingComparator:^NSComparisonResult(CKTSyncWatermark *first, CKTSyncWatermark *second) {
+                if (first.modificationTime == second.modificationTime) {
+                    return NSOrderedSame;
+                }
+                return first.modificationTime > second.modificationTime ? NSOrderedAscending : NSOrderedDescending;
+            }];
+        if (convIds.count > kCKTSyncMaxConversations) {
+            convIds = [convIds subarrayWithRange:NSMakeRange(0, kCKTSyncMaxConversations)];
+        }
+
+        self.pendingTasks = [NSMutableArray arrayWithCapacity:convIds.count];
+        for (NSString *convId in convIds) {
+            CKTSyncWatermark *watermark = self.watermarks[convId];
+            CKTSyncTask *task = [[CKTSyncTask alloc] init];
+            task.convId = convId;
+            task.generation = self.generation;
+            task.creationTime = watermark.creationTime;
+            task.cursor = watermark.modificationTime;
+            task.added = [NSMutableArray array];
+            task.updated = [NSMutableArray array];
+            [self.pendingTasks addObject:task];
+        }
+
+        LOGI(LOG_TAG, @"Syncing %lu conversations", (unsigned long)convIds.count);
+        self.completions = completion ? [NSMutableArray arrayWithObject:completion] : [NSMutableArray array];
+        self.syncStart = CKTMonotonicMicroseconds();
+        _syncs++;
+        _syncedConversations += convIds.count;
+    }
+
+    [self startTasks];
+}
+
+#pragma mark - CKTEventSink
+
+// Called on the event queue
+
+- (void)connectionStateChanged:(NSDictionary *)event
+{
+    NSString *state = event[@"state"];
+    BOOL reconnected;
+    @synchronized(self)
+    {
+        // Nothing to catch up with after the first logon, no items are known yet
+        reconnected = [state isEqual:kCKTConnectionStateConnected] &&
+                      ![self.connectionState isEqual:kCKTConnectionStateConnected] && self.watermarks.count > 0;
+        self.connectionState = state;
+    }
+
+    if (reconnected) {
+        [self synchronize:nil];
+    }
+}
+
+- (void)itemAdded:(NSDictionary *)event
+{
+    [self trackItems:event[@"item"]];
+}
+
+- (void)itemUpdated:(NSDictionary *)event
+{
+    [self trackItems:event[@"item"]];
+}
+
+- (void)coalescedEvents:(NSArray<NSDictionary *> *)events notification:(NSString *)name
+{
+    for (NSDictionary *event in events) {
+        [self trackItems:event[@"item"]];
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        return @{
+            kCKTSyncEngineConversations : @(self.watermarks.count),
+            kCKTSyncEngineSyncs : @(_syncs),
+            kCKTSyncEngineSyncedConversations : @(_syncedConversations),
+            kCKTSyncEngineChangedConversations : @(_changedConversations),
+            kCKTSyncEngineRequests : @(_requests),
+            kCKTSyncEngineFailedRequests : @(_failedRequests),
+            kCKTSyncEngineAddedItems : @(_addedItems),
+            kCKTSyncEngineUpdatedItems : @(_updatedItems),
+            kCKTSyncEngineSyncTime : [self.syncTime dictionaryRepresentation]
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        _syncs = 0;
+        _syncedConversations = 0;
+        _changedConversations = 0;
+        _requests = 0;
+        _failedRequests = 0;
+        _addedItems = 0;
+        _updatedItems = 0;
+        [self.syncTime reset];
+    }
+}
+
+#pragma mark - internal functions
+
+// Called with the lock held
+- (void)advanceWatermarkWithItem:(NSDictionary *)item
+{
+    NSString *convId = [item isKindOfClass:[NSDictionary class]] ? item[@"convId"] : nil;
+    if (![convId isKindOfClass:[NSString class]]) {
+        return;
+    }
+
+    int64_t creationTime = CKTTimeOf(item, @"creationTime");
+    int64_t modificationTime = MAX(CKTTimeOf(item, @"modificationTime"), creationTime);
+
+    CKTSyncWatermark *watermark = self.watermarks[convId];
+    if (!watermark) {
+        watermark = [[CKTSyncWatermark alloc] init];
+        self.watermarks[convId] = watermark;
+    }
+    watermark.creationTime = MAX(watermark.creationTime, creationTime);
+    watermark.modificationTime = MAX(watermark.modificationTime, modificationTime);
+}
+
+// Starts pending conversations while fewer than maxConcurrentRequests are being fetched
+- (void)startTasks
+{
+    NSMutableArray<CKTSyncTask *> *tasks = [NSMutableArray array];
+    BOOL finished;
+    @synchronized(self)
+    {
+        NSUInteger maxConcurrentRequests = MAX(self.maxConcurrentRequests, 1);
+        while (self.runningTasks < maxConcurrentRequests && self.pendingTasks.count > 0) {
+            [tasks addObject:self.pendingTasks.firstObject];
+            [self.pendingTasks removeObjectAtIndex:0];
+            self.runningTasks++;
+        }
+        finished = self.runningTasks == 0;
+    }
+
+    for (CKTSyncTask *task in tasks) {
+        [self fetch:task];
+    }
+    if (finished) {
+        [self finishSync];
+    }
+}
+
+- (void)fetch:(CKTSyncTask *)task
+{
+    @synchronized(self)
+    {
+        _requests++;
+    }
+
+    // The request of a stopped JS thread is dropped without calling the completion, which would stall the sync
+    if (![[JSEngine sharedInstance].jsThread isExecuting]) {
+        NSError *error = [NSError errorWithDomain:@"CircuitKit"
+                                             code:0
+                                         userInfo:@{NSLocalizedDescriptionKey : @"The JS engine is not running"}];
+        [self task:task didFetchItems:nil error:error];
+        return;
+    }
+
+    NSDictionary *options = @{
+        @"modificationDate" : @(task.cursor),
+        @"direction" : @"AFTER",
+        @"numberOfItems" : @(kCKTSyncPageSize)
+    };
+
+    // getConversationItems runs as background work on the JS thread, behind app calls such as answerCall
+    [[CKTClient sharedInstance] getConversationItems:task.convId
+                                             options:options
+                                          completion:^(id items, NSError *error) {
+                                              [self task:task didFetchItems:items error:error];
+                                          }];
+}
+
+- (void)task:(CKTSyncTask *)task didFetchItems:(id)items error:(NSError *)error
+{
+    @synchronized(self)
+    {
+        if (task.generation != self.generation) {
+            LOGD(LOG_TAG, @"Ignoring the items of conversation %@, the sync was abandoned", task.convId);
+            return;
+        }
+    }
+
+    if (error || ![items isKindOfClass:[NSArray class]]) {
+        LOGW(LOG_TAG, @"Error syncing conversation %@: %@", task.convId, error.localizedDescription);
+        @synchronized(self)
+        {
+            _failedRequests++;
+        }
+        [self finishTask:task];
+        return;
+    }
+
+    int64_t cursor = task.cursor;
+    for (NSDictionary *item in items) {
+        if (![item isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        int64_t creationTime = CKTTimeOf(item, @"creationTime");
+        if (creationTime > task.creationTime) {
+            [task.added addObject:item];
+        } else {
+            [task.updated addObject:item];
+        }
+        cursor = MAX(cursor, MAX(CKTTimeOf(item, @"modificationTime"), creationTime));
+    }
+
+    // A full page may be followed by more changes
+    if ([items count] >= kCKTSyncPageSize && cursor > task.cursor) {
+        task.cursor = cursor;
+        [self fetch:task];
+        return;
+    }
+    [self finishTask:task];
+}
+
+- (void)finishTask:(CKTSyncTask *)task
+{
+    NSDictionary *diff = nil;
+    void (^handler)(NSDictionary *diff);
+    dispatch_queue_t queue;
+
+    @synchronized(self)
+    {
+        if (task.generation != self.generation) {
+            return;
+        }
+        self.runningTasks--;
+        if (task.added.count > 0 || task.updated.count > 0) {
+            diff = @{
+                kCKTSyncConversationId : task.convId,
+                kCKTSyncAddedItems : task.added,
+                kCKTSyncUpdatedItems : task.updated
+            };
+            _changedConversations++;
+            _addedItems += task.added.count;
+            _updatedItems += task.updated.count;
+        }
+        handler = self.handler;
+        queue = self.handlerQueue;
+    }
+
+    if (diff && handler) {
+        dispatch_async(queue, ^{ handler(diff); });
+    }
+    [self startTasks];
+}
+
+- (void)finishSync
+{
+    NSArray *completions;
+    dispatch_queue_t queue;
+    @synchronized(self)
+    {
+        if (!self.completions) {
+            return;
+        }
+        completions = self.completions;
+        self.completions = nil;
+        self.pendingTasks = nil;
+        [self.syncTime recordValue:CKTMonotonicMicroseconds() - self.syncStart];
+        queue = self.handlerQueue ?: dispatch_get_main_queue();
+    }
+
+    LOGI(LOG_TAG, @"Sync finished");
+
+    // Behind the diffs already queued to the handler
+    dispatch_async(queue, ^{ [self callCompletions:completions]; });
+}
+
+// Called with the lock held. Drops the sync in flight, e.g. at logout, and returns the completions waiting for it.
+- (NSArray *)abandonSync
+{
+    NSArray *completions = self.completions;
+    if (!completions) {
+        return nil;
+    }
+
+    LOGI(LOG_TAG, @"Abandoning the sync, %lu conversations running, %lu pending", (unsigned long)self.runningTasks,
+         (unsigned long)self.pendingTasks.count);
+    self.completions = nil;
+    self.pendingTasks = nil;
+    self.runningTasks = 0;
+    self.generation++;
+    return completions;
+}
+
+- (void)callCompletions:(NSArray *)completions
+{
+    if (completions.count == 0) {
+        return;
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        for (void (^completion)(void) in completions) {
+            completion();
+        }
+    });
+}
+
+@end
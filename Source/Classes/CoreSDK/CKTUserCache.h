@@ -0,0 +1,77 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTUserCache.h
+//  CircuitSDK
+//
+//
+
+
+#import <Foundation/Foundation.h>
+
+#import "CKTEventSink.h"
+
+// Keys of the dictionary returned by -[CKTUserCache statistics]
+extern NSString *const kCKTUserCacheUsers;            // Users in the cache
+extern NSString *const kCKTUserCacheCapacity;         // Most users kept
+extern NSString *const kCKTUserCacheHits;             // Profile lookups answered from the cache
+extern NSString *const kCKTUserCacheMisses;           // Profile lookups not answered from the cache
+extern NSString *const kCKTUserCacheExpired;          // Misses on a profile older than its time to live
+extern NSString *const kCKTUserCacheHitRate;          // Hits per lookup, 0 - 1
+extern NSString *const kCKTUserCachePresenceHits;     // Presence lookups answered from the cache
+extern NSString *const kCKTUserCachePresenceMisses;   // Presence lookups not answered from the cache
+extern NSString *const kCKTUserCachePresenceHitRate;  // Presence hits per lookup, 0 - 1
+extern NSString *const kCKTUserCacheEvictions;        // Users dropped as the least recently used
+
+// Bounded least recently used cache of user profiles and presence, keyed by user id and email address. Fed by the
+// results of the user APIs and the UserUpdated and UserPresenceChanged events, so that the names and avatars shown in
+// list cells can be looked up synchronously and repeated requests are answered without going to the JS SDK.
+//
+// Profiles and presence expire separately, an expired entry is a miss. Disabled (capacity 0) by default. Thread safe.
+// Results are stored as plain Foundation copies, lazy ones (see CKTLazyDictionary.h) do not keep the JS context.
+@interface CKTUserCache : NSObject<CKTEventSink>
+
+// Most users kept, 0 disables the cache and empties it
+@property (atomic, assign) NSUInteger capacity;
+// Defaults to 5 minutes
+@property (atomic, assign) NSTimeInterval profileTimeToLive;
+// Defaults to 30 seconds, presence is only pushed for the users subscribed to
+@property (atomic, assign) NSTimeInterval presenceTimeToLive;
+
+@property (atomic, readonly, getter=isEnabled) BOOL enabled;
+
++ (CKTUserCache *)sharedInstance;
+
+- (NSDictionary *)userWithId:(NSString *)userId;
+- (NSDictionary *)userWithEmail:(NSString *)email;
+
+// Returns the users in the given order, nil unless all of them are cached
+- (NSArray<NSDictionary *> *)usersWithIds:(NSArray<NSString *> *)userIds;
+
+// A full presence also answers a request for the basic one, not the other way around
+- (NSDictionary *)presenceOfUser:(NSString *)userId full:(BOOL)full;
+- (NSArray<NSDictionary *> *)presenceOfUsers:(NSArray<NSString *> *)userIds full:(BOOL)full;
+
+// Results of the JS SDK APIs: a user or an array of them, a presence state or an array of them
+- (void)storeUsers:(id)users;
+- (void)storePresence:(id)presence full:(BOOL)full;
+
+- (void)removeAllUsers;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
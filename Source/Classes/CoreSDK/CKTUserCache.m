@@ -0,0 +1,475 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTUserCache.m
+//  CircuitSDK
+//
+//
+
+
+#import "CKTUserCache.h"
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
+#import "Log.h"
+
+NSString *const kCKTUserCacheUsers = @"users";
+NSString *const kCKTUserCacheCapacity = @"capacity";
+NSString *const kCKTUserCacheHits = @"hits";
+NSString *const kCKTUserCacheMisses = @"misses";
+NSString *const kCKTUserCacheExpired = @"expired";
+NSString *const kCKTUserCacheHitRate = @"hitRate";
+NSString *const kCKTUserCachePresenceHits = @"presenceHits";
+NSString *const kCKTUserCachePresenceMisses = @"presenceMisses";
+NSString *const kCKTUserCachePresenceHitRate = @"presenceHitRate";
+NSString *const kCKTUserCacheEvictions = @"evictions";
+
+// Plain Foundation copy of a result. Lazy results (see CKTLazyDictionary.h) reference their JS value, kept for the
+// time to live they would hold on to the JS context across a reset and make the lookups wait for the JS VM.
+static id CKTPlainCopy(id object)
+{
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSMutableDictionary *copy = [NSMutableDictionary dictionaryWithCapacity:[object count]];
+        [object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) { copy[key] = CKTPlainCopy(value); }];
+        return [copy copy];
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSMutableArray *copy = [NSMutableArray arrayWithCapacity:[object count]];
+        for (id value in object) {
+            [copy addObject:CKTPlainCopy(value)];
+        }
+        return [copy copy];
+    }
+    return object;
+}
+
+static NSArray *CKTPlainListOf(id objects)
+{
+    return CKTPlainCopy([objects isKindOfClass:[NSArray class]] ? objects : @[ objects ?: [NSNull null] ]);
+}
+
+@interface CKTUserCacheEntry : NSObject
+
+@property (nonatomic, strong) NSString *userId;
+@property (nonatomic, strong) NSString *email;
+@property (nonatomic, strong) NSDictionary *user;
+@property (nonatomic, assign) uint64_t userTime;
+@property (nonatomic, strong) NSDictionary *presence;
+@property (nonatomic, assign) BOOL fullPresence;
+@property (nonatomic, assign) uint64_t presenceTime;
+
+// Recency list, the entries are owned by the users dictionary
+@property (nonatomic, unsafe_unretained) CKTUserCacheEntry *newer;
+@property (nonatomic, unsafe_unretained) CKTUserCacheEntry *older;
+
+@end
+
+@implementation CKTUserCacheEntry
+
+@end
+
+@interface CKTUserCache () {
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _expired;
+    uint64_t _presenceHits;
+    uint64_t _presenceMisses;
+    uint64_t _evictions;
+}
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, CKTUserCacheEntry *> *users;
+// Lower case email address -> user id
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSString *> *emails;
+@property (nonatomic, unsafe_unretained) CKTUserCacheEntry *newest;
+@property (nonatomic, unsafe_unretained) CKTUserCacheEntry *oldest;
+@property (nonatomic, strong) dispatch_queue_t eventQueue;
+
+@end
+
+@implementation CKTUserCache
+
+@synthesize capacity = _capacity;
+
+static NSString *LOG_TAG = @"[CKTUserCache]";
+
++ (CKTUserCache *)sharedInstance
+{
+    static CKTUserCache *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTUserCache alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _profileTimeToLive = 5 * 60;
+        _presenceTimeToLive = 30;
+        _users = [NSMutableDictionary dictionary];
+        _emails = [NSMutableDictionary dictionary];
+        _eventQueue = dispatch_queue_create("com.unify.circuitsdk.usercache", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)setCapacity:(NSUInteger)capacity
+{
+    LOGD(LOG_TAG, @"setCapacity %lu", (unsigned long)capacity);
+
+    BOOL wasEnabled;
+    @synchronized(self)
+    {
+        wasEnabled = _capacity > 0;
+        _capacity = capacity;
+        if (capacity == 0) {
+            [self removeAllUsers];
+        } else {
+            [self trim];
+        }
+    }
+
+    // Only listen to the user events while there is somewhere to put them
+    if (capacity > 0 && !wasEnabled) {
+        [[CKTEventDispatcher sharedInstance] addSink:self queue:self.eventQueue];
+    } else if (capacity == 0 && wasEnabled) {
+        [[CKTEventDispatcher sharedInstance] removeSink:self];
+    }
+}
+
+- (NSUInteger)capacity
+{
+    @synchronized(self)
+    {
+        return _capacity;
+    }
+}
+
+- (BOOL)isEnabled
+{
+    return self.capacity > 0;
+}
+
+#pragma mark - Lookups
+
+- (NSDictionary *)userWithId:(NSString *)userId
+{
+    @synchronized(self)
+    {
+        if (_capacity == 0 || ![userId isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        return [self freshUserOf:self.users[userId]];
+    }
+}
+
+- (NSDictionary *)userWithEmail:(NSString *)email
+{
+    @synchronized(self)
+    {
+        if (_capacity == 0 || ![email isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        NSString *userId = self.emails[email.lowercaseString];
+        return [self freshUserOf:userId ? self.users[userId] : nil];
+    }
+}
+
+- (NSArray<NSDictionary *> *)usersWithIds:(NSArray<NSString *> *)userIds
+{
+    @synchronized(self)
+    {
+        if (_capacity == 0 || userIds.count == 0) {
+            return nil;
+        }
+
+        NSMutableArray *users = [NSMutableArray arrayWithCapacity:userIds.count];
+        for (NSString *userId in userIds) {
+            NSDictionary *user = [userId isKindOfClass:[NSString class]] ? [self freshUserOf:self.users[userId]] : nil;
+            if (!user) {
+                return nil;
+            }
+            [users addObject:user];
+        }
+        return users;
+    }
+}
+
+- (NSDictionary *)presenceOfUser:(NSString *)userId full:(BOOL)full
+{
+    @synchronized(self)
+    {
+        if (_capacity == 0 || ![userId isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        return [self freshPresenceOf:self.users[userId] full:full];
+    }
+}
+
+- (NSArray<NSDictionary *> *)presenceOfUsers:(NSArray<NSString *> *)userIds full:(BOOL)full
+{
+    @synchronized(self)
+    {
+        if (_capacity == 0 || userIds.count == 0) {
+            return nil;
+        }
+
+        NSMutableArray *presence = [NSMutableArray arrayWithCapacity:userIds.count];
+        for (NSString *userId in userIds) {
+            NSDictionary *state =
+                [userId isKindOfClass:[NSString class]] ? [self freshPresenceOf:self.users[userId] full:full] : nil;
+            if (!state) {
+                return nil;
+            }
+            [presence addObject:state];
+        }
+        return presence;
+    }
+}
+
+#pragma mark - Updates
+
+- (void)storeUsers:(id)users
+{
+    if (!self.isEnabled) {
+        return;
+    }
+
+    // Converted outside of the lock, lookups do not wait for it
+    NSArray *list = CKTPlainListOf(users);
+    uint64_t now = CKTMonotonicMicroseconds();
+
+    @synchronized(self)
+    {
+        if (_capacity == 0) {
+            return;
+        }
+
+        for (NSDictionary *user in list) {
+            CKTUserCacheEntry *entry = [self entryOf:user];
+            if (!entry) {
+                continue;
+            }
+            entry.user = user;
+            entry.userTime = now;
+
+            NSString *email = user[@"emailAddress"];
+            email = [email isKindOfClass:[NSString class]] ? email.lowercaseString : nil;
+            if (entry.email && ![entry.email isEqualToString:email]) {
+                [self.emails removeObjectForKey:entry.email];
+            }
+            entry.email = email;
+            if (email) {
+                self.emails[email] = entry.userId;
+            }
+        }
+        [self trim];
+    }
+}
+
+- (void)storePresence:(id)presence full:(BOOL)full
+{
+    if (!self.isEnabled) {
+        return;
+    }
+
+    NSArray *list = CKTPlainListOf(presence);
+    uint64_t now = CKTMonotonicMicroseconds();
+
+    @synchronized(self)
+    {
+        if (_capacity == 0) {
+            return;
+        }
+
+        for (NSDictionary *state in list) {
+            CKTUserCacheEntry *entry = [self entryOf:state];
+            if (!entry) {
+                continue;
+            }
+            entry.presence = state;
+            entry.fullPresence = full;
+            entry.presenceTime = now;
+        }
+        [self trim];
+    }
+}
+
+- (void)removeAllUsers
+{
+    LOGD(LOG_TAG, @"removeAllUsers");
+
+    @synchronized(self)
+    {
+        [self.users removeAllObjects];
+        [self.emails removeAllObjects];
+        self.newest = nil;
+        self.oldest = nil;
+    }
+}
+
+#pragma mark - CKTEventSink
+
+- (void)userUpdated:(NSDictionary *)event
+{
+    [self storeUsers:event[@"user"]];
+}
+
+- (void)userPresenceChanged:(NSDictionary *)event
+{
+    [self storePresence:event[@"presenceState"] full:NO];
+}
+
+- (void)coalescedEvents:(NSArray<NSDictionary *> *)events notification:(NSString *)name
+{
+    for (NSDictionary *event in events) {
+        if (event[@"user"]) {
+            [self userUpdated:event];
+        } else if (event[@"presenceState"]) {
+            [self userPresenceChanged:event];
+        }
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        uint64_t lookups = _hits + _misses;
+        uint64_t presenceLookups = _presenceHits + _presenceMisses;
+        return @{
+            kCKTUserCacheUsers : @(self.users.count),
+            kCKTUserCacheCapacity : @(_capacity),
+            kCKTUserCacheHits : @(_hits),
+            kCKTUserCacheMisses : @(_misses),
+            kCKTUserCacheExpired : @(_expired),
+            kCKTUserCacheHitRate : @(lookups ? (double)_hits / lookups : 0),
+            kCKTUserCachePresenceHits : @(_presenceHits),
+            kCKTUserCachePresenceMisses : @(_presenceMisses),
+            kCKTUserCachePresenceHitRate : @(presenceLookups ? (double)_presenceHits / presenceLookups : 0),
+            kCKTUserCacheEvictions : @(_evictions)
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        _hits = 0;
+        _misses = 0;
+        _expired = 0;
+        _presenceHits = 0;
+        _presenceMisses = 0;
+        _evictions = 0;
+    }
+}
+
+#pragma mark - internal functions
+
+// The functions below are called with the lock held
+
+- (NSDictionary *)freshUserOf:(CKTUserCacheEntry *)entry
+{
+    if (entry.user && CKTMonotonicMicroseconds() - entry.userTime <= self.profileTimeToLive * USEC_PER_SEC) {
+        _hits++;
+        [self touch:entry];
+        return entry.user;
+    }
+
+    _misses++;
+    if (entry.user) {
+        _expired++;
+    }
+    return nil;
+}
+
+- (NSDictionary *)freshPresenceOf:(CKTUserCacheEntry *)entry full:(BOOL)full
+{
+    if (entry.presence && (entry.fullPresence || !full) &&
+        CKTMonotonicMicroseconds() - entry.presenceTime <= self.presenceTimeToLive * USEC_PER_SEC) {
+        _presenceHits++;
+        [self touch:entry];
+        return entry.presence;
+    }
+
+    _presenceMisses++;
+    return nil;
+}
+
+// Returns the entry of the user the object is about, created if needed, as the most recently used one
+- (CKTUserCacheEntry *)entryOf:(NSDictionary *)object
+{
+    NSString *userId = [object isKindOfClass:[NSDictionary class]] ? object[@"userId"] : nil;
+    if (![userId isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+
+    CKTUserCacheEntry *entry = self.users[userId];
+    if (!entry) {
+        entry = [[CKTUserCacheEntry alloc] init];
+        entry.userId = userId;
+        self.users[userId] = entry;
+    }
+    [self touch:entry];
+    return entry;
+}
+
+- (void)touch:(CKTUserCacheEntry *)entry
+{
+    if (self.newest == entry) {
+        return;
+    }
+
+    [self unlink:entry];
+    entry.older = self.newest;
+    self.newest.newer = entry;
+    self.newest = entry;
+    if (!self.oldest) {
+        self.oldest = entry;
+    }
+}
+
+- (void)unlink:(CKTUserCacheEntry *)entry
+{
+    if (entry.newer) {
+        entry.newer.older = entry.older;
+    } else if (self.newest == entry) {
+        self.newest = entry.older;
+    }
+    if (entry.older) {
+        entry.older.newer = entry.newer;
+    } else if (self.oldest == entry) {
+        self.oldest = entry.newer;
+    }
+    entry.newer = nil;
+    entry.older = nil;
+}
+
+- (void)trim
+{
+    while (self.users.count > _capacity && self.oldest) {
+        CKTUserCacheEntry *entry = self.oldest;
+        [self unlink:entry];
+        if (entry.email && [self.emails[entry.email] isEqualToString:entry.userId]) {
+            [self.emails removeObjectForKey:entry.email];
+        }
+        [self.users removeObjectForKey:entry.userId];
+        _evictions++;
+    }
+}
+
+@end
@@ -375,6 +375,40 @@
 */
 - (void)removeParticipant:(NSString *)convId userIds:(id)userIds completion:(void (^)(void))completion;
 
+/*!
+
+ @brief Enables the incremental sync of the conversation items after a reconnect.
+
+ @discussion The SDK records the newest creation and modification time of the items of each conversation returned by
+ getConversationItems and getConversationFeed or received in ItemAdded and ItemUpdated events. When the connection
+ is reestablished, only the items modified since then are fetched for the 50 most recently active conversations,
+ a few conversations at a time, and the handler is called with a diff per changed conversation: convId, added
+ (created since the newest known item) and updated (the other items). See CKTSyncEngine.h for the keys.
+
+ @param handler Called with each diff, nil disables the sync and forgets the recorded times.
+ @param queue Queue the handler is called on, the main queue if nil.
+
+ */
+- (void)setConversationSyncHandler:(void (^)(NSDictionary *diff))handler queue:(dispatch_queue_t)queue;
+
+/*!
+
+ @brief Sets how many conversations are fetched at the same time by the conversation sync.
+
+ @param maxConcurrentRequests Requests in flight, 4 by default.
+
+ */
+- (void)setConversationSyncMaxConcurrentRequests:(NSUInteger)maxConcurrentRequests;
+
+/*!
+
+ @brief Runs the conversation sync now, e.g. when the app returns to the foreground.
+
+ @param completion Called on the main queue once all diffs were passed to the handler, may be nil.
+
+ */
+- (void)syncConversations:(void (^)(void))completion;
+
 /*!
 
  @brief Clear the flag of an item
@@ -21,6 +21,43 @@
 
 #import "CKTClient+Conversation.h"
 #import "CKTException.h"
+#import "CKTLocalStore.h"
+#import "CKTSyncEngine.h"
+
+// Results of the read APIs also refresh the local store while it is open. The generation is taken when the request
+// is made, a result arriving after the store of another user was opened is dropped.
+static CompletionBlock CKTStoringCompletion(CompletionBlock completion,
+                                            void (^store)(CKTLocalStore *store, id data, NSUInteger generation))
+{
+    CKTLocalStore *localStore = [CKTLocalStore sharedInstance];
+    if (!localStore.isOpen || !completion) {
+        return completion;
+    }
+
+    NSUInteger generation = [localStore currentGeneration];
+    return ^(id data, NSError *error) {
+        if (data && !error) {
+            store(localStore, data, generation);
+        }
+        completion(data, error);
+    };
+}
+
+// Item results also advance the watermarks of the conversation sync while it is enabled
+static CompletionBlock CKTTrackingCompletion(CompletionBlock completion, void (^track)(CKTSyncEngine *engine, id data))
+{
+    CKTSyncEngine *engine = [CKTSyncEngine sharedInstance];
+    if (!engine.isEnabled || !completion) {
+        return completion;
+    }
+
+    return ^(id data, NSError *error) {
+        if (data && !error) {
+            track(engine, data);
+        }
+        completion(data, error);
+    };
+}
 
 @implementation CKTClient (Conversation)
 
@@ -145,7 +182,9 @@
 
     [args setObject:completion forKey:kJSEngineBlockArgName];
 
-    [self executeAsync:@selector(getConversationsWithOptionsCompletion:) withObject:args];
+    [self executeAsync:@selector(getConversationsWithOptionsCompletion:)
+            withObject:args
+              priority:JSTaskPriorityBackground];
 }
 
 - (void)getConversationDetails:(NSString *)convId completion:(CompletionBlock)completion
@@ -174,7 +213,7 @@
     [args setObject:convId forKey:@"convId"];
     [args setObject:completion forKey:kJSEngineBlockArgName];
 
-    [self executeAsync:@selector(getConversationFeedCompletion:) withObject:args];
+    [self executeAsync:@selector(getConversationFeedCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getConversationItems:(NSString *)convId options:(NSDictionary *)options completion:(CompletionBlock)completion
@@ -188,7 +227,7 @@
     [args setObject:convId forKey:@"convId"];
     [args setObject:completion forKey:kJSEngineBlockArgName];
 
-    [self executeAsync:@selector(getConversationItemsCompletion:) withObject:args];
+    [self executeAsync:@selector(getConversationItemsCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getConversationParticipants:(NSString *)convId
@@ -204,7 +243,9 @@
     [args setObject:convId forKey:@"convId"];
     [args setObject:completion forKey:kJSEngineBlockArgName];
 
-    [self executeAsync:@selector(getConversationParticipantsCompletion:) withObject:args];
+    [self executeAsync:@selector(getConversationParticipantsCompletion:)
+            withObject:args
+              priority:JSTaskPriorityBackground];
 }
 
 - (void)getDirectConversationWithUser:(NSString *)query
@@ -247,7 +288,7 @@
 
     NSDictionary *args = @{ @"itemIds" : itemIds, kJSEngineBlockArgName : completion };
 
-    [self executeAsync:@selector(getItemsByIdCompletion:) withObject:args];
+    [self executeAsync:@selector(getItemsByIdCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 
@@ -268,7 +309,7 @@
     [args setObject:threadId forKey:@"threadId"];
     [args setObject:completion forKey:kJSEngineBlockArgName];
 
-    [self executeAsync:@selector(getItemsByThreadCompletion:) withObject:args];
+    [self executeAsync:@selector(getItemsByThreadCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getMarkedConversations:(CompletionBlock)completion
@@ -331,6 +372,21 @@
     [self executeAsync:@selector(removeParticipantCompletion:) withObject:args];
 }
 
+- (void)setConversationSyncHandler:(void (^)(NSDictionary *diff))handler queue:(dispatch_queue_t)queue
+{
+    [[CKTSyncEngine sharedInstance] setHandler:handler queue:queue];
+}
+
+- (void)setConversationSyncMaxConcurrentRequests:(NSUInteger)maxConcurrentRequests
+{
+    [CKTSyncEngine sharedInstance].maxConcurrentRequests = maxConcurrentRequests;
+}
+
+- (void)syncConversations:(void (^)(void))completion
+{
+    [[CKTSyncEngine sharedInstance] synchronize:completion];
+}
+
 - (void)unflagItem:(NSString *)convId itemId:(NSString *)itemId completion:(CompletionBlockWithNoData)completion
 {
     if (!convId) {
@@ -450,7 +506,10 @@
 
 - (void)getConversationsCompletion:(NSDictionary *)args
 {
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeConversations:data generation:generation];
+        });
 
     [self executeFunction:@"getConversations" args:nil completionHandler:completion];
 }
@@ -458,7 +517,10 @@
 - (void)getConversationById:(NSDictionary *)args
 {
     NSString *convId = args[@"convId"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeConversations:data generation:generation];
+        });
 
     NSArray *convArray = @[ convId ];
 
@@ -472,7 +534,10 @@
     id numberOfConversations = args[@"numberOfConversations"] ? args[@"numberOfConversations"] : [NSNull null];
     id numberOfParticipants = args[@"numberOfParticipants"] ? args[@"numberOfParticipants"] : [NSNull null];
 
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeConversations:data generation:generation];
+        });
 
     NSDictionary *options = @{
         @"direction" : direction,
@@ -489,7 +554,11 @@
 - (void)getConversationFeedCompletion:(NSDictionary *)args
 {
     NSString *convId = args[@"convId"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeFeed:data generation:generation];
+        });
+    completion = CKTTrackingCompletion(completion, ^(CKTSyncEngine *engine, id data) { [engine trackFeed:data]; });
 
     id timestamp = args[@"timestamp"] ? args[@"timestamp"] : [NSNull null];
     id minTotalItems = args[@"minTotalItems"] ? args[@"minTotalItems"] : [NSNull null];
@@ -519,7 +588,11 @@
     id modificationDate = args[@"modificationDate"] ? args[@"modificationDate"] : [NSNull null];
     id numberOfItems = args[@"numberOfItems"] ? args[@"numberOfItems"] : [NSNull null];
 
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeItems:data generation:generation];
+        });
+    completion = CKTTrackingCompletion(completion, ^(CKTSyncEngine *engine, id data) { [engine trackItems:data]; });
 
     NSDictionary *options = @{
         @"direction" : direction,
@@ -586,7 +659,10 @@
 - (void)getItemByIdCompletion:(NSDictionary *)args
 {
     NSString *itemId = args[@"itemId"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeItems:data generation:generation];
+        });
 
     [self executeFunction:@"getItemById" withId:itemId args:nil completionHandler:completion];
 }
@@ -594,7 +670,10 @@
 - (void)getItemsByIdCompletion:(NSDictionary *)args
 {
     NSArray *itemIds = args[@"itemIds"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion =
+        CKTStoringCompletion(args[kJSEngineBlockArgName], ^(CKTLocalStore *store, id data, NSUInteger generation) {
+            [store storeItems:data generation:generation];
+        });
 
     [self executeFunction:@"getItemsById" withId:itemIds args:nil completionHandler:completion];
 }
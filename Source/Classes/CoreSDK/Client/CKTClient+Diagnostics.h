@@ -0,0 +1,488 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Diagnostics.h
+//  CircuitSDK
+//
+//
+
+#import "CKTClient.h"
+#import "JSTimerWheel.h"
+
+@interface CKTClient (Diagnostics)
+
+/**
+
+ @brief Enables or disables end-to-end latency tracing of API requests.
+
+ @discussion Each traced request is stamped when the API function is entered, when the matching request is sent on
+ the WebSocket, when the response frame is received, when the promise is resolved and around the completion block.
+ Tracing is disabled by default.
+
+ @param enabled YES to start tracing new requests, NO to stop.
+
+ */
+- (void)setRequestTracingEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Returns YES if request tracing is enabled.
+
+ */
+- (BOOL)isRequestTracingEnabled;
+
+/**
+
+ @brief Returns the latency breakdown of all traced requests.
+
+ @discussion The dictionary maps the JS API function name (e.g. getConversationItems) to the phases request,
+ network, response, conversion, delivery and total. Each phase holds a histogram with count, mean, min, max, p50,
+ p90, p99 (in milliseconds) and the non empty buckets.
+
+ */
+- (NSDictionary *)requestLatencyStatistics;
+
+/**
+
+ @brief Clears the latency statistics collected so far.
+
+ */
+- (void)resetRequestLatencyStatistics;
+
+/**
+
+ @brief Enables or disables the sharing of identical read requests.
+
+ @discussion When enabled, read requests (getUserById, getUsersById, getUserByEmail, getConversationById,
+ getPresence, getLoggedOnUser) with the same arguments as a request still in flight do not cause another round trip,
+ all callers get the result of the first request. getUserById calls made within the user request batch window are
+ sent as one getUsersById request. Disabled by default.
+
+ @param enabled YES to share requests, NO to send each request on its own.
+
+ */
+- (void)setRequestCoalescingEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Returns YES if identical read requests are shared.
+
+ */
+- (BOOL)isRequestCoalescingEnabled;
+
+/**
+
+ @brief Sets the time during which getUserById calls are collected into one getUsersById request.
+
+ @discussion Only used while request coalescing is enabled, see setRequestCoalescingEnabled:.
+
+ @param window Time in seconds, 0.01 by default. 0 sends each getUserById call right away.
+
+ */
+- (void)setUserRequestBatchWindow:(NSTimeInterval)window;
+
+/**
+
+ @brief Returns the request coalescing counters.
+
+ @discussion sharedRequests is the number of read requests sent that could be shared, sharedHits the number of
+ calls answered by a request already in flight, mergedUsers the number of user ids requested through getUsersById
+ batches and userBatches the number of those batches.
+
+ */
+- (NSDictionary *)requestCoalescingStatistics;
+
+/**
+
+ @brief Clears the request coalescing counters.
+
+ */
+- (void)resetRequestCoalescingStatistics;
+
+/**
+
+ @brief Enables or disables the lazy conversion of list results.
+
+ @discussion When enabled, the results of getConversations, getConversationFeed, getConversationItems,
+ getConversationParticipants, getItemsById, getItemsByThread, getUsersById and getTenantUsers are passed to the
+ completion as CKTLazyDictionary or CKTLazyArray. They convert a field from JavaScript only when it is accessed,
+ objectForKeyPath: converts a single key path and freeze converts everything that is left. Disabled by default.
+
+ @param enabled YES to get lazy results, NO to get fully converted results.
+
+ */
+- (void)setLazyResultConversionEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Returns YES if list results are converted lazily.
+
+ */
+- (BOOL)isLazyResultConversionEnabled;
+
+/**
+
+ @brief Returns the result conversion statistics.
+
+ @discussion eagerTime and lazyTime are histograms (see CKTHistogram.h) of the time spent converting results on the
+ JS thread, fully or lazily. lazyResults is the number of lazy results handed out and lazyFields the number of fields
+ converted on access.
+
+ */
+- (NSDictionary *)resultConversionStatistics;
+
+/**
+
+ @brief Clears the result conversion statistics.
+
+ */
+- (void)resetResultConversionStatistics;
+
+/**
+
+ @brief Returns the statistics of the native promises through which all API results are delivered.
+
+ @discussion Contains the number of resolved and rejected promises, resolutionsPerSecond since the last reset, the
+ number of callbacks run, the number of microtask queue drains with the largest batch and a histogram of the drain
+ durations (see CKTHistogram.h). Resetting, issuing a burst of API calls and reading resolutionsPerSecond measures the
+ promise throughput.
+
+ */
+- (NSDictionary *)promiseStatistics;
+
+/**
+
+ @brief Clears the promise statistics and restarts the resolutionsPerSecond measurement.
+
+ */
+- (void)resetPromiseStatistics;
+
+/**
+
+ @brief Returns the JS heap statistics.
+
+ @discussion Contains the number of managed references into the JS heap currently held by the SDK and the totals
+ added and removed, the physical footprint of the app in MB, the number of garbage collections triggered by memory
+ pressure with the MB reclaimed by the last one and the number of memory pressure notifications. With leak detection
+ enabled referencesBySite maps the SDK functions holding references to their count.
+
+ */
+- (NSDictionary *)jsHeapStatistics;
+
+/**
+
+ @brief Enables or disables the recording of where managed references into the JS heap are added.
+
+ @discussion Disabled by default. References held for longer than the given age are reported by
+ suspectedManagedReferenceLeaks.
+
+ @param enabled YES to record new references, NO to stop.
+ @param age Age in seconds after which a reference is considered leaked.
+
+ */
+- (void)setManagedReferenceLeakDetectionEnabled:(BOOL)enabled leakAge:(NSTimeInterval)age;
+
+/**
+
+ @brief Returns the SDK functions holding managed references for longer than the leak age.
+
+ @discussion Each entry contains the site (function name), the count of references and the age in seconds of the
+ oldest one, most references first.
+
+ */
+- (NSArray<NSDictionary *> *)suspectedManagedReferenceLeaks;
+
+/**
+
+ @brief Runs a garbage collection of the JS heap, as done on memory pressure.
+
+ */
+- (void)collectJSGarbage;
+
+/**
+
+ @brief Enables or disables the persistent cache of the SDK scripts used when the JS engine starts.
+
+ @discussion Disabled by default. The cache only skips decoding the UTF-8 scripts, JavaScriptCore still parses and
+ compiles them, and it takes about twice the size of the scripts on disk. Compare scriptLoadStatistics with and
+ without it before enabling it. Takes effect the next time the JS engine is started. Disabling it also removes the
+ cached entries.
+
+ @param enabled NO to always read the bundled scripts.
+
+ */
+- (void)setScriptCacheEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Returns the load timings of each SDK script (sdkInterfacePre, circuit, sdkInterface) measured during the last
+ start of the JS engine.
+
+ @discussion Each entry contains cacheHit, readTime and evaluateTime (parse, compile and run, in milliseconds).
+ Comparing launches with the script cache enabled and disabled gives the startup benefit of the cache.
+
+ */
+- (NSDictionary *)scriptLoadStatistics;
+
+/**
+
+ @brief Returns the statistics of the cache of resolved JS SDK functions.
+
+ @discussion hits is the number of API calls and event subscriptions that used a cached function, misses the number
+ of lookups through the JS bridge and size the number of cached functions. resolveTime is the histogram of the
+ lookups (see CKTHistogram.h), its mean multiplied by the hits is the time saved. The cache is cleared when the JS
+ environment is recreated.
+
+ */
+- (NSDictionary *)functionCacheStatistics;
+
+/**
+
+ @brief Returns the statistics of the queue through which API calls and socket callbacks reach the JS thread.
+
+ @discussion Contains the number of enqueued and executed tasks, the number of thread wakeups, the largest batch
+ executed in one wakeup, the executed tasks per second and a histogram of the time from submission until execution
+ (see CKTHistogram.h). Calling an API from many threads and comparing tasksPerSecond and queueDelay gives the
+ throughput and enqueue latency of the JS thread.
+
+ The priorities entry breaks this down per scheduling class (userInteractive, callSignaling, timer, background)
+ and includes the number of tasks currently waiting in each class. deferrals counts the batches in which timer or
+ background tasks were postponed because their time slice was used up.
+
+ */
+- (NSDictionary *)taskQueueStatistics;
+
+/**
+
+ @brief Clears the task queue statistics collected so far.
+
+ */
+- (void)resetTaskQueueStatistics;
+
+/**
+
+ @brief Returns the statistics of the delivery of the SDK events.
+
+ @discussion Contains the number of events received from the JS SDK, the events skipped because nobody observes them
+ and the deliveries (notifications posted plus event sink methods called), with histograms (see CKTHistogram.h) of
+ the conversion time, the latency from the JS SDK until a delivery starts and the time each delivery takes on the
+ main thread. Comparing mainThreadTime of an app observing notifications with one using an event sink on its own
+ queue gives the main thread time saved. With event coalescing, merged counts the events replaced by a later one,
+ batches and batchedEvents the batches delivered and the events they held. observedEvents lists the events the SDK
+ currently listens to. For event sinks with a bounded buffer, dropped and overflowMerged count the events which gave
+ way to newer ones and maxBacklog the most events waiting for a sink.
+
+ */
+- (NSDictionary *)eventDeliveryStatistics;
+
+/**
+
+ @brief Clears the event delivery statistics collected so far.
+
+ */
+- (void)resetEventDeliveryStatistics;
+
+/**
+
+ @brief Returns the statistics of the local store of conversations and items.
+
+ @discussion Contains the conversations and items in the store, the size of its log and how much of it holds current
+ records, the time spent indexing the log when the store was opened (loadTime), the records written and those not
+ written since identical to the stored ones, the values read, the compactions of the log, the bytes of a torn record
+ dropped after a crash and a histogram of the query durations (see CKTHistogram.h and CKTLocalStore.h).
+
+ */
+- (NSDictionary *)localStoreStatistics;
+
+/**
+
+ @brief Returns the statistics of the user cache.
+
+ @discussion Contains the users in the cache and its capacity, the profile lookups answered from the cache (hits),
+ those which were not (misses, of which expired were too old) and the resulting hitRate, the same for presence and
+ the users dropped as the least recently used (evictions). See CKTUserCache.h for the keys.
+
+ */
+- (NSDictionary *)userCacheStatistics;
+
+/**
+
+ @brief Clears the user cache statistics collected so far, the cached users are kept.
+
+ */
+- (void)resetUserCacheStatistics;
+
+/**
+
+ @brief Returns the statistics of the conversation sync.
+
+ @discussion Contains the conversations with recorded times, the syncs run, the conversations they queried and those
+ which had changes, the getConversationItems requests made and failed, the items reported as added and updated and a
+ histogram of the time from the start of a sync until its last diff (syncTime, see CKTHistogram.h). Comparing the
+ requests and items with the pages a full refetch takes gives the bandwidth saved on reconnect.
+
+ */
+- (NSDictionary *)conversationSyncStatistics;
+
+/**
+
+ @brief Clears the conversation sync statistics collected so far.
+
+ */
+- (void)resetConversationSyncStatistics;
+
+/**
+
+ @brief Sets how late the request timeouts and intervals of the JS SDK may fire, so that timers due close to each
+ other share one wakeup of the JS thread.
+
+ @discussion 0 by default, every timer fires at its time. Request timeouts (setTimeout with a request id) and
+ intervals such as keepalives get the leeway, other timeouts stay precise. Each timer gets at most a tenth of its
+ delay. Comparing wakeupsPerMinute of timerStatistics with and without leeway gives the wakeups saved.
+
+ @param leeway Maximum delay in seconds, e.g. 1.
+
+ */
+- (void)setTimerLeeway:(NSTimeInterval)leeway;
+
+/**
+
+ @brief Sets how late the timers of one class may fire, see JSTimerClass in JSTimerWheel.h.
+
+ @discussion 0 by default for all classes. Each timer gets at most a tenth of its delay. The class of each active
+ timer is listed by timerInventory.
+
+ @param leeway Maximum delay in seconds.
+ @param timerClass JSTimerClassPrecise, JSTimerClassRequestTimeout or JSTimerClassInterval.
+
+ */
+- (void)setTimerLeeway:(NSTimeInterval)leeway forTimerClass:(JSTimerClass)timerClass;
+
+/**
+
+ @brief Returns the statistics of the timer wheel behind the JS setTimeout and setInterval.
+
+ @discussion Contains the number of active timers, the created, cancelled and fired timers with the churn (created
+ plus cancelled) per second, the run loop wakeups in total and per minute, the timers scheduled with a leeway
+ (coalescedTimers), the timers cascaded between the levels of the wheel, the largest number of timers expired in one
+ batch and a histogram of the batch durations (see CKTHistogram.h). A burst of setTimeout and clearTimeout calls from
+ the JS SDK shows up as churnPerSecond, its cost in taskRunTime of jsThreadStatistics. callbackTime is the histogram
+ of the time spent in the timer callbacks.
+
+ */
+- (NSDictionary *)timerStatistics;
+
+/**
+
+ @brief Clears the timer statistics collected so far, the number of active timers is kept.
+
+ */
+- (void)resetTimerStatistics;
+
+/**
+
+ @brief Lists the timers currently scheduled by the JS SDK.
+
+ @discussion timers holds one entry per timer with its id, origin (name of the callback or the start of its source),
+ requestId, class, delay, leeway, age, time until it fires, fire count and mean and max callback duration, see
+ Window.h and JSTimerWheel.h for the keys. origins sums them up per origin. Intervals set again without clearing the
+ previous one are flagged as suspectedLeak, their number per origin is suspectedLeaks. The counters are always kept,
+ only the listing itself has a cost.
+
+ @param completion Called on the main queue with the inventory, or with nil if the JS engine is not running.
+
+ */
+- (void)timerInventory:(void (^)(NSDictionary *inventory))completion;
+
+/**
+
+ @brief Enables or disables the JS thread watchdog.
+
+ @discussion The watchdog measures how long each run loop pass and each task keeps the JS thread busy and records a
+ stall report when the thread is busy for longer than the stall threshold. Disabled by default.
+
+ @param enabled YES to start watching, NO to stop.
+
+ */
+- (void)setJSThreadWatchdogEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Sets the time the JS thread may be busy before a stall is reported.
+
+ @param threshold Time in seconds, 0.25 by default.
+
+ */
+- (void)setJSThreadStallThreshold:(NSTimeInterval)threshold;
+
+/**
+
+ @brief Enables or disables the capture of the JS stack when a stall is reported.
+
+ @discussion The stack is captured when the stalled JS code next calls out to native code (timers, WebSocket,
+ XMLHttpRequest), stalls in pure JS code have no stack. Disabled by default.
+
+ @param enabled YES to capture the JS stack.
+
+ */
+- (void)setJSStackCaptureOnStallEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Returns the JS thread watchdog statistics.
+
+ @discussion iterationTime is the histogram (see CKTHistogram.h) of the busy time per run loop pass, i.e. the
+ latency an event arriving at the JS thread may see. taskRunTime is the histogram of the run time of API calls,
+ socket callbacks and timers. stallReports holds the most recent stalls with their start date, duration, running
+ task, JS SDK function and JS stack if captured. The queueing delay of the tasks is part of taskQueueStatistics.
+
+ */
+- (NSDictionary *)jsThreadStatistics;
+
+/**
+
+ @brief Clears the JS thread watchdog statistics and stall reports.
+
+ */
+- (void)resetJSThreadStatistics;
+
+/**
+
+ @brief Returns the phases of the last JS engine start or reset.
+
+ @discussion Contains the totalTime and the list of phases (thread start, JSContext creation, injection of the
+ exposed classes, read and evaluation of each script, event subscription) with their start and duration in
+ milliseconds. After -[JSEngine reset] the phases are resetSession, createClient and subscribeAll. The same
+ dictionary is sent in the KEY_STARTUP_PROFILE entry of the applicationServiceLoaded notification.
+
+ */
+- (NSDictionary *)startupProfile;
+
+/**
+
+ @brief Writes the phases of the last JS engine start to a file in the Trace Event Format.
+
+ @discussion The file can be opened with chrome://tracing or Perfetto to compare startups across releases.
+
+ @param path Path of the file to write.
+ @param error Set if the file could not be written.
+
+ @return YES if the file was written.
+
+ */
+- (BOOL)exportStartupTraceToPath:(NSString *)path error:(NSError **)error;
+
+@end
@@ -0,0 +1,318 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Diagnostics.m
+//  CircuitSDK
+//
+//
+
+#import "CKTClient+Diagnostics.h"
+#import "CKTEventDispatcher.h"
+#import "CKTLocalStore.h"
+#import "CKTRequestCoalescer.h"
+#import "CKTRequestTracer.h"
+#import "CKTResultConverter.h"
+#import "CKTSyncEngine.h"
+#import "CKTUserCache.h"
+#import "JSEngine.h"
+#import "JSFunctionCache.h"
+#import "JSHeapMonitor.h"
+#import "JSScriptCache.h"
+#import "JSTaskQueue.h"
+#import "JSThreadWatchdog.h"
+#import "Promise.h"
+#import "Window.h"
+
+@implementation CKTClient (Diagnostics)
+
+#pragma mark - Request tracing
+
+- (void)setRequestTracingEnabled:(BOOL)enabled
+{
+    [CKTRequestTracer sharedInstance].enabled = enabled;
+}
+
+- (BOOL)isRequestTracingEnabled
+{
+    return [CKTRequestTracer sharedInstance].isEnabled;
+}
+
+- (NSDictionary *)requestLatencyStatistics
+{
+    return [[CKTRequestTracer sharedInstance] latencyStatistics];
+}
+
+- (void)resetRequestLatencyStatistics
+{
+    [[CKTRequestTracer sharedInstance] resetLatencyStatistics];
+}
+
+#pragma mark - Request coalescing
+
+- (void)setRequestCoalescingEnabled:(BOOL)enabled
+{
+    [CKTRequestCoalescer sharedInstance].enabled = enabled;
+}
+
+- (BOOL)isRequestCoalescingEnabled
+{
+    return [CKTRequestCoalescer sharedInstance].isEnabled;
+}
+
+- (void)setUserRequestBatchWindow:(NSTimeInterval)window
+{
+    [CKTRequestCoalescer sharedInstance].userBatchWindow = window;
+}
+
+- (NSDictionary *)requestCoalescingStatistics
+{
+    return [[CKTRequestCoalescer sharedInstance] statistics];
+}
+
+- (void)resetRequestCoalescingStatistics
+{
+    [[CKTRequestCoalescer sharedInstance] resetStatistics];
+}
+
+#pragma mark - Result conversion
+
+- (void)setLazyResultConversionEnabled:(BOOL)enabled
+{
+    [CKTResultConverter sharedInstance].lazyConversionEnabled = enabled;
+}
+
+- (BOOL)isLazyResultConversionEnabled
+{
+    return [CKTResultConverter sharedInstance].isLazyConversionEnabled;
+}
+
+- (NSDictionary *)resultConversionStatistics
+{
+    return [[CKTResultConverter sharedInstance] statistics];
+}
+
+- (void)resetResultConversionStatistics
+{
+    [[CKTResultConverter sharedInstance] resetStatistics];
+}
+
+#pragma mark - Promises
+
+- (NSDictionary *)promiseStatistics
+{
+    return [Promise statistics];
+}
+
+- (void)resetPromiseStatistics
+{
+    [Promise resetStatistics];
+}
+
+#pragma mark - JS heap
+
+- (NSDictionary *)jsHeapStatistics
+{
+    return [[JSHeapMonitor sharedInstance] statistics];
+}
+
+- (void)setManagedReferenceLeakDetectionEnabled:(BOOL)enabled leakAge:(NSTimeInterval)age
+{
+    JSHeapMonitor *monitor = [JSHeapMonitor sharedInstance];
+    monitor.leakAge = age;
+    monitor.leakDetectionEnabled = enabled;
+}
+
+- (NSArray<NSDictionary *> *)suspectedManagedReferenceLeaks
+{
+    return [[JSHeapMonitor sharedInstance] suspectedLeaks];
+}
+
+- (void)collectJSGarbage
+{
+    [[JSHeapMonitor sharedInstance] collect:NO];
+}
+
+#pragma mark - Script loading
+
+- (void)setScriptCacheEnabled:(BOOL)enabled
+{
+    [JSScriptCache sharedInstance].enabled = enabled;
+    if (!enabled) {
+        [[JSScriptCache sharedInstance] purge];
+    }
+}
+
+- (NSDictionary *)scriptLoadStatistics
+{
+    return [JSEngine sharedInstance].jsThread.scriptLoadStatistics;
+}
+
+#pragma mark - JS function cache
+
+- (NSDictionary *)functionCacheStatistics
+{
+    return [[JSEngine sharedInstance].jsThread.functionCache statistics];
+}
+
+#pragma mark - JS thread task queue
+
+- (NSDictionary *)taskQueueStatistics
+{
+    return [[JSEngine sharedInstance].jsThread.taskQueue statistics];
+}
+
+- (void)resetTaskQueueStatistics
+{
+    [[JSEngine sharedInstance].jsThread.taskQueue resetStatistics];
+}
+
+#pragma mark - Events
+
+- (NSDictionary *)eventDeliveryStatistics
+{
+    return [[CKTEventDispatcher sharedInstance] statistics];
+}
+
+- (void)resetEventDeliveryStatistics
+{
+    [[CKTEventDispatcher sharedInstance] resetStatistics];
+}
+
+#pragma mark - Local store
+
+- (NSDictionary *)localStoreStatistics
+{
+    return [[CKTLocalStore sharedInstance] statistics];
+}
+
+#pragma mark - User cache
+
+- (NSDictionary *)userCacheStatistics
+{
+    return [[CKTUserCache sharedInstance] statistics];
+}
+
+- (void)resetUserCacheStatistics
+{
+    [[CKTUserCache sharedInstance] resetStatistics];
+}
+
+#pragma mark - Conversation sync
+
+- (NSDictionary *)conversationSyncStatistics
+{
+    return [[CKTSyncEngine sharedInstance] statistics];
+}
+
+- (void)resetConversationSyncStatistics
+{
+    [[CKTSyncEngine sharedInstance] resetStatistics];
+}
+
+#pragma mark - Timers
+
+- (void)setTimerLeeway:(NSTimeInterval)leeway
+{
+    // Plain timeouts keep their own leeway, precise unless set with setTimerLeeway:forTimerClass:
+    [[Window sharedInstance] setTimerLeeway:leeway forClass:JSTimerClassRequestTimeout];
+    [[Window sharedInstance] setTimerLeeway:leeway forClass:JSTimerClassInterval];
+}
+
+- (void)setTimerLeeway:(NSTimeInterval)leeway forTimerClass:(JSTimerClass)timerClass
+{
+    [[Window sharedInstance] setTimerLeeway:leeway forClass:timerClass];
+}
+
+- (NSDictionary *)timerStatistics
+{
+    return [[Window sharedInstance] timerStatistics];
+}
+
+- (void)resetTimerStatistics
+{
+    [[Window sharedInstance] resetTimerStatistics];
+}
+
+- (void)timerInventory:(void (^)(NSDictionary *inventory))completion
+{
+    dispatch_block_t notRunning = ^{ dispatch_async(dispatch_get_main_queue(), ^{ completion(nil); }); };
+
+    JSRunLoop *jsThread = [JSEngine sharedInstance].jsThread;
+    if (!jsThread || ![jsThread isExecuting]) {
+        notRunning();
+        return;
+    }
+
+    dispatch_block_t task = ^{
+        NSDictionary *inventory = [[Window sharedInstance] timerInventory];
+        dispatch_async(dispatch_get_main_queue(), ^{ completion(inventory); });
+    };
+    [jsThread.taskQueue addTask:task
+                       priority:JSTaskPriorityBackground
+                          label:"timerInventory"
+                 discardHandler:notRunning];
+}
+
+#pragma mark - JS thread watchdog
+
+- (void)setJSThreadWatchdogEnabled:(BOOL)enabled
+{
+    [JSThreadWatchdog sharedInstance].enabled = enabled;
+}
+
+- (void)setJSThreadStallThreshold:(NSTimeInterval)threshold
+{
+    [JSThreadWatchdog sharedInstance].stallThreshold = threshold;
+}
+
+- (void)setJSStackCaptureOnStallEnabled:(BOOL)enabled
+{
+    [JSThreadWatchdog sharedInstance].captureJSStackOnStall = enabled;
+}
+
+- (NSDictionary *)jsThreadStatistics
+{
+    return [[JSThreadWatchdog sharedInstance] statistics];
+}
+
+- (void)resetJSThreadStatistics
+{
+    [[JSThreadWatchdog sharedInstance] resetStatistics];
+}
+
+#pragma mark - Startup profile
+
+- (NSDictionary *)startupProfile
+{
+    return [JSEngine sharedInstance].jsThread.startupProfile;
+}
+
+- (BOOL)exportStartupTraceToPath:(NSString *)path error:(NSError **)error
+{
+    NSData *trace = [JSEngine sharedInstance].jsThread.startupTraceData;
+    if (!trace) {
+        if (error) {
+            *error = [NSError errorWithDomain:@"CircuitKit"
+                                         code:0
+                                     userInfo:@{NSLocalizedDescriptionKey : @"The JS engine has not started yet"}];
+        }
+        return NO;
+    }
+
+    return [trace writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+@end
@@ -0,0 +1,154 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Events.h
+//  CircuitSDK
+//
+//
+
+#import "CKTClient.h"
+#import "CKTEventSink.h"
+
+@interface CKTClient (Events)
+
+/**
+
+ @brief Registers a typed receiver of the SDK events.
+
+ @discussion The sink gets the events whose CKTEventSink methods it implements, with the same event object as the
+ userInfo of the matching CKTNotification*. Unlike notifications, which are posted on the main queue, the sink is
+ called on the given queue without going through NSNotificationCenter. The sink is held weakly; adding it again
+ replaces its queue.
+
+ @param sink Object implementing some of the CKTEventSink methods.
+ @param queue Serial queue the sink is called on.
+
+ */
+- (void)addEventSink:(id<CKTEventSink>)sink queue:(dispatch_queue_t)queue;
+
+/**
+
+ @brief Registers a typed receiver of the SDK events with a bounded buffer.
+
+ @discussion Same as addEventSink:queue: except that no more than capacity events wait for a slow sink. The events
+ are delivered in the order they were received, except for the updates batched by a coalescing window (see
+ setEventCoalescingWindow:forNotification:), which are delivered when their window closes or before the next event
+ about the same conversation or user. When the buffer is full
+ the policy decides which buffered update event (conversationUpdated, itemUpdated, userPresenceChanged or
+ userUpdated) gives way; call, session and connection events are never dropped, the buffer grows beyond the capacity
+ instead. Dropped and replaced events are counted in eventDeliveryStatistics.
+
+ @param sink Object implementing some of the CKTEventSink methods.
+ @param queue Serial queue the sink is called on.
+ @param capacity Most events waiting for the sink, 0 for no limit.
+ @param policy CKTEventOverflowPolicyDropOldest or CKTEventOverflowPolicyCoalesce.
+
+ */
+- (void)addEventSink:(id<CKTEventSink>)sink
+               queue:(dispatch_queue_t)queue
+            capacity:(NSUInteger)capacity
+      overflowPolicy:(CKTEventOverflowPolicy)policy;
+
+/**
+
+ @brief Unregisters an event sink.
+
+ @discussion The events still waiting in the buffer of the sink are dropped, no method is called on the sink once
+ the event being delivered on its queue, if any, returns.
+
+ @param sink Sink passed to addEventSink:queue:.
+
+ */
+- (void)removeEventSink:(id<CKTEventSink>)sink;
+
+/**
+
+ @brief Enables or disables the CKTNotification* notifications of the SDK events nobody is known to observe.
+
+ @discussion Enabled by default, since observers added to NSNotificationCenter directly are invisible to the SDK.
+ When disabled, the SDK only listens to the events of the JS SDK which have an observer registered with
+ addEventObserver:selector:name: or addEventObserverForName:queue:usingBlock:, or an event sink implementing them.
+ The other events are neither converted nor delivered, and the listeners are added and removed as observers come and
+ go.
+
+ @param enabled NO to post the notifications to the registered observers only.
+
+ */
+- (void)setEventNotificationsEnabled:(BOOL)enabled;
+
+/**
+
+ @brief Adds an observer of a CKTNotification* to the default notification center and counts it, see
+ setEventNotificationsEnabled:.
+
+ @param observer Object to notify.
+ @param selector Method called with the NSNotification.
+ @param name Notification name, e.g. CKTNotificationItemAdded.
+
+ */
+- (void)addEventObserver:(id)observer selector:(SEL)selector name:(NSString *)name;
+
+/**
+
+ @brief Adds a block based observer of a CKTNotification* to the default notification center and counts it, see
+ setEventNotificationsEnabled:.
+
+ @param name Notification name, e.g. CKTNotificationItemAdded.
+ @param queue Queue the block is run on, nil to run it on the main thread where notifications are posted.
+ @param block Block called with the NSNotification.
+
+ @return Observer to pass to removeEventObserver:name:.
+
+ */
+- (id<NSObject>)addEventObserverForName:(NSString *)name
+                                  queue:(NSOperationQueue *)queue
+                             usingBlock:(void (^)(NSNotification *notification))block;
+
+/**
+
+ @brief Removes an observer added with addEventObserver:selector:name: or addEventObserverForName:queue:usingBlock:.
+
+ @discussion Once the last observer of an event is gone, the SDK stops listening to it if notifications are
+ disabled.
+
+ @param observer Observer to remove.
+ @param name Notification name, nil for all.
+
+ */
+- (void)removeEventObserver:(id)observer name:(NSString *)name;
+
+/**
+
+ @brief Coalesces bursts of update events, e.g. the presence changes of a large tenant.
+
+ @discussion Off by default. When enabled, the events of the notification received within the window are delivered
+ as one notification whose userInfo holds the array of events in CKTKeyEvents. Events about the same user, item or
+ conversation are merged, the latest one wins and keeps the position of the first one. Event sinks get the batch in
+ coalescedEvents:notification: if implemented, the events one by one otherwise. A batch is delivered before the window
+ closes when an event which is not batched (e.g. itemAdded or callIncoming) arrives about one of its conversations or
+ users, so that the later event does not overtake it. Batches still pending at logout are dropped. The merged events
+ are counted in eventDeliveryStatistics.
+
+ @param window Time in seconds, e.g. 0.25, or 0 to deliver every event right away.
+ @param name CKTNotificationUserPresenceChanged, CKTNotificationItemUpdated, CKTNotificationUserUpdated or
+ CKTNotificationConversationUpdated.
+
+ @return NO if the events of the notification cannot be coalesced.
+
+ */
+- (BOOL)setEventCoalescingWindow:(NSTimeInterval)window forNotification:(NSString *)name;
+
+@end
@@ -0,0 +1,72 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Events.m
+//  CircuitSDK
+//
+//
+
+#import "CKTClient+Events.h"
+#import "CKTEventDispatcher.h"
+
+@implementation CKTClient (Events)
+
+- (void)addEventSink:(id<CKTEventSink>)sink queue:(dispatch_queue_t)queue
+{
+    [[CKTEventDispatcher sharedInstance] addSink:sink queue:queue];
+}
+
+- (void)addEventSink:(id<CKTEventSink>)sink
+               queue:(dispatch_queue_t)queue
+            capacity:(NSUInteger)capacity
+      overflowPolicy:(CKTEventOverflowPolicy)policy
+{
+    [[CKTEventDispatcher sharedInstance] addSink:sink queue:queue capacity:capacity overflowPolicy:policy];
+}
+
+- (void)removeEventSink:(id<CKTEventSink>)sink
+{
+    [[CKTEventDispatcher sharedInstance] removeSink:sink];
+}
+
+- (void)setEventNotificationsEnabled:(BOOL)enabled
+{
+    [CKTEventDispatcher sharedInstance].postsNotifications = enabled;
+}
+
+- (void)addEventObserver:(id)observer selector:(SEL)selector name:(NSString *)name
+{
+    [[CKTEventDispatcher sharedInstance] addObserver:observer selector:selector name:name];
+}
+
+- (id<NSObject>)addEventObserverForName:(NSString *)name
+                                  queue:(NSOperationQueue *)queue
+                             usingBlock:(void (^)(NSNotification *notification))block
+{
+    return [[CKTEventDispatcher sharedInstance] addObserverForName:name queue:queue usingBlock:block];
+}
+
+- (void)removeEventObserver:(id)observer name:(NSString *)name
+{
+    [[CKTEventDispatcher sharedInstance] removeObserver:observer name:name];
+}
+
+- (BOOL)setEventCoalescingWindow:(NSTimeInterval)window forNotification:(NSString *)name
+{
+    return [[CKTEventDispatcher sharedInstance] setCoalescingWindow:window forNotification:name];
+}
+
+@end
@@ -0,0 +1,51 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Future.h
+//  CircuitSDK
+//
+//
+
+#import "CKTClient.h"
+#import "CKTFuture.h"
+
+@interface CKTClient (Future)
+
+/**
+
+ @brief Makes the API requests of the given block cancellable.
+
+ @discussion All CKTClient methods called synchronously within the block belong to the returned future. Calling
+ cancel on it drops the requests not sent yet, skips converting the results of the requests in flight and releases
+ their JS callbacks; their completion blocks are never called. When the timeout expires first, the pending completion
+ blocks are called with an error of code CKTFutureErrorTimedOut and the requests are cancelled the same way.
+
+ @code
+ CKTFuture *future = [client requestWithTimeout:10 deliveryQueue:dispatch_get_main_queue() requests:^{
+     [client getConversationItems:convId options:nil completion:^(id items, NSError *error) { ... }];
+ }];
+ @endcode
+
+ @param timeout Deadline in seconds for all requests of the block, 0 for none.
+ @param queue Queue the completion blocks are called on, nil to call them on the JS thread.
+ @param requests Block making the API requests.
+
+ */
+- (CKTFuture *)requestWithTimeout:(NSTimeInterval)timeout
+                    deliveryQueue:(dispatch_queue_t)queue
+                         requests:(void (^)(void))requests;
+
+@end
@@ -0,0 +1,33 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Future.m
+//  CircuitSDK
+//
+//
+
+#import "CKTClient+Future.h"
+
+@implementation CKTClient (Future)
+
+- (CKTFuture *)requestWithTimeout:(NSTimeInterval)timeout
+                    deliveryQueue:(dispatch_queue_t)queue
+                         requests:(void (^)(void))requests
+{
+    return [[CKTFuture futureWithTimeout:timeout deliveryQueue:queue] run:requests];
+}
+
+@end
@@ -22,6 +22,8 @@
 #import "CKTClient+Logon.h"
 #import "CKTHttp.h"
 #import "CKTProxyConfiguration.h"
+#import "CKTSyncEngine.h"
+#import "CKTUserCache.h"
 #import "Log.h"
 #import "Window.h"
 
@@ -63,6 +65,9 @@ static NSString *const kCKTDefaultServerPath = @"circuitsandbox.net";
 
 - (void)logout:(void (^)(void))completion
 {
+    [[CKTUserCache sharedInstance] removeAllUsers];
+    [[CKTSyncEngine sharedInstance] removeAllWatermarks];
+
     NSDictionary *args = @{kJSEngineBlockArgName : completion};
 
     [self executeAsync:@selector(logoutCompletion:) withObject:args];
@@ -0,0 +1,110 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Store.h
+//  CircuitSDK
+//
+//
+
+
+#import "CKTClient.h"
+
+@interface CKTClient (Store)
+
+/**
+
+ @brief Opens the on-device store of the conversations and items of a user.
+
+ @discussion The store is kept up to date from the conversation and item events and the results of
+ getConversations, getConversationById, getConversationFeed, getConversationItems, getItemById and getItemsById, and
+ survives app restarts. Open it at launch with the id of the last logged on user to draw the cached conversations
+ right away, before logon, then reconcile with the results of the regular APIs. Call purgeLocalStore at logout.
+
+ @param userId Id of the user whose store is opened.
+ @param error Set if the store cannot be opened.
+
+ @return YES if the store is open.
+
+ */
+- (BOOL)openLocalStoreForUser:(NSString *)userId error:(NSError **)error;
+
+/**
+
+ @brief Closes the local store, it is not updated anymore.
+
+ */
+- (void)closeLocalStore;
+
+/**
+
+ @brief Removes all conversations and items from the local store.
+
+ */
+- (void)purgeLocalStore;
+
+/**
+
+ @brief Returns the cached conversations of the user, by decreasing last activity.
+
+ @discussion Synchronous, may be called on any thread. Takes the same options as getConversations:completionHandler:,
+ timestamp (in milliseconds) and numberOfConversations (default 25). Only the BEFORE direction is supported.
+
+ @param options Options to filter by, or nil.
+
+ @return The conversations, empty if the store is not open.
+
+ */
+- (NSArray<NSDictionary *> *)cachedConversations:(NSDictionary *)options;
+
+/**
+
+ @brief Returns a cached conversation.
+
+ @param convId The conversation's id.
+
+ @return The conversation, nil if it is not in the store.
+
+ */
+- (NSDictionary *)cachedConversationById:(NSString *)convId;
+
+/**
+
+ @brief Returns the cached items of a conversation.
+
+ @discussion Synchronous, may be called on any thread. Takes the same options as
+ getConversationItems:options:completion:, direction (BEFORE, newest first, or AFTER, oldest first), creationTime (in
+ milliseconds) and numberOfItems (default 25).
+
+ @param convId Conversation id of the items.
+ @param options Options to filter by, or nil.
+
+ @return The items, empty if the store is not open.
+
+ */
+- (NSArray<NSDictionary *> *)cachedConversationItems:(NSString *)convId options:(NSDictionary *)options;
+
+/**
+
+ @brief Returns a cached item.
+
+ @param itemId The item's id.
+
+ @return The item, nil if it is not in the store.
+
+ */
+- (NSDictionary *)cachedItemById:(NSString *)itemId;
+
+@end
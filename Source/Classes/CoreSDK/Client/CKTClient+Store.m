@@ -0,0 +1,78 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTClient+Store.m
+//  CircuitSDK
+//
+//
+
+
+#import "CKTClient+Store.h"
+#import "CKTLocalStore.h"
+
+// Default page size of the JS SDK
+static const NSUInteger kCKTDefaultNumberOfResults = 25;
+
+@implementation CKTClient (Store)
+
+- (BOOL)openLocalStoreForUser:(NSString *)userId error:(NSError **)error
+{
+    return [[CKTLocalStore sharedInstance] openForUser:userId error:error];
+}
+
+- (void)closeLocalStore
+{
+    [[CKTLocalStore sharedInstance] close];
+}
+
+- (void)purgeLocalStore
+{
+    [[CKTLocalStore sharedInstance] purge];
+}
+
+- (NSArray<NSDictionary *> *)cachedConversations:(NSDictionary *)options
+{
+    NSNumber *count = options[@"numberOfConversations"];
+
+    return [[CKTLocalStore sharedInstance] conversationsBefore:options[@"timestamp"]
+                                                         limit:count ? count.unsignedIntegerValue
+                                                                     : kCKTDefaultNumberOfResults];
+}
+
+- (NSDictionary *)cachedConversationById:(NSString *)convId
+{
+    return [[CKTLocalStore sharedInstance] conversationWithId:convId];
+}
+
+- (NSArray<NSDictionary *> *)cachedConversationItems:(NSString *)convId options:(NSDictionary *)options
+{
+    NSString *direction = options[@"direction"];
+    BOOL after = [direction isKindOfClass:[NSString class]] && [direction.uppercaseString isEqualToString:@"AFTER"];
+    NSNumber *count = options[@"numberOfItems"];
+
+    return [[CKTLocalStore sharedInstance] itemsOfConversation:convId
+                                                        before:!after
+                                                     timestamp:options[@"creationTime"]
+                                                         limit:count ? count.unsignedIntegerValue
+                                                                     : kCKTDefaultNumberOfResults];
+}
+
+- (NSDictionary *)cachedItemById:(NSString *)itemId
+{
+    return [[CKTLocalStore sharedInstance] itemWithId:itemId];
+}
+
+@end
@@ -23,6 +23,45 @@
 
 @interface CKTClient (User)
 
+/**
+
+ @brief Returns the cached presence of a user.
+
+ @discussion Synchronous, may be called on any thread. The user cache must be enabled with setUserCacheCapacity:.
+
+ @param userId Id of the user.
+
+ @return The presence, nil if it is not cached or older than the presence time to live.
+
+ */
+- (NSDictionary *)cachedPresence:(NSString *)userId;
+
+/**
+
+ @brief Returns a cached user by email address.
+
+ @discussion Synchronous, may be called on any thread. The user cache must be enabled with setUserCacheCapacity:.
+
+ @param email Email address of the user.
+
+ @return The user, nil if it is not cached or older than the profile time to live.
+
+ */
+- (NSDictionary *)cachedUserByEmail:(NSString *)email;
+
+/**
+
+ @brief Returns a cached user by id, e.g. to show names and avatars in list cells without a request.
+
+ @discussion Synchronous, may be called on any thread. The user cache must be enabled with setUserCacheCapacity:.
+
+ @param userId Id of the user.
+
+ @return The user, nil if it is not cached or older than the profile time to live.
+
+ */
+- (NSDictionary *)cachedUserById:(NSString *)userId;
+
 /**
 
  @brief Returns the current logged on user in JSON format.
@@ -147,6 +186,34 @@
  */
 - (void)setStatusMessage:(NSString *)statusMessage completion:(void (^)(void))completion;
 
+/**
+
+ @brief Enables the user cache and sets the most users it keeps, the least recently used are dropped first.
+
+ @discussion Disabled by default. The cache is fed by the results of getLoggedOnUser, getUserById, getUsersById (not
+ limited), getUserByEmail, getUsersByEmail and getPresence and by the UserUpdated and UserPresenceChanged events.
+ While a user is fresh, getUserById, getUsersById, getUserByEmail and getPresence are answered from the cache
+ without a request. The cache is emptied at logout, its hit rate is reported by userCacheStatistics.
+
+ @param capacity Most users kept, e.g. 1000. 0 disables and empties the cache.
+
+ */
+- (void)setUserCacheCapacity:(NSUInteger)capacity;
+
+/**
+
+ @brief Sets how long cached user profiles and presence are used.
+
+ @discussion Presence changes are only pushed for the users whose presence is subscribed to, so presence expires
+ sooner than the rest of the profile by default.
+
+ @param profileTimeToLive Seconds a user profile is used, 300 by default.
+ @param presenceTimeToLive Seconds a presence state is used, 30 by default.
+
+ */
+- (void)setUserCacheProfileTimeToLive:(NSTimeInterval)profileTimeToLive
+                   presenceTimeToLive:(NSTimeInterval)presenceTimeToLive;
+
 /**
 
  @brief Update the logged on user's own object.
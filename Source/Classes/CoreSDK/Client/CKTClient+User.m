@@ -20,9 +20,44 @@
 //
 
 #import "CKTClient+User.h"
+#import "CKTFuture.h"
+#import "CKTRequestCoalescer.h"
+#import "CKTUserCache.h"
+#import "JSEngine.h"
+
+// Results of the user APIs also feed the user cache while it is enabled
+static CompletionBlock CKTCachingCompletion(CompletionBlock completion, void (^store)(CKTUserCache *cache, id data))
+{
+    CKTUserCache *cache = [CKTUserCache sharedInstance];
+    if (!cache.isEnabled || !completion) {
+        return completion;
+    }
+
+    return ^(id data, NSError *error) {
+        if (data && !error) {
+            store(cache, data);
+        }
+        completion(data, error);
+    };
+}
 
 @implementation CKTClient (User)
 
+- (NSDictionary *)cachedPresence:(NSString *)userId
+{
+    return [[CKTUserCache sharedInstance] presenceOfUser:userId full:NO];
+}
+
+- (NSDictionary *)cachedUserByEmail:(NSString *)email
+{
+    return [[CKTUserCache sharedInstance] userWithEmail:email];
+}
+
+- (NSDictionary *)cachedUserById:(NSString *)userId
+{
+    return [[CKTUserCache sharedInstance] userWithId:userId];
+}
+
 - (void)getLoggedOnUser:(CompletionBlock)completion;
 {
     NSDictionary *args = @{kJSEngineBlockArgName : completion};
@@ -63,7 +98,7 @@
     BOOL isLimited = YES;
     NSDictionary *args = @{ @"userIds" : userIds, @"limited" : @(isLimited), kJSEngineBlockArgName : completion };
 
-    [self executeAsync:@selector(getUsersByIdCompletion:) withObject:args];
+    [self executeAsync:@selector(getUsersByIdCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getUsersById:(NSArray *)userIds limited:(BOOL)limited completion:(CompletionBlock)completion
@@ -75,7 +110,7 @@
     BOOL isLimited = limited;
     NSDictionary *args = @{ @"userIds" : userIds, @"limited" : @(isLimited), kJSEngineBlockArgName : completion };
 
-    [self executeAsync:@selector(getUsersByIdCompletion:) withObject:args];
+    [self executeAsync:@selector(getUsersByIdCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getUserByEmail:(NSString *)email completion:(CompletionBlock)completion
@@ -97,7 +132,7 @@
 
     NSDictionary *args = @{ @"emails" : emails, kJSEngineBlockArgName : completion };
 
-    [self executeAsync:@selector(getUsersByEmailCompletion:) withObject:args];
+    [self executeAsync:@selector(getUsersByEmailCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)getUserSettings:(CompletionBlock)completion
@@ -125,13 +160,26 @@
     [self executeAsync:@selector(setStatusMessageCompletion:) withObject:args];
 }
 
+- (void)setUserCacheCapacity:(NSUInteger)capacity
+{
+    [CKTUserCache sharedInstance].capacity = capacity;
+}
+
+- (void)setUserCacheProfileTimeToLive:(NSTimeInterval)profileTimeToLive
+                   presenceTimeToLive:(NSTimeInterval)presenceTimeToLive
+{
+    CKTUserCache *cache = [CKTUserCache sharedInstance];
+    cache.profileTimeToLive = profileTimeToLive;
+    cache.presenceTimeToLive = presenceTimeToLive;
+}
+
 - (void)getTenantUsers:(NSDictionary *)options completion:(CompletionBlock)completion
 {
     id filterOptions = options ? options : [NSNull null];
 
     NSDictionary *args = @{ @"options" : filterOptions, kJSEngineBlockArgName : completion };
 
-    [self executeAsync:@selector(getTenantUsersCompletion:) withObject:args];
+    [self executeAsync:@selector(getTenantUsersCompletion:) withObject:args priority:JSTaskPriorityBackground];
 }
 
 - (void)updateUser:(NSDictionary *)user completion:(CompletionBlockWithNoData)completion
@@ -149,7 +197,9 @@
 
 - (void)getLoggedOnUserCompletion:(NSDictionary *)args
 {
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion = CKTCachingCompletion(args[kJSEngineBlockArgName], ^(CKTUserCache *cache, id data) {
+        [cache storeUsers:data];
+    });
 
     [self executeFunction:@"getLoggedOnUser" args:nil completionHandler:completion];
 }
@@ -157,8 +207,17 @@
 - (void)getPresenceCompletion:(NSDictionary *)args
 {
     NSArray *userIds = args[@"userIds"];
-    BOOL full = (BOOL)args[@"full"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    BOOL full = [args[@"full"] boolValue];
+
+    NSArray *presence = [[CKTUserCache sharedInstance] presenceOfUsers:userIds full:full];
+    if (presence) {
+        [self deliverCachedResult:presence completion:args[kJSEngineBlockArgName]];
+        return;
+    }
+
+    CompletionBlock completion = CKTCachingCompletion(args[kJSEngineBlockArgName], ^(CKTUserCache *cache, id data) {
+        [cache storePresence:data full:full];
+    });
 
     NSArray *userArgs = @[ userIds, @(full) ];
 
@@ -168,17 +227,115 @@
 - (void)getUserByIdCompletion:(NSDictionary *)args
 {
     NSString *userId = args[@"userId"];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
-    NSArray *userArgs = @[ userId ];
 
-    [self executeFunction:@"getUserById" args:userArgs completionHandler:completion];
+    NSDictionary *user = [[CKTUserCache sharedInstance] userWithId:userId];
+    if (user) {
+        [self deliverCachedResult:user completion:args[kJSEngineBlockArgName]];
+        return;
+    }
+
+    CompletionBlock completion = CKTCachingCompletion(args[kJSEngineBlockArgName], ^(CKTUserCache *cache, id data) {
+        [cache storeUsers:data];
+    });
+
+    CKTRequestCoalescer *coalescer = [CKTRequestCoalescer sharedInstance];
+    NSTimeInterval batchWindow = coalescer.userBatchWindow;
+    if (!coalescer.isEnabled || batchWindow <= 0) {
+        [self executeFunction:@"getUserById" args:@[ userId ] completionHandler:completion];
+        return;
+    }
+
+    // The batched request is shared, a future can only drop the delivery of its own user
+    CKTFuture *future = [CKTFuture currentFuture];
+    if (future) {
+        completion = [future completionForCompletion:completion];
+        if (!completion) {
+            return;
+        }
+    }
+
+    // Collect the getUserById calls made within the batch window into one getUsersById request
+    if ([coalescer addPendingUserId:userId completion:completion]) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(batchWindow * NSEC_PER_SEC)),
+                       dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                           [[JSEngine sharedInstance] performBlock:^{ [self sendPendingUserIds]; }];
+                       });
+    }
+}
+
+- (void)sendPendingUserIds
+{
+    NSDictionary<NSString *, NSArray<CKTCoalescerCompletion> *> *pending =
+        [[CKTRequestCoalescer sharedInstance] takePendingUserIds];
+
+    if (pending.count == 0) {
+        return;
+    } else if (pending.count == 1) {
+        [self getUsersIndividually:pending];
+        return;
+    }
+
+    NSArray *userIds = pending.allKeys;
+    [self executeFunction:@"getUsersById"
+                     args:@[ userIds, @NO ]
+        completionHandler:^(NSDictionary *jsData, NSError *error) {
+            NSArray *users = (NSArray *)jsData;
+            if (error || ![users isKindOfClass:[NSArray class]]) {
+                // Let each call report its own result
+                [self getUsersIndividually:pending];
+                return;
+            }
+
+            NSMutableDictionary *usersById = [NSMutableDictionary dictionary];
+            for (NSDictionary *user in users) {
+                if ([user isKindOfClass:[NSDictionary class]] && user[@"userId"]) {
+                    usersById[user[@"userId"]] = user;
+                }
+            }
+
+            NSMutableDictionary *missing = [NSMutableDictionary dictionary];
+            [pending enumerateKeysAndObjectsUsingBlock:^(NSString *userId, NSArray *completions, BOOL *stop) {
+                NSDictionary *user = usersById[userId];
+                if (!user) {
+                    missing[userId] = completions;
+                    return;
+                }
+                for (CKTCoalescerCompletion completion in completions) {
+                    completion(user, nil);
+                }
+            }];
+
+            // Unknown users get the error of getUserById
+            [self getUsersIndividually:missing];
+        }];
+}
+
+- (void)getUsersIndividually:(NSDictionary<NSString *, NSArray<CKTCoalescerCompletion> *> *)pending
+{
+    [pending enumerateKeysAndObjectsUsingBlock:^(NSString *userId, NSArray *completions, BOOL *stop) {
+        for (CKTCoalescerCompletion completion in completions) {
+            // Shared by the de-duplication in executeFunction
+            [self executeFunction:@"getUserById" args:@[ userId ] completionHandler:completion];
+        }
+    }];
 }
 
 - (void)getUsersByIdCompletion:(NSDictionary *)args
 {
     NSArray *userIds = args[@"userIds"];
-    BOOL limited = (BOOL)args[@"limited"];
+    BOOL limited = [args[@"limited"] boolValue];
+
+    // A cached user is complete, limited results only hold some of the attributes and are not cached
+    NSArray *users = [[CKTUserCache sharedInstance] usersWithIds:userIds];
+    if (users) {
+        [self deliverCachedResult:users completion:args[kJSEngineBlockArgName]];
+        return;
+    }
+
     CompletionBlock completion = args[kJSEngineBlockArgName];
+    if (!limited) {
+        completion = CKTCachingCompletion(completion, ^(CKTUserCache *cache, id data) { [cache storeUsers:data]; });
+    }
     NSArray *userArgs = @[ userIds, @(limited) ];
 
     [self executeFunction:@"getUsersById" args:userArgs completionHandler:completion];
@@ -187,8 +344,17 @@
 - (void)getUserByEmailCompletion:(NSDictionary *)args
 {
     NSString *email = args[@"email"];
+
+    NSDictionary *user = [[CKTUserCache sharedInstance] userWithEmail:email];
+    if (user) {
+        [self deliverCachedResult:user completion:args[kJSEngineBlockArgName]];
+        return;
+    }
+
     NSArray *userArgs = @[ email ];
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion = CKTCachingCompletion(args[kJSEngineBlockArgName], ^(CKTUserCache *cache, id data) {
+        [cache storeUsers:data];
+    });
 
     [self executeFunction:@"getUserByEmail" args:userArgs completionHandler:completion];
 }
@@ -198,11 +364,26 @@
     NSArray *emails = args[@"emails"];
     NSArray *usersArgs = @[ emails ];
 
-    CompletionBlock completion = args[kJSEngineBlockArgName];
+    CompletionBlock completion = CKTCachingCompletion(args[kJSEngineBlockArgName], ^(CKTUserCache *cache, id data) {
+        [cache storeUsers:data];
+    });
 
     [self executeFunction:@"getUsersByEmail" args:usersArgs completionHandler:completion];
 }
 
+// Answers a request from the user cache, on the JS thread like the results of the JS SDK
+- (void)deliverCachedResult:(id)result completion:(CompletionBlock)completion
+{
+    CKTFuture *future = [CKTFuture currentFuture];
+    if (future) {
+        completion = [future completionForCompletion:completion];
+        if (!completion) {
+            return;
+        }
+    }
+    completion(result, nil);
+}
+
 - (void)getUserSettingsCompletion:(NSDictionary *)args
 {
     CompletionBlock completion = args[kJSEngineBlockArgName];
@@ -21,6 +21,7 @@
 
 #import <Foundation/Foundation.h>
 #import "JSRunLoop.h"
+#import "JSTaskQueue.h"
 
 @class JSContext;
 
@@ -32,8 +33,13 @@
 
 - (void)start;
 - (void)stop;
+- (void)reset;
 - (void)sendNotification:(NSString *)notification userInfo:(NSDictionary *)data;
 - (void)performAction:(id)service selector:(SEL)selector withObject:(id)arg waitUntilDone:(BOOL)wait;
+- (void)performAction:(id)service selector:(SEL)selector withObject:(id)arg priority:(JSTaskPriority)priority;
+- (void)performBlock:(dispatch_block_t)block;
+- (void)performBlock:(dispatch_block_t)block priority:(JSTaskPriority)priority;
+- (void)performBlock:(dispatch_block_t)block priority:(JSTaskPriority)priority label:(const char *)label;
 
 // *** I M P O R T A N T ***
 // Managed references should not be added directly using the context. Instead, the add/removeManagedReference
@@ -20,6 +20,8 @@
 //
 
 #import "JSEngine.h"
+#import "CKTFuture.h"
+#import "JSHeapMonitor.h"
 #import "JSNotificationCenter.h"
 #import "JSRunLoop.h"
 #import "Log.h"
@@ -63,6 +65,23 @@ static NSString *LOG_TAG = @"[JSEngine]";
     self.jsThread = nil;
 }
 
+/**
+ *  Warm restart, e.g. on logout or account switch: keeps the JS thread and the loaded scripts and only
+ *  recreates the session state of the JS SDK. The applicationServiceLoaded notification is sent again once
+ *  done. Starts the engine if it is not running.
+ */
+- (void)reset
+{
+    JSRunLoop *jsThread = self.jsThread;
+    if (jsThread == nil) {
+        [self start];
+        return;
+    }
+
+    LOGI(LOG_TAG, @"Resetting JS Engine...");
+    [self performBlock:^{ [jsThread resetJSEnvironment]; } priority:JSTaskPriorityUserInteractive label:"reset"];
+}
+
 - (void)sendNotification:(NSString *)notification userInfo:(NSDictionary *)data
 {
     // Send notifications asynchronously otherwise the UI may freeze.
@@ -80,14 +99,107 @@ static NSString *LOG_TAG = @"[JSEngine]";
  */
 - (void)performAction:(id)service selector:(SEL)selector withObject:(id)arg waitUntilDone:(BOOL)wait
 {
+    JSRunLoop *jsThread = self.jsThread;
+
     // Make sure jsThread is still running
-    if (self.jsThread && [self.jsThread isExecuting]) {
-        [service performSelector:selector onThread:self.jsThread withObject:arg waitUntilDone:wait];
+    if (!jsThread || ![jsThread isExecuting]) {
+        LOGE(LOG_TAG, @"cannot execute %@ - jsThread has stopped running", NSStringFromSelector(selector));
+        return;
+    }
+
+    dispatch_block_t action = [self blockForAction:service selector:selector withObject:arg];
+
+    if (!wait) {
+        [jsThread.taskQueue addTask:action priority:JSTaskPriorityUserInteractive label:sel_getName(selector)];
+    } else if ([NSThread currentThread] == jsThread) {
+        action();
+    } else {
+        // Goes through the task queue as well so that it is not executed ahead of pending async actions. If the
+        // JS thread stops before the action runs, the action is discarded and the caller released.
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        dispatch_block_t task = ^{
+            action();
+            dispatch_semaphore_signal(done);
+        };
+        dispatch_block_t discarded = ^{
+            LOGE(LOG_TAG, @"%@ not executed - jsThread has stopped running", NSStringFromSelector(selector));
+            dispatch_semaphore_signal(done);
+        };
+        [jsThread.taskQueue addTask:task
+                           priority:JSTaskPriorityUserInteractive
+                              label:sel_getName(selector)
+                     discardHandler:discarded];
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    }
+}
+
+/**
+ *  Executes a function asynchronously on the JS thread with the given scheduling priority.
+ *
+ *  @param service  The class where the function is to be called
+ *  @param selector The function that is to be executed
+ *  @param arg      Arguments that will be passed into the executing function
+ *  @param priority Scheduling class, bulk work should use JSTaskPriorityBackground
+ */
+- (void)performAction:(id)service selector:(SEL)selector withObject:(id)arg priority:(JSTaskPriority)priority
+{
+    JSRunLoop *jsThread = self.jsThread;
+
+    if (jsThread && [jsThread isExecuting]) {
+        [jsThread.taskQueue addTask:[self blockForAction:service selector:selector withObject:arg]
+                           priority:priority
+                              label:sel_getName(selector)];
     } else {
         LOGE(LOG_TAG, @"cannot execute %@ - jsThread has stopped running", NSStringFromSelector(selector));
     }
 }
 
+/**
+ *  Executes a block asynchronously on the JS thread. Blocks of the same priority are executed in the order
+ *  they are submitted.
+ *
+ *  @param block The block to be executed
+ */
+- (void)performBlock:(dispatch_block_t)block
+{
+    [self performBlock:block priority:JSTaskPriorityUserInteractive];
+}
+
+- (void)performBlock:(dispatch_block_t)block priority:(JSTaskPriority)priority
+{
+    [self performBlock:block priority:priority label:NULL];
+}
+
+- (void)performBlock:(dispatch_block_t)block priority:(JSTaskPriority)priority label:(const char *)label
+{
+    JSRunLoop *jsThread = self.jsThread;
+
+    if (jsThread && [jsThread isExecuting]) {
+        [jsThread.taskQueue addTask:block priority:priority label:label];
+    } else {
+        LOGE(LOG_TAG, @"cannot execute block - jsThread has stopped running");
+    }
+}
+
+- (dispatch_block_t)blockForAction:(id)service selector:(SEL)selector withObject:(id)arg
+{
+    // Actions requested within -[CKTFuture run:] carry the future over to the JS thread
+    CKTFuture *future = [CKTFuture currentFuture];
+
+    return ^{
+        if (future.isCancelled) {
+            return;
+        }
+        [CKTFuture performWithCurrentFuture:future
+                                      block:^{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
+                                          [service performSelector:selector withObject:arg];
+#pragma clang diagnostic pop
+                                      }];
+    };
+}
+
 - (JSContext *)context
 {
     return self.jsThread.context;
@@ -96,11 +208,13 @@ static NSString *LOG_TAG = @"[JSEngine]";
 - (void)addManagedReference:(id)object
 {
     [self.context.virtualMachine addManagedReference:object withOwner:self];
+    [[JSHeapMonitor sharedInstance] didAddManagedReference:object site:__builtin_return_address(0)];
 }
 
 - (void)removeManagedReference:(id)object
 {
     [self.context.virtualMachine removeManagedReference:object withOwner:self];
+    [[JSHeapMonitor sharedInstance] didRemoveManagedReference:object];
 }
 
 - (NSRunLoop *)runLoop
@@ -0,0 +1,50 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSFunctionCache.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class JSContext;
+@class JSValue;
+
+// Keys of the dictionary returned by -[JSFunctionCache statistics]
+extern NSString *const kJSFunctionCacheHits;
+extern NSString *const kJSFunctionCacheMisses;
+extern NSString *const kJSFunctionCacheSize;
+extern NSString *const kJSFunctionCacheResolveTime;  // Histogram (see CKTHistogram.h) of the lookups on a miss
+
+// Resolved sdkClient functions of one JSContext, so that API calls and event subscriptions do not look up
+// context[@"sdkClient"] and its function property through the JSC bridge every time. The functions are held
+// as managed references owned by the JSEngine.
+//
+// Must be recreated with the context. All methods except -statistics must be called on the JS thread.
+@interface JSFunctionCache : NSObject
+
+- (instancetype)initWithContext:(JSContext *)context;
+
+// Returns the sdkClient function with the given name, undefined if there is none. Only functions are cached.
+- (JSValue *)functionNamed:(NSString *)functionName;
+
+// Releases the managed references
+- (void)removeAllFunctions;
+
+- (NSDictionary *)statistics;
+
+@end
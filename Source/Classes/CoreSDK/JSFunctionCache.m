@@ -0,0 +1,126 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSFunctionCache.m
+//  CircuitSDK
+//
+//
+
+#import <JavaScriptCore/JavaScriptCore.h>
+
+#import "CKTHistogram.h"
+#import "JSEngine.h"
+#import "JSFunctionCache.h"
+#import "Log.h"
+
+NSString *const kJSFunctionCacheHits = @"hits";
+NSString *const kJSFunctionCacheMisses = @"misses";
+NSString *const kJSFunctionCacheSize = @"size";
+NSString *const kJSFunctionCacheResolveTime = @"resolveTime";
+
+@interface JSFunctionCache ()
+
+@property (nonatomic, weak) JSContext *context;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, JSManagedValue *> *functions;
+
+// Protected by @synchronized(self)
+@property (nonatomic, assign) uint64_t hits;
+@property (nonatomic, assign) uint64_t misses;
+@property (nonatomic, assign) NSUInteger size;
+@property (nonatomic, strong) CKTHistogram *resolveTime;
+
+@end
+
+@implementation JSFunctionCache
+
+static NSString *LOG_TAG = @"[JSFunctionCache]";
+
+- (instancetype)initWithContext:(JSContext *)context
+{
+    if (self = [super init]) {
+        _context = context;
+        _functions = [NSMutableDictionary dictionary];
+        _resolveTime = [[CKTHistogram alloc] init];
+    }
+    return self;
+}
+
+- (JSValue *)functionNamed:(NSString *)functionName
+{
+    JSValue *function = self.functions[functionName].value;
+    if (function) {
+        @synchronized(self)
+        {
+            self.hits++;
+        }
+        return function;
+    }
+
+    uint64_t start = CKTMonotonicMicroseconds();
+
+    JSValue *circuit = self.context[@"sdkClient"];
+    function = circuit[functionName];
+
+    if ([function isObject]) {
+        JSManagedValue *managedFunction = [JSManagedValue managedValueWithValue:function];
+        [[JSEngine sharedInstance] addManagedReference:managedFunction];
+
+        JSManagedValue *previous = self.functions[functionName];
+        if (previous) {
+            [[JSEngine sharedInstance] removeManagedReference:previous];
+        }
+        self.functions[functionName] = managedFunction;
+    } else {
+        LOGW(LOG_TAG, @"sdkClient.%@ is not a function", functionName);
+    }
+
+    @synchronized(self)
+    {
+        self.misses++;
+        self.size = self.functions.count;
+        [self.resolveTime recordValue:CKTMonotonicMicroseconds() - start];
+    }
+
+    return function;
+}
+
+- (void)removeAllFunctions
+{
+    for (JSManagedValue *function in self.functions.allValues) {
+        [[JSEngine sharedInstance] removeManagedReference:function];
+    }
+    [self.functions removeAllObjects];
+
+    @synchronized(self)
+    {
+        self.size = 0;
+    }
+}
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        return @{
+            kJSFunctionCacheHits : @(self.hits),
+            kJSFunctionCacheMisses : @(self.misses),
+            kJSFunctionCacheSize : @(self.size),
+            kJSFunctionCacheResolveTime : [self.resolveTime dictionaryRepresentation]
+        };
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSHeapMonitor.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Keys of the dictionary returned by -[JSHeapMonitor statistics]
+extern NSString *const kJSHeapManagedReferences;         // Managed references currently held by the JSEngine
+extern NSString *const kJSHeapManagedReferencesAdded;    // Total -addManagedReference: calls
+extern NSString *const kJSHeapManagedReferencesRemoved;  // Total -removeManagedReference: calls
+extern NSString *const kJSHeapReferencesBySite;          // Function name -> references it holds (leak detection)
+extern NSString *const kJSHeapFootprint;                 // Physical footprint of the app in MB
+extern NSString *const kJSHeapGarbageCollections;        // Collections triggered by memory pressure or -collect
+extern NSString *const kJSHeapLastCollectionReclaimed;   // Footprint reclaimed in MB by the last collection
+extern NSString *const kJSHeapMemoryWarnings;            // Memory pressure notifications received
+
+// Keys of the reports returned by -[JSHeapMonitor suspectedLeaks]
+extern NSString *const kJSHeapLeakSite;   // Function which added the references
+extern NSString *const kJSHeapLeakCount;  // References added there and held for longer than leakAge
+extern NSString *const kJSHeapLeakAge;    // Age in seconds of the oldest of them
+
+// Accounting of the JS heap and of the native references into it.
+//
+// JavaScriptCore has no public API for the heap size or its object counts. The managed references held through
+// -[JSEngine addManagedReference:] are what keeps JS objects alive from native code, they are counted and, with leak
+// detection enabled, recorded with the function which added them. The heap size is approximated by the physical
+// footprint of the app before and after a collection.
+//
+// On memory pressure a garbage collection is run on the JS thread.
+@interface JSHeapMonitor : NSObject
+
+// Disabled by default, when disabled only the counters are maintained
+@property (atomic, assign, getter=isLeakDetectionEnabled) BOOL leakDetectionEnabled;
+
+// References held for longer than this are reported as suspected leaks, 5 minutes by default
+@property (atomic, assign) NSTimeInterval leakAge;
+
++ (JSHeapMonitor *)sharedInstance;
+
+// Starts listening to the memory pressure notifications of the system, can be called repeatedly
+- (void)startMonitoringMemoryPressure;
+
+// Hooks called by JSEngine. The site is the return address of the caller.
+- (void)didAddManagedReference:(id)object site:(void *)site;
+- (void)didRemoveManagedReference:(id)object;
+
+// Forgets all references, called when the JS environment is torn down
+- (void)discardReferences;
+
+// Runs a garbage collection on the JS thread, like on memory pressure
+- (void)collect:(BOOL)critical;
+
+- (NSDictionary *)statistics;
+- (NSArray<NSDictionary *> *)suspectedLeaks;
+
+@end
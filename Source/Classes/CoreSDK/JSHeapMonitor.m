@@ -0,0 +1,290 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSHeapMonitor.m
+//  CircuitSDK
+//
+//
+
+#import "JSHeapMonitor.h"
+#import "CKTHistogram.h"
+#import "JSEngine.h"
+#import "Log.h"
+
+#import <JavaScriptCore/JavaScriptCore.h>
+#import <dlfcn.h>
+#import <mach/mach.h>
+#import <os/lock.h>
+#import <stdatomic.h>
+
+NSString *const kJSHeapManagedReferences = @"managedReferences";
+NSString *const kJSHeapManagedReferencesAdded = @"managedReferencesAdded";
+NSString *const kJSHeapManagedReferencesRemoved = @"managedReferencesRemoved";
+NSString *const kJSHeapReferencesBySite = @"referencesBySite";
+NSString *const kJSHeapFootprint = @"footprint";
+NSString *const kJSHeapGarbageCollections = @"garbageCollections";
+NSString *const kJSHeapLastCollectionReclaimed = @"lastCollectionReclaimed";
+NSString *const kJSHeapMemoryWarnings = @"memoryWarnings";
+
+NSString *const kJSHeapLeakSite = @"site";
+NSString *const kJSHeapLeakCount = @"count";
+NSString *const kJSHeapLeakAge = @"age";
+
+// Where and when a managed reference was added, only recorded with leak detection enabled
+@interface JSManagedReferenceRecord : NSObject {
+@public
+    void *_site;
+    uint64_t _added;
+}
+@end
+
+@implementation JSManagedReferenceRecord
+@end
+
+@interface JSHeapMonitor () {
+    atomic_uint_fast64_t _added;
+    atomic_uint_fast64_t _removed;
+    atomic_uint_fast64_t _memoryWarnings;
+
+    // Protects _records
+    os_unfair_lock _lock;
+
+    // Managed object -> record, weak keys so that released objects drop out by themselves
+    NSMapTable<id, JSManagedReferenceRecord *> *_records;
+}
+
+@property (nonatomic, strong) dispatch_source_t memoryPressureSource;
+
+// Written on the JS thread
+@property (atomic, assign) uint64_t garbageCollections;
+@property (atomic, assign) double lastCollectionReclaimed;
+
+@end
+
+@implementation JSHeapMonitor
+
+static NSString *LOG_TAG = @"[JSHeapMonitor]";
+
++ (JSHeapMonitor *)sharedInstance
+{
+    static JSHeapMonitor *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[JSHeapMonitor alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _records = [NSMapTable weakToStrongObjectsMapTable];
+        _leakAge = 300;
+    }
+    return self;
+}
+
+- (void)startMonitoringMemoryPressure
+{
+    @synchronized(self)
+    {
+        if (self.memoryPressureSource) {
+            return;
+        }
+
+        dispatch_source_t source =
+            dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                   DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                   dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        __weak JSHeapMonitor *weakSelf = self;
+        dispatch_source_set_event_handler(source, ^{
+            JSHeapMonitor *strongSelf = weakSelf;
+            BOOL critical = (dispatch_source_get_data(source) & DISPATCH_MEMORYPRESSURE_CRITICAL) != 0;
+            atomic_fetch_add_explicit(&strongSelf->_memoryWarnings, 1, memory_order_relaxed);
+            LOGW(LOG_TAG, @"Memory pressure (%@), footprint %.1f MB", critical ? @"critical" : @"warning",
+                 [strongSelf footprint]);
+            [strongSelf collect:critical];
+        });
+        dispatch_resume(source);
+        self.memoryPressureSource = source;
+    }
+}
+
+#pragma mark - Managed references
+
+- (void)didAddManagedReference:(id)object site:(void *)site
+{
+    atomic_fetch_add_explicit(&_added, 1, memory_order_relaxed);
+
+    if (!self.leakDetectionEnabled || !object) {
+        return;
+    }
+
+    JSManagedReferenceRecord *record = [[JSManagedReferenceRecord alloc] init];
+    record->_site = site;
+    record->_added = CKTMonotonicMicroseconds();
+
+    os_unfair_lock_lock(&_lock);
+    [_records setObject:record forKey:object];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)didRemoveManagedReference:(id)object
+{
+    atomic_fetch_add_explicit(&_removed, 1, memory_order_relaxed);
+
+    if (!object) {
+        return;
+    }
+
+    // Also done with leak detection disabled, it may have been enabled while the reference was held
+    os_unfair_lock_lock(&_lock);
+    [_records removeObjectForKey:object];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)discardReferences
+{
+    os_unfair_lock_lock(&_lock);
+    [_records removeAllObjects];
+    os_unfair_lock_unlock(&_lock);
+
+    atomic_store(&_removed, atomic_load(&_added));
+}
+
+#pragma mark - Garbage collection
+
+- (void)collect:(BOOL)critical
+{
+    [[JSEngine sharedInstance] performBlock:^{ [self collectOnJSThread:critical]; }
+                                   priority:JSTaskPriorityUserInteractive
+                                      label:"collectGarbage"];
+}
+
+- (void)collectOnJSThread:(BOOL)critical
+{
+    JSContext *context = [JSEngine sharedInstance].context;
+    if (!context) {
+        return;
+    }
+
+    double before = [self footprint];
+
+    JSGarbageCollect(context.JSGlobalContextRef);
+
+    double reclaimed = before - [self footprint];
+    self.garbageCollections++;
+    self.lastCollectionReclaimed = reclaimed;
+
+    LOGI(LOG_TAG, @"Garbage collection (%@) reclaimed %.1f MB", critical ? @"critical" : @"warning", reclaimed);
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    uint64_t added = atomic_load_explicit(&_added, memory_order_relaxed);
+    uint64_t removed = atomic_load_explicit(&_removed, memory_order_relaxed);
+
+    NSMutableDictionary *bySite = [NSMutableDictionary dictionary];
+    [self enumerateRecords:^(NSString *site, JSManagedReferenceRecord *record) {
+        bySite[site] = @([bySite[site] unsignedIntegerValue] + 1);
+    }];
+
+    return @{
+        kJSHeapManagedReferences : @(added > removed ? added - removed : 0),
+        kJSHeapManagedReferencesAdded : @(added),
+        kJSHeapManagedReferencesRemoved : @(removed),
+        kJSHeapReferencesBySite : bySite,
+        kJSHeapFootprint : @([self footprint]),
+        kJSHeapGarbageCollections : @(self.garbageCollections),
+        kJSHeapLastCollectionReclaimed : @(self.lastCollectionReclaimed),
+        kJSHeapMemoryWarnings : @(atomic_load_explicit(&_memoryWarnings, memory_order_relaxed))
+    };
+}
+
+- (NSArray<NSDictionary *> *)suspectedLeaks
+{
+    uint64_t now = CKTMonotonicMicroseconds();
+    uint64_t leakAge = (uint64_t)(self.leakAge * USEC_PER_SEC);
+
+    NSMutableDictionary<NSString *, NSNumber *> *counts = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString *, NSNumber *> *oldest = [NSMutableDictionary dictionary];
+    [self enumerateRecords:^(NSString *site, JSManagedReferenceRecord *record) {
+        uint64_t age = now - record->_added;
+        if (age < leakAge) {
+            return;
+        }
+        counts[site] = @([counts[site] unsignedIntegerValue] + 1);
+        oldest[site] = @(MAX([oldest[site] unsignedLongLongValue], age));
+    }];
+
+    NSMutableArray *leaks = [NSMutableArray array];
+    [counts enumerateKeysAndObjectsUsingBlock:^(NSString *site, NSNumber *count, BOOL *stop) {
+        [leaks addObject:@{
+            kJSHeapLeakSite : site,
+            kJSHeapLeakCount : count,
+            kJSHeapLeakAge : @([oldest[site] unsignedLongLongValue] / (double)USEC_PER_SEC)
+        }];
+    }];
+    [leaks sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:kJSHeapLeakCount ascending:NO] ]];
+
+    return leaks;
+}
+
+#pragma mark - internal functions
+
+- (void)enumerateRecords:(void (^)(NSString *site, JSManagedReferenceRecord *record))block
+{
+    NSMutableArray<JSManagedReferenceRecord *> *records = [NSMutableArray array];
+    os_unfair_lock_lock(&_lock);
+    for (id object in _records) {
+        JSManagedReferenceRecord *record = [_records objectForKey:object];
+        if (record) {
+            [records addObject:record];
+        }
+    }
+    os_unfair_lock_unlock(&_lock);
+
+    // Symbols are only resolved here, not when the references are added
+    NSMutableDictionary<NSValue *, NSString *> *symbols = [NSMutableDictionary dictionary];
+    for (JSManagedReferenceRecord *record in records) {
+        NSValue *address = [NSValue valueWithPointer:record->_site];
+        NSString *site = symbols[address];
+        if (!site) {
+            Dl_info info;
+            if (dladdr(record->_site, &info) && info.dli_sname) {
+                site = @(info.dli_sname);
+            } else {
+                site = [NSString stringWithFormat:@"%p", record->_site];
+            }
+            symbols[address] = site;
+        }
+        block(site, record);
+    }
+}
+
+// Physical footprint of the app in MB, what the system looks at before terminating it
+- (double)footprint
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.phys_footprint / (1024.0 * 1024.0);
+}
+
+@end
@@ -22,14 +22,42 @@
 #import <Foundation/Foundation.h>
 #import <JavaScriptCore/JavaScriptCore.h>
 
+@class JSFunctionCache;
+@class JSStartupProfiler;
+@class JSTaskQueue;
+
 extern NSString *const kJSRunloopName;
 
+// Keys of the per script dictionaries in scriptLoadStatistics, times are in milliseconds
+extern NSString *const kJSScriptStatisticsCacheHit;
+extern NSString *const kJSScriptStatisticsReadTime;
+extern NSString *const kJSScriptStatisticsEvaluateTime;
+
 @interface JSRunLoop : NSThread
 
 @property (nonatomic, strong) JSContext *context;
 @property (nonatomic, strong) NSRunLoop *runLoop;
+@property (nonatomic, strong) JSFunctionCache *functionCache;
+
+// Work submitted to the JS thread, see -[JSEngine performBlock:]
+@property (nonatomic, readonly) JSTaskQueue *taskQueue;
+
+// Script name -> load timings of the last -initializeJSEnviroment
+@property (atomic, strong) NSDictionary *scriptLoadStatistics;
+
+// Phases of the JS engine bring-up, only set while -initializeJSEnviroment is running
+@property (nonatomic, strong) JSStartupProfiler *startupProfiler;
+
+// Result of the last bring-up or reset, see JSStartupProfiler.h. Also sent in the applicationServiceLoaded
+// notification.
+@property (atomic, strong) NSDictionary *startupProfile;
+@property (atomic, strong) NSData *startupTraceData;
+
+// Result of the bring-up of this thread, kept across resets for comparison
+@property (atomic, strong) NSDictionary *coldStartProfile;
 
 - (void)initializeJSEnviroment;
+- (void)resetJSEnvironment;
 - (void)cleanJSEnvironment;
 
 @end
@@ -21,9 +21,18 @@
 
 #import "Angular.h"
 #import "Audio.h"
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
 #import "CKTHttp.h"
+#import "CKTRequestCoalescer.h"
 #import "JSEngine.h"
+#import "JSFunctionCache.h"
+#import "JSHeapMonitor.h"
 #import "JSRunLoop.h"
+#import "JSScriptCache.h"
+#import "JSStartupProfiler.h"
+#import "JSTaskQueue.h"
+#import "JSThreadWatchdog.h"
 #import "JSNotificationCenter.h"
 #import "Log.h"
 #import "Logger.h"
@@ -36,6 +45,9 @@
 #import "XMLHttpRequest.h"
 
 NSString *const kJSRunloopName = @"JS Run Loop";
+NSString *const kJSScriptStatisticsCacheHit = @"cacheHit";
+NSString *const kJSScriptStatisticsReadTime = @"readTime";
+NSString *const kJSScriptStatisticsEvaluateTime = @"evaluateTime";
 
 @interface JSRunLoop ()
 
@@ -47,6 +59,28 @@ NSString *const kJSRunloopName = @"JS Run Loop";
 
 static NSString *LOG_TAG = @"[JSRunLoop]";
 
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _taskQueue = [[JSTaskQueue alloc] init];
+
+        // Also accounts for the time it takes to spawn the thread
+        _startupProfiler = [[JSStartupProfiler alloc] init];
+        [_startupProfiler beginPhase:@"threadStart"];
+    }
+    return self;
+}
+
+/**
+ *  Returns the bundle containing the js scripts
+ */
+- (NSBundle *)resourceBundle
+{
+    NSBundle *circuitBundle = [NSBundle bundleForClass:self.classForCoder];
+    NSURL *bundleURL = [[circuitBundle resourceURL] URLByAppendingPathComponent:@"CircuitSDK.bundle"];
+    return [NSBundle bundleWithURL:bundleURL];
+}
+
 /**
  *  Loads all required js scripts into the JSContext
  */
@@ -56,21 +90,44 @@ static NSString *LOG_TAG = @"[JSRunLoop]";
 
     NSError *error;
 
-    NSBundle *circuitBundle = [NSBundle bundleForClass:self.classForCoder];
-    NSURL *bundleURL = [[circuitBundle resourceURL] URLByAppendingPathComponent:@"CircuitSDK.bundle"];
-    NSBundle *resourceBundle = [NSBundle bundleWithURL:bundleURL];
+    NSBundle *resourceBundle = [self resourceBundle];
+
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionary];
 
     for (NSString *name in scripts) {
         NSString *fileURL = [resourceBundle pathForResource:name ofType:@"js"];
-        NSString *script = [NSString stringWithContentsOfFile:fileURL encoding:NSUTF8StringEncoding error:&error];
+
+        NSString *readPhase = [@"read " stringByAppendingString:name];
+        NSString *evaluatePhase = [@"evaluate " stringByAppendingString:name];
+
+        BOOL cacheHit = NO;
+        uint64_t readStart = CKTMonotonicMicroseconds();
+        [self.startupProfiler beginPhase:readPhase];
+        NSString *script =
+            [[JSScriptCache sharedInstance] sourceForScriptAtPath:fileURL cacheHit:&cacheHit error:&error];
+        [self.startupProfiler endPhase:readPhase];
         if (error) {
             LOGE(LOG_TAG, @"Error reading file: %@, error: %@", name, error.localizedDescription);
             return;
         }
 
+        uint64_t evaluateStart = CKTMonotonicMicroseconds();
+        [self.startupProfiler beginPhase:evaluatePhase];
         [self.context evaluateScript:script withSourceURL:[NSURL URLWithString:fileURL]];
+        [self.startupProfiler endPhase:evaluatePhase];
+        uint64_t evaluateEnd = CKTMonotonicMicroseconds();
+
+        statistics[name] = @{
+            kJSScriptStatisticsCacheHit : @(cacheHit),
+            kJSScriptStatisticsReadTime : @((evaluateStart - readStart) / 1000.0),
+            kJSScriptStatisticsEvaluateTime : @((evaluateEnd - evaluateStart) / 1000.0)
+        };
+        LOGI(LOG_TAG, @"Loaded %@ (cache hit: %d) - read: %.1f ms, parse/compile/evaluate: %.1f ms", name, cacheHit,
+             (evaluateStart - readStart) / 1000.0, (evaluateEnd - evaluateStart) / 1000.0);
     }
 
+    self.scriptLoadStatistics = statistics;
+
     self.context.exceptionHandler =
         ^(JSContext *ctx, JSValue *ex) { LOGE(LOG_TAG, @"JavaScript exception handler: %@\n%@", ex, [ex toObject]); };
 
@@ -83,31 +140,107 @@ static NSString *LOG_TAG = @"[JSRunLoop]";
 - (void)initializeJSEnviroment
 {
     if (self.context == nil) {
+        if (!self.startupProfiler) {
+            self.startupProfiler = [[JSStartupProfiler alloc] init];
+        }
+        JSStartupProfiler *profiler = self.startupProfiler;
+
+        [profiler beginPhase:@"createContext"];
         self.context = [[JSContext alloc] init];
+        [profiler endPhase:@"createContext"];
 
         // We insert the JSEngine into the global object (context) so that when we call
         // -addManagedReference:withOwner: we can use the JSEngine as the owner. In this
         // manner the JSEngine itself is reachable from within JavaScript. If we didn't
         // do this, the JSEngine wouldn't be reachable from JavaScript, and there wouldn't
         // be anything keeping the managed object alive.
+        [profiler beginPhase:@"injectClasses"];
         self.context[@"JSEngine"] = [JSEngine sharedInstance];
         self.context[@"Audio"] = [Audio class];
+        [profiler beginPhase:@"injectNavigator"];
         [Navigator initWebRTCInJSContext:self.context];
+        [profiler endPhase:@"injectNavigator"];
         self.context[@"URL"] = [URL sharedInstance];
         self.context[@"WebSocket"] = [WebSocketManager class];
         self.context[@"XMLHttpRequest"] = [XMLHttpRequest class];
         self.context[@"logger"] = [Logger sharedInstance];
         self.context[@"angular"] = [Angular sharedInstance];
         self.context[@"window"] = [Window sharedInstance];
+        [profiler endPhase:@"injectClasses"];
 
+        [profiler beginPhase:@"loadScripts"];
         [self loadScripts];
+        self.functionCache = [[JSFunctionCache alloc] initWithContext:self.context];
+        [profiler endPhase:@"loadScripts"];
 
+        [profiler beginPhase:@"subscribeAll"];
         self.pubSubService = [[PubSubService alloc] init];
         [self.pubSubService subscribeAll];
-        [[JSEngine sharedInstance] sendNotification:CKTNotificationApplicationServiceLoaded userInfo:nil];
+        [profiler endPhase:@"subscribeAll"];
+
+        [profiler finish];
+        self.startupProfile = [profiler profile];
+        self.startupTraceData = [profiler traceEventData];
+        self.coldStartProfile = self.startupProfile;
+        self.startupProfiler = nil;
+
+        [[JSEngine sharedInstance] sendNotification:CKTNotificationApplicationServiceLoaded
+                                           userInfo:@{KEY_STARTUP_PROFILE : self.startupProfile}];
     }
 }
 
+/**
+ *  Replaces the sdkClient of the loaded scripts by a new one, dropping all session state (connection, timers,
+ *  pending requests, event listeners) while keeping the JSContext, the scripts and the JS thread.
+ */
+- (void)resetJSEnvironment
+{
+    if (self.context == nil) {
+        [self initializeJSEnviroment];
+        return;
+    }
+
+    LOGI(LOG_TAG, @"Resetting JS environment");
+
+    JSStartupProfiler *profiler = [[JSStartupProfiler alloc] init];
+
+    [profiler beginPhase:@"resetSession"];
+    JSValue *oldClient = self.context[@"sdkClient"];
+    [self.pubSubService unsubscribeAll];
+    if ([oldClient isObject]) {
+        // Closes the WebSocket of the old session, its result is of no interest
+        [oldClient invokeMethod:@"logout" withArguments:@[]];
+    }
+    [Window.sharedInstance clearAllTimeouts];
+    [[CKTRequestCoalescer sharedInstance] discardPendingRequests];
+    [[CKTEventDispatcher sharedInstance] discardPendingEvents];
+    [Promise discardPendingCallbacks];
+
+    // The cached functions are bound to the old client
+    [self.functionCache removeAllFunctions];
+    [profiler endPhase:@"resetSession"];
+
+    [profiler beginPhase:@"createClient"];
+    [self.context evaluateScript:@"sdkClient = new Circuit.Client();"];
+    [profiler endPhase:@"createClient"];
+
+    [profiler beginPhase:@"subscribeAll"];
+    self.pubSubService = [[PubSubService alloc] init];
+    [self.pubSubService subscribeAll];
+    [profiler endPhase:@"subscribeAll"];
+
+    [profiler finish];
+    self.startupProfile = [profiler profile];
+    self.startupTraceData = [profiler traceEventData];
+
+    LOGI(LOG_TAG, @"JS environment reset in %.1f ms (cold start: %.1f ms)",
+         [self.startupProfile[kJSStartupProfileTotalTime] doubleValue],
+         [self.coldStartProfile[kJSStartupProfileTotalTime] doubleValue]);
+
+    [[JSEngine sharedInstance] sendNotification:CKTNotificationApplicationServiceLoaded
+                                       userInfo:@{KEY_STARTUP_PROFILE : self.startupProfile}];
+}
+
 /**
  *  Clears out the js environment
  */
@@ -115,7 +248,13 @@ static NSString *LOG_TAG = @"[JSRunLoop]";
 {
     LOGI(LOG_TAG, @"Clearing out JS environment");
     [Window.sharedInstance clearAllTimeouts];
+    [[CKTRequestCoalescer sharedInstance] discardPendingRequests];
+    [[CKTEventDispatcher sharedInstance] discardPendingEvents];
+    [Promise discardPendingCallbacks];
+    [self.functionCache removeAllFunctions];
+    self.functionCache = nil;
     self.context = nil;
+    [[JSHeapMonitor sharedInstance] discardReferences];
 }
 
 - (void)main
@@ -123,10 +262,14 @@ static NSString *LOG_TAG = @"[JSRunLoop]";
     @autoreleasepool
     {
         LOGI(LOG_TAG, @"main - begin");
+        [self.startupProfiler endPhase:@"threadStart"];
 
         [self initializeJSEnviroment];
 
         self.runLoop = [NSRunLoop currentRunLoop];
+        [self.taskQueue scheduleInRunLoop:self.runLoop];
+        [[JSThreadWatchdog sharedInstance] observeRunLoop:self.runLoop];
+        [[JSHeapMonitor sharedInstance] startMonitoringMemoryPressure];
 
         // add dummy port to ensure that run loop won't exit immediately after
         // launch due to lack of input sources
@@ -136,6 +279,8 @@ static NSString *LOG_TAG = @"[JSRunLoop]";
             [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
         }
 
+        [[JSThreadWatchdog sharedInstance] stopObservingRunLoop:self.runLoop];
+        [self.taskQueue invalidate];
         [self cleanJSEnvironment];
 
         LOGI(LOG_TAG, @"main - end");
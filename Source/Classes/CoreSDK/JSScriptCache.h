@@ -0,0 +1,49 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSScriptCache.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Persistent cache of the scripts loaded into the JSContext (see -[JSRunLoop loadScripts]).
+//
+// The public JavaScriptCore API has no way to serialize compiled bytecode, so what is cached is the
+// script source already decoded into the UTF-16 representation JavaScriptCore works with. Loading it
+// is a memory mapped read followed by a copy, skipping the UTF-8 decoding of the 2.7 MB circuit.js.
+// Parsing and compiling are not saved and the entry takes twice the size of the script, so the cache
+// is off unless the app measures a gain on its devices (see scriptLoadStatistics).
+//
+// Entries are keyed by the size and modification date of the bundled script, the SDK version and the
+// OS build (which determines the JavaScriptCore version). Any mismatch or I/O error transparently
+// falls back to reading the bundled script, and the entry is rebuilt in the background.
+@interface JSScriptCache : NSObject
+
+// Defaults to NO
+@property (atomic, assign, getter=isEnabled) BOOL enabled;
+
++ (JSScriptCache *)sharedInstance;
+
+// Returns the source of the script at the given path. |cacheHit| is set to YES if the source was
+// served from the cache.
+- (NSString *)sourceForScriptAtPath:(NSString *)path cacheHit:(BOOL *)cacheHit error:(NSError **)error;
+
+// Removes all cached entries
+- (void)purge;
+
+@end
@@ -0,0 +1,153 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSScriptCache.m
+//  CircuitSDK
+//
+//
+
+#import "JSScriptCache.h"
+#import "Log.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+@interface JSScriptCache ()
+
+@property (nonatomic, strong) NSString *cacheDirectory;
+@property (nonatomic, strong) dispatch_queue_t writeQueue;
+
+@end
+
+@implementation JSScriptCache
+
+static NSString *LOG_TAG = @"[JSScriptCache]";
+
++ (JSScriptCache *)sharedInstance
+{
+    static JSScriptCache *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[JSScriptCache alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _enabled = NO;
+        _writeQueue = dispatch_queue_create("com.unify.circuitsdk.scriptcache", DISPATCH_QUEUE_SERIAL);
+
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        _cacheDirectory = [caches stringByAppendingPathComponent:@"CircuitSDK/scripts"];
+    }
+    return self;
+}
+
+- (NSString *)sourceForScriptAtPath:(NSString *)path cacheHit:(BOOL *)cacheHit error:(NSError **)error
+{
+    if (cacheHit) {
+        *cacheHit = NO;
+    }
+
+    NSString *cachePath = self.enabled ? [self cachePathForScriptAtPath:path] : nil;
+
+    if (cachePath) {
+        NSData *data = [NSData dataWithContentsOfFile:cachePath options:NSDataReadingMappedIfSafe error:nil];
+        if (data.length > 0) {
+            NSString *script = [[NSString alloc] initWithData:data encoding:NSUTF16LittleEndianStringEncoding];
+            if (script) {
+                if (cacheHit) {
+                    *cacheHit = YES;
+                }
+                return script;
+            }
+        }
+        LOGI(LOG_TAG, @"No valid cache entry for %@", path.lastPathComponent);
+    }
+
+    NSString *script = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:error];
+
+    if (script && cachePath) {
+        [self writeScript:script toPath:cachePath];
+    }
+
+    return script;
+}
+
+- (void)purge
+{
+    dispatch_async(self.writeQueue, ^{
+        LOGI(LOG_TAG, @"Purging script cache");
+        [[NSFileManager defaultManager] removeItemAtPath:self.cacheDirectory error:nil];
+    });
+}
+
+#pragma mark - internal functions
+
+// The cache file name embeds a digest of everything the cached entry depends on, so a stale entry
+// simply is never looked up again.
+- (NSString *)cachePathForScriptAtPath:(NSString *)path
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+    if (!attributes) {
+        return nil;
+    }
+
+    NSString *sdkVersion =
+        [NSBundle bundleForClass:self.classForCoder].infoDictionary[@"CFBundleShortVersionString"] ?: @"";
+    NSString *key = [NSString stringWithFormat:@"%@|%llu|%f|%@|%@", path.lastPathComponent, attributes.fileSize,
+                                               attributes.fileModificationDate.timeIntervalSince1970, sdkVersion,
+                                               [NSProcessInfo processInfo].operatingSystemVersionString];
+
+    const char *keyString = key.UTF8String;
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(keyString, (CC_LONG)strlen(keyString), digest);
+
+    NSMutableString *fileName = [NSMutableString stringWithString:path.lastPathComponent.stringByDeletingPathExtension];
+    [fileName appendString:@"-"];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [fileName appendFormat:@"%02x", digest[i]];
+    }
+    [fileName appendString:@".utf16"];
+
+    return [self.cacheDirectory stringByAppendingPathComponent:fileName];
+}
+
+- (void)writeScript:(NSString *)script toPath:(NSString *)cachePath
+{
+    // Do not delay the current launch, the entry will be used by the next one
+    dispatch_async(self.writeQueue, ^{
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        NSString *prefix =
+            [[cachePath.lastPathComponent componentsSeparatedByString:@"-"].firstObject stringByAppendingString:@"-"];
+
+        [fileManager createDirectoryAtPath:self.cacheDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+
+        // Remove entries of older versions of the same script
+        for (NSString *file in [fileManager contentsOfDirectoryAtPath:self.cacheDirectory error:nil]) {
+            if ([file hasPrefix:prefix]) {
+                [fileManager removeItemAtPath:[self.cacheDirectory stringByAppendingPathComponent:file] error:nil];
+            }
+        }
+
+        NSData *data = [script dataUsingEncoding:NSUTF16LittleEndianStringEncoding];
+        NSError *error;
+        if (![data writeToFile:cachePath options:NSDataWritingAtomic error:&error]) {
+            LOGE(LOG_TAG, @"Error writing cache entry %@: %@", cachePath.lastPathComponent, error.localizedDescription);
+        }
+    });
+}
+
+@end
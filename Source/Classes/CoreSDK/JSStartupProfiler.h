@@ -0,0 +1,48 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSStartupProfiler.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Keys of the dictionary returned by -[JSStartupProfiler profile]. Times are in milliseconds,
+// phase start times are relative to the creation of the profiler.
+extern NSString *const kJSStartupProfileTotalTime;
+extern NSString *const kJSStartupProfilePhases;
+extern NSString *const kJSStartupProfilePhaseName;
+extern NSString *const kJSStartupProfilePhaseStart;
+extern NSString *const kJSStartupProfilePhaseDuration;
+
+// Records monotonic clock spans for the phases of the JS engine bring-up (thread start, JSContext
+// creation, injection of the exposed classes, evaluation of each script, event subscription).
+// Phases may be nested. Not thread safe, used on the JS thread only.
+@interface JSStartupProfiler : NSObject
+
+- (void)beginPhase:(NSString *)name;
+- (void)endPhase:(NSString *)name;
+
+// Ends all open phases and freezes the total time
+- (void)finish;
+
+- (NSDictionary *)profile;
+
+// The profile in the Trace Event Format (JSON), viewable in chrome://tracing or Perfetto
+- (NSData *)traceEventData;
+
+@end
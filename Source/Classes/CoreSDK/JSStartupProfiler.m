@@ -0,0 +1,136 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSStartupProfiler.m
+//  CircuitSDK
+//
+//
+
+#import "CKTHistogram.h"
+#import "JSStartupProfiler.h"
+#import "Log.h"
+
+NSString *const kJSStartupProfileTotalTime = @"totalTime";
+NSString *const kJSStartupProfilePhases = @"phases";
+NSString *const kJSStartupProfilePhaseName = @"name";
+NSString *const kJSStartupProfilePhaseStart = @"start";
+NSString *const kJSStartupProfilePhaseDuration = @"duration";
+
+@interface JSStartupProfiler ()
+
+@property (nonatomic, assign) uint64_t origin;
+@property (nonatomic, assign) uint64_t end;
+
+// Phase names in the order they began, with their begin and end times (in microseconds)
+@property (nonatomic, strong) NSMutableArray<NSString *> *names;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *begins;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *ends;
+
+@end
+
+@implementation JSStartupProfiler
+
+static NSString *LOG_TAG = @"[JSStartupProfiler]";
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _origin = CKTMonotonicMicroseconds();
+        _names = [NSMutableArray array];
+        _begins = [NSMutableDictionary dictionary];
+        _ends = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)beginPhase:(NSString *)name
+{
+    if (self.end || self.begins[name]) {
+        return;
+    }
+    [self.names addObject:name];
+    self.begins[name] = @(CKTMonotonicMicroseconds());
+}
+
+- (void)endPhase:(NSString *)name
+{
+    if (self.begins[name] && !self.ends[name]) {
+        self.ends[name] = @(CKTMonotonicMicroseconds());
+    }
+}
+
+- (void)finish
+{
+    if (self.end) {
+        return;
+    }
+
+    for (NSString *name in self.names) {
+        [self endPhase:name];
+    }
+    self.end = CKTMonotonicMicroseconds();
+
+    for (NSDictionary *phase in self.profile[kJSStartupProfilePhases]) {
+        LOGI(LOG_TAG, @"%@: %.1f ms", phase[kJSStartupProfilePhaseName],
+             [phase[kJSStartupProfilePhaseDuration] doubleValue]);
+    }
+    LOGI(LOG_TAG, @"JS engine started in %.1f ms", (self.end - self.origin) / 1000.0);
+}
+
+- (NSDictionary *)profile
+{
+    NSMutableArray *phases = [NSMutableArray arrayWithCapacity:self.names.count];
+    uint64_t now = self.end ? self.end : CKTMonotonicMicroseconds();
+
+    for (NSString *name in self.names) {
+        uint64_t begin = self.begins[name].unsignedLongLongValue;
+        uint64_t end = self.ends[name] ? self.ends[name].unsignedLongLongValue : now;
+        [phases addObject:@{
+            kJSStartupProfilePhaseName : name,
+            kJSStartupProfilePhaseStart : @((begin - self.origin) / 1000.0),
+            kJSStartupProfilePhaseDuration : @((end - begin) / 1000.0)
+        }];
+    }
+
+    return @{kJSStartupProfileTotalTime : @((now - self.origin) / 1000.0), kJSStartupProfilePhases : phases};
+}
+
+- (NSData *)traceEventData
+{
+    NSMutableArray *events = [NSMutableArray array];
+    uint64_t now = self.end ? self.end : CKTMonotonicMicroseconds();
+
+    for (NSString *name in self.names) {
+        uint64_t begin = self.begins[name].unsignedLongLongValue;
+        uint64_t end = self.ends[name] ? self.ends[name].unsignedLongLongValue : now;
+        // Complete events, timestamps and durations in microseconds
+        [events addObject:@{
+            @"name" : name,
+            @"cat" : @"startup",
+            @"ph" : @"X",
+            @"ts" : @(begin - self.origin),
+            @"dur" : @(end - begin),
+            @"pid" : @([NSProcessInfo processInfo].processIdentifier),
+            @"tid" : @1
+        }];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:@{ @"traceEvents" : events, @"displayTimeUnit" : @"ms" }
+                                           options:0
+                                             error:nil];
+}
+
+@end
@@ -0,0 +1,87 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSTaskQueue.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Scheduling classes of the JS thread, highest priority first
+typedef NS_ENUM(NSInteger, JSTaskPriority) {
+    JSTaskPriorityUserInteractive,  // API calls made by the app, e.g. answerCall
+    JSTaskPriorityCallSignaling,    // WebSocket frames (events, call signaling, responses)
+    JSTaskPriorityTimer,            // window.setTimeout/setInterval callbacks
+    JSTaskPriorityBackground,       // Bulk requests (list fetches, conversation sync) and SDK housekeeping
+
+    // Must be last
+    JSTaskPriorityNumberOfPriorities
+};
+
+// Keys of the dictionary returned by -[JSTaskQueue statistics]
+extern NSString *const kJSTaskQueueEnqueuedTasks;    // Tasks added since the last reset
+extern NSString *const kJSTaskQueueExecutedTasks;    // Tasks executed since the last reset
+extern NSString *const kJSTaskQueueWakeups;          // Number of drained batches, i.e. thread wakeups
+extern NSString *const kJSTaskQueueMaxBatchSize;     // Largest number of tasks drained in one batch
+extern NSString *const kJSTaskQueueTasksPerSecond;   // Executed tasks per second since the last reset
+extern NSString *const kJSTaskQueueQueueDelay;       // Histogram (see CKTHistogram.h) of add until execution
+extern NSString *const kJSTaskQueueDeferrals;        // Batches cut short because the time slice was used up
+extern NSString *const kJSTaskQueuePriorities;       // Priority name -> dictionary of the keys below
+extern NSString *const kJSTaskQueueDepth;            // Tasks currently waiting, not affected by a reset
+
+// Multiple producer, single consumer queue of blocks executed on the JS thread.
+//
+// Producers push onto a lock free list per priority. Only the producer finding its list empty signals
+// the run loop source and wakes up the thread, the consumer then takes the lists in one atomic exchange
+// each. A burst of API calls or socket callbacks therefore costs a single wakeup, instead of one locked
+// enqueue and one run loop pass per -performSelector:onThread:.
+//
+// Tasks are executed by priority and in FIFO order within a priority. Scheduling is cooperative: a running
+// task is never interrupted, but before each task newly added higher priority tasks are picked up, and
+// tasks are only started while the batch is within the time slice of their priority. The remaining
+// tasks are deferred to the next run loop iteration so that timers and sockets are serviced in between.
+// Each batch starts at least one task of every priority with waiting tasks, so none of them starves.
+@interface JSTaskQueue : NSObject
+
+// Attaches the queue to the run loop of the consumer thread, must be called on that thread.
+// Tasks added before are executed once the run loop runs.
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop;
+
+// Detaches the queue, pending and later added tasks are discarded and their discard handlers are called.
+// Must be called on the consumer thread.
+- (void)invalidate;
+
+// Can be called from any thread. -addTask: uses JSTaskPriorityUserInteractive. The label identifies the task in
+// stall reports (see JSThreadWatchdog.h) and must be a static string, e.g. a selector name.
+- (void)addTask:(dispatch_block_t)task;
+- (void)addTask:(dispatch_block_t)task priority:(JSTaskPriority)priority;
+- (void)addTask:(dispatch_block_t)task priority:(JSTaskPriority)priority label:(const char *)label;
+
+// The discard handler is called instead of the task if the queue is invalidated before the task runs, e.g. to
+// release a thread waiting for the task. It is called on the thread invalidating the queue or adding the task.
+- (void)addTask:(dispatch_block_t)task
+          priority:(JSTaskPriority)priority
+             label:(const char *)label
+    discardHandler:(dispatch_block_t)discardHandler;
+
+// Number of tasks of the given priority waiting to be executed
+- (NSUInteger)depthForPriority:(JSTaskPriority)priority;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,440 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSTaskQueue.m
+//  CircuitSDK
+//
+//
+
+#import "JSTaskQueue.h"
+#import "CKTHistogram.h"
+#import "JSThreadWatchdog.h"
+#import "Log.h"
+
+#import <stdatomic.h>
+
+NSString *const kJSTaskQueueEnqueuedTasks = @"enqueuedTasks";
+NSString *const kJSTaskQueueExecutedTasks = @"executedTasks";
+NSString *const kJSTaskQueueWakeups = @"wakeups";
+NSString *const kJSTaskQueueMaxBatchSize = @"maxBatchSize";
+NSString *const kJSTaskQueueTasksPerSecond = @"tasksPerSecond";
+NSString *const kJSTaskQueueQueueDelay = @"queueDelay";
+NSString *const kJSTaskQueueDeferrals = @"deferrals";
+NSString *const kJSTaskQueuePriorities = @"priorities";
+NSString *const kJSTaskQueueDepth = @"depth";
+
+// Time (in microseconds) since the start of a batch after which no more tasks of the priority are
+// started in that batch. Bounded for every priority so that a burst of app calls or socket frames still
+// lets the run loop service its timers and sockets.
+static const uint64_t kJSTaskQueueTimeSlice[JSTaskPriorityNumberOfPriorities] = {
+    50000,  // JSTaskPriorityUserInteractive
+    32000,  // JSTaskPriorityCallSignaling
+    16000,  // JSTaskPriorityTimer
+    8000    // JSTaskPriorityBackground
+};
+
+static NSString *JSTaskPriorityName(JSTaskPriority priority)
+{
+    switch (priority) {
+        case JSTaskPriorityUserInteractive:
+            return @"userInteractive";
+        case JSTaskPriorityCallSignaling:
+            return @"callSignaling";
+        case JSTaskPriorityTimer:
+            return @"timer";
+        case JSTaskPriorityBackground:
+            return @"background";
+        default:
+            return @"unknown";
+    }
+}
+
+typedef struct JSTask {
+    struct JSTask *next;
+    void *block;           // Retained dispatch_block_t
+    void *discardHandler;  // Retained dispatch_block_t, may be NULL
+    const char *label;
+    uint64_t enqueueTime;
+} JSTask;
+
+static void JSTaskQueuePerform(void *info);
+
+@interface JSTaskQueue () {
+    // Tasks added by the producers, most recently added first
+    _Atomic(JSTask *) _incoming[JSTaskPriorityNumberOfPriorities];
+    atomic_uint_fast64_t _depth[JSTaskPriorityNumberOfPriorities];
+    atomic_uint_fast64_t _enqueuedTasks[JSTaskPriorityNumberOfPriorities];
+    _Atomic(CFRunLoopRef) _runLoop;
+    atomic_bool _invalidated;
+
+    // Tasks taken over by the consumer, oldest first. Only accessed on the consumer thread.
+    JSTask *_pendingHead[JSTaskPriorityNumberOfPriorities];
+    JSTask *_pendingTail[JSTaskPriorityNumberOfPriorities];
+
+    CFRunLoopSourceRef _source;
+
+    // Statistics, protected by @synchronized(self)
+    uint64_t _executedTasks[JSTaskPriorityNumberOfPriorities];
+    uint64_t _wakeups;
+    uint64_t _deferrals;
+    uint64_t _maxBatchSize;
+    uint64_t _resetTime;
+    CKTHistogram *_queueDelay[JSTaskPriorityNumberOfPriorities];
+}
+
+@end
+
+@implementation JSTaskQueue
+
+static NSString *LOG_TAG = @"[JSTaskQueue]";
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        for (int i = 0; i < JSTaskPriorityNumberOfPriorities; i++) {
+            atomic_init(&_incoming[i], NULL);
+            atomic_init(&_depth[i], 0);
+            atomic_init(&_enqueuedTasks[i], 0);
+            _queueDelay[i] = [[CKTHistogram alloc] init];
+        }
+        atomic_init(&_runLoop, NULL);
+        atomic_init(&_invalidated, false);
+
+        // The source does not retain the queue, it is invalidated before the queue goes away
+        CFRunLoopSourceContext context = {0};
+        context.info = (__bridge void *)self;
+        context.perform = JSTaskQueuePerform;
+        _source = CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &context);
+
+        _resetTime = CKTMonotonicMicroseconds();
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    CFRunLoopSourceInvalidate(_source);
+    CFRelease(_source);
+
+    CFRunLoopRef runLoop = atomic_load(&_runLoop);
+    if (runLoop) {
+        CFRelease(runLoop);
+    }
+
+    [self discardTasks];
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop
+{
+    CFRunLoopRef cfRunLoop = [runLoop getCFRunLoop];
+    CFRunLoopAddSource(cfRunLoop, _source, kCFRunLoopCommonModes);
+    atomic_store(&_runLoop, (CFRunLoopRef)CFRetain(cfRunLoop));
+
+    // Pick up the tasks added while the queue was not attached yet
+    CFRunLoopSourceSignal(_source);
+}
+
+- (void)invalidate
+{
+    atomic_store(&_invalidated, true);
+    // Pairs with the check in -addTask: so that either the producer sees the flag or we see its task
+    atomic_thread_fence(memory_order_seq_cst);
+    CFRunLoopSourceInvalidate(_source);
+    [self discardTasks];
+}
+
+- (void)addTask:(dispatch_block_t)task
+{
+    [self addTask:task priority:JSTaskPriorityUserInteractive];
+}
+
+- (void)addTask:(dispatch_block_t)task priority:(JSTaskPriority)priority
+{
+    [self addTask:task priority:priority label:NULL];
+}
+
+- (void)addTask:(dispatch_block_t)task priority:(JSTaskPriority)priority label:(const char *)label
+{
+    [self addTask:task priority:priority label:label discardHandler:nil];
+}
+
+- (void)addTask:(dispatch_block_t)task
+          priority:(JSTaskPriority)priority
+             label:(const char *)label
+    discardHandler:(dispatch_block_t)discardHandler
+{
+    if (!task) {
+        return;
+    }
+
+    if (priority < 0 || priority >= JSTaskPriorityNumberOfPriorities) {
+        priority = JSTaskPriorityUserInteractive;
+    }
+
+    if (atomic_load(&_invalidated)) {
+        LOGW(LOG_TAG, @"addTask - queue has been invalidated, task discarded");
+        if (discardHandler) {
+            discardHandler();
+        }
+        return;
+    }
+
+    JSTask *node = malloc(sizeof(JSTask));
+    node->block = (__bridge_retained void *)[task copy];
+    node->discardHandler = discardHandler ? (__bridge_retained void *)[discardHandler copy] : NULL;
+    node->enqueueTime = CKTMonotonicMicroseconds();
+    node->label = label ? label : "block";
+
+    atomic_fetch_add_explicit(&_depth[priority], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_enqueuedTasks[priority], 1, memory_order_relaxed);
+
+    JSTask *head = atomic_load_explicit(&_incoming[priority], memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&_incoming[priority], &head, node, memory_order_seq_cst,
+                                                    memory_order_relaxed));
+
+    // The queue was invalidated while the task was added, it may have missed the task
+    if (atomic_load(&_invalidated)) {
+        [self discardTasks];
+        return;
+    }
+
+    // Tasks added to a non empty list are picked up by the wakeup already pending
+    if (head == NULL) {
+        CFRunLoopSourceSignal(_source);
+        CFRunLoopRef runLoop = atomic_load(&_runLoop);
+        if (runLoop) {
+            CFRunLoopWakeUp(runLoop);
+        }
+    }
+}
+
+- (NSUInteger)depthForPriority:(JSTaskPriority)priority
+{
+    if (priority < 0 || priority >= JSTaskPriorityNumberOfPriorities) {
+        return 0;
+    }
+    return (NSUInteger)atomic_load_explicit(&_depth[priority], memory_order_relaxed);
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        double elapsed = (CKTMonotonicMicroseconds() - _resetTime) / (double)USEC_PER_SEC;
+
+        uint64_t enqueuedTasks = 0;
+        uint64_t executedTasks = 0;
+        CKTHistogram *queueDelay = [[CKTHistogram alloc] init];
+        NSMutableDictionary *priorities = [NSMutableDictionary dictionary];
+
+        for (int i = 0; i < JSTaskPriorityNumberOfPriorities; i++) {
+            uint64_t enqueued = atomic_load_explicit(&_enqueuedTasks[i], memory_order_relaxed);
+            enqueuedTasks += enqueued;
+            executedTasks += _executedTasks[i];
+            [queueDelay mergeHistogram:_queueDelay[i]];
+
+            priorities[JSTaskPriorityName(i)] = @{
+                kJSTaskQueueDepth : @([self depthForPriority:i]),
+                kJSTaskQueueEnqueuedTasks : @(enqueued),
+                kJSTaskQueueExecutedTasks : @(_executedTasks[i]),
+                kJSTaskQueueQueueDelay : [_queueDelay[i] dictionaryRepresentation]
+            };
+        }
+
+        return @{
+            kJSTaskQueueEnqueuedTasks : @(enqueuedTasks),
+            kJSTaskQueueExecutedTasks : @(executedTasks),
+            kJSTaskQueueWakeups : @(_wakeups),
+            kJSTaskQueueDeferrals : @(_deferrals),
+            kJSTaskQueueMaxBatchSize : @(_maxBatchSize),
+            kJSTaskQueueTasksPerSecond : @(elapsed > 0 ? executedTasks / elapsed : 0),
+            kJSTaskQueueQueueDelay : [queueDelay dictionaryRepresentation],
+            kJSTaskQueuePriorities : priorities
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        for (int i = 0; i < JSTaskPriorityNumberOfPriorities; i++) {
+            atomic_store_explicit(&_enqueuedTasks[i], 0, memory_order_relaxed);
+            _executedTasks[i] = 0;
+            [_queueDelay[i] reset];
+        }
+        _wakeups = 0;
+        _deferrals = 0;
+        _maxBatchSize = 0;
+        _resetTime = CKTMonotonicMicroseconds();
+    }
+}
+
+#pragma mark - internal functions
+
+// Appends the tasks added by the producers to the pending lists, oldest first
+- (void)collectTasks
+{
+    for (int i = 0; i < JSTaskPriorityNumberOfPriorities; i++) {
+        JSTask *list = atomic_exchange_explicit(&_incoming[i], NULL, memory_order_acquire);
+        if (!list) {
+            continue;
+        }
+
+        JSTask *fifo = NULL;
+        JSTask *tail = list;
+        while (list) {
+            JSTask *next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+
+        if (_pendingTail[i]) {
+            _pendingTail[i]->next = fifo;
+        } else {
+            _pendingHead[i] = fifo;
+        }
+        _pendingTail[i] = tail;
+    }
+}
+
+- (BOOL)hasIncomingTasksAbove:(JSTaskPriority)priority
+{
+    for (int i = 0; i < priority; i++) {
+        if (atomic_load_explicit(&_incoming[i], memory_order_relaxed)) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (void)drain
+{
+    [self collectTasks];
+
+    uint64_t batchStart = CKTMonotonicMicroseconds();
+    uint64_t batchSize = 0;
+    uint64_t executed[JSTaskPriorityNumberOfPriorities] = {0};
+    BOOL deferred = NO;
+
+    JSThreadWatchdog *watchdog = [JSThreadWatchdog sharedInstance];
+
+    JSTaskPriority priority = JSTaskPriorityUserInteractive;
+    while (priority < JSTaskPriorityNumberOfPriorities) {
+        JSTask *task = _pendingHead[priority];
+        if (!task) {
+            priority++;
+            continue;
+        }
+
+        uint64_t now = CKTMonotonicMicroseconds();
+        uint64_t timeSlice = kJSTaskQueueTimeSlice[priority];
+        if (now - batchStart >= timeSlice && executed[priority] > 0) {
+            // Time slice used up, the remaining tasks of the priority continue in the next iteration. Every batch
+            // runs at least one task per priority so that higher priority work cannot starve the lower ones.
+            deferred = YES;
+            priority++;
+            continue;
+        }
+
+        _pendingHead[priority] = task->next;
+        if (!_pendingHead[priority]) {
+            _pendingTail[priority] = NULL;
+        }
+        atomic_fetch_sub_explicit(&_depth[priority], 1, memory_order_relaxed);
+
+        @synchronized(self)
+        {
+            [_queueDelay[priority] recordValue:now - task->enqueueTime];
+            _executedTasks[priority]++;
+        }
+        batchSize++;
+        executed[priority]++;
+
+        dispatch_block_t block = (__bridge_transfer dispatch_block_t)task->block;
+        const char *label = task->label;
+        if (task->discardHandler) {
+            CFRelease(task->discardHandler);
+        }
+        free(task);
+
+        @autoreleasepool
+        {
+            [watchdog taskWillRun:label];
+            block();
+            [watchdog taskDidRun];
+        }
+
+        // Higher priority tasks added in the meantime go first
+        if (priority > JSTaskPriorityUserInteractive && [self hasIncomingTasksAbove:priority]) {
+            [self collectTasks];
+            priority = JSTaskPriorityUserInteractive;
+        }
+    }
+
+    if (deferred) {
+        // Give the run loop a chance to service timers and sockets first
+        CFRunLoopSourceSignal(_source);
+    }
+
+    @synchronized(self)
+    {
+        _wakeups++;
+        _maxBatchSize = MAX(_maxBatchSize, batchSize);
+        if (deferred) {
+            _deferrals++;
+        }
+    }
+}
+
+// Once the queue is invalidated this is also called by producers racing with -invalidate, hence the lock
+- (void)discardTasks
+{
+    @synchronized(self)
+    {
+        [self collectTasks];
+
+        for (int i = 0; i < JSTaskPriorityNumberOfPriorities; i++) {
+            JSTask *tasks = _pendingHead[i];
+            _pendingHead[i] = NULL;
+            _pendingTail[i] = NULL;
+
+            while (tasks) {
+                JSTask *task = tasks;
+                tasks = task->next;
+                CFRelease(task->block);
+                if (task->discardHandler) {
+                    dispatch_block_t discardHandler = (__bridge_transfer dispatch_block_t)task->discardHandler;
+                    discardHandler();
+                }
+                free(task);
+                atomic_fetch_sub_explicit(&_depth[i], 1, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+@end
+
+static void JSTaskQueuePerform(void *info)
+{
+    [(__bridge JSTaskQueue *)info drain];
+}
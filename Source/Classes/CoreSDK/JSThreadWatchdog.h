@@ -0,0 +1,73 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSThreadWatchdog.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Keys of the dictionary returned by -[JSThreadWatchdog statistics]
+extern NSString *const kJSWatchdogIterationTime;  // Histogram (see CKTHistogram.h) of the busy time per run loop pass
+extern NSString *const kJSWatchdogTaskRunTime;    // Histogram of the run time of the JSTaskQueue tasks
+extern NSString *const kJSWatchdogStalls;         // Number of stalls since the last reset
+extern NSString *const kJSWatchdogStallReports;   // Array of the most recent stall reports, oldest first
+
+// Keys of a stall report
+extern NSString *const kJSWatchdogStallDate;      // NSDate the run loop pass started
+extern NSString *const kJSWatchdogStallDuration;  // Milliseconds the JS thread was busy, final once the pass ended
+extern NSString *const kJSWatchdogStallTask;      // Selector or label of the task running when the stall fired
+extern NSString *const kJSWatchdogStallFunction;  // JS SDK function called when the stall fired, if any
+extern NSString *const kJSWatchdogStallJSStack;   // JS stack, if captured
+
+// Detects when the JS thread is busy for longer than the stall threshold, e.g. because circuit.js does something
+// expensive and every API call and socket message waits behind it.
+//
+// A run loop observer stamps the start and end of each busy run loop pass, the JSTaskQueue reports the task it is
+// running and CKTService the JS function it calls. A timer on a private queue checks the stamps and records a stall
+// report with what was running. JSC can not sample the JS stack of another thread, the optional JS stack capture is
+// therefore taken on the JS thread the next time the stalled JS code calls out to native code (timers, WebSocket,
+// XMLHttpRequest).
+//
+// Disabled by default, when disabled the hooks only read a flag.
+@interface JSThreadWatchdog : NSObject
+
+@property (atomic, assign, getter=isEnabled) BOOL enabled;
+
+// 250 ms by default
+@property (atomic, assign) NSTimeInterval stallThreshold;
+
+// Disabled by default
+@property (atomic, assign) BOOL captureJSStackOnStall;
+
++ (JSThreadWatchdog *)sharedInstance;
+
+// Must be called on the JS thread
+- (void)observeRunLoop:(NSRunLoop *)runLoop;
+- (void)stopObservingRunLoop:(NSRunLoop *)runLoop;
+
+// Hooks called on the JS thread. Labels must be static strings, e.g. selector names.
+- (void)taskWillRun:(const char *)label;
+- (void)taskDidRun;
+- (void)willCallFunction:(NSString *)functionName;
+- (void)didCallFunction;
+- (void)jsDidCallOut;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
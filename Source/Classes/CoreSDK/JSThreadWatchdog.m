@@ -0,0 +1,370 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSThreadWatchdog.m
+//  CircuitSDK
+//
+//
+
+#import <JavaScriptCore/JavaScriptCore.h>
+#import <os/lock.h>
+#import <stdatomic.h>
+
+#import "CKTHistogram.h"
+#import "JSThreadWatchdog.h"
+#import "Log.h"
+
+NSString *const kJSWatchdogIterationTime = @"iterationTime";
+NSString *const kJSWatchdogTaskRunTime = @"taskRunTime";
+NSString *const kJSWatchdogStalls = @"stalls";
+NSString *const kJSWatchdogStallReports = @"stallReports";
+NSString *const kJSWatchdogStallDate = @"date";
+NSString *const kJSWatchdogStallDuration = @"duration";
+NSString *const kJSWatchdogStallTask = @"task";
+NSString *const kJSWatchdogStallFunction = @"function";
+NSString *const kJSWatchdogStallJSStack = @"jsStack";
+
+static const NSUInteger kJSWatchdogMaxStallReports = 32;
+
+@interface JSThreadWatchdog () {
+    // Start of the current busy run loop pass, 0 while the run loop is waiting
+    atomic_uint_fast64_t _busySince;
+    atomic_uint_fast64_t _iteration;
+    atomic_bool _stackCaptureRequested;
+
+    // Mirrors enabled for the hooks on the JS thread
+    atomic_bool _active;
+
+    // JS thread only
+    uint64_t _taskStart;
+    CFRunLoopObserverRef _observer;
+
+    // Watchdog queue only
+    uint64_t _reportedIteration;
+    dispatch_source_t _timer;
+
+    // Protected by _lock
+    os_unfair_lock _lock;
+    const char *_taskLabel;
+    NSString *_functionName;
+    NSMutableDictionary *_activeStall;
+    NSMutableArray<NSMutableDictionary *> *_stallReports;
+    CKTHistogram *_iterationTime;
+    CKTHistogram *_taskRunTime;
+    uint64_t _stalls;
+}
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+@end
+
+@implementation JSThreadWatchdog
+
+@synthesize enabled = _enabled;
+@synthesize stallThreshold = _stallThreshold;
+
+static NSString *LOG_TAG = @"[JSThreadWatchdog]";
+
++ (JSThreadWatchdog *)sharedInstance
+{
+    static JSThreadWatchdog *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[JSThreadWatchdog alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        atomic_init(&_busySince, 0);
+        atomic_init(&_iteration, 0);
+        atomic_init(&_stackCaptureRequested, false);
+        atomic_init(&_active, false);
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _stallReports = [NSMutableArray array];
+        _iterationTime = [[CKTHistogram alloc] init];
+        _taskRunTime = [[CKTHistogram alloc] init];
+        _stallThreshold = 0.25;
+        _queue = dispatch_queue_create("com.unify.circuitsdk.watchdog", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark - Configuration
+
+- (BOOL)isEnabled
+{
+    @synchronized(self)
+    {
+        return _enabled;
+    }
+}
+
+- (void)setEnabled:(BOOL)enabled
+{
+    @synchronized(self)
+    {
+        if (_enabled == enabled) {
+            return;
+        }
+        _enabled = enabled;
+        atomic_store(&_active, enabled);
+        [self updateTimer];
+    }
+}
+
+- (NSTimeInterval)stallThreshold
+{
+    @synchronized(self)
+    {
+        return _stallThreshold;
+    }
+}
+
+- (void)setStallThreshold:(NSTimeInterval)stallThreshold
+{
+    @synchronized(self)
+    {
+        _stallThreshold = MAX(stallThreshold, 0.01);
+        [self updateTimer];
+    }
+}
+
+#pragma mark - Run loop
+
+- (void)observeRunLoop:(NSRunLoop *)runLoop
+{
+    if (_observer) {
+        return;
+    }
+
+    __weak JSThreadWatchdog *weakSelf = self;
+    CFOptionFlags activities = kCFRunLoopEntry | kCFRunLoopAfterWaiting | kCFRunLoopBeforeWaiting | kCFRunLoopExit;
+    _observer = CFRunLoopObserverCreateWithHandler(
+        kCFAllocatorDefault, activities, YES, 0,
+        ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) { [weakSelf runLoopActivity:activity]; });
+    CFRunLoopAddObserver([runLoop getCFRunLoop], _observer, kCFRunLoopCommonModes);
+}
+
+- (void)stopObservingRunLoop:(NSRunLoop *)runLoop
+{
+    if (_observer) {
+        CFRunLoopRemoveObserver([runLoop getCFRunLoop], _observer, kCFRunLoopCommonModes);
+        CFRunLoopObserverInvalidate(_observer);
+        CFRelease(_observer);
+        _observer = NULL;
+    }
+    atomic_store(&_busySince, 0);
+}
+
+- (void)runLoopActivity:(CFRunLoopActivity)activity
+{
+    if (!atomic_load_explicit(&_active, memory_order_relaxed)) {
+        atomic_store_explicit(&_busySince, 0, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t now = CKTMonotonicMicroseconds();
+
+    if (activity == kCFRunLoopEntry || activity == kCFRunLoopAfterWaiting) {
+        if (atomic_load_explicit(&_busySince, memory_order_relaxed) == 0) {
+            atomic_fetch_add_explicit(&_iteration, 1, memory_order_relaxed);
+            atomic_store_explicit(&_busySince, now, memory_order_release);
+        }
+        return;
+    }
+
+    uint64_t busySince = atomic_exchange_explicit(&_busySince, 0, memory_order_acq_rel);
+    if (busySince == 0) {
+        return;
+    }
+
+    os_unfair_lock_lock(&_lock);
+    [_iterationTime recordValue:now - busySince];
+    if (_activeStall) {
+        _activeStall[kJSWatchdogStallDuration] = @((now - busySince) / 1000.0);
+        _activeStall = nil;
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Hooks
+
+- (void)taskWillRun:(const char *)label
+{
+    if (!atomic_load_explicit(&_active, memory_order_relaxed)) {
+        return;
+    }
+
+    _taskStart = CKTMonotonicMicroseconds();
+
+    os_unfair_lock_lock(&_lock);
+    _taskLabel = label;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)taskDidRun
+{
+    if (!_taskStart) {
+        return;
+    }
+
+    uint64_t runTime = CKTMonotonicMicroseconds() - _taskStart;
+    _taskStart = 0;
+
+    os_unfair_lock_lock(&_lock);
+    [_taskRunTime recordValue:runTime];
+    _taskLabel = NULL;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)willCallFunction:(NSString *)functionName
+{
+    if (!atomic_load_explicit(&_active, memory_order_relaxed)) {
+        return;
+    }
+
+    os_unfair_lock_lock(&_lock);
+    _functionName = functionName;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)didCallFunction
+{
+    if (!atomic_load_explicit(&_active, memory_order_relaxed)) {
+        return;
+    }
+
+    os_unfair_lock_lock(&_lock);
+    _functionName = nil;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)jsDidCallOut
+{
+    if (!atomic_load_explicit(&_stackCaptureRequested, memory_order_relaxed) ||
+        !atomic_exchange(&_stackCaptureRequested, false)) {
+        return;
+    }
+
+    JSContext *context = [JSContext currentContext];
+    NSString *stack = [[context evaluateScript:@"new Error().stack"] toString];
+
+    os_unfair_lock_lock(&_lock);
+    _activeStall[kJSWatchdogStallJSStack] = stack;
+    os_unfair_lock_unlock(&_lock);
+
+    LOGW(LOG_TAG, @"JS stack of the stalled code:\n%@", stack);
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    os_unfair_lock_lock(&_lock);
+
+    NSMutableArray *reports = [NSMutableArray arrayWithCapacity:_stallReports.count];
+    for (NSDictionary *report in _stallReports) {
+        [reports addObject:[report copy]];
+    }
+
+    NSDictionary *statistics = @{
+        kJSWatchdogIterationTime : [_iterationTime dictionaryRepresentation],
+        kJSWatchdogTaskRunTime : [_taskRunTime dictionaryRepresentation],
+        kJSWatchdogStalls : @(_stalls),
+        kJSWatchdogStallReports : reports
+    };
+
+    os_unfair_lock_unlock(&_lock);
+    return statistics;
+}
+
+- (void)resetStatistics
+{
+    os_unfair_lock_lock(&_lock);
+    [_iterationTime reset];
+    [_taskRunTime reset];
+    [_stallReports removeAllObjects];
+    _activeStall = nil;
+    _stalls = 0;
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - internal functions
+
+// Called with @synchronized(self) held
+- (void)updateTimer
+{
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+        _timer = nil;
+    }
+
+    if (!_enabled) {
+        return;
+    }
+
+    // Check twice per threshold, a stall is reported at most half a threshold late
+    uint64_t interval = (uint64_t)(_stallThreshold * NSEC_PER_SEC / 2);
+    _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+
+    __weak JSThreadWatchdog *weakSelf = self;
+    dispatch_source_set_event_handler(_timer, ^{ [weakSelf checkForStall]; });
+    dispatch_resume(_timer);
+}
+
+- (void)checkForStall
+{
+    uint64_t busySince = atomic_load_explicit(&_busySince, memory_order_acquire);
+    uint64_t iteration = atomic_load_explicit(&_iteration, memory_order_relaxed);
+    if (busySince == 0 || iteration == _reportedIteration) {
+        return;
+    }
+
+    uint64_t busy = CKTMonotonicMicroseconds() - busySince;
+    if (busy < self.stallThreshold * USEC_PER_SEC) {
+        return;
+    }
+
+    _reportedIteration = iteration;
+
+    NSMutableDictionary *report = [NSMutableDictionary dictionary];
+    report[kJSWatchdogStallDate] = [NSDate dateWithTimeIntervalSinceNow:-(busy / (double)USEC_PER_SEC)];
+    report[kJSWatchdogStallDuration] = @(busy / 1000.0);
+
+    os_unfair_lock_lock(&_lock);
+    if (_taskLabel) {
+        report[kJSWatchdogStallTask] = [NSString stringWithUTF8String:_taskLabel];
+    }
+    report[kJSWatchdogStallFunction] = _functionName;
+    if (_stallReports.count >= kJSWatchdogMaxStallReports) {
+        [_stallReports removeObjectAtIndex:0];
+    }
+    [_stallReports addObject:report];
+    _activeStall = report;
+    _stalls++;
+    os_unfair_lock_unlock(&_lock);
+
+    LOGW(LOG_TAG, @"JS thread stalled for %.0f ms - task: %@, function: %@", busy / 1000.0,
+         report[kJSWatchdogStallTask], report[kJSWatchdogStallFunction]);
+
+    if (self.captureJSStackOnStall) {
+        atomic_store(&_stackCaptureRequested, true);
+    }
+}
+
+@end
@@ -0,0 +1,119 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSTimerWheel.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// Kinds of timers, each with its own leeway
+typedef NS_ENUM(NSInteger, JSTimerClass) {
+    JSTimerClassPrecise,         // One shot timers such as deferred callbacks, which are expected on time
+    JSTimerClassRequestTimeout,  // Timeouts guarding a request, almost always cancelled by the response
+    JSTimerClassInterval,        // Repeating timers such as keepalives and polling
+
+    // Must be last
+    JSTimerClassNumberOfClasses
+};
+
+// Keys of the dictionary returned by -[JSTimerWheel statistics]
+extern NSString *const kJSTimerWheelActiveTimers;     // Timers currently scheduled, not affected by a reset
+extern NSString *const kJSTimerWheelCreatedTimers;    // Timers scheduled since the last reset
+extern NSString *const kJSTimerWheelCancelledTimers;  // Timers cancelled before they expired
+extern NSString *const kJSTimerWheelFiredTimers;      // Expirations, each period of a repeating timer counts
+extern NSString *const kJSTimerWheelChurnPerSecond;   // Scheduled and cancelled timers per second since the last reset
+extern NSString *const kJSTimerWheelWakeups;          // Times the run loop timer fired
+extern NSString *const kJSTimerWheelWakeupsPerMinute; // Wakeups per minute since the last reset
+extern NSString *const kJSTimerWheelCoalescedTimers;  // Timers scheduled with a leeway, which may fire late
+extern NSString *const kJSTimerWheelCascades;         // Timers moved from a coarse level to a finer one
+extern NSString *const kJSTimerWheelMaxBatchSize;     // Largest number of timers expired in one batch
+extern NSString *const kJSTimerWheelExpiryTime;       // Histogram (see CKTHistogram.h) of the batch durations
+extern NSString *const kJSTimerWheelCallbackTime;     // Histogram of the time spent in the handler per expiration
+
+// Keys of the dictionaries passed to -[JSTimerWheel enumerateTimersUsingBlock:], times in milliseconds
+extern NSString *const kJSTimerWheelTimerId;
+extern NSString *const kJSTimerWheelTimerRepeats;
+extern NSString *const kJSTimerWheelTimerClass;               // JSTimerClass
+extern NSString *const kJSTimerWheelTimerDelay;               // Delay or period as requested
+extern NSString *const kJSTimerWheelTimerLeeway;
+extern NSString *const kJSTimerWheelTimerAge;                 // Seconds since the timer was scheduled
+extern NSString *const kJSTimerWheelTimerDueIn;
+extern NSString *const kJSTimerWheelTimerFires;               // Only repeating timers fire more than once
+extern NSString *const kJSTimerWheelTimerMeanCallbackTime;
+extern NSString *const kJSTimerWheelTimerMaxCallbackTime;
+
+typedef uint32_t JSTimerId;
+
+// Called for every expiration with the target and argument passed when scheduling. repeats is NO for the last
+// call, after which the wheel has released both.
+typedef void (^JSTimerWheelHandler)(id target, id argument, BOOL repeats);
+
+// Hierarchical timer wheel with millisecond ticks, backing window.setTimeout/setInterval.
+//
+// Four levels of 64 slots cover 64 ms, 4 s, 4 min and 4.6 h (longer timers wait in an overflow list). Each slot
+// is an intrusive list in one array of timer records, so scheduling and cancelling are O(1) and allocation free
+// once the array has grown. A timer is filed in the level matching its distance to the current tick and moved to a
+// finer level when the wheel reaches its slot, bitmaps of the non empty slots let the wheel jump directly to the
+// next tick where something happens.
+//
+// A single run loop timer, armed for that tick, drives the wheel. When it fires the wakeup block is called once,
+// which is expected to call -expireTimers; all timers due by then expire in one batch, in expiry order. A wakeup
+// which has not led to -expireTimers within a second, e.g. because its task was dropped, is requested again.
+//
+// Timers may be given a leeway, the time they are allowed to fire late, which is set per timer class. Their expiry is
+// then rounded up to a multiple of the largest power of two milliseconds within the leeway, so that timers expiring
+// close to each other share a tick and thus a wakeup. Timers without leeway are precise and fire at their tick.
+//
+// Timer ids combine the index of the record with a generation, so a stale id never cancels a newer timer reusing
+// the record. Not thread safe, all methods must be called on the thread whose run loop drives the wheel.
+@interface JSTimerWheel : NSObject
+
+- (instancetype)initWithWakeup:(dispatch_block_t)wakeup handler:(JSTimerWheelHandler)handler;
+
+// Leeway in milliseconds given to new timers of the class, 0 (precise) for all classes by default. A timer never gets
+// more than a tenth of its delay, so short timers stay precise. Thread safe, timers already scheduled keep theirs.
+- (NSTimeInterval)leewayForClass:(JSTimerClass)timerClass;
+- (void)setLeeway:(NSTimeInterval)leeway forClass:(JSTimerClass)timerClass;
+
+// Schedules a timer in the current run loop, the delay is in milliseconds. Never returns 0.
+- (JSTimerId)scheduleTimerAfter:(NSTimeInterval)delay
+                        repeats:(BOOL)repeats
+                     timerClass:(JSTimerClass)timerClass
+                         target:(id)target
+                       argument:(id)argument;
+
+// Same as above with JSTimerClassInterval for repeating timers and JSTimerClassPrecise otherwise
+- (JSTimerId)scheduleTimerAfter:(NSTimeInterval)delay repeats:(BOOL)repeats target:(id)target argument:(id)argument;
+
+// Returns the target of the cancelled timer, nil if the id is unknown, stale or already expired
+- (id)cancelTimer:(JSTimerId)timerId;
+
+// Cancels all timers and detaches the wheel from the run loop, the block is called with the target of each timer
+- (void)cancelAllTimers:(void (^)(id target))block;
+
+// Calls the block for each scheduled timer with its target, argument and counters. The counters are kept for
+// every timer at the cost of two clock reads per expiration.
+- (void)enumerateTimersUsingBlock:(void (^)(id target, id argument, NSDictionary *timer))block;
+
+// Expires the timers which are due, calling the handler for each of them
+- (void)expireTimers;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
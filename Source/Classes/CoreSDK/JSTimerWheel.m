@@ -0,0 +1,738 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  JSTimerWheel.m
+//  CircuitSDK
+//
+//
+
+#import "JSTimerWheel.h"
+#import "CKTHistogram.h"
+#import "Log.h"
+
+#import <stdatomic.h>
+
+NSString *const kJSTimerWheelActiveTimers = @"activeTimers";
+NSString *const kJSTimerWheelCreatedTimers = @"createdTimers";
+NSString *const kJSTimerWheelCancelledTimers = @"cancelledTimers";
+NSString *const kJSTimerWheelFiredTimers = @"firedTimers";
+NSString *const kJSTimerWheelChurnPerSecond = @"churnPerSecond";
+NSString *const kJSTimerWheelWakeups = @"wakeups";
+NSString *const kJSTimerWheelWakeupsPerMinute = @"wakeupsPerMinute";
+NSString *const kJSTimerWheelCoalescedTimers = @"coalescedTimers";
+NSString *const kJSTimerWheelCascades = @"cascades";
+NSString *const kJSTimerWheelMaxBatchSize = @"maxBatchSize";
+NSString *const kJSTimerWheelExpiryTime = @"expiryTime";
+NSString *const kJSTimerWheelCallbackTime = @"callbackTime";
+
+NSString *const kJSTimerWheelTimerId = @"id";
+NSString *const kJSTimerWheelTimerRepeats = @"repeats";
+NSString *const kJSTimerWheelTimerClass = @"class";
+NSString *const kJSTimerWheelTimerDelay = @"delay";
+NSString *const kJSTimerWheelTimerLeeway = @"leeway";
+NSString *const kJSTimerWheelTimerAge = @"age";
+NSString *const kJSTimerWheelTimerDueIn = @"dueIn";
+NSString *const kJSTimerWheelTimerFires = @"fires";
+NSString *const kJSTimerWheelTimerMeanCallbackTime = @"meanCallbackTime";
+NSString *const kJSTimerWheelTimerMaxCallbackTime = @"maxCallbackTime";
+
+#define TIMER_LEVELS 4
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+
+// Lists 0 .. TIMER_LEVELS * TIMER_SLOTS - 1 are the slots, followed by these two
+#define TIMER_LIST_EXPIRED (TIMER_LEVELS * TIMER_SLOTS)
+#define TIMER_LIST_OVERFLOW (TIMER_LIST_EXPIRED + 1)
+#define TIMER_LIST_COUNT (TIMER_LIST_OVERFLOW + 1)
+
+#define TIMER_NIL UINT32_MAX
+// A timer is given at most this part of its delay as leeway
+#define TIMER_MAX_LEEWAY_RATIO 0.1
+// Fire date of the run loop timer while no timer is scheduled, about 300 years ahead
+#define TIMER_DISTANT_FUTURE 1.0e10
+#define TIMER_NO_TICK UINT64_MAX
+
+// Microseconds after which a wakeup that did not lead to -expireTimers is considered lost and requested again
+#define TIMER_WAKEUP_TIMEOUT (1 * USEC_PER_SEC)
+
+// Timer ids are (generation << TIMER_INDEX_BITS) | (index + 1)
+#define TIMER_INDEX_BITS 20
+#define TIMER_INDEX_MASK ((1u << TIMER_INDEX_BITS) - 1)
+#define TIMER_GENERATION_MASK ((1u << (32 - TIMER_INDEX_BITS)) - 1)
+
+typedef struct JSTimer {
+    uint64_t deadline;  // Tick at which the timer is due
+    uint64_t expiry;    // Tick at which the timer expires, the deadline rounded up within the leeway
+    uint64_t interval;  // Period in ticks, 0 for a one shot timer
+    uint64_t leeway;    // Ticks
+    uint64_t delay;     // Ticks, as requested
+    uint64_t created;   // Tick at which the timer was scheduled
+    uint64_t callbackTime;     // Total time spent in the handler, in microseconds
+    uint32_t maxCallbackTime;  // Microseconds
+    uint32_t fires;
+    uint32_t timerClass;
+    void *target;       // Retained
+    void *argument;     // Retained, may be NULL
+    uint32_t prev;
+    uint32_t next;
+    uint32_t list;  // TIMER_NIL while the record is free
+    uint32_t generation;
+} JSTimer;
+
+typedef struct JSTimerWheelState {
+    JSTimer *timers;
+    uint32_t capacity;
+
+    // Free records, reused oldest first to make the most of the generations
+    uint32_t freeHead;
+    uint32_t freeTail;
+
+    uint32_t heads[TIMER_LIST_COUNT];
+    uint32_t tails[TIMER_LIST_COUNT];
+    uint64_t occupied[TIMER_LEVELS];  // Bit per non empty slot
+
+    // All ticks up to this one have been processed
+    uint64_t now;
+    uint32_t count;
+    uint64_t cascades;
+} JSTimerWheelState;
+
+static void JSTimerListAppend(JSTimerWheelState *wheel, uint32_t list, uint32_t index)
+{
+    JSTimer *timer = &wheel->timers[index];
+    timer->list = list;
+    timer->next = TIMER_NIL;
+    timer->prev = wheel->tails[list];
+    if (timer->prev != TIMER_NIL) {
+        wheel->timers[timer->prev].next = index;
+    } else {
+        wheel->heads[list] = index;
+    }
+    wheel->tails[list] = index;
+
+    if (list < TIMER_LIST_EXPIRED) {
+        wheel->occupied[list / TIMER_SLOTS] |= 1ULL << (list % TIMER_SLOTS);
+    }
+}
+
+static void JSTimerListRemove(JSTimerWheelState *wheel, uint32_t index)
+{
+    JSTimer *timer = &wheel->timers[index];
+    uint32_t list = timer->list;
+    if (timer->prev != TIMER_NIL) {
+        wheel->timers[timer->prev].next = timer->next;
+    } else {
+        wheel->heads[list] = timer->next;
+    }
+    if (timer->next != TIMER_NIL) {
+        wheel->timers[timer->next].prev = timer->prev;
+    } else {
+        wheel->tails[list] = timer->prev;
+    }
+
+    if (list < TIMER_LIST_EXPIRED && wheel->heads[list] == TIMER_NIL) {
+        wheel->occupied[list / TIMER_SLOTS] &= ~(1ULL << (list % TIMER_SLOTS));
+    }
+
+    timer->prev = timer->next = TIMER_NIL;
+    timer->list = TIMER_NIL;
+}
+
+// Rounds the deadline up to a multiple of the largest power of two within the leeway, so that timers due around
+// the same time expire at the same tick
+static uint64_t JSTimerCoalescedExpiry(uint64_t deadline, uint64_t leeway)
+{
+    if (leeway < 2) {
+        return deadline;
+    }
+
+    uint64_t granularity = 1ULL << (63 - __builtin_clzll(leeway));
+    return (deadline + granularity - 1) & ~(granularity - 1);
+}
+
+// Files the timer in the slot matching the distance of its expiry to the current tick
+static void JSTimerFile(JSTimerWheelState *wheel, uint32_t index)
+{
+    uint64_t expiry = wheel->timers[index].expiry;
+    if (expiry <= wheel->now) {
+        JSTimerListAppend(wheel, TIMER_LIST_EXPIRED, index);
+        return;
+    }
+
+    int level = (63 - __builtin_clzll(expiry - wheel->now)) / TIMER_SLOT_BITS;
+    if (level >= TIMER_LEVELS) {
+        JSTimerListAppend(wheel, TIMER_LIST_OVERFLOW, index);
+        return;
+    }
+
+    uint32_t slot = (uint32_t)((expiry >> (level * TIMER_SLOT_BITS)) & (TIMER_SLOTS - 1));
+    JSTimerListAppend(wheel, level * TIMER_SLOTS + slot, index);
+}
+
+// Next tick after the current one at which a slot expires or has to be cascaded, TIMER_NO_TICK if none
+static uint64_t JSTimerNextTick(JSTimerWheelState *wheel)
+{
+    uint64_t next = TIMER_NO_TICK;
+
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        uint64_t occupied = wheel->occupied[level];
+        if (!occupied) {
+            continue;
+        }
+
+        // Slots are reached in order starting after the one of the current tick
+        int shift = level * TIMER_SLOT_BITS;
+        uint64_t position = wheel->now >> shift;
+        unsigned start = (unsigned)((position + 1) & (TIMER_SLOTS - 1));
+        uint64_t rotated = start ? (occupied >> start) | (occupied << (TIMER_SLOTS - start)) : occupied;
+        uint64_t tick = (position + 1 + __builtin_ctzll(rotated)) << shift;
+        next = MIN(next, tick);
+    }
+
+    if (wheel->heads[TIMER_LIST_OVERFLOW] != TIMER_NIL) {
+        // Looked at again whenever the coarsest level moves on
+        int shift = (TIMER_LEVELS - 1) * TIMER_SLOT_BITS;
+        next = MIN(next, ((wheel->now >> shift) + 1) << shift);
+    }
+
+    return next;
+}
+
+// Moves all timers of the list to where they belong now
+static void JSTimerRefile(JSTimerWheelState *wheel, uint32_t list)
+{
+    uint32_t index = wheel->heads[list];
+    wheel->heads[list] = wheel->tails[list] = TIMER_NIL;
+    if (list < TIMER_LIST_EXPIRED) {
+        wheel->occupied[list / TIMER_SLOTS] &= ~(1ULL << (list % TIMER_SLOTS));
+    }
+
+    while (index != TIMER_NIL) {
+        uint32_t next = wheel->timers[index].next;
+        JSTimerFile(wheel, index);
+        wheel->cascades++;
+        index = next;
+    }
+}
+
+// Processes all ticks up to the given one, due timers end up in the expired list
+static void JSTimerAdvance(JSTimerWheelState *wheel, uint64_t target)
+{
+    for (;;) {
+        uint64_t tick = JSTimerNextTick(wheel);
+        if (tick > target) {
+            break;
+        }
+        wheel->now = tick;
+
+        // Coarse levels first, they may file timers in the finer slots reached at the same tick
+        for (int level = TIMER_LEVELS - 1; level > 0; level--) {
+            int shift = level * TIMER_SLOT_BITS;
+            if (tick & ((1ULL << shift) - 1)) {
+                continue;
+            }
+            if (level == TIMER_LEVELS - 1 && wheel->heads[TIMER_LIST_OVERFLOW] != TIMER_NIL) {
+                JSTimerRefile(wheel, TIMER_LIST_OVERFLOW);
+            }
+            uint32_t list = level * TIMER_SLOTS + (uint32_t)((tick >> shift) & (TIMER_SLOTS - 1));
+            if (wheel->heads[list] != TIMER_NIL) {
+                JSTimerRefile(wheel, list);
+            }
+        }
+
+        // Every timer of the finest slot expires at this very tick
+        uint32_t list = (uint32_t)(tick & (TIMER_SLOTS - 1));
+        uint32_t index = wheel->heads[list];
+        while (index != TIMER_NIL) {
+            uint32_t next = wheel->timers[index].next;
+            JSTimerListRemove(wheel, index);
+            JSTimerListAppend(wheel, TIMER_LIST_EXPIRED, index);
+            index = next;
+        }
+    }
+
+    wheel->now = MAX(wheel->now, target);
+}
+
+static void JSTimerWheelTimerFired(CFRunLoopTimerRef timer, void *info);
+
+@interface JSTimerWheel () {
+    JSTimerWheelState _wheel;
+
+    // Monotonic time in microseconds of tick 0
+    uint64_t _epoch;
+
+    CFRunLoopTimerRef _runLoopTimer;
+    uint64_t _armedTick;
+    BOOL _expiryPending;
+    uint64_t _expiryRequested;
+
+    dispatch_block_t _wakeup;
+    JSTimerWheelHandler _handler;
+
+    // Statistics, written on the wheel's thread
+    atomic_uint_fast64_t _createdTimers;
+    atomic_uint_fast64_t _cancelledTimers;
+    atomic_uint_fast64_t _firedTimers;
+    atomic_uint_fast64_t _wakeups;
+    atomic_uint_fast64_t _coalescedTimers;
+    atomic_uint_fast64_t _activeTimers;
+
+    // Milliseconds per JSTimerClass, set from any thread
+    atomic_uint_fast64_t _leeways[JSTimerClassNumberOfClasses];
+
+    // Protected by @synchronized(self)
+    uint64_t _maxBatchSize;
+    uint64_t _resetTime;
+    uint64_t _cascadesAtReset;
+    CKTHistogram *_expiryTime;
+    CKTHistogram *_callbackTime;
+}
+
+@end
+
+@implementation JSTimerWheel
+
+static NSString *LOG_TAG = @"[JSTimerWheel]";
+
+- (instancetype)initWithWakeup:(dispatch_block_t)wakeup handler:(JSTimerWheelHandler)handler
+{
+    if (self = [super init]) {
+        _wakeup = [wakeup copy];
+        _handler = [handler copy];
+
+        for (int i = 0; i < TIMER_LIST_COUNT; i++) {
+            _wheel.heads[i] = _wheel.tails[i] = TIMER_NIL;
+        }
+        _wheel.freeHead = _wheel.freeTail = TIMER_NIL;
+        _epoch = CKTMonotonicMicroseconds();
+        _armedTick = TIMER_NO_TICK;
+
+        _expiryTime = [[CKTHistogram alloc] init];
+        _callbackTime = [[CKTHistogram alloc] init];
+        _resetTime = _epoch;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self cancelAllTimers:nil];
+    free(_wheel.timers);
+}
+
+- (NSTimeInterval)leewayForClass:(JSTimerClass)timerClass
+{
+    if (timerClass < 0 || timerClass >= JSTimerClassNumberOfClasses) {
+        return 0;
+    }
+    return atomic_load_explicit(&_leeways[timerClass], memory_order_relaxed);
+}
+
+- (void)setLeeway:(NSTimeInterval)leeway forClass:(JSTimerClass)timerClass
+{
+    if (timerClass < 0 || timerClass >= JSTimerClassNumberOfClasses) {
+        return;
+    }
+
+    LOGD(LOG_TAG, @"Leeway of timer class %ld set to %.0f ms", (long)timerClass, leeway);
+    atomic_store_explicit(&_leeways[timerClass], (uint64_t)ceil(MAX(leeway, 0)), memory_order_relaxed);
+}
+
+- (JSTimerId)scheduleTimerAfter:(NSTimeInterval)delay repeats:(BOOL)repeats target:(id)target argument:(id)argument
+{
+    JSTimerClass timerClass = repeats ? JSTimerClassInterval : JSTimerClassPrecise;
+    return [self scheduleTimerAfter:delay repeats:repeats timerClass:timerClass target:target argument:argument];
+}
+
+- (JSTimerId)scheduleTimerAfter:(NSTimeInterval)delay
+                        repeats:(BOOL)repeats
+                     timerClass:(JSTimerClass)timerClass
+                         target:(id)target
+                       argument:(id)argument
+{
+    if (timerClass < 0 || timerClass >= JSTimerClassNumberOfClasses) {
+        timerClass = JSTimerClassPrecise;
+    }
+
+    uint32_t index = [self allocateTimer];
+    if (index == TIMER_NIL) {
+        LOGE(LOG_TAG, @"Too many timers, dropping a timer of %.0f ms", delay);
+        return 0;
+    }
+
+    uint64_t ticks = (uint64_t)ceil(MAX(delay, 0));
+    uint64_t classLeeway = atomic_load_explicit(&_leeways[timerClass], memory_order_relaxed);
+    uint64_t leeway = (uint64_t)MIN(classLeeway, ticks * TIMER_MAX_LEEWAY_RATIO);
+    JSTimer *timer = &_wheel.timers[index];
+    timer->created = [self currentTick];
+    timer->deadline = timer->created + ticks;
+    timer->delay = ticks;
+    timer->callbackTime = 0;
+    timer->maxCallbackTime = 0;
+    timer->fires = 0;
+    timer->timerClass = (uint32_t)timerClass;
+    timer->leeway = leeway;
+    timer->expiry = JSTimerCoalescedExpiry(timer->deadline, leeway);
+    timer->interval = repeats ? MAX(ticks, 1) : 0;
+    timer->target = (__bridge_retained void *)target;
+    timer->argument = argument ? (__bridge_retained void *)argument : NULL;
+    JSTimerFile(&_wheel, index);
+    _wheel.count++;
+
+    atomic_fetch_add_explicit(&_createdTimers, 1, memory_order_relaxed);
+    if (leeway >= 2) {
+        atomic_fetch_add_explicit(&_coalescedTimers, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&_activeTimers, _wheel.count, memory_order_relaxed);
+
+    [self attachToCurrentRunLoop];
+    [self armTimer:NO];
+
+    return (timer->generation << TIMER_INDEX_BITS) | (index + 1);
+}
+
+- (id)cancelTimer:(JSTimerId)timerId
+{
+    uint32_t index = [self indexOfTimer:timerId];
+    if (index == TIMER_NIL) {
+        return nil;
+    }
+
+    JSTimerListRemove(&_wheel, index);
+    id target = [self releaseTimer:index argument:NULL];
+
+    atomic_fetch_add_explicit(&_cancelledTimers, 1, memory_order_relaxed);
+
+    // The run loop timer is left armed, waking up once for nothing is cheaper than looking for the next tick
+    return target;
+}
+
+- (void)cancelAllTimers:(void (^)(id target))block
+{
+    for (uint32_t list = 0; list < TIMER_LIST_COUNT; list++) {
+        uint32_t index;
+        while ((index = _wheel.heads[list]) != TIMER_NIL) {
+            JSTimerListRemove(&_wheel, index);
+            id target = [self releaseTimer:index argument:NULL];
+            if (block) {
+                block(target);
+            }
+        }
+    }
+
+    if (_runLoopTimer) {
+        CFRunLoopTimerInvalidate(_runLoopTimer);
+        CFRelease(_runLoopTimer);
+        _runLoopTimer = NULL;
+    }
+    _armedTick = TIMER_NO_TICK;
+    _expiryPending = NO;
+}
+
+- (void)expireTimers
+{
+    _expiryPending = NO;
+
+    uint64_t start = CKTMonotonicMicroseconds();
+    JSTimerAdvance(&_wheel, [self currentTick]);
+
+    uint64_t batchSize = 0;
+    uint32_t index;
+    while ((index = _wheel.heads[TIMER_LIST_EXPIRED]) != TIMER_NIL) {
+        JSTimerListRemove(&_wheel, index);
+        JSTimer *timer = &_wheel.timers[index];
+        batchSize++;
+
+        // The handler may schedule timers and reallocate the records, the timer must not be used after it
+        id target;
+        id argument;
+        BOOL repeats = timer->interval != 0;
+        uint32_t generation = timer->generation;
+        if (repeats) {
+            timer->fires++;
+            target = (__bridge id)timer->target;
+            argument = (__bridge id)timer->argument;
+            // Filed again first so that the handler can clear the interval. The period runs from the deadline so
+            // that the leeway does not accumulate.
+            timer->deadline = MAX(timer->deadline + timer->interval, _wheel.now + 1);
+            timer->expiry = MAX(JSTimerCoalescedExpiry(timer->deadline, timer->leeway), _wheel.now + 1);
+            JSTimerFile(&_wheel, index);
+        } else {
+            void *retainedArgument;
+            target = [self releaseTimer:index argument:&retainedArgument];
+            argument = (__bridge_transfer id)retainedArgument;
+        }
+
+        uint64_t callbackStart = CKTMonotonicMicroseconds();
+        _handler(target, argument, repeats);
+        uint64_t callbackTime = CKTMonotonicMicroseconds() - callbackStart;
+
+        // Unless the interval was cleared by its handler
+        timer = &_wheel.timers[index];
+        if (repeats && timer->list != TIMER_NIL && timer->generation == generation) {
+            timer->callbackTime += callbackTime;
+            timer->maxCallbackTime = (uint32_t)MIN(MAX(timer->maxCallbackTime, callbackTime), UINT32_MAX);
+        }
+        @synchronized(self)
+        {
+            [_callbackTime recordValue:callbackTime];
+        }
+    }
+
+    atomic_fetch_add_explicit(&_firedTimers, batchSize, memory_order_relaxed);
+
+    @synchronized(self)
+    {
+        _maxBatchSize = MAX(_maxBatchSize, batchSize);
+        [_expiryTime recordValue:CKTMonotonicMicroseconds() - start];
+    }
+
+    [self armTimer:YES];
+}
+
+- (void)enumerateTimersUsingBlock:(void (^)(id target, id argument, NSDictionary *timer))block
+{
+    uint64_t now = [self currentTick];
+
+    for (uint32_t index = 0; index < _wheel.capacity; index++) {
+        JSTimer *timer = &_wheel.timers[index];
+        if (timer->list == TIMER_NIL) {
+            continue;
+        }
+
+        NSDictionary *info = @{
+            kJSTimerWheelTimerId : @((timer->generation << TIMER_INDEX_BITS) | (index + 1)),
+            kJSTimerWheelTimerRepeats : @((BOOL)(timer->interval != 0)),
+            kJSTimerWheelTimerClass : @(timer->timerClass),
+            kJSTimerWheelTimerDelay : @(timer->delay),
+            kJSTimerWheelTimerLeeway : @(timer->leeway),
+            kJSTimerWheelTimerAge : @((now - timer->created) / 1000.0),
+            kJSTimerWheelTimerDueIn : @(timer->expiry > now ? timer->expiry - now : 0),
+            kJSTimerWheelTimerFires : @(timer->fires),
+            kJSTimerWheelTimerMeanCallbackTime : @(timer->fires ? timer->callbackTime / 1000.0 / timer->fires : 0),
+            kJSTimerWheelTimerMaxCallbackTime : @(timer->maxCallbackTime / 1000.0)
+        };
+
+        // The block may cancel timers but must not schedule any, the records could be reallocated
+        block((__bridge id)timer->target, (__bridge id)timer->argument, info);
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    uint64_t created = atomic_load_explicit(&_createdTimers, memory_order_relaxed);
+    uint64_t cancelled = atomic_load_explicit(&_cancelledTimers, memory_order_relaxed);
+    uint64_t wakeups = atomic_load_explicit(&_wakeups, memory_order_relaxed);
+
+    @synchronized(self)
+    {
+        double seconds = (CKTMonotonicMicroseconds() - _resetTime) / (double)USEC_PER_SEC;
+
+        return @{
+            kJSTimerWheelActiveTimers : @(atomic_load_explicit(&_activeTimers, memory_order_relaxed)),
+            kJSTimerWheelCreatedTimers : @(created),
+            kJSTimerWheelCancelledTimers : @(cancelled),
+            kJSTimerWheelFiredTimers : @(atomic_load_explicit(&_firedTimers, memory_order_relaxed)),
+            kJSTimerWheelChurnPerSecond : @(seconds > 0 ? (created + cancelled) / seconds : 0),
+            kJSTimerWheelWakeups : @(wakeups),
+            kJSTimerWheelWakeupsPerMinute : @(seconds > 0 ? wakeups * 60 / seconds : 0),
+            kJSTimerWheelCoalescedTimers : @(atomic_load_explicit(&_coalescedTimers, memory_order_relaxed)),
+            kJSTimerWheelCascades : @(_wheel.cascades - _cascadesAtReset),
+            kJSTimerWheelMaxBatchSize : @(_maxBatchSize),
+            kJSTimerWheelExpiryTime : [_expiryTime dictionaryRepresentation],
+            kJSTimerWheelCallbackTime : [_callbackTime dictionaryRepresentation]
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    LOGD(LOG_TAG, @"resetStatistics");
+
+    atomic_store(&_createdTimers, 0);
+    atomic_store(&_cancelledTimers, 0);
+    atomic_store(&_firedTimers, 0);
+    atomic_store(&_wakeups, 0);
+    atomic_store(&_coalescedTimers, 0);
+
+    @synchronized(self)
+    {
+        _maxBatchSize = 0;
+        _resetTime = CKTMonotonicMicroseconds();
+        _cascadesAtReset = _wheel.cascades;
+        [_expiryTime reset];
+        [_callbackTime reset];
+    }
+}
+
+#pragma mark - internal functions
+
+- (uint64_t)currentTick
+{
+    return (CKTMonotonicMicroseconds() - _epoch) / USEC_PER_MSEC;
+}
+
+// Index of the scheduled timer with the given id, TIMER_NIL if the id is stale
+- (uint32_t)indexOfTimer:(JSTimerId)timerId
+{
+    uint32_t index = (timerId & TIMER_INDEX_MASK) - 1;
+    if (timerId == 0 || index >= _wheel.capacity) {
+        return TIMER_NIL;
+    }
+
+    JSTimer *timer = &_wheel.timers[index];
+    if (timer->list == TIMER_NIL || timer->generation != timerId >> TIMER_INDEX_BITS) {
+        return TIMER_NIL;
+    }
+    return index;
+}
+
+- (uint32_t)allocateTimer
+{
+    if (_wheel.freeHead == TIMER_NIL) {
+        uint32_t capacity = _wheel.capacity ? _wheel.capacity * 2 : 64;
+        if (capacity > TIMER_INDEX_MASK) {
+            return TIMER_NIL;
+        }
+
+        JSTimer *timers = realloc(_wheel.timers, capacity * sizeof(JSTimer));
+        if (!timers) {
+            return TIMER_NIL;
+        }
+        memset(&timers[_wheel.capacity], 0, (capacity - _wheel.capacity) * sizeof(JSTimer));
+        _wheel.timers = timers;
+
+        for (uint32_t i = _wheel.capacity; i < capacity; i++) {
+            timers[i].list = TIMER_NIL;
+            timers[i].prev = TIMER_NIL;
+            timers[i].next = (i + 1 < capacity) ? i + 1 : TIMER_NIL;
+        }
+        _wheel.freeHead = _wheel.capacity;
+        _wheel.freeTail = capacity - 1;
+        _wheel.capacity = capacity;
+    }
+
+    uint32_t index = _wheel.freeHead;
+    _wheel.freeHead = _wheel.timers[index].next;
+    if (_wheel.freeHead == TIMER_NIL) {
+        _wheel.freeTail = TIMER_NIL;
+    }
+    _wheel.timers[index].next = TIMER_NIL;
+    return index;
+}
+
+// Returns the target and puts the record back on the free list. The retained argument is handed over if requested,
+// released otherwise.
+- (id)releaseTimer:(uint32_t)index argument:(void **)argument
+{
+    JSTimer *timer = &_wheel.timers[index];
+    id target = (__bridge_transfer id)timer->target;
+    if (argument) {
+        *argument = timer->argument;
+    } else if (timer->argument) {
+        CFRelease(timer->argument);
+    }
+    timer->target = timer->argument = NULL;
+    timer->generation = (timer->generation + 1) & TIMER_GENERATION_MASK;
+
+    timer->next = TIMER_NIL;
+    if (_wheel.freeTail != TIMER_NIL) {
+        _wheel.timers[_wheel.freeTail].next = index;
+    } else {
+        _wheel.freeHead = index;
+    }
+    _wheel.freeTail = index;
+
+    _wheel.count--;
+    atomic_store_explicit(&_activeTimers, _wheel.count, memory_order_relaxed);
+
+    return target;
+}
+
+- (void)attachToCurrentRunLoop
+{
+    if (_runLoopTimer) {
+        return;
+    }
+
+    // Repeats with a huge interval so that it stays valid after firing, the fire date is always set explicitly.
+    // The timer does not retain the wheel, it is invalidated before the wheel goes away.
+    CFRunLoopTimerContext context = {0};
+    context.info = (__bridge void *)self;
+    _runLoopTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, TIMER_DISTANT_FUTURE, TIMER_DISTANT_FUTURE, 0, 0, JSTimerWheelTimerFired, &context);
+    CFRunLoopAddTimer(CFRunLoopGetCurrent(), _runLoopTimer, kCFRunLoopDefaultMode);
+}
+
+// Sets the fire date of the run loop timer to the next tick with work, unless it is already set to it
+- (void)armTimer:(BOOL)force
+{
+    if (!_runLoopTimer || _expiryPending) {
+        return;
+    }
+
+    uint64_t tick = _wheel.heads[TIMER_LIST_EXPIRED] != TIMER_NIL ? _wheel.now : JSTimerNextTick(&_wheel);
+    if (tick == _armedTick && !force) {
+        return;
+    }
+    _armedTick = tick;
+
+    if (tick == TIMER_NO_TICK) {
+        CFRunLoopTimerSetNextFireDate(_runLoopTimer, TIMER_DISTANT_FUTURE);
+        return;
+    }
+
+    int64_t delay = (int64_t)(_epoch + tick * USEC_PER_MSEC) - (int64_t)CKTMonotonicMicroseconds();
+    CFRunLoopTimerSetNextFireDate(_runLoopTimer, CFAbsoluteTimeGetCurrent() + MAX(delay, 0) / (double)USEC_PER_SEC);
+}
+
+- (void)runLoopTimerFired
+{
+    atomic_fetch_add_explicit(&_wakeups, 1, memory_order_relaxed);
+
+    _armedTick = TIMER_NO_TICK;
+
+    uint64_t now = CKTMonotonicMicroseconds();
+    if (_expiryPending) {
+        uint64_t waiting = now - _expiryRequested;
+        if (waiting < TIMER_WAKEUP_TIMEOUT) {
+            [self armWakeupTimeout:TIMER_WAKEUP_TIMEOUT - waiting];
+            return;
+        }
+        // E.g. discarded by the task queue, no later wakeup would ever be requested otherwise
+        LOGW(LOG_TAG, @"Wakeup not handled after %llu ms, requesting it again", waiting / USEC_PER_MSEC);
+    }
+
+    _expiryPending = YES;
+    _expiryRequested = now;
+    // Overridden by -expireTimers, which arms the timer for the next tick again
+    [self armWakeupTimeout:TIMER_WAKEUP_TIMEOUT];
+    _wakeup();
+}
+
+- (void)armWakeupTimeout:(uint64_t)timeout
+{
+    CFRunLoopTimerSetNextFireDate(_runLoopTimer, CFAbsoluteTimeGetCurrent() + timeout / (double)USEC_PER_SEC);
+}
+
+@end
+
+static void JSTimerWheelTimerFired(CFRunLoopTimerRef timer, void *info)
+{
+    [(__bridge JSTimerWheel *)info runLoopTimerFired];
+}
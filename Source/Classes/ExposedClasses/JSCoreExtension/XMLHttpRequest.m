@@ -22,6 +22,7 @@
 #import "XMLHttpRequest.h"
 #import "CKTHttp.h"
 #import "JSEngine.h"
+#import "JSThreadWatchdog.h"
 
 @implementation XMLHttpRequest {
     NSString *_method;
@@ -90,8 +91,33 @@ NSMutableURLRequest *req;
     return _onError.value;
 }
 
+- (void)handleResponse:(NSURLResponse *)serverResponse data:(NSData *)data error:(NSError *)error
+{
+    NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)serverResponse;
+    self.response = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    self.status = [httpResponse statusCode];
+    if (error) {
+        [self setOnerror: [JSValue valueWithNewErrorFromMessage:error.localizedDescription
+                                                     inContext:[[JSEngine sharedInstance] context]]];
+        self->responseText = error.localizedDescription;
+        [[self.onload invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:@[ self->_onError.value ]];
+    } else {
+        if (self.status == 200) {
+            self->responseText = self->response;
+            self->readyState = 4;
+            if (self->_onLoad) {
+                [[self.onload invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:NULL];
+            }
+        } else if (self->_onError) {
+            [[self.onerror invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:@[ self->_onError.value ]];
+        }
+    }
+}
+
 - (void)send:(NSString *)formData
 {
+    [[JSThreadWatchdog sharedInstance] jsDidCallOut];
+
     readyState = 2;
 
     req.HTTPMethod = _method;
@@ -104,29 +130,15 @@ NSMutableURLRequest *req;
 
     readyState = 3;
 
-    dataTask =
-        [urlSession dataTaskWithRequest:req
-                      completionHandler:^(NSData *data, NSURLResponse *serverResponse, NSError *error) {
-                          NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)serverResponse;
-                          self.response = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-                          self.status = [httpResponse statusCode];
-                          if (error) {
-                              [self setOnerror: [JSValue valueWithNewErrorFromMessage:error.localizedDescription
-                                                                           inContext:[[JSEngine sharedInstance] context]]];
-                              self->responseText = error.localizedDescription;
-                              [[self.onload invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:@[ self->_onError.value ]];
-                          } else {
-                              if (self.status == 200) {
-                                  self->responseText = self->response;
-                                  self->readyState = 4;
-                                  if (self->_onLoad) {
-                                      [[self.onload invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:NULL];
-                                  }
-                              } else if (self->_onError) {
-                                  [[self.onerror invokeMethod:@"bind" withArguments:@[ self ]] callWithArguments:@[ self->_onError.value ]];
-                              }
-                          }
-                      }];
+    dataTask = [urlSession
+        dataTaskWithRequest:req
+          completionHandler:^(NSData *data, NSURLResponse *serverResponse, NSError *error) {
+              // Deliver on the JS thread, behind interactive API calls and call signaling
+              [[JSEngine sharedInstance]
+                  performBlock:^{ [self handleResponse:serverResponse data:data error:error]; }
+                      priority:JSTaskPriorityBackground
+                         label:"XMLHttpRequest"];
+          }];
     [dataTask resume];
 }
 
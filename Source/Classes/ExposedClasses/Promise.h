@@ -31,10 +31,20 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-selector-name"
 
+@class CKTRequestTrace;
 @class Promise;
 
 typedef void (^PromiseCallback)(JSValue *value);
 
+// Keys of the dictionary returned by +[Promise statistics]
+extern NSString *const kPromiseResolutions;            // Promises resolved since the last reset
+extern NSString *const kPromiseRejections;             // Promises rejected since the last reset
+extern NSString *const kPromiseResolutionsPerSecond;   // Settled promises per second since the last reset
+extern NSString *const kPromiseCallbacks;              // Callbacks run from the microtask queue
+extern NSString *const kPromiseDrains;                 // Microtask queue drains (one per run loop turn at most)
+extern NSString *const kPromiseMaxCallbacksPerDrain;   // Largest number of callbacks run by a single drain
+extern NSString *const kPromiseDrainTime;              // Histogram of the drain durations (see CKTHistogram.h)
+
 @protocol PromiseExport<JSExport>
 
 - (Promise *)then:(JSValue *)successCallback:(JSValue *)errorCallback;
@@ -49,6 +59,28 @@ typedef void (^PromiseCallback)(JSValue *value);
 @property (nonatomic, assign) BOOL resolved;
 @property (nonatomic, assign) BOOL rejected;
 
+// Set by CKTService when request tracing is enabled, stamped when the promise settles
+@property (nonatomic, strong) CKTRequestTrace *trace;
+
+@property (nonatomic, readonly) BOOL cancelled;
+
+// Releases the pending callbacks, which are never called. Must be called on the JS thread.
+- (void)cancel;
+
+// Native fast path of then::, the blocks are stored and called as is instead of being wrapped into JSValues and
+// registered with the VM. No chained promise is created. Must be called on the JS thread.
+- (void)addSuccessCallback:(PromiseCallback)successCallback errorCallback:(PromiseCallback)errorCallback;
+
+// Callbacks of settled promises are not called recursively from resolve/reject but queued and run by a single
+// drain of the JS thread's task queue, further promises settled by the callbacks are handled by the same drain.
++ (NSDictionary *)statistics;
++ (void)resetStatistics;
+
+// Called when the JS environment is reset or torn down. Native callbacks still waiting for a promise, e.g. API
+// completions, are called with an error, the JS references of those promises and of the queued ones are released.
+// Must be called on the JS thread while the context is still there.
++ (void)discardPendingCallbacks;
+
 @end
 
 @protocol DeferExport<JSExport>
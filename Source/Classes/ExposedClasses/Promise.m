@@ -20,25 +20,79 @@
 //
 
 #import "Promise.h"
+#import "CKTHistogram.h"
+#import "CKTRequestTracer.h"
 #import "Log.h"
 #import "JSEngine.h"
 
+#import <os/lock.h>
+#import <stdatomic.h>
+
+NSString *const kPromiseResolutions = @"resolutions";
+NSString *const kPromiseRejections = @"rejections";
+NSString *const kPromiseResolutionsPerSecond = @"resolutionsPerSecond";
+NSString *const kPromiseCallbacks = @"callbacks";
+NSString *const kPromiseDrains = @"drains";
+NSString *const kPromiseMaxCallbacksPerDrain = @"maxCallbacksPerDrain";
+NSString *const kPromiseDrainTime = @"drainTime";
+
+// Promises whose callbacks are due, only accessed on the JS thread
+static NSMutableArray<Promise *> *pendingPromises;
+static BOOL drainScheduled;
+
+// Promises with native callbacks which have not been called yet, protected by @synchronized on the table
+static NSHashTable<Promise *> *waitingPromises;
+
+static atomic_uint_fast64_t resolutions;
+static atomic_uint_fast64_t rejections;
+
+// Protects the drain statistics below
+static os_unfair_lock statisticsLock = OS_UNFAIR_LOCK_INIT;
+static uint64_t statisticsStart;
+static uint64_t callbacks;
+static uint64_t drains;
+static uint64_t maxCallbacksPerDrain;
+static CKTHistogram *drainTime;
+
+static Class NSBlockClass;
+
+// Callbacks registered by one then::, catch: or addSuccessCallback:errorCallback:
+@interface PromiseReaction : NSObject
+
+// For some reason NSBlock objects from native code are not reachable through the Objective-C or Swift object graph
+// using JSManagedValue wrapper. And as a result they can be released by JavaScript garbage collector at any point
+// of time. So for this just store such object as is since it doesn't create a retain cycle, keeping the JS context
+// from being deallocated.
+@property (nonatomic, strong) id successCallback;
+@property (nonatomic, strong) id errorCallback;
+
+// The callbacks were registered natively and are PromiseCallback blocks to be called directly
+@property (nonatomic, assign) BOOL native;
+
+// Only created by then:: and catch: called from JavaScript
+@property (nonatomic, strong) Promise *chainedPromise;
+
+@end
+
+@implementation PromiseReaction
+
+@end
+
 @interface Promise () {
+    // Protects the state below, callbacks are never called while holding it
+    os_unfair_lock _lock;
+
     // Note: There will either be a valid pointer or nil for these values i.e., no NSNull or undefined
     // as can be the case with JSValues received from JavaScript.
     JSManagedValue *_data;
 
-    // For some reason NSBlock objects from native code are not reachable through the Objective-C or Swift object graph
-    // using JSManagedValue wrapper. And as a result they can be released by JavaScript garbage collector at any point
-    // of time. So for this just store such object as is since it doesn't create a retain cycle, keeping the JS context
-    // from being deallocated.
-    id _successCallback;
-    id _errorCallback;
-
-    Promise *_chainedPromise;
+    // Reactions not called yet, in the order they were registered
+    NSMutableArray<PromiseReaction *> *_reactions;
 }
 
 @property (nonatomic, assign) BOOL asynchronous;
+@property (nonatomic, assign) BOOL cancelled;
+@property (nonatomic, assign) BOOL callbacksScheduled;
 
 - (void)resolve:(JSValue *)data;
 - (void)reject:(JSValue *)data;
@@ -49,9 +103,22 @@
 
 static NSString *LOG_TAG = @"[Promise]";
 
++ (void)initialize
+{
+    if (self == [Promise class]) {
+        NSBlockClass = NSClassFromString(@"NSBlock");
+        pendingPromises = [NSMutableArray array];
+        waitingPromises = [NSHashTable weakObjectsHashTable];
+        drainTime = [[CKTHistogram alloc] init];
+        statisticsStart = CKTMonotonicMicroseconds();
+    }
+}
+
 - (instancetype)init
 {
     if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _reactions = [NSMutableArray array];
         self.resolved = NO;
         self.rejected = NO;
         self.asynchronous = NO;
@@ -59,114 +126,379 @@ static NSString *LOG_TAG = @"[Promise]";
     return self;
 }
 
+- (void)dealloc
+{
+    [self releaseReactions:_reactions];
+    [self clearJSReferences];
+}
+
 - (Promise *)then: (JSValue *)successCallback :(JSValue *)errorCallback
 {
-    @synchronized(self)
-    {
-        _chainedPromise = [[Promise alloc] init];
-
-        if (self.resolved) {
-            [self invokeSuccessCallback:successCallback];
-        } else if (self.rejected) {
-            [self invokeErrorCallback:errorCallback];
-        } else {
-            // Store the callbacks to be called at a later time.
-            if ([[successCallback toObject] isKindOfClass:NSClassFromString(@"NSBlock")]) {
-                // We deal with ObjC block as callback so just store it inside promise object.
-                _successCallback = [successCallback toObject];
-            } else if (![successCallback isNull] && ![successCallback isUndefined]) {
-                // We deal with JS function so we shoud use managed value to store this callback inside
-                // promise object.
-                _successCallback = [JSManagedValue managedValueWithValue:successCallback];
-                [[JSEngine sharedInstance] addManagedReference:_successCallback];
-            }
-
-            if ([[errorCallback toObject] isKindOfClass:NSClassFromString(@"NSBlock")]) {
-                // We deal with ObjC block as callback so just store it inside promise object.
-                _errorCallback = [errorCallback toObject];
-            } else if (![errorCallback isNull] && ![errorCallback isUndefined] && errorCallback) {
-                // We deal with JS function so we shoud use managed value to store this callback inside
-                // promise object.
-                _errorCallback = [JSManagedValue managedValueWithValue:errorCallback];
-                [[JSEngine sharedInstance] addManagedReference:_errorCallback];
-            }
-
-            self.asynchronous = YES;
-        }
+    Promise *chainedPromise = [[Promise alloc] init];
 
-        return _chainedPromise;
-    }
+    // Converted outside of the lock, toObject may call back into JavaScript
+    id success = [self storableCallback:successCallback];
+    id error = [self storableCallback:errorCallback];
+
+    [self registerCallbacks:success errorCallback:error native:NO chainedPromise:chainedPromise];
+    return chainedPromise;
 }
 
 - (Promise *) catch:(JSValue *)errorCallback
 {
-    @synchronized(self)
-    {
-        _chainedPromise = [[Promise alloc] init];
-
-        if (self.resolved) {
-            // Simply resolve the chained promise
-            [_chainedPromise resolve:_data ? _data.value : nil];
-        } else if (self.rejected) {
-            [self invokeErrorCallback:errorCallback];
-        } else {
-            // Store the error callback to be called at a later time
-            if ([[errorCallback toObject] isKindOfClass:NSClassFromString(@"NSBlock")]) {
-                // We deal with ObjC block as callback so just store it inside promise object.
-                _errorCallback = [errorCallback toObject];
-            } else if (![errorCallback isNull] && ![errorCallback isUndefined] && errorCallback) {
-                // We deal with JS function so we shoud use managed value to store this callback inside
-                // promise object.
-                _errorCallback = [JSManagedValue managedValueWithValue:errorCallback];
-                [[JSEngine sharedInstance] addManagedReference:_errorCallback];
-            }
-            self.asynchronous = YES;
-        }
+    Promise *chainedPromise = [[Promise alloc] init];
+
+    // Without a success callback the chained promise is simply resolved with our data
+    [self registerCallbacks:nil
+              errorCallback:[self storableCallback:errorCallback]
+                     native:NO
+             chainedPromise:chainedPromise];
+    return chainedPromise;
+}
+
+- (void)addSuccessCallback:(PromiseCallback)successCallback errorCallback:(PromiseCallback)errorCallback
+{
+    [self registerCallbacks:[successCallback copy] errorCallback:[errorCallback copy] native:YES chainedPromise:nil];
+}
 
-        return _chainedPromise;
+- (void)cancel
+{
+    // Also possible once settled, as long as the callbacks are still queued
+    os_unfair_lock_lock(&_lock);
+    if (self.cancelled) {
+        os_unfair_lock_unlock(&_lock);
+        return;
     }
+    self.cancelled = YES;
+    NSArray<PromiseReaction *> *reactions = [self takeReactions];
+    os_unfair_lock_unlock(&_lock);
+
+    LOGD(LOG_TAG, @"Cancelling promise (%p)", self);
+    [Promise stopWaitingFor:self];
+    [self releaseReactions:reactions];
+    [self clearJSReferences];
 }
 
 - (void)resolve:(JSValue *)data
 {
-    @synchronized(self)
+    [self settleWithData:data rejected:NO];
+}
+
+- (void)reject:(JSValue *)data
+{
+    LOGE(LOG_TAG, @"Rejecting promise (%p), asynchronous (%d)", self, self.asynchronous);
+    [self settleWithData:data rejected:YES];
+}
+
+#pragma mark - Statistics
+
++ (NSDictionary *)statistics
+{
+    uint64_t resolved = atomic_load_explicit(&resolutions, memory_order_relaxed);
+    uint64_t rejected = atomic_load_explicit(&rejections, memory_order_relaxed);
+
+    os_unfair_lock_lock(&statisticsLock);
+    double seconds = (CKTMonotonicMicroseconds() - statisticsStart) / (double)USEC_PER_SEC;
+    NSDictionary *statistics = @{
+        kPromiseResolutions : @(resolved),
+        kPromiseRejections : @(rejected),
+        kPromiseResolutionsPerSecond : @(seconds > 0 ? (resolved + rejected) / seconds : 0),
+        kPromiseCallbacks : @(callbacks),
+        kPromiseDrains : @(drains),
+        kPromiseMaxCallbacksPerDrain : @(maxCallbacksPerDrain),
+        kPromiseDrainTime : [drainTime dictionaryRepresentation]
+    };
+    os_unfair_lock_unlock(&statisticsLock);
+
+    return statistics;
+}
+
++ (void)resetStatistics
+{
+    atomic_store(&resolutions, 0);
+    atomic_store(&rejections, 0);
+
+    os_unfair_lock_lock(&statisticsLock);
+    statisticsStart = CKTMonotonicMicroseconds();
+    callbacks = 0;
+    drains = 0;
+    maxCallbacksPerDrain = 0;
+    [drainTime reset];
+    os_unfair_lock_unlock(&statisticsLock);
+}
+
++ (void)discardPendingCallbacks
+{
+    NSArray<Promise *> *waiting;
+    @synchronized(waitingPromises)
     {
-        [self setData:data];
-        self.resolved = YES;
-        if (self.asynchronous) {
-            JSValue *successCallback;
-            if ([_successCallback isKindOfClass:NSClassFromString(@"NSBlock")]) {
-                successCallback =
-                    [JSValue valueWithObject:_successCallback inContext:[JSEngine sharedInstance].context];
-            } else {
-                successCallback = _successCallback ? [(JSManagedValue *)_successCallback value] : nil;
-            }
-            [self invokeSuccessCallback:successCallback];
+        waiting = waitingPromises.allObjects;
+        [waitingPromises removeAllObjects];
+    }
+
+    NSArray<Promise *> *queued = [pendingPromises copy];
+    [pendingPromises removeAllObjects];
+    drainScheduled = NO;
+
+    LOGI(LOG_TAG, @"discardPendingCallbacks - %lu promises waited for, %lu with queued callbacks",
+         (unsigned long)waiting.count, (unsigned long)queued.count);
+
+    JSContext *context = [JSEngine sharedInstance].context;
+    JSValue *error = [JSValue valueWithNewErrorFromMessage:@"The JS environment has been reset" inContext:context];
+    for (Promise *promise in waiting) {
+        [promise discardWithError:error];
+    }
+    for (Promise *promise in queued) {
+        [promise discardWithError:error];
+    }
+}
+
+#pragma mark - internal functions
+
+// Returns what is to be stored for the given JavaScript callback: the block itself for an ObjC block, a managed
+// value for a JS function, nil for null or undefined
+- (id)storableCallback:(JSValue *)callback
+{
+    if (!callback || [callback isNull] || [callback isUndefined]) {
+        return nil;
+    }
+
+    id object = [callback toObject];
+    if ([object isKindOfClass:NSBlockClass]) {
+        // We deal with ObjC block as callback so just store it inside promise object.
+        return object;
+    }
+
+    // We deal with JS function so we shoud use managed value to store this callback inside promise object.
+    JSManagedValue *managedCallback = [JSManagedValue managedValueWithValue:callback];
+    [[JSEngine sharedInstance] addManagedReference:managedCallback];
+    return managedCallback;
+}
+
+- (void)registerCallbacks:(id)successCallback
+            errorCallback:(id)errorCallback
+                   native:(BOOL)native
+           chainedPromise:(Promise *)chainedPromise
+{
+    PromiseReaction *reaction = [[PromiseReaction alloc] init];
+    reaction.successCallback = successCallback;
+    reaction.errorCallback = errorCallback;
+    reaction.native = native;
+    reaction.chainedPromise = chainedPromise;
+
+    os_unfair_lock_lock(&_lock);
+
+    if (self.cancelled) {
+        // Neither settled nor calling back anymore
+        os_unfair_lock_unlock(&_lock);
+        [self releaseReactions:@[ reaction ]];
+        return;
+    }
+
+    [_reactions addObject:reaction];
+    self.asynchronous = YES;
+    if (native) {
+        @synchronized(waitingPromises)
+        {
+            [waitingPromises addObject:self];
         }
     }
+
+    BOOL schedule = (self.resolved || self.rejected) && !self.callbacksScheduled;
+    if (schedule) {
+        self.callbacksScheduled = YES;
+    }
+
+    os_unfair_lock_unlock(&_lock);
+
+    if (schedule) {
+        [Promise scheduleCallbacksOf:self];
+    }
 }
 
-- (void)reject:(JSValue *)data
+- (void)settleWithData:(JSValue *)data rejected:(BOOL)rejected
 {
-    @synchronized(self)
-    {
-        LOGE(LOG_TAG, @"Rejecting promise (%p), asynchronous (%d)", self, self.asynchronous);
+    [self.trace stamp:CKTTracePointResolved];
+
+    os_unfair_lock_lock(&_lock);
 
-        [self setData:data];
+    // A promise settles only once, nobody is interested anymore in the result of a cancelled one
+    if (self.cancelled || self.resolved || self.rejected) {
+        os_unfair_lock_unlock(&_lock);
+        return;
+    }
+
+    [self setData:data];
+    if (rejected) {
         self.rejected = YES;
-        if (self.asynchronous) {
-            JSValue *errorCallback;
-            if ([_errorCallback isKindOfClass:NSClassFromString(@"NSBlock")]) {
-                errorCallback = [JSValue valueWithObject:_errorCallback inContext:[JSEngine sharedInstance].context];
-            } else {
-                errorCallback = _errorCallback ? [(JSManagedValue *)_errorCallback value] : nil;
-            }
-            [self invokeErrorCallback:errorCallback];
+    } else {
+        self.resolved = YES;
+    }
+
+    BOOL schedule = self.asynchronous && !self.callbacksScheduled;
+    if (schedule) {
+        self.callbacksScheduled = YES;
+    }
+
+    os_unfair_lock_unlock(&_lock);
+
+    atomic_fetch_add_explicit(rejected ? &rejections : &resolutions, 1, memory_order_relaxed);
+
+    if (schedule) {
+        [Promise scheduleCallbacksOf:self];
+    }
+}
+
++ (void)scheduleCallbacksOf:(Promise *)promise
+{
+    JSRunLoop *jsThread = [JSEngine sharedInstance].jsThread;
+    if ([NSThread currentThread] != jsThread) {
+        // Not settled by JavaScript, e.g. while the engine is being torn down
+        [promise invokeCallbacks];
+        return;
+    }
+
+    [pendingPromises addObject:promise];
+    if (!drainScheduled) {
+        drainScheduled = YES;
+        [jsThread.taskQueue addTask:^{ [Promise drainPendingCallbacks]; }
+                           priority:JSTaskPriorityUserInteractive
+                              label:"Promise"];
+    }
+}
+
++ (void)drainPendingCallbacks
+{
+    uint64_t start = CKTMonotonicMicroseconds();
+
+    // Promises settled by the callbacks are appended and handled by this loop instead of recursively
+    NSUInteger count = 0;
+    for (; count < pendingPromises.count; count++) {
+        @autoreleasepool
+        {
+            [pendingPromises[count] invokeCallbacks];
         }
     }
+    [pendingPromises removeAllObjects];
+    drainScheduled = NO;
+
+    os_unfair_lock_lock(&statisticsLock);
+    callbacks += count;
+    drains++;
+    maxCallbacksPerDrain = MAX(maxCallbacksPerDrain, count);
+    [drainTime recordValue:CKTMonotonicMicroseconds() - start];
+    os_unfair_lock_unlock(&statisticsLock);
 }
 
-#pragma mark - internal functions
+- (void)invokeCallbacks
+{
+    os_unfair_lock_lock(&_lock);
+    self.callbacksScheduled = NO;
+    if (self.cancelled) {
+        os_unfair_lock_unlock(&_lock);
+        return;
+    }
+    BOOL rejected = self.rejected;
+    NSArray<PromiseReaction *> *reactions = [self takeReactions];
+    os_unfair_lock_unlock(&_lock);
+
+    if (rejected) {
+        LOGE(LOG_TAG, @"Promise (%p) has been rejected", self);
+    }
+
+    [Promise stopWaitingFor:self];
+
+    // The data is kept for reactions registered later on, it is released with the promise
+    for (PromiseReaction *reaction in reactions) {
+        [self invokeReaction:reaction rejected:rejected];
+    }
+    [self releaseReactions:reactions];
+}
+
+- (void)invokeReaction:(PromiseReaction *)reaction rejected:(BOOL)rejected
+{
+    id callback = rejected ? reaction.errorCallback : reaction.successCallback;
+
+    if (reaction.native) {
+        // Native callbacks do not return anything, there is no chained promise to settle
+        if (callback && ![[JSEngine sharedInstance].jsThread isCancelled]) {
+            ((PromiseCallback)callback)([self dataValue]);
+        }
+        return;
+    }
+
+    JSValue *jsCallback;
+    if ([callback isKindOfClass:NSBlockClass]) {
+        jsCallback = [JSValue valueWithObject:callback inContext:[JSEngine sharedInstance].context];
+    } else {
+        jsCallback = callback ? [(JSManagedValue *)callback value] : nil;
+    }
+
+    if (jsCallback && ![jsCallback isNull] && ![jsCallback isUndefined] &&
+        ![[JSEngine sharedInstance].jsThread isCancelled]) {
+        [self invokeRegisteredCallback:jsCallback chainedPromise:reaction.chainedPromise];
+    } else if (rejected) {
+        // We don't have an error callback registered. Simply reject the chained promise.
+        [reaction.chainedPromise reject:_data ? _data.value : nil];
+    } else {
+        // We don't have a success callback registered. Simply resolve the chained promise.
+        [reaction.chainedPromise resolve:_data ? _data.value : nil];
+    }
+}
+
+// Settles nothing anymore. Native error callbacks are called with the error, JavaScript callbacks belong to the
+// discarded session and are only released.
+- (void)discardWithError:(JSValue *)error
+{
+    os_unfair_lock_lock(&_lock);
+    if (self.cancelled) {
+        os_unfair_lock_unlock(&_lock);
+        return;
+    }
+    self.cancelled = YES;
+    NSArray<PromiseReaction *> *reactions = [self takeReactions];
+    os_unfair_lock_unlock(&_lock);
+
+    for (PromiseReaction *reaction in reactions) {
+        if (reaction.native && reaction.errorCallback) {
+            ((PromiseCallback)reaction.errorCallback)(error);
+        }
+    }
+    [self releaseReactions:reactions];
+    [self clearJSReferences];
+}
+
++ (void)stopWaitingFor:(Promise *)promise
+{
+    @synchronized(waitingPromises)
+    {
+        [waitingPromises removeObject:promise];
+    }
+}
+
+// Must be called with the lock held
+- (NSArray<PromiseReaction *> *)takeReactions
+{
+    NSArray<PromiseReaction *> *reactions = _reactions;
+    _reactions = [NSMutableArray array];
+    return reactions;
+}
+
+- (void)releaseReactions:(NSArray<PromiseReaction *> *)reactions
+{
+    for (PromiseReaction *reaction in reactions) {
+        [self releaseCallback:reaction.successCallback];
+        [self releaseCallback:reaction.errorCallback];
+        reaction.successCallback = nil;
+        reaction.errorCallback = nil;
+    }
+}
+
+- (JSValue *)dataValue
+{
+    JSValue *value = _data ? _data.value : nil;
+    return value ? value : [JSValue valueWithNullInContext:[JSEngine sharedInstance].context];
+}
 
 - (void)setData:(JSValue *)value
 {
@@ -178,22 +510,20 @@ static NSString *LOG_TAG = @"[Promise]";
     }
 }
 
+- (void)releaseCallback:(id)callback
+{
+    if ([callback isKindOfClass:[JSManagedValue class]]) {
+        [[JSEngine sharedInstance] removeManagedReference:callback];
+    }
+}
+
 - (void)clearJSReferences
 {
-    // Clear all references to JS variables
+    // Clear all references to JS variables, the callbacks are released with their reactions
     if (_data) {
         [[JSEngine sharedInstance] removeManagedReference:_data];
         _data = nil;
     }
-
-    if ([_successCallback isKindOfClass:[JSManagedValue class]]) {
-        [[JSEngine sharedInstance] removeManagedReference:_successCallback];
-        _successCallback = nil;
-    }
-    if ([_errorCallback isKindOfClass:[JSManagedValue class]]) {
-        [[JSEngine sharedInstance] removeManagedReference:_errorCallback];
-        _errorCallback = nil;
-    }
 }
 
 /**
@@ -202,16 +532,21 @@ static NSString *LOG_TAG = @"[Promise]";
 
  - parameters:
  - callback: The JavaScript function to be invoked. Can not be nil, NSNull or undefined!
+ - chainedPromise: The promise returned by the then/catch which registered the callback, settled with its result.
  */
-- (void)invokeRegisteredCallback:(JSValue *)callback
+- (void)invokeRegisteredCallback:(JSValue *)callback chainedPromise:(Promise *)chainedPromise
 {
-    JSValue *arg = _data ? _data.value : [JSValue valueWithNullInContext:[JSEngine sharedInstance].context];
+    JSValue *arg = [self dataValue];
     if (arg == NULL) {
         LOGE(LOG_TAG, @"invokeRegisteredCallback - error during callback");
         return;
     }
 
     JSValue *cbResult = [callback callWithArguments:@[ arg ]];
+    if (!chainedPromise) {
+        return;
+    }
+
     NSObject *resultObj = [cbResult toObject];
     if ([resultObj isKindOfClass:[NSDictionary class]] && ((NSDictionary *)resultObj)[@"__nativePromise"]) {
         resultObj = ((NSDictionary *)resultObj)[@"__nativePromise"];
@@ -221,57 +556,14 @@ static NSString *LOG_TAG = @"[Promise]";
         Promise *returnedPromise = (Promise *)resultObj;
         // Wait for the returned promise to be resolved/rejected before
         // resolving/rejecting the chained promise.
-        [returnedPromise then:[JSValue valueWithObject:^(JSValue *newData) { [self->_chainedPromise resolve:newData]; }
-                                             inContext:[JSEngine sharedInstance].context
-                               ]:[JSValue valueWithObject:^(JSValue *error) { [self->_chainedPromise reject:error]; }
-                                   inContext:[JSEngine sharedInstance].context]];
+        [returnedPromise addSuccessCallback:^(JSValue *newData) { [chainedPromise resolve:newData]; }
+                              errorCallback:^(JSValue *error) { [chainedPromise reject:error]; }];
     } else {
         // The callback returned a simple object
-        [_chainedPromise resolve:cbResult];
+        [chainedPromise resolve:cbResult];
     }
 }
 
-/**
- Invokes the given JavaScript success callback if present. Called both internally and directly from
- JavaScript via the exported interface.
-
- - parameters:
- - callback: The JavaScript function to be invoked. May be nil if called internally or NSNull or
- undefined when called directly from JavaScript.
- */
-- (void)invokeSuccessCallback:(JSValue *)callback
-{
-    if (callback && ![callback isNull] && ![callback isUndefined] &&
-        ![[JSEngine sharedInstance].jsThread isCancelled]) {
-        [self invokeRegisteredCallback:callback];
-    } else {
-        // We don't have a success callback registered. Simply resolve the chained promise.
-        [_chainedPromise resolve:_data ? _data.value : nil];
-    }
-    [self clearJSReferences];
-}
-
-/**
- Invokes the given JavaScript error callback if present. Called both internally and directly from
- JavaScript via the exported interface.
-
- - parameters:
- - callback: The JavaScript function to be invoked. May be nil if called internally or NSNull or
- undefined when called directly from JavaScript.
- */
-- (void)invokeErrorCallback:(JSValue *)callback
-{
-    LOGE(LOG_TAG, @"Promise (%p) has been rejected", self);
-    if (callback && ![callback isNull] && ![callback isUndefined] &&
-        ![[JSEngine sharedInstance].jsThread isCancelled]) {
-        [self invokeRegisteredCallback:callback];
-    } else {
-        // We don't have an error callback registered. Simply reject the chained promise.
-        [_chainedPromise reject:_data ? _data.value : nil];
-    }
-    [self clearJSReferences];
-}
-
 @end
 
 @implementation Defer
@@ -0,0 +1,53 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  WebSocketConnectionManager.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class SRWebSocket;
+@class WebSocketManager;
+
+// Owns the resources shared by all WebSocketManager instances (api and /prototype sockets):
+// - a single serial queue on which SocketRocket delivers the delegate callbacks of every socket.
+//   The sockets' streams themselves are all scheduled on SocketRocket's one network thread.
+// - the URL request template and cookie snapshot used to open sockets, refreshed only when the
+//   shared cookie storage changes. TLS session resumption is keyed by host/port by the system,
+//   so sockets to the same server reuse each others sessions.
+// - one batched queue per target thread through which the socket callbacks are delivered, so that a
+//   burst of frames from several sockets costs a single thread wakeup. Callbacks for the JS thread
+//   go through its JSTaskQueue with JSTaskPriorityCallSignaling.
+@interface WebSocketConnectionManager : NSObject
+
+@property (nonatomic, readonly) dispatch_queue_t delegateQueue;
+
++ (WebSocketConnectionManager *)sharedInstance;
+
+// Creates a SocketRocket socket for the given URL, configured to use the shared resources
+- (SRWebSocket *)createSocketWithURL:(NSString *)url;
+
+// Sockets are tracked weakly, there is no need to unregister them
+- (void)registerSocket:(WebSocketManager *)socket;
+- (NSUInteger)numberOfSockets;
+
+// Queues the block to be executed on the given thread. Blocks queued before the thread got to
+// drain the queue are executed in FIFO order in the same run loop iteration.
+- (void)performBlock:(dispatch_block_t)block onThread:(NSThread *)thread;
+
+@end
@@ -0,0 +1,183 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  WebSocketConnectionManager.m
+//  CircuitSDK
+//
+//
+
+#import "WebSocketConnectionManager.h"
+
+#import "CKTHttp.h"
+#import "JSRunLoop.h"
+#import "JSTaskQueue.h"
+#import "Log.h"
+#import "SocketRocket/SRWebSocket.h"
+
+static const double ANSSocketConnectionTimeout = 30.0;
+
+@interface WebSocketConnectionManager ()
+
+@property (nonatomic, strong) NSHashTable<WebSocketManager *> *sockets;
+// Weak keys, a thread which exits before draining its blocks is not kept alive by them
+@property (nonatomic, strong) NSMapTable<NSThread *, NSMutableArray *> *pendingBlocks;
+@property (nonatomic, strong) NSArray<NSHTTPCookie *> *cookies;
+
+@end
+
+@implementation WebSocketConnectionManager
+
+static NSString *LOG_TAG = @"[WebSocketConnectionManager]";
+
++ (WebSocketConnectionManager *)sharedInstance
+{
+    static WebSocketConnectionManager *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[WebSocketConnectionManager alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _delegateQueue = dispatch_queue_create("com.unify.circuitsdk.websocket", DISPATCH_QUEUE_SERIAL);
+        _sockets = [NSHashTable weakObjectsHashTable];
+        _pendingBlocks = [NSMapTable weakToStrongObjectsMapTable];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(cookiesChanged:)
+                                                     name:NSHTTPCookieManagerCookiesChangedNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark - Sockets
+
+- (SRWebSocket *)createSocketWithURL:(NSString *)url
+{
+    NSURL *socketURL = [NSURL URLWithString:url];
+    NSMutableURLRequest *urlRequest = [NSMutableURLRequest requestWithURL:socketURL
+                                                              cachePolicy:NSURLRequestUseProtocolCachePolicy
+                                                          timeoutInterval:ANSSocketConnectionTimeout];
+
+    urlRequest.networkServiceType = NSURLNetworkServiceTypeVoIP;
+
+    NSString *userAgent = [CKTHttp userAgent];
+    [urlRequest setValue:userAgent forHTTPHeaderField:@"User-Agent"];
+
+    SRWebSocket *srWebSocket =
+        [[SRWebSocket alloc] initWithURLRequest:urlRequest protocols:nil allowsUntrustedSSLCertificates:YES];
+    srWebSocket.requestCookies = [self requestCookies];
+    [srWebSocket setDelegateDispatchQueue:self.delegateQueue];
+
+    return srWebSocket;
+}
+
+- (void)registerSocket:(WebSocketManager *)socket
+{
+    @synchronized(self)
+    {
+        [self.sockets addObject:socket];
+        LOGD(LOG_TAG, @"registerSocket - %p, number of sockets = %lu", socket, (unsigned long)self.sockets.count);
+    }
+}
+
+- (NSUInteger)numberOfSockets
+{
+    @synchronized(self)
+    {
+        return self.sockets.allObjects.count;
+    }
+}
+
+#pragma mark - Batched delivery
+
+- (void)performBlock:(dispatch_block_t)block onThread:(NSThread *)thread
+{
+    if (!block || !thread) {
+        return;
+    }
+
+    // The JS thread has its own queue with the same batching
+    if ([thread isKindOfClass:[JSRunLoop class]]) {
+        [((JSRunLoop *)thread).taskQueue addTask:block priority:JSTaskPriorityCallSignaling label:"WebSocket"];
+        return;
+    }
+
+    BOOL wakeUp = NO;
+
+    @synchronized(self)
+    {
+        NSMutableArray *blocks = [self.pendingBlocks objectForKey:thread];
+        if (!blocks) {
+            blocks = [NSMutableArray array];
+            [self.pendingBlocks setObject:blocks forKey:thread];
+        }
+
+        // Only the first block of a batch needs to wake up the thread
+        wakeUp = (blocks.count == 0);
+        [blocks addObject:[block copy]];
+    }
+
+    if (wakeUp) {
+        [self performSelector:@selector(drainPendingBlocks) onThread:thread withObject:nil waitUntilDone:NO];
+    }
+}
+
+- (void)drainPendingBlocks
+{
+    NSThread *thread = [NSThread currentThread];
+    NSArray *blocks;
+
+    @synchronized(self)
+    {
+        blocks = [self.pendingBlocks objectForKey:thread];
+        [self.pendingBlocks removeObjectForKey:thread];
+    }
+
+    for (dispatch_block_t block in blocks) {
+        block();
+    }
+}
+
+#pragma mark - internal functions
+
+- (NSArray<NSHTTPCookie *> *)requestCookies
+{
+    @synchronized(self)
+    {
+        if (!self.cookies) {
+            self.cookies = [NSHTTPCookieStorage sharedHTTPCookieStorage].cookies;
+        }
+        return self.cookies;
+    }
+}
+
+- (void)cookiesChanged:(NSNotification *)notification
+{
+    @synchronized(self)
+    {
+        self.cookies = nil;
+    }
+}
+
+@end
@@ -20,12 +20,13 @@
 
 #import "WebSocketManager.h"
 
-#import "CKTHttp.h"
+#import "CKTRequestTracer.h"
 #import "JSEngine.h"
+#import "JSThreadWatchdog.h"
 #import "Log.h"
 #import "SocketRocket/SRWebSocket.h"
+#import "WebSocketConnectionManager.h"
 
-static const double ANSSocketConnectionTimeout = 30.0;
 static const double ANSSocketPingTimeout = 5.0;
 static const int ANSPongFailuresCountMax = 3;
 
@@ -116,7 +117,10 @@ static WebSocketManager *currentSocket;
 
         [self allocWebSocket];
 
+        // All JS callbacks are delivered on the thread the socket was created on (the JS thread)
         self.myThread = [NSThread currentThread];
+
+        [[WebSocketConnectionManager sharedInstance] registerSocket:self];
     }
 
     return self;
@@ -211,6 +215,8 @@ static WebSocketManager *currentSocket;
     // LOGD(LOG_TAG, @"send - message= %@",json);
 
     [self updateStatistics:YES numberOfBytes:json.length];
+    [[CKTRequestTracer sharedInstance] socketWillSendMessage:json];
+    [[JSThreadWatchdog sharedInstance] jsDidCallOut];
 
     LOGD(LOG_TAG, @"send - send WebSocket message");
     if (self.srWebSocket)
@@ -231,13 +237,11 @@ static WebSocketManager *currentSocket;
         _waitingForPong = YES;
         [self.srWebSocket sendPing:nil];
 
+        WebSocketConnectionManager *connectionManager = [WebSocketConnectionManager sharedInstance];
         dispatch_time_t popTime = dispatch_time(DISPATCH_TIME_NOW, ANSSocketPingTimeout * NSEC_PER_SEC);
-        dispatch_after(popTime, dispatch_get_main_queue(), ^(void) {
+        dispatch_after(popTime, connectionManager.delegateQueue, ^(void) {
             if (self->_waitingForPong) {
-                [self performSelector:@selector(callOnPingTimeout)
-                             onThread:self.myThread
-                           withObject:nil
-                        waitUntilDone:NO];
+                [connectionManager performBlock:^{ [self callOnPingTimeout]; } onThread:self.myThread];
             }
         });
     } else {
@@ -285,6 +289,7 @@ static WebSocketManager *currentSocket;
     LOGD(LOG_TAG, @"[%p] callOnMessage", self);
 
     [self updateStatistics:NO numberOfBytes:message.length];
+    [[CKTRequestTracer sharedInstance] socketDidReceiveMessage:message];
 
     NSDictionary *dict = @{
         @"size" : [NSNumber numberWithInteger:message.length],
@@ -304,22 +309,25 @@ static WebSocketManager *currentSocket;
 
     if (self.outstandingPongResponses >= ANSPongFailuresCountMax) {
         LOGE(LOG_TAG, @"Closing socket - ping timeout counter threshold exceeded");
-        [self performSelector:@selector(close) onThread:self.myThread withObject:nil waitUntilDone:NO];
+        [self close];
     }
 }
 
 #pragma mark - SRWebSocketDelegate call backs
 
+// The delegate callbacks are received on the shared WebSocketConnectionManager queue and forwarded in batches
+// to the thread the socket was created on.
+
 // message will either be an NSString if the server is using text
 // or NSData if the server is using binary.
 - (void)webSocket:(SRWebSocket *)webSocket didReceiveMessage:(id)message
 {
-    [self performSelector:@selector(callOnMessage:) onThread:self.myThread withObject:message waitUntilDone:NO];
+    [self performOnMyThread:^{ [self callOnMessage:message]; }];
 }
 
 - (void)webSocketDidOpen:(SRWebSocket *)webSocket
 {
-    [self performSelector:@selector(callOnOpen) onThread:self.myThread withObject:nil waitUntilDone:NO];
+    [self performOnMyThread:^{ [self callOnOpen]; }];
 }
 
 - (void)webSocket:(SRWebSocket *)webSocket didFailWithError:(NSError *)error
@@ -337,16 +345,15 @@ static WebSocketManager *currentSocket;
         // we need socket immediately.
         // Server side components unavailablity is seen with 503, 504 responses. An immediate retry would
         // less likely to establish socket. These errors are propagated to application layer run retry logic
-        [self performSelector:@selector(retryConnectionAfter500Error)
-                     onThread:self.myThread
-                   withObject:nil
-                waitUntilDone:NO];
+        [self performOnMyThread:^{ [self retryConnectionAfter500Error]; }];
     } else {
-        [self performSelector:@selector(callOnError) onThread:self.myThread withObject:nil waitUntilDone:NO];
+        [self performOnMyThread:^{
+            [self callOnError];
 
-        self.srWebSocket.delegate = nil;
-        self.srWebSocket = nil;
-        [self clearJSReferences];
+            self.srWebSocket.delegate = nil;
+            self.srWebSocket = nil;
+            [self clearJSReferences];
+        }];
     }
 }
 
@@ -359,11 +366,10 @@ static WebSocketManager *currentSocket;
 
     LOGI(LOG_TAG, @"webSocket:didCloseWithCode - code:%d reason:%@ clean:%d", code, reason, wasClean);
 
-    [self performSelector:@selector(callOnClose) onThread:self.myThread withObject:nil waitUntilDone:NO];
-
-    self.srWebSocket.delegate = nil;
-    self.srWebSocket = nil;
-    [self clearJSReferences];
+    [self performOnMyThread:^{
+        self.srWebSocket.delegate = nil;
+        [self callOnClose];
+    }];
 }
 
 - (void)webSocket:(SRWebSocket *)webSocket didReceivePong:(NSData *)pongPayload
@@ -383,22 +389,15 @@ static WebSocketManager *currentSocket;
 
 - (void)allocWebSocket
 {
-    NSURL *socketURL = [NSURL URLWithString:_url];
-    NSMutableURLRequest *urlRequest = [NSMutableURLRequest requestWithURL:socketURL
-                                                              cachePolicy:NSURLRequestUseProtocolCachePolicy
-                                                          timeoutInterval:ANSSocketConnectionTimeout];
-
-    urlRequest.networkServiceType = NSURLNetworkServiceTypeVoIP;
-
-    NSString *userAgent = [CKTHttp userAgent];
-    [urlRequest setValue:userAgent forHTTPHeaderField:@"User-Agent"];
-
-    self.srWebSocket =
-        [[SRWebSocket alloc] initWithURLRequest:urlRequest protocols:nil allowsUntrustedSSLCertificates:YES];
-    self.srWebSocket.requestCookies = [NSHTTPCookieStorage sharedHTTPCookieStorage].cookies;
+    self.srWebSocket = [[WebSocketConnectionManager sharedInstance] createSocketWithURL:_url];
     self.srWebSocket.delegate = self;
 }
 
+- (void)performOnMyThread:(dispatch_block_t)block
+{
+    [[WebSocketConnectionManager sharedInstance] performBlock:block onThread:self.myThread];
+}
+
 // retry logic is coded for SocketRocket only. WebSocket++ sockets will not be retried
 - (void)retryConnectionAfter500Error
 {
@@ -459,13 +458,16 @@ static WebSocketManager *currentSocket;
     if (_onopenCallback) {
         [[JSEngine sharedInstance] removeManagedReference:_onopenCallback];
         _onopenCallback = nil;
-    } else if (_oncloseCallback) {
+    }
+    if (_oncloseCallback) {
         [[JSEngine sharedInstance] removeManagedReference:_oncloseCallback];
         _oncloseCallback = nil;
-    } else if (_onmessageCallback) {
+    }
+    if (_onmessageCallback) {
         [[JSEngine sharedInstance] removeManagedReference:_onmessageCallback];
         _onmessageCallback = nil;
-    } else if (_onerrorCallback) {
+    }
+    if (_onerrorCallback) {
         [[JSEngine sharedInstance] removeManagedReference:_onerrorCallback];
         _onerrorCallback = nil;
     }
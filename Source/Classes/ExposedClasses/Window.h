@@ -21,6 +21,7 @@
 
 #import <Foundation/Foundation.h>
 #import <JavaScriptCore/JavaScriptCore.h>
+#import "JSTimerWheel.h"
 
 // To supress the warning:
 //   “used as the name of the previous parameter rather than as part of the selector”
@@ -31,6 +32,15 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-selector-name"
 
+// Keys of -[Window timerInventory], the entries of the timers are described in JSTimerWheel.h
+extern NSString *const kWindowTimerInventoryTimers;   // Array of the active timers
+extern NSString *const kWindowTimerInventoryOrigins;  // Origin -> active timers, fires and callback times
+extern NSString *const kWindowTimerOrigin;            // Name of the callback, or the start of its source
+extern NSString *const kWindowTimerRequestId;         // Argument given to setTimeout, if any
+extern NSString *const kWindowTimerSuspectedLeak;     // Timer: YES for an interval running next to another one
+                                                      // of the same origin
+extern NSString *const kWindowTimerSuspectedLeaks;    // Origin: number of such intervals, 0 if there is only one
+
 @class Location;
 @class Navigator;
 
@@ -51,8 +61,21 @@
 @interface Window : NSObject<WindowExport>
 
 + (Window *)sharedInstance;
+
+// Leeway in seconds given to new timers of the class so that timers due close to each other fire in one wakeup of
+// the JS thread, a timer never gets more than a tenth of its delay. 0 (all timers precise) by default. setTimeout
+// with a request id is a request timeout, setInterval an interval and any other setTimeout precise.
+- (NSTimeInterval)timerLeewayForClass:(JSTimerClass)timerClass;
+- (void)setTimerLeeway:(NSTimeInterval)timerLeeway forClass:(JSTimerClass)timerClass;
 - (void)clearAllTimeouts;
 
+// Statistics of the timer wheel backing setTimeout/setInterval, see JSTimerWheel.h for the keys
+- (NSDictionary *)timerStatistics;
+- (void)resetTimerStatistics;
+
+// Active timers with their origin and counters, must be called on the JS thread
+- (NSDictionary *)timerInventory;
+
 @end
 
 // Not all Location methods are implemented, only those those thought
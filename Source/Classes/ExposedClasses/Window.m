@@ -21,6 +21,8 @@
 
 #import "Window.h"
 #import "JSEngine.h"
+#import "JSThreadWatchdog.h"
+#import "JSTimerWheel.h"
 #import "Navigator.h"
 
 
@@ -35,16 +37,19 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-selector-name"
 
-#define TIMER_INFO_CALLBACK @"CALLBACK"
-#define TIMER_INFO_REQUEST_ID @"REQUEST_ID"
-#define TIMER_INFO_TIMER_ID @"TIMER_ID"
-#define TIMER_DURATION @"DURATION"
-#define TIMER_IS_INTERVAL @"IS_INTERVAL"
+NSString *const kWindowTimerInventoryTimers = @"timers";
+NSString *const kWindowTimerInventoryOrigins = @"origins";
+NSString *const kWindowTimerOrigin = @"origin";
+NSString *const kWindowTimerRequestId = @"requestId";
+NSString *const kWindowTimerSuspectedLeak = @"suspectedLeak";
+NSString *const kWindowTimerSuspectedLeaks = @"suspectedLeaks";
+
+// Length of the callback source used as origin of anonymous functions
+#define TIMER_ORIGIN_LENGTH 80
 
 @interface Window ()
 
-@property (nonatomic, strong) NSMutableDictionary *timerCache;
-@property (nonatomic, assign) NSUInteger lastTimerId;
+@property (nonatomic, strong) JSTimerWheel *timerWheel;
 
 @end
 
@@ -67,8 +72,18 @@
 {
     if (self = [super init]) {
         _location = [[Location alloc] init];
-        self.lastTimerId = 0;
-        self.timerCache = [NSMutableDictionary dictionary];
+
+        __weak typeof(self) weakSelf = self;
+        self.timerWheel = [[JSTimerWheel alloc]
+            initWithWakeup:^{
+                // Go through the JS thread scheduler so that pending interactive work and call signaling run first
+                [[JSEngine sharedInstance] performBlock:^{ [weakSelf.timerWheel expireTimers]; }
+                                               priority:JSTaskPriorityTimer
+                                                  label:"timer"];
+            }
+            handler:^(JSManagedValue *timeoutCallback, NSString *requestId, BOOL repeats) {
+                [weakSelf fireTimer:timeoutCallback requestId:requestId repeats:repeats];
+            }];
     }
     return self;
 }
@@ -98,15 +113,9 @@
 
 - (void)clearTimeout:(NSUInteger)timeoutId
 {
-    NSString *timerId = [NSString stringWithFormat:@"%tu", timeoutId];
-
-    NSTimer *timer = [self.timerCache valueForKey:timerId];
-    if (timer) {
-        JSManagedValue *timoutCallback = [timer.userInfo valueForKey:TIMER_INFO_CALLBACK];
-        [[JSEngine sharedInstance] removeManagedReference:timoutCallback];
-        [timer invalidate];
-        [self.timerCache removeObjectForKey:timerId];
-    } else {
+    JSManagedValue *timeoutCallback = [self.timerWheel cancelTimer:(JSTimerId)timeoutId];
+    if (timeoutCallback) {
+        [[JSEngine sharedInstance] removeManagedReference:timeoutCallback];
     }
 }
 
@@ -120,15 +129,85 @@
     [self clearTimeout:timeoutId];
 }
 
+- (NSTimeInterval)timerLeewayForClass:(JSTimerClass)timerClass
+{
+    return [self.timerWheel leewayForClass:timerClass] / 1000;
+}
+
+- (void)setTimerLeeway:(NSTimeInterval)timerLeeway forClass:(JSTimerClass)timerClass
+{
+    [self.timerWheel setLeeway:MAX(timerLeeway, 0) * 1000 forClass:timerClass];
+}
+
 - (void)clearAllTimeouts
 {
-    for (NSTimer *timer in self.timerCache.allValues) {
-        JSManagedValue *timoutCallback = [timer.userInfo valueForKey:TIMER_INFO_CALLBACK];
-        [[JSEngine sharedInstance] removeManagedReference:timoutCallback];
-        [timer invalidate];
-    }
+    [self.timerWheel cancelAllTimers:^(JSManagedValue *timeoutCallback) {
+        [[JSEngine sharedInstance] removeManagedReference:timeoutCallback];
+    }];
+}
+
+- (NSDictionary *)timerStatistics
+{
+    return [self.timerWheel statistics];
+}
 
-    [self.timerCache removeAllObjects];
+- (void)resetTimerStatistics
+{
+    [self.timerWheel resetStatistics];
+}
+
+- (NSDictionary *)timerInventory
+{
+    NSMutableArray<NSMutableDictionary *> *timers = [NSMutableArray array];
+    NSMutableDictionary<NSString *, NSMutableArray *> *timersByOrigin = [NSMutableDictionary dictionary];
+
+    [self.timerWheel enumerateTimersUsingBlock:^(JSManagedValue *timeoutCallback, NSString *requestId,
+                                                 NSDictionary *info) {
+        NSMutableDictionary *timer = [info mutableCopy];
+        NSString *origin = [self originOfCallback:timeoutCallback.value];
+        timer[kWindowTimerOrigin] = origin;
+        timer[kWindowTimerRequestId] = requestId;
+        [timers addObject:timer];
+
+        if (!timersByOrigin[origin]) {
+            timersByOrigin[origin] = [NSMutableArray array];
+        }
+        [timersByOrigin[origin] addObject:timer];
+    }];
+
+    NSMutableDictionary *origins = [NSMutableDictionary dictionary];
+    [timersByOrigin enumerateKeysAndObjectsUsingBlock:^(NSString *origin, NSArray *originTimers, BOOL *stop) {
+        NSUInteger intervals = 0;
+        NSUInteger fires = 0;
+        double callbackTime = 0;
+        double maxCallbackTime = 0;
+        for (NSDictionary *timer in originTimers) {
+            NSUInteger timerFires = [timer[kJSTimerWheelTimerFires] unsignedIntegerValue];
+            intervals += [timer[kJSTimerWheelTimerRepeats] boolValue];
+            fires += timerFires;
+            callbackTime += [timer[kJSTimerWheelTimerMeanCallbackTime] doubleValue] * timerFires;
+            maxCallbackTime = MAX(maxCallbackTime, [timer[kJSTimerWheelTimerMaxCallbackTime] doubleValue]);
+        }
+
+        // An interval set again without clearing the previous one keeps running forever
+        if (intervals > 1) {
+            for (NSMutableDictionary *timer in originTimers) {
+                if ([timer[kJSTimerWheelTimerRepeats] boolValue]) {
+                    timer[kWindowTimerSuspectedLeak] = @YES;
+                }
+            }
+        }
+
+        origins[origin] = @{
+            kJSTimerWheelActiveTimers : @(originTimers.count),
+            kJSTimerWheelTimerFires : @(fires),
+            kJSTimerWheelTimerMeanCallbackTime : @(fires ? callbackTime / fires : 0),
+            kJSTimerWheelTimerMaxCallbackTime : @(maxCallbackTime),
+            kWindowTimerSuspectedLeaks : @(intervals > 1 ? intervals : 0)
+        };
+    }];
+
+    return @{kWindowTimerInventoryTimers : timers, kWindowTimerInventoryOrigins : origins};
 }
 
 - (NSString *)btoa:(NSString *)encode
@@ -142,15 +221,17 @@
 #pragma mark - Private Methods
 
 //------------------------------------------------------------------------------
-// If the duration is  less than 0, just call the callback.
-// Otherwise, create a timer and store it in the cache. If the duration is 0, a
-// timer with 0.1ms is created.
+// If the duration is less than 0, just call the callback.
+// Otherwise, schedule a timer in the timer wheel. Timers are only ever set and
+// cleared on the JS thread, the wheel is not thread safe.
 //------------------------------------------------------------------------------
 - (NSUInteger)setTimeoutCommon:(JSValue *)callback
                       duration:(NSTimeInterval)duration
                      requestId:(NSString *)requestId
                     isInterval:(BOOL)isInterval
 {
+    [[JSThreadWatchdog sharedInstance] jsDidCallOut];
+
     if (duration < 0) {
         if (requestId)
             [callback callWithArguments:@[ requestId ]];
@@ -158,67 +239,62 @@
             [callback callWithArguments:@[]];
 
         return 0;
-    } else {
-        @synchronized(self)
-        {
-            if (self.lastTimerId < NSUIntegerMax)
-                self.lastTimerId++;
-            else
-                self.lastTimerId = 0;
-
-            NSNumber *timerDuration = @(duration);
-
-            NSString *timerId = [NSString stringWithFormat:@"%tu", self.lastTimerId];
-
-            NSNumber *isIntervalIndicator = [NSNumber numberWithInt:isInterval];
-
-            // Garbage collected references
-            JSManagedValue *timoutCallback = [JSManagedValue managedValueWithValue:callback];
-            [[JSEngine sharedInstance] addManagedReference:timoutCallback];
-
-            // Do not use new dictionaty syntax here because requestId may be nil
-            NSDictionary *timerInfo =
-                [NSDictionary dictionaryWithObjectsAndKeys:timerId, TIMER_INFO_TIMER_ID, timoutCallback,
-                                                           TIMER_INFO_CALLBACK, timerDuration, TIMER_DURATION,
-                                                           isIntervalIndicator, TIMER_IS_INTERVAL, requestId,
-                                                           TIMER_INFO_REQUEST_ID,  // requestId may be nil so put
-                                                                                   // it last!
-                                                           nil];
-
-            NSTimer *timer = [NSTimer timerWithTimeInterval:duration / 1000
-                                                     target:self
-                                                   selector:@selector(timerPopped:)
-                                                   userInfo:timerInfo
-                                                    repeats:isInterval];
-
-            [[JSEngine sharedInstance].runLoop addTimer:timer forMode:NSDefaultRunLoopMode];
+    }
 
-            [self.timerCache setValue:timer forKey:timerId];
+    // Garbage collected references
+    JSManagedValue *timeoutCallback = [JSManagedValue managedValueWithValue:callback];
+    [[JSEngine sharedInstance] addManagedReference:timeoutCallback];
+
+    // The SDK passes a request id to the timeouts guarding its requests, those are cancelled by the response and
+    // need not fire on time
+    JSTimerClass timerClass = JSTimerClassPrecise;
+    if (isInterval) {
+        timerClass = JSTimerClassInterval;
+    } else if (requestId) {
+        timerClass = JSTimerClassRequestTimeout;
+    }
 
-            return self.lastTimerId;
-        }
+    JSTimerId timerId = [self.timerWheel scheduleTimerAfter:duration
+                                                    repeats:isInterval
+                                                 timerClass:timerClass
+                                                     target:timeoutCallback
+                                                   argument:requestId];
+    if (timerId == 0) {
+        [[JSEngine sharedInstance] removeManagedReference:timeoutCallback];
     }
+    return timerId;
 }
 
-- (void)timerPopped:(NSTimer *)timer
+// Only called for the inventory, reading the source of a function is too expensive for every setTimeout
+- (NSString *)originOfCallback:(JSValue *)callback
 {
-    NSDictionary *userInfo = timer.userInfo;
-    NSString *timerId = [userInfo valueForKey:TIMER_INFO_TIMER_ID];
+    if (!callback) {
+        return @"<collected>";
+    }
 
-    JSManagedValue *timeoutCallback = [userInfo valueForKey:TIMER_INFO_CALLBACK];
-    NSString *requestId = [userInfo valueForKey:TIMER_INFO_REQUEST_ID];
+    NSString *name = [callback[@"name"] toString];
+    if (name.length > 0 && ![name isEqualToString:@"undefined"]) {
+        return name;
+    }
+
+    // Anonymous functions are told apart by the start of their source, e.g. "function () { sendPing(); ..."
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSArray *words = [[callback toString] componentsSeparatedByCharactersInSet:whitespace];
+    NSString *source = [[words filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]]
+        componentsJoinedByString:@" "];
+    return source.length > TIMER_ORIGIN_LENGTH ? [source substringToIndex:TIMER_ORIGIN_LENGTH] : source;
+}
 
+- (void)fireTimer:(JSManagedValue *)timeoutCallback requestId:(NSString *)requestId repeats:(BOOL)repeats
+{
     if (requestId)
         [timeoutCallback.value callWithArguments:@[ requestId ]];
     else
         [timeoutCallback.value callWithArguments:@[]];
 
-    BOOL isInterval = [[userInfo valueForKey:TIMER_IS_INTERVAL] boolValue];
-
-    // If it's not an interval timer, remove it from the list
-    if (!isInterval) {
+    // A timeout is gone once it fired, an interval stays until it is cleared
+    if (!repeats) {
         [[JSEngine sharedInstance] removeManagedReference:timeoutCallback];
-        [self.timerCache removeObjectForKey:timerId];
     }
 }
 
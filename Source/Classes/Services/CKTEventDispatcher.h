@@ -0,0 +1,105 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTEventDispatcher.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "CKTEventSink.h"
+#import "PubSubEvents.h"
+
+// Keys of the dictionary returned by -[CKTEventDispatcher statistics]
+extern NSString *const kCKTEventDispatcherReceived;       // Events received from the JS SDK
+extern NSString *const kCKTEventDispatcherSkipped;        // Events dropped unconverted since nobody observes them
+extern NSString *const kCKTEventDispatcherDeliveries;     // Notifications posted plus sink methods called
+extern NSString *const kCKTEventDispatcherConversionTime; // Histogram (see CKTHistogram.h) of the event conversion
+extern NSString *const kCKTEventDispatcherLatency;        // Histogram from the JS callback until delivery starts
+extern NSString *const kCKTEventDispatcherMainThreadTime; // Histogram of the time each delivery takes on main
+extern NSString *const kCKTEventDispatcherMerged;         // Coalesced events replaced by a later one
+extern NSString *const kCKTEventDispatcherBatches;        // Batches of coalesced events delivered
+extern NSString *const kCKTEventDispatcherBatchedEvents;  // Events delivered within these batches
+extern NSString *const kCKTEventDispatcherObservedEvents; // Names of the events currently subscribed to
+extern NSString *const kCKTEventDispatcherDropped;        // Events dropped from a full sink buffer
+extern NSString *const kCKTEventDispatcherOverflowMerged; // Events replaced by a newer one in a full sink buffer
+extern NSString *const kCKTEventDispatcherMaxBacklog;     // Most events waiting for a sink at a time
+
+// Delivers the events of the JS SDK, as notifications on the main queue and to the registered event sinks on their
+// queues. Events are converted once, and not at all if nobody observes them.
+//
+// Observers registered through NSNotificationCenter directly are invisible to the SDK, so all notifications are
+// posted by default. Apps registering their observers through -addObserver... can turn postsNotifications off, the
+// SDK then only listens to the events of the JS SDK which have an observer or an event sink.
+@interface CKTEventDispatcher : NSObject
+
+// Whether the CKTNotification* notifications are posted without observers registered through -addObserver...,
+// YES by default
+@property (atomic, assign) BOOL postsNotifications;
+
+// Called on the JS thread when the set of observed events changed, set by the PubSubService
+@property (atomic, copy) dispatch_block_t observedEventsChanged;
+
++ (CKTEventDispatcher *)sharedInstance;
+
+// Sinks are held weakly and called on the given serial queue, adding a sink again changes its queue. Each sink has
+// a buffer from which its events are delivered in the order they were received, a capacity of 0 leaves it
+// unbounded. Removing a sink drops the events still waiting in its buffer, the event being delivered on the queue
+// of the sink, if any, is the last one it gets.
+- (void)addSink:(id<CKTEventSink>)sink queue:(dispatch_queue_t)queue;
+- (void)addSink:(id<CKTEventSink>)sink
+             queue:(dispatch_queue_t)queue
+          capacity:(NSUInteger)capacity
+    overflowPolicy:(CKTEventOverflowPolicy)policy;
+- (void)removeSink:(id<CKTEventSink>)sink;
+
+// NSNotificationCenter observers of the default center which are counted, see postsNotifications
+- (void)addObserver:(id)observer selector:(SEL)selector name:(NSString *)name;
+- (id<NSObject>)addObserverForName:(NSString *)name
+                             queue:(NSOperationQueue *)queue
+                        usingBlock:(void (^)(NSNotification *notification))block;
+// A nil name removes the observer from all notifications
+- (void)removeObserver:(id)observer name:(NSString *)name;
+
+// Events of the given notification (conversationUpdated, itemUpdated, userPresenceChanged or userUpdated) received
+// within the window are delivered together, the latest event about an object replacing the previous ones. The
+// notification then carries the events in CKTKeyEvents. A batch is delivered early when an event which is not
+// batched arrives about one of its conversations or users, so that it is not overtaken. Returns NO for other
+// notifications. 0 turns it off.
+- (BOOL)setCoalescingWindow:(NSTimeInterval)window forNotification:(NSString *)name;
+
+// Called on the JS thread before converting the event
+- (BOOL)isEventObserved:(JSEvent)event;
+
+// Called on the JS thread with the converted event, received is the CKTMonotonicMicroseconds() when the JS SDK
+// called out and converted when the conversion was done
+- (void)dispatchEvent:(JSEvent)event
+                 name:(NSString *)name
+                 data:(id)data
+             received:(uint64_t)received
+            converted:(uint64_t)converted;
+
+// Called on the JS thread for an event which was not converted
+- (void)skipEvent:(JSEvent)event;
+
+// Called on the JS thread when the JS environment is reset, drops the events of the old session still waiting in a
+// coalescing window
+- (void)discardPendingEvents;
+
+- (NSDictionary *)statistics;
+- (void)resetStatistics;
+
+@end
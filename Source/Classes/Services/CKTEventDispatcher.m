@@ -0,0 +1,832 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTEventDispatcher.m
+//  CircuitSDK
+//
+//
+
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
+#import "JSEngine.h"
+#import "JSNotificationCenter.h"
+#import "Log.h"
+#import "PubSubService.h"
+
+#import <stdatomic.h>
+
+NSString *const kCKTEventDispatcherReceived = @"received";
+NSString *const kCKTEventDispatcherSkipped = @"skipped";
+NSString *const kCKTEventDispatcherDeliveries = @"deliveries";
+NSString *const kCKTEventDispatcherConversionTime = @"conversionTime";
+NSString *const kCKTEventDispatcherLatency = @"latency";
+NSString *const kCKTEventDispatcherMainThreadTime = @"mainThreadTime";
+NSString *const kCKTEventDispatcherMerged = @"merged";
+NSString *const kCKTEventDispatcherBatches = @"batches";
+NSString *const kCKTEventDispatcherBatchedEvents = @"batchedEvents";
+NSString *const kCKTEventDispatcherObservedEvents = @"observedEvents";
+NSString *const kCKTEventDispatcherDropped = @"dropped";
+NSString *const kCKTEventDispatcherOverflowMerged = @"overflowMerged";
+NSString *const kCKTEventDispatcherMaxBacklog = @"maxBacklog";
+
+#define EVENT_BIT(event) (1u << (event))
+
+// Sink method of each event, all take the event object
+static SEL CKTEventSinkSelector(JSEvent event)
+{
+    switch (event) {
+        case JSEventBasicSearchResults:
+            return @selector(basicSearchResults:);
+        case JSEventCallEnded:
+            return @selector(callEnded:);
+        case JSEventCallIncoming:
+            return @selector(callIncoming:);
+        case JSEventCallStatus:
+            return @selector(callStatus:);
+        case JSEventConnectionStateChanged:
+            return @selector(connectionStateChanged:);
+        case JSEventConversationCreated:
+            return @selector(conversationCreated:);
+        case JSEventConversationUpdated:
+            return @selector(conversationUpdated:);
+        case JSEventItemAdded:
+            return @selector(itemAdded:);
+        case JSEventItemUpdated:
+            return @selector(itemUpdated:);
+        case JSEventReconnectFailed:
+            return @selector(reconnectFailed:);
+        case JSEventRenewToken:
+            return @selector(renewToken:);
+        case JSEventSessionExpires:
+            return @selector(sessionExpires:);
+        case JSEventUserPresenceChanged:
+            return @selector(userPresenceChanged:);
+        case JSEventUserSettingsChanged:
+            return @selector(userSettingsChanged:);
+        case JSEventUserUpdated:
+            return @selector(userUpdated:);
+        default:
+            return NULL;
+    }
+}
+
+// Events which can be coalesced, with the key path of the id of the object they are about
+static NSDictionary<NSString *, NSString *> *CKTEventCoalescingKeyPaths(void)
+{
+    static NSDictionary *keyPaths;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keyPaths = @{
+            CKTNotificationConversationUpdated : @"conversation.convId",
+            CKTNotificationItemUpdated : @"item.itemId",
+            CKTNotificationUserPresenceChanged : @"presenceState.userId",
+            CKTNotificationUserUpdated : @"user.userId"
+        };
+    });
+    return keyPaths;
+}
+
+// Key path of the conversation or user an event is about, used to keep a batch from being overtaken
+static NSDictionary<NSString *, NSString *> *CKTEventScopeKeyPaths(void)
+{
+    static NSDictionary *keyPaths;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keyPaths = @{
+            CKTNotificationCallEnded : @"call.convId",
+            CKTNotificationCallIncoming : @"call.convId",
+            CKTNotificationCallStatus : @"call.convId",
+            CKTNotificationConversationCreated : @"conversation.convId",
+            CKTNotificationConversationUpdated : @"conversation.convId",
+            CKTNotificationItemAdded : @"item.convId",
+            CKTNotificationItemUpdated : @"item.convId",
+            CKTNotificationUserPresenceChanged : @"presenceState.userId",
+            CKTNotificationUserUpdated : @"user.userId"
+        };
+    });
+    return keyPaths;
+}
+
+// Events of one type collected during the coalescing window, the latest event per id replaces the previous one
+@interface CKTEventBatch : NSObject
+
+@property (nonatomic, assign) JSEvent event;
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, strong) NSMutableArray *events;
+@property (nonatomic, strong) NSMutableDictionary<id, NSNumber *> *indexById;
+@property (nonatomic, strong) NSMutableSet *scopes;  // Conversations or users the events are about
+@property (nonatomic, assign) uint64_t received;     // Of the first event
+
+@end
+
+@implementation CKTEventBatch
+
+@end
+
+// Event waiting in the buffer of a sink, either a single event or a batch of coalesced events
+@interface CKTPendingEvent : NSObject
+
+@property (nonatomic, assign) JSEvent event;
+@property (nonatomic, strong) id data;
+@property (nonatomic, strong) NSArray *batch;
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, strong) id objectId;  // Id of the user, item... the event is about, if known
+@property (nonatomic, assign) uint64_t received;
+
+@end
+
+@implementation CKTPendingEvent
+
+@end
+
+@interface CKTEventSinkEntry : NSObject
+
+@property (nonatomic, weak) id<CKTEventSink> sink;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, assign) uint32_t events;  // Bit per implemented event method
+@property (nonatomic, assign) NSUInteger capacity;  // 0 for unbounded
+@property (nonatomic, assign) CKTEventOverflowPolicy overflowPolicy;
+
+// Protected by @synchronized(entry). Events are delivered in the order they were added by one drain block at a
+// time on the queue of the sink.
+@property (nonatomic, strong) NSMutableArray<CKTPendingEvent *> *buffer;
+@property (nonatomic, assign) BOOL drainScheduled;
+// Set by -removeSink:, the buffered events are dropped and nothing is delivered anymore
+@property (atomic, assign) BOOL removed;
+
+@end
+
+@implementation CKTEventSinkEntry
+
+@end
+
+@interface CKTEventDispatcher () {
+    // Union of the events of all sinks, read on the JS thread for every event
+    atomic_uint_fast32_t _sinkEvents;
+    // Events with observers registered through -addObserver..., updated like the sinks
+    atomic_uint_fast32_t _observerEvents;
+
+    atomic_uint_fast64_t _received;
+    atomic_uint_fast64_t _skipped;
+    atomic_uint_fast64_t _deliveries;
+    atomic_uint_fast64_t _merged;
+    atomic_uint_fast64_t _batches;
+    atomic_uint_fast64_t _batchedEvents;
+    atomic_uint_fast64_t _dropped;
+    atomic_uint_fast64_t _overflowMerged;
+    atomic_uint_fast64_t _maxBacklog;
+}
+
+// Replaced, never mutated, so that the JS thread can iterate it without locking
+@property (atomic, copy) NSArray<CKTEventSinkEntry *> *sinks;
+
+// Observer -> names of the notifications it observes, observers going away without being removed drop out
+@property (nonatomic, strong) NSMapTable<id, NSMutableArray<NSString *> *> *observers;
+
+// Notification name -> coalescing window, replaced like the sinks
+@property (atomic, copy) NSDictionary<NSString *, NSNumber *> *coalescingWindows;
+
+// Pending batches by notification name, only used on the JS thread
+@property (nonatomic, strong) NSMutableDictionary<NSString *, CKTEventBatch *> *pendingBatches;
+
+// Protected by @synchronized(self)
+@property (nonatomic, strong) CKTHistogram *conversionTime;
+@property (nonatomic, strong) CKTHistogram *latency;
+@property (nonatomic, strong) CKTHistogram *mainThreadTime;
+
+@end
+
+@implementation CKTEventDispatcher
+
+@synthesize postsNotifications = _postsNotifications;
+
+static NSString *LOG_TAG = @"[CKTEventDispatcher]";
+
++ (CKTEventDispatcher *)sharedInstance
+{
+    static CKTEventDispatcher *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{ sharedInstance = [[CKTEventDispatcher alloc] init]; });
+    return sharedInstance;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _postsNotifications = YES;
+        _observers = [NSMapTable weakToStrongObjectsMapTable];
+        _sinks = @[];
+        _coalescingWindows = @{};
+        _pendingBatches = [NSMutableDictionary dictionary];
+        _conversionTime = [[CKTHistogram alloc] init];
+        _latency = [[CKTHistogram alloc] init];
+        _mainThreadTime = [[CKTHistogram alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Sinks
+
+- (void)addSink:(id<CKTEventSink>)sink queue:(dispatch_queue_t)queue
+{
+    [self addSink:sink queue:queue capacity:0 overflowPolicy:CKTEventOverflowPolicyDropOldest];
+}
+
+- (void)addSink:(id<CKTEventSink>)sink
+             queue:(dispatch_queue_t)queue
+          capacity:(NSUInteger)capacity
+    overflowPolicy:(CKTEventOverflowPolicy)policy
+{
+    if (!sink || !queue) {
+        LOGE(LOG_TAG, @"addSink needs a sink and a queue");
+        return;
+    }
+
+    CKTEventSinkEntry *entry = [[CKTEventSinkEntry alloc] init];
+    entry.sink = sink;
+    entry.queue = queue;
+    entry.capacity = capacity;
+    entry.overflowPolicy = policy;
+    entry.buffer = [NSMutableArray array];
+    for (NSInteger event = 1; event < JSEventNumberOfEvents; event++) {
+        if ([sink respondsToSelector:CKTEventSinkSelector(event)]) {
+            entry.events |= EVENT_BIT(event);
+        }
+    }
+    LOGD(LOG_TAG, @"addSink %@ for events 0x%x", sink, entry.events);
+
+    @synchronized(self)
+    {
+        NSMutableArray *sinks = [self sinksExcluding:sink];
+        [sinks addObject:entry];
+        [self updateSinks:sinks];
+    }
+    [self observedEventsDidChange];
+}
+
+- (void)removeSink:(id<CKTEventSink>)sink
+{
+    LOGD(LOG_TAG, @"removeSink %@", sink);
+
+    @synchronized(self)
+    {
+        for (CKTEventSinkEntry *entry in self.sinks) {
+            if (entry.sink == sink) {
+                @synchronized(entry)
+                {
+                    entry.removed = YES;
+                    [entry.buffer removeAllObjects];
+                }
+            }
+        }
+        [self updateSinks:[self sinksExcluding:sink]];
+    }
+    [self observedEventsDidChange];
+}
+
+#pragma mark - Observers
+
+- (void)setPostsNotifications:(BOOL)postsNotifications
+{
+    @synchronized(self)
+    {
+        _postsNotifications = postsNotifications;
+    }
+    [self observedEventsDidChange];
+}
+
+- (BOOL)postsNotifications
+{
+    @synchronized(self)
+    {
+        return _postsNotifications;
+    }
+}
+
+- (void)addObserver:(id)observer selector:(SEL)selector name:(NSString *)name
+{
+    [[NSNotificationCenter defaultCenter] addObserver:observer selector:selector name:name object:nil];
+    [self observer:observer addedForName:name];
+}
+
+- (id<NSObject>)addObserverForName:(NSString *)name
+                             queue:(NSOperationQueue *)queue
+                        usingBlock:(void (^)(NSNotification *notification))block
+{
+    id<NSObject> observer =
+        [[NSNotificationCenter defaultCenter] addObserverForName:name object:nil queue:queue usingBlock:block];
+    [self observer:observer addedForName:name];
+    return observer;
+}
+
+- (void)removeObserver:(id)observer name:(NSString *)name
+{
+    if (name) {
+        [[NSNotificationCenter defaultCenter] removeObserver:observer name:name object:nil];
+    } else {
+        [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    }
+
+    @synchronized(self)
+    {
+        NSMutableArray *names = [self.observers objectForKey:observer];
+        if (name) {
+            [names removeObject:name];
+        }
+        if (!name || names.count == 0) {
+            [self.observers removeObjectForKey:observer];
+        }
+        [self updateObserverEvents];
+    }
+    [self observedEventsDidChange];
+}
+
+#pragma mark - Coalescing
+
+- (BOOL)setCoalescingWindow:(NSTimeInterval)window forNotification:(NSString *)name
+{
+    if (!CKTEventCoalescingKeyPaths()[name]) {
+        LOGE(LOG_TAG, @"%@ events cannot be coalesced", name);
+        return NO;
+    }
+    LOGD(LOG_TAG, @"setCoalescingWindow %.3f for %@", window, name);
+
+    @synchronized(self)
+    {
+        NSMutableDictionary *windows = [self.coalescingWindows mutableCopy];
+        windows[name] = window > 0 ? @(window) : nil;
+        self.coalescingWindows = windows;
+    }
+    return YES;
+}
+
+#pragma mark - Event delivery
+
+- (BOOL)isEventObserved:(JSEvent)event
+{
+    uint32_t events = atomic_load_explicit(&_sinkEvents, memory_order_relaxed) |
+                      atomic_load_explicit(&_observerEvents, memory_order_relaxed);
+    return (events & EVENT_BIT(event)) || self.postsNotifications;
+}
+
+- (void)dispatchEvent:(JSEvent)event
+                 name:(NSString *)name
+                 data:(id)data
+             received:(uint64_t)received
+            converted:(uint64_t)converted
+{
+    atomic_fetch_add_explicit(&_received, 1, memory_order_relaxed);
+    @synchronized(self)
+    {
+        [self.conversionTime recordValue:converted - received];
+    }
+
+    NSNumber *window = self.coalescingWindows[name];
+    if (window) {
+        [self addEvent:event name:name data:data received:received window:window.doubleValue];
+        return;
+    }
+    [self flushBatchesBefore:data name:name];
+
+    if ([self postsNotificationOfEvent:event]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            uint64_t start = [self deliveryStarted:received];
+            [JSNotificationCenter sendNotificationName:name object:nil userInfo:data];
+            [self deliveryEnded:start onMainThread:YES];
+        });
+    }
+
+    uint32_t bit = EVENT_BIT(event);
+    if (!(atomic_load_explicit(&_sinkEvents, memory_order_relaxed) & bit)) {
+        return;
+    }
+
+    NSString *keyPath = CKTEventCoalescingKeyPaths()[name];
+    for (CKTEventSinkEntry *entry in self.sinks) {
+        if (!(entry.events & bit)) {
+            continue;
+        }
+
+        CKTPendingEvent *pending = [[CKTPendingEvent alloc] init];
+        pending.event = event;
+        pending.data = data;
+        pending.name = name;
+        pending.received = received;
+        // Only needed to make room by merging
+        if (keyPath && entry.capacity && entry.overflowPolicy == CKTEventOverflowPolicyCoalesce) {
+            pending.objectId = [data valueForKeyPath:keyPath];
+        }
+        [self enqueue:pending sink:entry];
+    }
+}
+
+- (void)skipEvent:(JSEvent)event
+{
+    atomic_fetch_add_explicit(&_received, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_skipped, 1, memory_order_relaxed);
+}
+
+- (void)discardPendingEvents
+{
+    LOGD(LOG_TAG, @"discardPendingEvents - %lu batches", (unsigned long)self.pendingBatches.count);
+
+    // The flushes already scheduled find no batch anymore
+    [self.pendingBatches removeAllObjects];
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self)
+    {
+        return @{
+            kCKTEventDispatcherReceived : @(atomic_load_explicit(&_received, memory_order_relaxed)),
+            kCKTEventDispatcherSkipped : @(atomic_load_explicit(&_skipped, memory_order_relaxed)),
+            kCKTEventDispatcherDeliveries : @(atomic_load_explicit(&_deliveries, memory_order_relaxed)),
+            kCKTEventDispatcherConversionTime : [self.conversionTime dictionaryRepresentation],
+            kCKTEventDispatcherLatency : [self.latency dictionaryRepresentation],
+            kCKTEventDispatcherMainThreadTime : [self.mainThreadTime dictionaryRepresentation],
+            kCKTEventDispatcherMerged : @(atomic_load_explicit(&_merged, memory_order_relaxed)),
+            kCKTEventDispatcherBatches : @(atomic_load_explicit(&_batches, memory_order_relaxed)),
+            kCKTEventDispatcherBatchedEvents : @(atomic_load_explicit(&_batchedEvents, memory_order_relaxed)),
+            kCKTEventDispatcherObservedEvents : [self observedEventNames],
+            kCKTEventDispatcherDropped : @(atomic_load_explicit(&_dropped, memory_order_relaxed)),
+            kCKTEventDispatcherOverflowMerged : @(atomic_load_explicit(&_overflowMerged, memory_order_relaxed)),
+            kCKTEventDispatcherMaxBacklog : @(atomic_load_explicit(&_maxBacklog, memory_order_relaxed))
+        };
+    }
+}
+
+- (void)resetStatistics
+{
+    LOGD(LOG_TAG, @"resetStatistics");
+
+    atomic_store(&_received, 0);
+    atomic_store(&_skipped, 0);
+    atomic_store(&_deliveries, 0);
+    atomic_store(&_merged, 0);
+    atomic_store(&_batches, 0);
+    atomic_store(&_batchedEvents, 0);
+    atomic_store(&_dropped, 0);
+    atomic_store(&_overflowMerged, 0);
+    atomic_store(&_maxBacklog, 0);
+
+    @synchronized(self)
+    {
+        [self.conversionTime reset];
+        [self.latency reset];
+        [self.mainThreadTime reset];
+    }
+}
+
+#pragma mark - internal functions
+
+// JS thread
+- (void)addEvent:(JSEvent)event name:(NSString *)name data:(id)data received:(uint64_t)received window:(double)window
+{
+    CKTEventBatch *batch = self.pendingBatches[name];
+    if (!batch) {
+        batch = [[CKTEventBatch alloc] init];
+        batch.event = event;
+        batch.name = name;
+        batch.events = [NSMutableArray array];
+        batch.indexById = [NSMutableDictionary dictionary];
+        batch.scopes = [NSMutableSet set];
+        batch.received = received;
+        self.pendingBatches[name] = batch;
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(window * NSEC_PER_SEC)),
+                       dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+                           [[JSEngine sharedInstance] performBlock:^{ [self flushBatch:batch]; }
+                                                          priority:JSTaskPriorityBackground
+                                                             label:"flushEvents"];
+                       });
+    }
+
+    id scope = [data valueForKeyPath:CKTEventScopeKeyPaths()[name]];
+    if (scope) {
+        [batch.scopes addObject:scope];
+    }
+
+    // Last write wins, the event keeps the position of the first one about the same object
+    id objectId = [data valueForKeyPath:CKTEventCoalescingKeyPaths()[name]];
+    NSNumber *index = objectId ? batch.indexById[objectId] : nil;
+    if (index) {
+        batch.events[index.unsignedIntegerValue] = data;
+        atomic_fetch_add_explicit(&_merged, 1, memory_order_relaxed);
+    } else {
+        if (objectId) {
+            batch.indexById[objectId] = @(batch.events.count);
+        }
+        [batch.events addObject:data];
+    }
+}
+
+// JS thread. Delivers the batches holding events about the conversation or user of an event which is not batched, so
+// that it does not overtake them.
+- (void)flushBatchesBefore:(id)data name:(NSString *)name
+{
+    if (self.pendingBatches.count == 0) {
+        return;
+    }
+
+    NSString *keyPath = CKTEventScopeKeyPaths()[name];
+    id scope = keyPath ? [data valueForKeyPath:keyPath] : nil;
+    if (!scope) {
+        return;
+    }
+    for (CKTEventBatch *batch in self.pendingBatches.allValues) {
+        if ([batch.scopes containsObject:scope]) {
+            [self flushBatch:batch];
+        }
+    }
+}
+
+// JS thread. A batch flushed early, or discarded, is no longer pending when its window closes.
+- (void)flushBatch:(CKTEventBatch *)batch
+{
+    if (self.pendingBatches[batch.name] != batch) {
+        return;
+    }
+    [self.pendingBatches removeObjectForKey:batch.name];
+
+    JSEvent event = batch.event;
+    NSString *name = batch.name;
+    NSArray *events = batch.events;
+    uint64_t received = batch.received;
+    atomic_fetch_add_explicit(&_batches, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_batchedEvents, events.count, memory_order_relaxed);
+
+    if ([self postsNotificationOfEvent:event]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            uint64_t start = [self deliveryStarted:received];
+            [JSNotificationCenter sendNotificationName:name object:nil userInfo:@{CKTKeyEvents : events}];
+            [self deliveryEnded:start onMainThread:YES];
+        });
+    }
+
+    uint32_t bit = EVENT_BIT(event);
+    for (CKTEventSinkEntry *entry in self.sinks) {
+        if (!(entry.events & bit)) {
+            continue;
+        }
+
+        CKTPendingEvent *pending = [[CKTPendingEvent alloc] init];
+        pending.event = event;
+        pending.batch = events;
+        pending.name = name;
+        pending.received = received;
+        [self enqueue:pending sink:entry];
+    }
+}
+
+// Adds the event to the buffer of the sink, making room according to its policy if full
+- (void)enqueue:(CKTPendingEvent *)pending sink:(CKTEventSinkEntry *)entry
+{
+    BOOL scheduleDrain = NO;
+    NSUInteger backlog;
+
+    @synchronized(entry)
+    {
+        // The JS thread may still iterate the sinks from before -removeSink:
+        if (entry.removed) {
+            return;
+        }
+
+        NSMutableArray *buffer = entry.buffer;
+        if (entry.capacity && buffer.count >= entry.capacity &&
+            ![self makeRoomFor:pending inBuffer:buffer policy:entry.overflowPolicy] &&
+            buffer.count == entry.capacity) {
+            LOGW(LOG_TAG, @"Buffer of %@ holds no update event to drop, exceeding its capacity of %lu", entry.sink,
+                 (unsigned long)entry.capacity);
+        }
+        [buffer addObject:pending];
+        backlog = buffer.count;
+
+        if (!entry.drainScheduled) {
+            entry.drainScheduled = YES;
+            scheduleDrain = YES;
+        }
+    }
+
+    uint_fast64_t maxBacklog = atomic_load_explicit(&_maxBacklog, memory_order_relaxed);
+    while (backlog > maxBacklog &&
+           !atomic_compare_exchange_weak_explicit(&_maxBacklog, &maxBacklog, backlog, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+
+    if (scheduleDrain) {
+        dispatch_async(entry.queue, ^{ [self drainSink:entry]; });
+    }
+}
+
+// Must be called within @synchronized(entry). Merging removes the older event so that the newer one is delivered at
+// its own place, the remaining events keep their order. Only the update events which can be coalesced give way,
+// dropping a call, session or connection event would leave the app with the wrong state. Returns NO if there is no
+// such event in the buffer, which then grows beyond its capacity.
+- (BOOL)makeRoomFor:(CKTPendingEvent *)pending
+           inBuffer:(NSMutableArray<CKTPendingEvent *> *)buffer
+             policy:(CKTEventOverflowPolicy)policy
+{
+    if (policy == CKTEventOverflowPolicyCoalesce && pending.objectId) {
+        NSUInteger index = [buffer indexOfObjectPassingTest:^BOOL(CKTPendingEvent *queued, NSUInteger idx, BOOL *stop) {
+            return queued.event == pending.event && [queued.objectId isEqual:pending.objectId];
+        }];
+        if (index != NSNotFound) {
+            [buffer removeObjectAtIndex:index];
+            atomic_fetch_add_explicit(&_overflowMerged, 1, memory_order_relaxed);
+            return YES;
+        }
+    }
+
+    NSDictionary *keyPaths = CKTEventCoalescingKeyPaths();
+    NSUInteger index = [buffer indexOfObjectPassingTest:^BOOL(CKTPendingEvent *queued, NSUInteger idx, BOOL *stop) {
+        return keyPaths[queued.name] != nil;
+    }];
+    if (index == NSNotFound) {
+        return NO;
+    }
+    [buffer removeObjectAtIndex:index];
+    atomic_fetch_add_explicit(&_dropped, 1, memory_order_relaxed);
+    return YES;
+}
+
+// Queue of the sink
+- (void)drainSink:(CKTEventSinkEntry *)entry
+{
+    BOOL mainThread = entry.queue == dispatch_get_main_queue();
+
+    for (;;) {
+        NSArray<CKTPendingEvent *> *events;
+        @synchronized(entry)
+        {
+            if (entry.buffer.count == 0) {
+                entry.drainScheduled = NO;
+                return;
+            }
+            events = [entry.buffer copy];
+            [entry.buffer removeAllObjects];
+        }
+
+        id<CKTEventSink> sink = entry.sink;
+        if (!sink) {
+            continue;
+        }
+
+        for (CKTPendingEvent *pending in events) {
+            if (entry.removed) {
+                break;
+            }
+            @autoreleasepool {
+                uint64_t start = [self deliveryStarted:pending.received];
+                [self deliver:pending toSink:sink];
+                [self deliveryEnded:start onMainThread:mainThread];
+            }
+        }
+    }
+}
+
+- (void)deliver:(CKTPendingEvent *)pending toSink:(id<CKTEventSink>)sink
+{
+    SEL selector = CKTEventSinkSelector(pending.event);
+    if (!pending.batch) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
+        [sink performSelector:selector withObject:pending.data];
+#pragma clang diagnostic pop
+    } else if ([sink respondsToSelector:@selector(coalescedEvents:notification:)]) {
+        [sink coalescedEvents:pending.batch notification:pending.name];
+    } else {
+        for (id data in pending.batch) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
+            [sink performSelector:selector withObject:data];
+#pragma clang diagnostic pop
+        }
+    }
+}
+
+// Must be called within @synchronized(self)
+- (NSMutableArray<CKTEventSinkEntry *> *)sinksExcluding:(id<CKTEventSink>)sink
+{
+    NSMutableArray *sinks = [NSMutableArray arrayWithCapacity:self.sinks.count + 1];
+    for (CKTEventSinkEntry *entry in self.sinks) {
+        // Sinks which went away are dropped on the way
+        id<CKTEventSink> existing = entry.sink;
+        if (existing && existing != sink) {
+            [sinks addObject:entry];
+        }
+    }
+    return sinks;
+}
+
+// Must be called within @synchronized(self)
+- (void)updateSinks:(NSArray<CKTEventSinkEntry *> *)sinks
+{
+    uint32_t events = 0;
+    for (CKTEventSinkEntry *entry in sinks) {
+        events |= entry.events;
+    }
+    self.sinks = sinks;
+    atomic_store(&_sinkEvents, events);
+}
+
+- (BOOL)postsNotificationOfEvent:(JSEvent)event
+{
+    return (atomic_load_explicit(&_observerEvents, memory_order_relaxed) & EVENT_BIT(event)) ||
+           self.postsNotifications;
+}
+
+- (void)observer:(id)observer addedForName:(NSString *)name
+{
+    if ([PubSubService eventForTopic:name] == JSEventUnknown) {
+        // Not an event of the JS SDK, e.g. applicationServiceLoaded, which is always posted
+        return;
+    }
+
+    @synchronized(self)
+    {
+        NSMutableArray *names = [self.observers objectForKey:observer];
+        if (!names) {
+            names = [NSMutableArray array];
+            [self.observers setObject:names forKey:observer];
+        }
+        [names addObject:name];
+        [self updateObserverEvents];
+    }
+    [self observedEventsDidChange];
+}
+
+// Must be called within @synchronized(self)
+- (void)updateObserverEvents
+{
+    uint32_t events = 0;
+    for (NSArray *names in self.observers.objectEnumerator) {
+        for (NSString *name in names) {
+            events |= EVENT_BIT([PubSubService eventForTopic:name]);
+        }
+    }
+    atomic_store(&_observerEvents, events);
+}
+
+// Lets the PubSubService add or remove the JS SDK listeners
+- (void)observedEventsDidChange
+{
+    dispatch_block_t observedEventsChanged = self.observedEventsChanged;
+    if (observedEventsChanged && [JSEngine sharedInstance].jsThread) {
+        [[JSEngine sharedInstance] performBlock:observedEventsChanged
+                                       priority:JSTaskPriorityUserInteractive
+                                          label:"updateSubscriptions"];
+    }
+}
+
+- (NSArray<NSString *> *)observedEventNames
+{
+    NSMutableArray *names = [NSMutableArray array];
+    for (NSInteger event = 1; event < JSEventNumberOfEvents; event++) {
+        if ([self isEventObserved:event]) {
+            [names addObject:[PubSubService topicForEvent:event]];
+        }
+    }
+    return names;
+}
+
+- (uint64_t)deliveryStarted:(uint64_t)received
+{
+    uint64_t start = CKTMonotonicMicroseconds();
+    atomic_fetch_add_explicit(&_deliveries, 1, memory_order_relaxed);
+    @synchronized(self)
+    {
+        [self.latency recordValue:start - received];
+    }
+    return start;
+}
+
+- (void)deliveryEnded:(uint64_t)start onMainThread:(BOOL)mainThread
+{
+    if (!mainThread) {
+        return;
+    }
+
+    uint64_t time = CKTMonotonicMicroseconds() - start;
+    @synchronized(self)
+    {
+        [self.mainThreadTime recordValue:time];
+    }
+}
+
+@end
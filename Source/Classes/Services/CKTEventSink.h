@@ -0,0 +1,60 @@
+// Apache 2.0 License
+//
+// Copyright 2017 Unify Software and Solutions GmbH & Co.KG.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//  CKTEventSink.h
+//  CircuitSDK
+//
+//
+
+#import <Foundation/Foundation.h>
+
+// What happens when an event arrives while the buffer of a sink with a capacity is full. Only conversationUpdated,
+// itemUpdated, userPresenceChanged and userUpdated events give way, call, session and connection events are never
+// dropped: a buffer holding none of the former grows beyond its capacity.
+typedef NS_ENUM(NSInteger, CKTEventOverflowPolicy) {
+    CKTEventOverflowPolicyDropOldest,  // The oldest buffered update event is dropped
+    CKTEventOverflowPolicyCoalesce,    // A buffered event about the same user, item or conversation is replaced,
+                                       // the oldest update event is dropped if there is none
+};
+
+// Typed alternative to observing the CKTNotification* notifications, see -[CKTClient addEventSink:queue:].
+// Each method receives the same event object as the userInfo of the matching notification. Only the events whose
+// method is implemented are converted and delivered to the sink.
+@protocol CKTEventSink<NSObject>
+
+@optional
+
+- (void)basicSearchResults:(NSDictionary *)event;
+- (void)callEnded:(NSDictionary *)event;
+- (void)callIncoming:(NSDictionary *)event;
+- (void)callStatus:(NSDictionary *)event;
+- (void)connectionStateChanged:(NSDictionary *)event;
+- (void)conversationCreated:(NSDictionary *)event;
+- (void)conversationUpdated:(NSDictionary *)event;
+- (void)itemAdded:(NSDictionary *)event;
+- (void)itemUpdated:(NSDictionary *)event;
+- (void)reconnectFailed:(NSDictionary *)event;
+- (void)renewToken:(NSDictionary *)event;
+- (void)sessionExpires:(NSDictionary *)event;
+- (void)userPresenceChanged:(NSDictionary *)event;
+- (void)userSettingsChanged:(NSDictionary *)event;
+- (void)userUpdated:(NSDictionary *)event;
+
+// Called with the events of a batch when coalescing is enabled for their notification (see
+// -[CKTClient setEventCoalescingWindow:forNotification:]), instead of calling the method of each event
+- (void)coalescedEvents:(NSArray<NSDictionary *> *)events notification:(NSString *)name;
+
+@end
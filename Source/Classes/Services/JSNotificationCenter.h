@@ -54,6 +54,10 @@ extern NSString *const KEY_EVENT_DATA;
 extern NSString *const KEY_AUDIO_ACTIVATE;
 extern NSString *const KEY_CALL;
 extern NSString *const KEY_CALL_REPLACED;
+// Startup profile of the JS engine, sent with CKTNotificationApplicationServiceLoaded
+extern NSString *const KEY_STARTUP_PROFILE;
+// Events of a batch, sent instead of the event object when events are coalesced
+extern NSString *const CKTKeyEvents;
 
 @interface JSNotificationCenter : NSObject
 
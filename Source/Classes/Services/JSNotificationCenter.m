@@ -56,6 +56,8 @@ NSString *const KEY_EVENT_DATA = @"circuitkit.key.DATA";
 NSString *const KEY_AUDIO_ACTIVATE = @"circuitkit.key.AUDIO_ACTIVATE";
 NSString *const KEY_CALL = @"circuitkit.key.CALL";
 NSString *const KEY_CALL_REPLACED = @"circuitkit.key.REPLACED_CALL_FLAG";
+NSString *const KEY_STARTUP_PROFILE = @"circuitkit.key.STARTUP_PROFILE";
+NSString *const CKTKeyEvents = @"circuitkit.key.EVENTS";
 
 static NSString *LOG_TAG = @"[JSNotificationCenter]";
 
@@ -20,9 +20,14 @@
 //
 
 #import "CKTService.h"
+#import "PubSubEvents.h"
 
 @interface PubSubService : CKTService
 
+// Notification name of the event and back, JSEventUnknown if the name is not one of an event
++ (NSString *)topicForEvent:(JSEvent)event;
++ (JSEvent)eventForTopic:(NSString *)topic;
+
 - (NSInteger)subscribeAll;
 - (NSInteger)unsubscribeAll;
 
@@ -19,6 +19,8 @@
 //
 //
 
+#import "CKTEventDispatcher.h"
+#import "CKTHistogram.h"
 #import "CKTService.h"
 #import "JSEngine.h"
 #import "JSNotificationCenter.h"
@@ -32,10 +34,43 @@ typedef void (^EventCallbackZeroArg)(JSValue *value);
 typedef void (^EventCallbackOneArg)(JSValue *value);
 typedef void (^EventCallbackTwoArgs)(JSValue *value1, JSValue *value2);
 
+// Notification name of each JSEvent
+static NSArray<NSString *> *PubSubTopics(void)
+{
+    static NSArray *topics;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        topics = @[
+            @"UNKNOWN",
+            CKTNotificationBasicSearchResults,
+            CKTNotificationCallEnded,
+            CKTNotificationCallIncoming,
+            CKTNotificationCallStatus,
+            CKTNotificationConnectionStateChange,
+            CKTNotificationConversationCreated,
+            CKTNotificationConversationUpdated,
+            CKTNotificationItemAdded,
+            CKTNotificationItemUpdated,
+            CKTNotificationReconnectFailed,
+            CKTNotificationRenewToken,
+            CKTNotificationSessionExpires,
+            CKTNotificationUserPresenceChanged,
+            CKTNotificationUserSettingsChanged,
+            CKTNotificationUserUpdated
+        ];
+    });
+    return topics;
+}
+
 @interface PubSubService ()
 
 @property (nonatomic, strong) NSArray *eventCallbacks;
 
+// Bit per JSEvent with a listener in the JS SDK
+@property (nonatomic, assign) uint32_t subscribedEvents;
+// Cleared by unsubscribeAll, the service then ignores changes of the observed events
+@property (nonatomic, assign) BOOL active;
+
 @end
 
 @implementation PubSubService
@@ -53,7 +88,22 @@ static NSString *LOG_TAG = @"[PubSubService]";
     return self;
 }
 
-// Add event listener for all events in PubSubEvents.h
++ (NSString *)topicForEvent:(JSEvent)event
+{
+    if ((event > 0) && (event < JSEventNumberOfEvents)) {
+        return PubSubTopics()[event];
+    }
+    return nil;
+}
+
++ (JSEvent)eventForTopic:(NSString *)topic
+{
+    NSUInteger event = topic ? [PubSubTopics() indexOfObject:topic] : NSNotFound;
+    return (event != NSNotFound && event > 0) ? (JSEvent)event : JSEventUnknown;
+}
+
+// Add event listeners for the events in PubSubEvents.h which are observed (see CKTEventDispatcher), and keeps
+// adding and removing them as observers come and go
 - (NSInteger)subscribeAll
 {
     // This method should only be called on the js thread, assert if otherwise
@@ -62,9 +112,10 @@ static NSString *LOG_TAG = @"[PubSubService]";
 
     LOGD(LOG_TAG, @"subscribeAll");
 
-    for (NSInteger i = 1; i < JSEventNumberOfEvents; i++) {
-        [self subscribe:i];
-    }
+    self.active = YES;
+    __weak typeof(self) weakSelf = self;
+    [CKTEventDispatcher sharedInstance].observedEventsChanged = ^{ [weakSelf updateSubscriptions]; };
+    [self updateSubscriptions];
 
     return JSSuccess;
 }
@@ -72,9 +123,13 @@ static NSString *LOG_TAG = @"[PubSubService]";
 - (NSInteger)unsubscribeAll
 {
     LOGD(LOG_TAG, @"unsubscribeAll");
-    for (NSInteger i = 0; i < JSEventNumberOfEvents; i++) {
-        [self unsubscribe:i];
+    self.active = NO;
+    for (NSInteger i = 1; i < JSEventNumberOfEvents; i++) {
+        if (self.subscribedEvents & (1u << i)) {
+            [self unsubscribe:i];
+        }
     }
+    self.subscribedEvents = 0;
     return JSSuccess;
 }
 
@@ -82,12 +137,19 @@ static NSString *LOG_TAG = @"[PubSubService]";
 
 - (void)processReceivedEvent:(JSEvent)event data:(JSValue *)value
 {
+    uint64_t received = CKTMonotonicMicroseconds();
     NSString *notificationEvent = [self topicStringFromPublishedEvent:event];
     LOGI(LOG_TAG, @"processReceivedEvent (one argument) - received event (%@)", notificationEvent);
 
     // This method should only be called on the js thread, assert if otherwise.
     [self validateCurrentThread];
 
+    // Nobody would see the event, do not even convert it
+    if (![[CKTEventDispatcher sharedInstance] isEventObserved:event]) {
+        [[CKTEventDispatcher sharedInstance] skipEvent:event];
+        return;
+    }
+
     @try {
         NSDictionary *pubDict = @{ CKTKeyEmpty : @"" };
 
@@ -122,7 +184,7 @@ static NSString *LOG_TAG = @"[PubSubService]";
         }
 
         // Send the event to the other handlers and then send the notification
-        [self processEvent:event withData:data andNotification:notificationEvent];
+        [self processEvent:event withData:data andNotification:notificationEvent received:received];
     }
     @catch (NSException *exception)
     {
@@ -132,6 +194,27 @@ static NSString *LOG_TAG = @"[PubSubService]";
 
 #pragma mark - Internal methods
 
+// JS thread
+- (void)updateSubscriptions
+{
+    if (!self.active) {
+        return;
+    }
+
+    CKTEventDispatcher *dispatcher = [CKTEventDispatcher sharedInstance];
+    for (NSInteger i = 1; i < JSEventNumberOfEvents; i++) {
+        uint32_t bit = 1u << i;
+        BOOL observed = [dispatcher isEventObserved:i];
+        if (observed && !(self.subscribedEvents & bit)) {
+            [self subscribe:i];
+            self.subscribedEvents |= bit;
+        } else if (!observed && (self.subscribedEvents & bit)) {
+            [self unsubscribe:i];
+            self.subscribedEvents &= ~bit;
+        }
+    }
+}
+
 // Used when processing received events to validate the current thread is the jsThread
 - (void)validateCurrentThread
 {
@@ -156,8 +239,11 @@ static NSString *LOG_TAG = @"[PubSubService]";
 {
     NSString *eventTopic = [self topicStringFromPublishedEvent:event];
 
+    // Done right away on the JS thread so that no event of the old client gets through during a reset
     NSDictionary *dict = @{ @"topic" : eventTopic, @"callback" : self.eventCallbacks[event] };
-    [self executeAsync:@selector(unsubscribeInternal:) withObject:dict];
+    if (![self executeMyselfAsync:@selector(unsubscribeInternal:) withObject:dict]) {
+        [self unsubscribeInternal:dict];
+    }
 }
 
 - (void)unsubscribeInternal:(NSDictionary *)args
@@ -165,21 +251,34 @@ static NSString *LOG_TAG = @"[PubSubService]";
     [self callFunction:@"removeEventListener" withArguments:@[ args[@"topic"], args[@"callback"] ]];
 }
 
-- (void)processEvent:(JSEvent)event withData:(NSDictionary *)dict andNotification:(NSString *)notification
+- (void)processEvent:(JSEvent)event
+           withData:(NSDictionary *)dict
+    andNotification:(NSString *)notification
+           received:(uint64_t)received
 {
     if (notification) {
-        [[JSEngine sharedInstance] sendNotification:notification userInfo:dict];
+        [[CKTEventDispatcher sharedInstance] dispatchEvent:event
+                                                      name:notification
+                                                      data:dict
+                                                  received:received
+                                                 converted:CKTMonotonicMicroseconds()];
     }
 }
 
 - (void)processReceivedEvent:(JSEvent)event data1:(JSValue *)value1 data2:(JSValue *)value2
 {
+    uint64_t received = CKTMonotonicMicroseconds();
     NSString *notificationEvent = [self topicStringFromPublishedEvent:event];
     LOGI(LOG_TAG, @"processReceivedEvent (two arguments) - received event (%@)", notificationEvent);
 
     // This method should only be called on the js thread, assert if otherwise.
     [self validateCurrentThread];
 
+    if (![[CKTEventDispatcher sharedInstance] isEventObserved:event]) {
+        [[CKTEventDispatcher sharedInstance] skipEvent:event];
+        return;
+    }
+
     @try {
         id data1 = [value1 an_dataFromJSValue];
         id data2 = [value2 an_dataFromJSValue];
@@ -201,7 +300,7 @@ static NSString *LOG_TAG = @"[PubSubService]";
             pubDict = @{KEY_CALL : data1, KEY_CALL_REPLACED : callReplaced};
         }
         // Send the event to the other handlers and then send the notification
-        [self processEvent:event withData:pubDict andNotification:notificationEvent];
+        [self processEvent:event withData:pubDict andNotification:notificationEvent received:received];
     }
     @catch (NSException *exception)
     {
@@ -233,31 +332,8 @@ static NSString *LOG_TAG = @"[PubSubService]";
 
 - (NSString *)topicStringFromPublishedEvent:(JSEvent)publishedEvent
 {
-    static NSArray *topics;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        topics = @[
-            @"UNKNOWN",
-            CKTNotificationBasicSearchResults,
-            CKTNotificationCallEnded,
-            CKTNotificationCallIncoming,
-            CKTNotificationCallStatus,
-            CKTNotificationConnectionStateChange,
-            CKTNotificationConversationCreated,
-            CKTNotificationConversationUpdated,
-            CKTNotificationItemAdded,
-            CKTNotificationItemUpdated,
-            CKTNotificationReconnectFailed,
-            CKTNotificationRenewToken,
-            CKTNotificationSessionExpires,
-            CKTNotificationUserPresenceChanged,
-            CKTNotificationUserSettingsChanged,
-            CKTNotificationUserUpdated
-        ];
-    });
-
     if ((publishedEvent > 0) && (publishedEvent < JSEventNumberOfEvents)) {
-        return topics[publishedEvent];
+        return PubSubTopics()[publishedEvent];
     }
 
     LOGE(LOG_TAG, @"Invalid event id: %d", publishedEvent);